@@ -42,6 +42,24 @@ static bool create_pixel_pack_buffer(struct gs_stage_surface *surf)
 	return success;
 }
 
+static void delete_fence(struct gs_stage_surface *surf)
+{
+	if (surf->fence) {
+		glDeleteSync(surf->fence);
+		surf->fence = NULL;
+	}
+}
+
+/* Lets the caller find out when the transfer has finished without stalling
+ * on glMapBuffer. */
+static void insert_fence(struct gs_stage_surface *surf)
+{
+	delete_fence(surf);
+
+	surf->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl_success("glFenceSync");
+}
+
 gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width, uint32_t height,
 					   enum gs_color_format color_format)
 {
@@ -68,6 +86,8 @@ gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
 void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
 {
 	if (stagesurf) {
+		delete_fence(stagesurf);
+
 		if (stagesurf->pack_buffer)
 			gl_delete_buffers(1, &stagesurf->pack_buffer);
 
@@ -138,6 +158,7 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst, gs_texture_t
 	if (!gl_success("glReadPixels"))
 		goto failed_unbind_all;
 
+	insert_fence(dst);
 	success = true;
 
 failed_unbind_all:
@@ -170,6 +191,8 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst, gs_texture_t
 	if (!gl_success("glGetTexImage"))
 		goto failed;
 
+	insert_fence(dst);
+
 	gl_bind_texture(GL_TEXTURE_2D, 0);
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 	return;
@@ -199,8 +222,24 @@ enum gs_color_format gs_stagesurface_get_color_format(const gs_stagesurf_t *stag
 	return stagesurf->format;
 }
 
+bool gs_stagesurface_is_ready(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf->fence)
+		return true;
+
+	GLenum result = glClientWaitSync(stagesurf->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	/* Also treats GL_WAIT_FAILED as ready, mapping will wait if needed */
+	delete_fence(stagesurf);
+	return true;
+}
+
 bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data, uint32_t *linesize)
 {
+	delete_fence(stagesurf);
+
 	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, stagesurf->pack_buffer))
 		goto fail;
 
@@ -588,6 +588,20 @@ struct gs_stage_surface {
 	GLint gl_internal_format;
 	GLenum gl_type;
 	GLuint pack_buffer;
+	GLsync fence;
+};
+
+struct upload_fence {
+	GLsync sync;
+	uint64_t tag;
+};
+
+struct gs_upload_buffer {
+	gs_device_t *device;
+	GLuint buffer;
+	size_t size;
+	DARRAY(struct upload_fence) fences;
+	uint64_t signaled;
 };
 
 struct gs_zstencil_buffer {
@@ -0,0 +1,146 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ *   Persistently mapped pixel unpack buffers.  The mapping stays valid for
+ * the lifetime of the buffer and is coherent, so any thread can write into
+ * it while the graphics thread only issues texture uploads from offsets.
+ * Fences tagged by the caller tell when regions may be rewritten.
+ */
+
+#include "gl-subsystem.h"
+
+#define PERSISTENT_MAP_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+gs_upload_buffer_t *device_upload_buffer_create(gs_device_t *device, size_t size, uint8_t **map)
+{
+	struct gs_upload_buffer *buf;
+
+	if (!GLAD_GL_VERSION_4_4 && !GLAD_GL_ARB_buffer_storage)
+		return NULL;
+
+	buf = bzalloc(sizeof(struct gs_upload_buffer));
+	buf->device = device;
+	buf->size = size;
+
+	if (!gl_gen_buffers(1, &buf->buffer))
+		goto fail;
+	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, buf->buffer))
+		goto fail;
+
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, PERSISTENT_MAP_FLAGS);
+	if (!gl_success("glBufferStorage"))
+		goto fail_unbind;
+
+	*map = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, PERSISTENT_MAP_FLAGS);
+	if (!gl_success("glMapBufferRange") || !*map)
+		goto fail_unbind;
+
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return buf;
+
+fail_unbind:
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+fail:
+	blog(LOG_ERROR, "device_upload_buffer_create (GL) failed");
+	gs_upload_buffer_destroy(buf);
+	return NULL;
+}
+
+void gs_upload_buffer_destroy(gs_upload_buffer_t *buf)
+{
+	if (!buf)
+		return;
+
+	for (size_t i = 0; i < buf->fences.num; i++)
+		glDeleteSync(buf->fences.array[i].sync);
+	da_free(buf->fences);
+
+	if (buf->buffer) {
+		/* Deleting a buffer implicitly unmaps it */
+		gl_delete_buffers(1, &buf->buffer);
+	}
+
+	bfree(buf);
+}
+
+bool device_texture_set_image_from_buffer(gs_device_t *device, gs_texture_t *tex, gs_upload_buffer_t *buf,
+					  size_t offset, uint32_t linesize)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)tex;
+	const uint32_t bpp = gs_get_format_bpp(tex->format) / 8;
+	bool success = false;
+
+	if (tex->type != GS_TEXTURE_2D || !bpp || linesize % bpp != 0)
+		return false;
+	if (offset + (size_t)linesize * tex2d->height > buf->size)
+		return false;
+
+	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, buf->buffer))
+		goto fail;
+	if (!gl_bind_texture(GL_TEXTURE_2D, tex->texture))
+		goto fail;
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(linesize / bpp));
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex2d->width, tex2d->height, tex->gl_format, tex->gl_type,
+			(const void *)(uintptr_t)offset);
+	success = gl_success("glTexSubImage2D");
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+fail:
+	gl_bind_texture(GL_TEXTURE_2D, 0);
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (!success)
+		blog(LOG_ERROR, "device_texture_set_image_from_buffer (GL) failed");
+
+	UNUSED_PARAMETER(device);
+	return success;
+}
+
+void gs_upload_buffer_fence(gs_upload_buffer_t *buf, uint64_t tag)
+{
+	struct upload_fence fence;
+
+	fence.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (!gl_success("glFenceSync") || !fence.sync)
+		return;
+
+	fence.tag = tag;
+	da_push_back(buf->fences, &fence);
+}
+
+uint64_t gs_upload_buffer_poll(gs_upload_buffer_t *buf)
+{
+	size_t done = 0;
+
+	/* Fences complete in submission order, stop at the first pending one */
+	for (; done < buf->fences.num; done++) {
+		struct upload_fence *fence = &buf->fences.array[done];
+		GLenum result = glClientWaitSync(fence->sync, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+			break;
+
+		buf->signaled = fence->tag;
+		glDeleteSync(fence->sync);
+	}
+
+	if (done)
+		da_erase_range(buf->fences, 0, done);
+
+	return buf->signaled;
+}
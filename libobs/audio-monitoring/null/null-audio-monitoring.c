@@ -26,3 +26,9 @@ void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	UNUSED_PARAMETER(monitor);
 }
+
+bool obs_get_audio_monitoring_latency(uint64_t *latency_ns)
+{
+	UNUSED_PARAMETER(latency_ns);
+	return false;
+}
@@ -163,7 +163,13 @@ static bool audio_monitor_init(struct audio_monitor *monitor, obs_source_t *sour
 	monitor->source = source;
 
 	monitor->channels = channels;
-	monitor->buffer_size = channels * sizeof(float) * info->samples_per_sec / 100 * 3;
+	/* two audio ticks, but no more than 30 ms */
+	const uint32_t tick_frames = audio_output_get_frames(obs->audio.audio);
+	size_t buffer_frames = info->samples_per_sec / 100 * 3;
+	if (tick_frames * 2 < buffer_frames)
+		buffer_frames = tick_frames * 2;
+
+	monitor->buffer_size = channels * sizeof(float) * buffer_frames;
 	monitor->wait_size = monitor->buffer_size * 3;
 
 	pthread_mutex_init_value(&monitor->mutex);
@@ -323,3 +329,9 @@ void audio_monitor_destroy(struct audio_monitor *monitor)
 		bfree(monitor);
 	}
 }
+
+bool obs_get_audio_monitoring_latency(uint64_t *latency_ns)
+{
+	UNUSED_PARAMETER(latency_ns);
+	return false;
+}
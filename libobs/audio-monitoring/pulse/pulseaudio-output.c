@@ -1,30 +1,86 @@
 #include "obs-internal.h"
+#include "media-io/audio-dsp.h"
+#include "media-io/audio-ring.h"
 #include "pulseaudio-wrapper.h"
 
-#define PULSE_DATA(voidptr) struct audio_monitor *data = voidptr;
 #define blog(level, msg, ...) blog(level, "pulse-am: " msg, ##__VA_ARGS__)
 
-struct audio_monitor {
-	obs_source_t *source;
-	pa_stream *stream;
+/*
+ * All monitored sources are played through a single stream.  The capture
+ * callback of a source only copies its audio into a lock-free ring.  The
+ * mixer takes one audio tick from every ring, applies the volume, and then
+ * converts and writes the mix once.  It runs either on its own thread, paced
+ * by the clock, or in callback mode on the PulseAudio mainloop whenever the
+ * server asks for data, which is how JACK and PipeWire drive their clients.
+ */
+
+/* Audio a monitor can queue, and how far it may run ahead of the mixer
+ * before the excess is dropped */
+#define MONITOR_RING_MS 500
+#define MONITOR_MAX_DRIFT_MS 50
+
+struct audio_monitor;
+
+struct monitoring_mixer {
+	long refs;
+	char *device_id;
 	char *device;
+	bool callback_mode;
+
+	pa_stream *stream;
 	pa_buffer_attr attr;
-	enum speaker_layout speakers;
 	pa_sample_format_t format;
 	uint_fast32_t samples_per_sec;
 	uint_fast32_t bytes_per_frame;
 	uint_fast8_t channels;
 
+	/* format of the rings and the mix */
+	uint32_t obs_samples_per_sec;
+	enum speaker_layout obs_speakers;
+	size_t obs_channels;
+	uint32_t period;
+
+	pthread_mutex_t inputs_mutex;
+	DARRAY(struct audio_monitor *) inputs;
+
+	/* only used by whatever mixes: the mixer thread or the mainloop */
+	float *mix[MAX_AUDIO_CHANNELS];
+	float *input[MAX_AUDIO_CHANNELS];
+	audio_resampler_t *resampler;
+	struct deque new_data;
+	uint64_t latency_total;
+	uint64_t latency_max;
+	uint64_t mixes;
+
+	/* estimated end-to-end latency of the last mix in us, -1 if unknown */
+	volatile long latency;
+
+	pthread_t thread;
+	os_event_t *stop_event;
+	bool thread_active;
+};
+
+struct audio_monitor {
+	obs_source_t *source;
+	struct monitoring_mixer *mixer;
+	struct audio_ring *ring;
+
+	/* written by the capture callback */
+	volatile bool muted;
+	volatile long max_packet;
 	uint_fast32_t packets;
 	uint_fast64_t frames;
+	uint_fast64_t dropped;
 
-	struct deque new_data;
-	audio_resampler_t *resampler;
+	/* waiting for data again after running dry, mixer only */
+	bool buffering;
 
 	bool ignore;
-	pthread_mutex_t playback_mutex;
 };
 
+static struct monitoring_mixer *cur_mixer = NULL;
+static pthread_mutex_t mixer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static enum speaker_layout pulseaudio_channels_to_obs_speakers(uint_fast32_t channels)
 {
 	switch (channels) {
@@ -120,155 +176,213 @@ static pa_channel_map pulseaudio_channel_map(enum speaker_layout layout)
 	return ret;
 }
 
-static void process_byte(void *p, size_t frames, size_t channels, float vol)
-{
-	register uint8_t *cur = (uint8_t *)p;
-	register uint8_t *end = cur + frames * channels;
+/* ------------------------------------------------------------------------- */
+/* mixing */
 
-	for (; cur < end; cur++)
-		*cur = ((int)*cur - 128) * vol + 128;
+/* Frames a monitor has to queue before the mixer reads from it */
+static inline uint32_t monitor_target(const struct audio_monitor *monitor, uint32_t period)
+{
+	uint32_t packet = (uint32_t)os_atomic_load_long(&monitor->max_packet);
+	return period + (packet > period ? packet : period);
 }
 
-static void process_s16(void *p, size_t frames, size_t channels, float vol)
+/* Mixes one period of every input into mixer->mix, returns the largest
+ * amount of audio an input had queued */
+static uint32_t mix_inputs(struct monitoring_mixer *mixer)
 {
-	register int16_t *cur = (int16_t *)p;
-	register int16_t *end = cur + frames * channels;
+	const uint32_t period = mixer->period;
+	const uint32_t max_drift = (uint32_t)(mixer->obs_samples_per_sec * MONITOR_MAX_DRIFT_MS / 1000);
+	uint32_t max_queued = 0;
 
-	while (cur < end)
-		*(cur++) *= vol;
+	for (size_t ch = 0; ch < mixer->obs_channels; ch++)
+		memset(mixer->mix[ch], 0, period * sizeof(float));
+
+	pthread_mutex_lock(&mixer->inputs_mutex);
+
+	for (size_t i = 0; i < mixer->inputs.num; i++) {
+		struct audio_monitor *monitor = mixer->inputs.array[i];
+		uint32_t target = monitor_target(monitor, period);
+		uint32_t size = audio_ring_size(monitor->ring);
+
+		if (monitor->buffering) {
+			if (size < target)
+				continue;
+			monitor->buffering = false;
+		}
+
+		/* the source runs faster than the mixer */
+		if (size > target + max_drift) {
+			audio_ring_pop(monitor->ring, size - target);
+			size = target;
+		}
+
+		if (size > max_queued)
+			max_queued = size;
+
+		uint32_t frames = size < period ? size : period;
+		if (frames < period)
+			monitor->buffering = true;
+
+		if (frames && !os_atomic_load_bool(&monitor->muted)) {
+			float vol = monitor->source->user_volume;
+
+			audio_ring_peek(monitor->ring, mixer->input, mixer->obs_channels, frames);
+			for (size_t ch = 0; ch < mixer->obs_channels; ch++)
+				audio_dsp_mix(mixer->mix[ch], mixer->input[ch], vol, frames);
+		}
+
+		audio_ring_pop(monitor->ring, frames);
+		audio_ring_release(monitor->ring, 0);
+	}
+
+	pthread_mutex_unlock(&mixer->inputs_mutex);
+	return max_queued;
 }
 
-static void process_s32(void *p, size_t frames, size_t channels, float vol)
+static uint32_t mixer_mix(struct monitoring_mixer *mixer)
 {
-	register int32_t *cur = (int32_t *)p;
-	register int32_t *end = cur + frames * channels;
+	uint8_t *resample_data[MAX_AV_PLANES];
+	uint32_t resample_frames;
+	uint64_t ts_offset;
+	uint32_t queued = mix_inputs(mixer);
+
+	if (audio_resampler_resample(mixer->resampler, resample_data, &resample_frames, &ts_offset,
+				     (const uint8_t *const *)mixer->mix, mixer->period))
+		deque_push_back(&mixer->new_data, resample_data[0], mixer->bytes_per_frame * resample_frames);
 
-	while (cur < end)
-		*(cur++) *= vol;
+	return queued;
 }
 
-static void process_float(void *p, size_t frames, size_t channels, float vol)
+/* Called with the mainloop locked */
+static void mixer_write(struct monitoring_mixer *mixer, size_t max_bytes)
 {
-	register float *cur = (float *)p;
-	register float *end = cur + frames * channels;
+	size_t bytes = mixer->new_data.size < max_bytes ? mixer->new_data.size : max_bytes;
+	uint8_t *buffer = NULL;
 
-	while (cur < end)
-		*(cur++) *= vol;
+	bytes -= bytes % mixer->bytes_per_frame;
+
+	while (bytes > 0) {
+		size_t chunk = bytes;
+		if (pa_stream_begin_write(mixer->stream, (void **)&buffer, &chunk))
+			break;
+
+		chunk -= chunk % mixer->bytes_per_frame;
+		if (!chunk) {
+			pa_stream_cancel_write(mixer->stream);
+			break;
+		}
+		if (chunk > bytes)
+			chunk = bytes;
+
+		deque_pop_front(&mixer->new_data, buffer, chunk);
+		pa_stream_write(mixer->stream, buffer, chunk, NULL, 0LL, PA_SEEK_RELATIVE);
+		bytes -= chunk;
+	}
 }
 
-void process_volume(const struct audio_monitor *monitor, float vol, uint8_t *const *resample_data,
-		    uint32_t resample_frames)
+/* Called with the mainloop locked */
+static void mixer_update_latency(struct monitoring_mixer *mixer, uint32_t queued)
 {
-	switch (monitor->format) {
-	case PA_SAMPLE_U8:
-		process_byte(resample_data[0], resample_frames, monitor->channels, vol);
-		break;
-	case PA_SAMPLE_S16LE:
-		process_s16(resample_data[0], resample_frames, monitor->channels, vol);
-		break;
-	case PA_SAMPLE_S32LE:
-		process_s32(resample_data[0], resample_frames, monitor->channels, vol);
-		break;
-	case PA_SAMPLE_FLOAT32LE:
-		process_float(resample_data[0], resample_frames, monitor->channels, vol);
-		break;
-	default:
-		// just ignore
-		break;
-	}
+	pa_usec_t stream_usec;
+	int negative;
+
+	if (pa_stream_get_latency(mixer->stream, &stream_usec, &negative) != 0 || negative)
+		stream_usec = 0;
+
+	uint64_t pending = mixer->new_data.size / mixer->bytes_per_frame;
+	uint64_t latency = audio_frames_to_ns(mixer->obs_samples_per_sec, queued) +
+			   audio_frames_to_ns(mixer->samples_per_sec, pending) + stream_usec * 1000;
+
+	mixer->latency_total += latency;
+	if (latency > mixer->latency_max)
+		mixer->latency_max = latency;
+	mixer->mixes++;
+
+	os_atomic_set_long(&mixer->latency, (long)(latency / 1000));
 }
 
-static void do_stream_write(void *param)
+static void *mixer_thread(void *param)
 {
-	PULSE_DATA(param);
-	uint8_t *buffer = NULL;
+	struct monitoring_mixer *mixer = param;
+	const uint64_t period_ns = audio_frames_to_ns(mixer->obs_samples_per_sec, mixer->period);
+	uint64_t next_time = os_gettime_ns();
 
-	pulseaudio_lock();
-	pthread_mutex_lock(&data->playback_mutex);
-
-	// If we have grown a large buffer internally, grow the pulse buffer to match so we can write our data out.
-	if (data->new_data.size > data->attr.tlength * 2) {
-		data->attr.fragsize = (uint32_t)-1;
-		data->attr.maxlength = (uint32_t)-1;
-		data->attr.prebuf = (uint32_t)-1;
-		data->attr.minreq = (uint32_t)-1;
-		data->attr.tlength = data->new_data.size;
-		pa_stream_set_buffer_attr(data->stream, &data->attr, NULL, NULL);
-	}
+	os_set_thread_name("pulse-am: mixer");
+
+	while (os_event_try(mixer->stop_event) == EAGAIN) {
+		uint32_t queued = mixer_mix(mixer);
 
-	// Buffer up enough data before we start playing.
-	if (pa_stream_is_corked(data->stream)) {
-		if (data->new_data.size >= data->attr.tlength) {
-			pa_stream_cork(data->stream, 0, NULL, NULL);
-		} else {
-			goto finish;
+		pulseaudio_lock();
+
+		/* Buffer up enough data before we start playing. */
+		bool corked = pa_stream_is_corked(mixer->stream) == 1;
+		if (corked && mixer->new_data.size >= mixer->attr.tlength) {
+			pa_stream_cork(mixer->stream, 0, NULL, NULL);
+			corked = false;
 		}
-	}
 
-	while (data->new_data.size > 0) {
-		size_t bytesToFill = data->new_data.size;
-		if (pa_stream_begin_write(data->stream, (void **)&buffer, &bytesToFill))
-			goto finish;
+		if (!corked)
+			mixer_write(mixer, pa_stream_writable_size(mixer->stream));
 
-		// PA may request we submit more or less data than we have.
-		// Wait for more data if we cannot perform a full write.
-		if (bytesToFill > data->new_data.size) {
-			pa_stream_cancel_write(data->stream);
-			goto finish;
+		/* the server is not taking data, drop the oldest */
+		if (mixer->new_data.size > mixer->attr.tlength * 2) {
+			size_t excess = mixer->new_data.size - mixer->attr.tlength;
+			deque_pop_front(&mixer->new_data, NULL, excess - excess % mixer->bytes_per_frame);
 		}
 
-		deque_pop_front(&data->new_data, buffer, bytesToFill);
+		mixer_update_latency(mixer, queued);
+		pulseaudio_unlock();
 
-		pa_stream_write(data->stream, buffer, bytesToFill, NULL, 0LL, PA_SEEK_RELATIVE);
+		next_time += period_ns;
+		if (!os_sleepto_ns(next_time))
+			next_time = os_gettime_ns();
 	}
 
-finish:
-	pthread_mutex_unlock(&data->playback_mutex);
-	pulseaudio_unlock();
+	return NULL;
 }
 
-static void on_audio_playback(void *param, obs_source_t *source, const struct audio_data *audio_data, bool muted)
+/* Callback mode, runs on the mainloop */
+static void mixer_request(pa_stream *p, size_t nbytes, void *param)
 {
-	struct audio_monitor *monitor = param;
-	float vol = source->user_volume;
-	size_t bytes;
+	struct monitoring_mixer *mixer = param;
+	uint32_t queued = 0;
 
-	uint8_t *resample_data[MAX_AV_PLANES];
-	uint32_t resample_frames;
-	uint64_t ts_offset;
-	bool success;
+	UNUSED_PARAMETER(p);
 
-	if (pthread_mutex_trylock(&monitor->playback_mutex) != 0)
-		return;
+	while (mixer->new_data.size < nbytes) {
+		size_t size = mixer->new_data.size;
+		queued = mixer_mix(mixer);
+		if (mixer->new_data.size == size)
+			break;
+	}
 
-	if (os_atomic_load_long(&source->activate_refs) == 0)
-		goto unlock;
+	mixer_write(mixer, nbytes);
+	mixer_update_latency(mixer, queued);
+}
 
-	success = audio_resampler_resample(monitor->resampler, resample_data, &resample_frames, &ts_offset,
-					   (const uint8_t *const *)audio_data->data, (uint32_t)audio_data->frames);
+static void on_audio_playback(void *param, obs_source_t *source, const struct audio_data *audio_data, bool muted)
+{
+	struct audio_monitor *monitor = param;
+	uint32_t frames = (uint32_t)audio_data->frames;
 
-	if (!success)
-		goto unlock;
+	if (os_atomic_load_long(&source->activate_refs) == 0)
+		return;
 
-	bytes = monitor->bytes_per_frame * resample_frames;
+	os_atomic_set_bool(&monitor->muted, muted);
+	if ((long)frames > os_atomic_load_long(&monitor->max_packet))
+		os_atomic_set_long(&monitor->max_packet, (long)frames);
 
-	if (muted) {
-		memset(resample_data[0], 0, bytes);
+	if (audio_ring_push_back(monitor->ring, (const uint8_t *const *)audio_data->data, frames)) {
+		monitor->packets++;
+		monitor->frames += frames;
 	} else {
-		if (!close_float(vol, 1.0f, EPSILON)) {
-			process_volume(monitor, vol, resample_data, resample_frames);
-		}
+		monitor->dropped += frames;
 	}
-
-	deque_push_back(&monitor->new_data, resample_data[0], bytes);
-	monitor->packets++;
-	monitor->frames += resample_frames;
-
-unlock:
-	pthread_mutex_unlock(&monitor->playback_mutex);
-	do_stream_write(param);
 }
 
+/* ------------------------------------------------------------------------- */
+/* mixer */
+
 static void pulseaudio_server_info(pa_context *c, const pa_server_info *i, void *userdata)
 {
 	UNUSED_PARAMETER(c);
@@ -282,7 +396,7 @@ static void pulseaudio_server_info(pa_context *c, const pa_server_info *i, void
 static void pulseaudio_sink_info(pa_context *c, const pa_sink_info *i, int eol, void *userdata)
 {
 	UNUSED_PARAMETER(c);
-	PULSE_DATA(userdata);
+	struct monitoring_mixer *data = userdata;
 	// An error occurred
 	if (eol < 0) {
 		data->format = PA_SAMPLE_INVALID;
@@ -322,139 +436,290 @@ skip:
 	pulseaudio_signal(0);
 }
 
-static void pulseaudio_stop_playback(struct audio_monitor *monitor)
+static void pulseaudio_stop_playback(struct monitoring_mixer *mixer)
 {
-	if (monitor->stream) {
-		/* Stop the stream */
-		pulseaudio_lock();
-		pa_stream_disconnect(monitor->stream);
-		pulseaudio_unlock();
-
-		/* Remove the callbacks, to ensure we no longer try to do anything
-		 * with this stream object */
-		pulseaudio_write_callback(monitor->stream, NULL, NULL);
+	/* Stop the stream */
+	pulseaudio_lock();
+	pa_stream_disconnect(mixer->stream);
+	pulseaudio_unlock();
 
-		/* Unreference the stream and drop it. PA will free it when it can. */
-		pulseaudio_lock();
-		pa_stream_unref(monitor->stream);
-		pulseaudio_unlock();
-		monitor->stream = NULL;
-	}
+	/* Remove the callbacks, to ensure we no longer try to do anything
+	 * with this stream object */
+	pulseaudio_write_callback(mixer->stream, NULL, NULL);
 
-	blog(LOG_INFO, "Stopped Monitoring in '%s'", monitor->device);
-	blog(LOG_INFO, "Got %" PRIuFAST32 " packets with %" PRIuFAST64 " frames", monitor->packets, monitor->frames);
+	/* Unreference the stream and drop it. PA will free it when it can. */
+	pulseaudio_lock();
+	pa_stream_unref(mixer->stream);
+	pulseaudio_unlock();
+	mixer->stream = NULL;
 
-	monitor->packets = 0;
-	monitor->frames = 0;
+	blog(LOG_INFO, "Stopped Monitoring in '%s'", mixer->device);
+	if (mixer->mixes)
+		blog(LOG_INFO, "Monitoring latency: %.1f ms average, %.1f ms worst",
+		     (double)mixer->latency_total / (double)mixer->mixes / 1000000.0,
+		     (double)mixer->latency_max / 1000000.0);
 }
 
-static bool audio_monitor_init(struct audio_monitor *monitor, obs_source_t *source)
+static void monitoring_mixer_destroy(struct monitoring_mixer *mixer)
 {
-	pthread_mutex_init_value(&monitor->playback_mutex);
+	if (mixer->thread_active) {
+		os_event_signal(mixer->stop_event);
+		pthread_join(mixer->thread, NULL);
+	}
 
-	monitor->source = source;
+	if (mixer->stream)
+		pulseaudio_stop_playback(mixer);
+	pulseaudio_unref();
 
-	const char *id = obs->audio.monitoring_device_id;
-	if (!id)
-		return false;
+	os_event_destroy(mixer->stop_event);
+	audio_resampler_destroy(mixer->resampler);
+	deque_free(&mixer->new_data);
+	bfree(mixer->mix[0]);
+	bfree(mixer->input[0]);
+	da_free(mixer->inputs);
+	pthread_mutex_destroy(&mixer->inputs_mutex);
+	bfree(mixer->device);
+	bfree(mixer->device_id);
+	bfree(mixer);
+}
 
-	if (source->info.output_flags & OBS_SOURCE_DO_NOT_SELF_MONITOR) {
-		obs_data_t *s = obs_source_get_settings(source);
-		const char *s_dev_id = obs_data_get_string(s, "device_id");
-		bool match = devices_match(s_dev_id, id);
-		obs_data_release(s);
+static struct monitoring_mixer *monitoring_mixer_create(const char *id, bool callback_mode)
+{
+	struct monitoring_mixer *mixer = bzalloc(sizeof(struct monitoring_mixer));
+	const struct audio_output_info *info = audio_output_get_info(obs->audio.audio);
 
-		if (match) {
-			monitor->ignore = true;
-			blog(LOG_INFO, "Prevented feedback-loop in '%s'", s_dev_id);
-			return true;
-		}
-	}
+	pthread_mutex_init_value(&mixer->inputs_mutex);
+	mixer->refs = 1;
+	mixer->device_id = bstrdup(id);
+	mixer->callback_mode = callback_mode;
+	mixer->latency = -1;
 
 	pulseaudio_init();
 
+	if (pthread_mutex_init(&mixer->inputs_mutex, NULL) != 0)
+		goto fail;
+
 	if (strcmp(id, "default") == 0)
-		get_default_id(&monitor->device);
+		get_default_id(&mixer->device);
 	else
-		monitor->device = bstrdup(id);
+		mixer->device = bstrdup(id);
 
-	if (!monitor->device)
-		return false;
+	if (!mixer->device)
+		goto fail;
 
-	if (pulseaudio_get_server_info(pulseaudio_server_info, (void *)monitor) < 0) {
+	if (pulseaudio_get_server_info(pulseaudio_server_info, (void *)mixer) < 0) {
 		blog(LOG_ERROR, "Unable to get server info !");
-		return false;
+		goto fail;
 	}
 
-	if (pulseaudio_get_sink_info(pulseaudio_sink_info, monitor->device, (void *)monitor) < 0) {
+	if (pulseaudio_get_sink_info(pulseaudio_sink_info, mixer->device, (void *)mixer) < 0) {
 		blog(LOG_ERROR, "Unable to get sink info !");
-		return false;
+		goto fail;
 	}
-	if (monitor->format == PA_SAMPLE_INVALID) {
+	if (mixer->format == PA_SAMPLE_INVALID) {
 		blog(LOG_ERROR, "An error occurred while getting the source info!");
-		return false;
+		goto fail;
 	}
 
 	pa_sample_spec spec;
-	spec.format = monitor->format;
-	spec.rate = (uint32_t)monitor->samples_per_sec;
-	spec.channels = monitor->channels;
+	spec.format = mixer->format;
+	spec.rate = (uint32_t)mixer->samples_per_sec;
+	spec.channels = mixer->channels;
 
 	if (!pa_sample_spec_valid(&spec)) {
 		blog(LOG_ERROR, "Sample spec is not valid");
-		return false;
+		goto fail;
 	}
 
-	const struct audio_output_info *info = audio_output_get_info(obs->audio.audio);
+	mixer->obs_samples_per_sec = info->samples_per_sec;
+	mixer->obs_speakers = info->speakers;
+	mixer->obs_channels = get_audio_channels(info->speakers);
+	mixer->period = audio_output_get_frames(obs->audio.audio);
 
 	struct resample_info from = {.samples_per_sec = info->samples_per_sec,
 				     .speakers = info->speakers,
 				     .format = AUDIO_FORMAT_FLOAT_PLANAR};
-	struct resample_info to = {.samples_per_sec = (uint32_t)monitor->samples_per_sec,
-				   .speakers = pulseaudio_channels_to_obs_speakers(monitor->channels),
-				   .format = pulseaudio_to_obs_audio_format(monitor->format)};
+	struct resample_info to = {.samples_per_sec = (uint32_t)mixer->samples_per_sec,
+				   .speakers = pulseaudio_channels_to_obs_speakers(mixer->channels),
+				   .format = pulseaudio_to_obs_audio_format(mixer->format)};
 
-	monitor->resampler = audio_resampler_create(&to, &from);
-	if (!monitor->resampler) {
+	mixer->resampler = audio_resampler_create(&to, &from);
+	if (!mixer->resampler) {
 		blog(LOG_WARNING, "%s: %s", __FUNCTION__, "Failed to create resampler");
-		return false;
+		goto fail;
+	}
+
+	mixer->mix[0] = bzalloc(mixer->period * mixer->obs_channels * sizeof(float));
+	mixer->input[0] = bzalloc(mixer->period * mixer->obs_channels * sizeof(float));
+	for (size_t ch = 1; ch < mixer->obs_channels; ch++) {
+		mixer->mix[ch] = mixer->mix[ch - 1] + mixer->period;
+		mixer->input[ch] = mixer->input[ch - 1] + mixer->period;
 	}
 
-	monitor->speakers = pulseaudio_channels_to_obs_speakers(spec.channels);
-	monitor->bytes_per_frame = pa_frame_size(&spec);
+	mixer->bytes_per_frame = pa_frame_size(&spec);
 
-	pa_channel_map channel_map = pulseaudio_channel_map(monitor->speakers);
+	pa_channel_map channel_map = pulseaudio_channel_map(to.speakers);
 
-	monitor->stream = pulseaudio_stream_new(obs_source_get_name(monitor->source), &spec, &channel_map);
-	if (!monitor->stream) {
+	mixer->stream = pulseaudio_stream_new("OBS Audio Monitoring", &spec, &channel_map);
+	if (!mixer->stream) {
 		blog(LOG_ERROR, "Unable to create stream");
-		return false;
+		goto fail;
 	}
 
-	monitor->attr.fragsize = (uint32_t)-1;
-	monitor->attr.maxlength = (uint32_t)-1;
-	monitor->attr.minreq = (uint32_t)-1;
-	monitor->attr.prebuf = (uint32_t)-1;
-	monitor->attr.tlength = pa_usec_to_bytes(25000, &spec);
+	mixer->attr.fragsize = (uint32_t)-1;
+	mixer->attr.maxlength = (uint32_t)-1;
+	mixer->attr.minreq = (uint32_t)-1;
+	mixer->attr.prebuf = (uint32_t)-1;
+	/* two audio ticks, but no more than 25 ms */
+	pa_usec_t tick_usec = audio_frames_to_ns(info->samples_per_sec, mixer->period) / 1000;
+	mixer->attr.tlength = pa_usec_to_bytes(tick_usec * 2 < 25000 ? tick_usec * 2 : 25000, &spec);
 
-	pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE | PA_STREAM_START_CORKED;
+	pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE;
 
-	int_fast32_t ret = pulseaudio_connect_playback(monitor->stream, monitor->device, &monitor->attr, flags);
+	if (callback_mode) {
+		/* the server pulls data as soon as the stream is ready */
+		pulseaudio_write_callback(mixer->stream, mixer_request, mixer);
+	} else {
+		flags |= PA_STREAM_START_CORKED;
+	}
+
+	int_fast32_t ret = pulseaudio_connect_playback(mixer->stream, mixer->device, &mixer->attr, flags);
 	if (ret < 0) {
-		pulseaudio_stop_playback(monitor);
+		pulseaudio_stop_playback(mixer);
 		blog(LOG_ERROR, "Unable to connect to stream");
+		goto fail;
+	}
+
+	if (!callback_mode) {
+		if (os_event_init(&mixer->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+			goto fail;
+		if (pthread_create(&mixer->thread, NULL, mixer_thread, mixer) != 0) {
+			blog(LOG_ERROR, "Failed to create mixer thread");
+			goto fail;
+		}
+		mixer->thread_active = true;
+	}
+
+	blog(LOG_INFO, "Started Monitoring in '%s' (%s mode)", mixer->device, callback_mode ? "callback" : "thread");
+	return mixer;
+
+fail:
+	monitoring_mixer_destroy(mixer);
+	return NULL;
+}
+
+static bool monitoring_mixer_usable(struct monitoring_mixer *mixer, const char *id)
+{
+	const struct audio_output_info *info = audio_output_get_info(obs->audio.audio);
+	bool usable;
+
+	if (strcmp(mixer->device_id, id) != 0 || mixer->callback_mode != obs->audio.monitoring_callback_mode)
+		return false;
+	if (mixer->obs_samples_per_sec != info->samples_per_sec || mixer->obs_speakers != info->speakers ||
+	    mixer->period != audio_output_get_frames(obs->audio.audio))
 		return false;
+
+	/* recreate the stream if the server went away */
+	pulseaudio_lock();
+	usable = PA_STREAM_IS_GOOD(pa_stream_get_state(mixer->stream));
+	pulseaudio_unlock();
+
+	return usable;
+}
+
+/* Shares the mixer of the current device; an old mixer stays around until
+ * the last monitor using it is reset */
+static struct monitoring_mixer *monitoring_mixer_get(const char *id)
+{
+	struct monitoring_mixer *mixer;
+
+	pthread_mutex_lock(&mixer_mutex);
+
+	if (cur_mixer && monitoring_mixer_usable(cur_mixer, id)) {
+		mixer = cur_mixer;
+		mixer->refs++;
+	} else {
+		mixer = monitoring_mixer_create(id, obs->audio.monitoring_callback_mode);
+		if (mixer)
+			cur_mixer = mixer;
+	}
+
+	pthread_mutex_unlock(&mixer_mutex);
+	return mixer;
+}
+
+static void monitoring_mixer_release(struct monitoring_mixer *mixer)
+{
+	pthread_mutex_lock(&mixer_mutex);
+
+	if (--mixer->refs == 0) {
+		if (cur_mixer == mixer)
+			cur_mixer = NULL;
+		monitoring_mixer_destroy(mixer);
 	}
 
-	blog(LOG_INFO, "Started Monitoring in '%s'", monitor->device);
+	pthread_mutex_unlock(&mixer_mutex);
+}
+
+bool obs_get_audio_monitoring_latency(uint64_t *latency_ns)
+{
+	long latency = -1;
+
+	pthread_mutex_lock(&mixer_mutex);
+	if (cur_mixer)
+		latency = os_atomic_load_long(&cur_mixer->latency);
+	pthread_mutex_unlock(&mixer_mutex);
+
+	if (latency < 0)
+		return false;
+
+	*latency_ns = (uint64_t)latency * 1000;
 	return true;
 }
 
+/* ------------------------------------------------------------------------- */
+/* monitors */
+
+static bool audio_monitor_init(struct audio_monitor *monitor, obs_source_t *source)
+{
+	monitor->source = source;
+
+	const char *id = obs->audio.monitoring_device_id;
+	if (!id)
+		return false;
+
+	if (source->info.output_flags & OBS_SOURCE_DO_NOT_SELF_MONITOR) {
+		obs_data_t *s = obs_source_get_settings(source);
+		const char *s_dev_id = obs_data_get_string(s, "device_id");
+		bool match = devices_match(s_dev_id, id);
+		obs_data_release(s);
+
+		if (match) {
+			monitor->ignore = true;
+			blog(LOG_INFO, "Prevented feedback-loop in '%s'", s_dev_id);
+			return true;
+		}
+	}
+
+	monitor->mixer = monitoring_mixer_get(id);
+	if (!monitor->mixer)
+		return false;
+
+	uint32_t frames = monitor->mixer->obs_samples_per_sec * MONITOR_RING_MS / 1000;
+	monitor->ring = audio_ring_create(monitor->mixer->obs_channels, frames);
+	monitor->buffering = true;
+	return monitor->ring != NULL;
+}
+
 static void audio_monitor_init_final(struct audio_monitor *monitor)
 {
 	if (monitor->ignore)
 		return;
 
+	pthread_mutex_lock(&monitor->mixer->inputs_mutex);
+	da_push_back(monitor->mixer->inputs, &monitor);
+	pthread_mutex_unlock(&monitor->mixer->inputs_mutex);
+
 	obs_source_add_audio_capture_callback(monitor->source, on_audio_playback, monitor);
 }
 
@@ -466,14 +731,21 @@ static inline void audio_monitor_free(struct audio_monitor *monitor)
 	if (monitor->source)
 		obs_source_remove_audio_capture_callback(monitor->source, on_audio_playback, monitor);
 
-	audio_resampler_destroy(monitor->resampler);
-	deque_free(&monitor->new_data);
+	if (monitor->mixer) {
+		pthread_mutex_lock(&monitor->mixer->inputs_mutex);
+		da_erase_item(monitor->mixer->inputs, &monitor);
+		pthread_mutex_unlock(&monitor->mixer->inputs_mutex);
 
-	if (monitor->stream)
-		pulseaudio_stop_playback(monitor);
-	pulseaudio_unref();
+		monitoring_mixer_release(monitor->mixer);
+		monitor->mixer = NULL;
+	}
 
-	bfree(monitor->device);
+	audio_ring_destroy(monitor->ring);
+	monitor->ring = NULL;
+
+	if (monitor->packets)
+		blog(LOG_INFO, "Got %" PRIuFAST32 " packets with %" PRIuFAST64 " frames (%" PRIuFAST64 " dropped)",
+		     monitor->packets, monitor->frames, monitor->dropped);
 }
 
 struct audio_monitor *audio_monitor_create(obs_source_t *source)
@@ -501,18 +773,15 @@ fail:
 void audio_monitor_reset(struct audio_monitor *monitor)
 {
 	struct audio_monitor new_monitor = {0};
-	bool success;
-	audio_monitor_free(monitor);
 
-	pthread_mutex_lock(&monitor->playback_mutex);
-	success = audio_monitor_init(&new_monitor, monitor->source);
-	pthread_mutex_unlock(&monitor->playback_mutex);
+	audio_monitor_free(monitor);
 
-	if (success) {
+	if (audio_monitor_init(&new_monitor, monitor->source)) {
 		*monitor = new_monitor;
 		audio_monitor_init_final(monitor);
 	} else {
 		audio_monitor_free(&new_monitor);
+		monitor->ignore = true;
 	}
 }
 
@@ -3,6 +3,7 @@ find_package(X11 REQUIRED)
 find_package(X11-xcb REQUIRED)
 find_package(Xcb REQUIRED xcb OPTIONAL_COMPONENTS xcb-xinput)
 find_package(Gio)
+find_package(Liburing)
 
 target_sources(
   libobs
@@ -80,6 +81,14 @@ if(TARGET gio::gio)
   target_link_libraries(libobs PRIVATE gio::gio)
 endif()
 
+if(TARGET Liburing::Liburing)
+  target_compile_definitions(libobs PRIVATE HAVE_LIBURING)
+  target_link_libraries(libobs PRIVATE Liburing::Liburing)
+  target_enable_feature(libobs "io_uring direct I/O file writer (Linux)")
+else()
+  target_disable_feature(libobs "io_uring direct I/O file writer (Linux)")
+endif()
+
 if(ENABLE_WAYLAND)
   find_package(Wayland REQUIRED Client)
   find_package(Xkbcommon REQUIRED)
@@ -128,6 +128,9 @@ EXPORT bool device_is_monitor_hdr(gs_device_t *device, void *monitor);
 EXPORT bool device_shared_texture_available(void);
 EXPORT bool device_nv12_available(gs_device_t *device);
 EXPORT bool device_p010_available(gs_device_t *device);
+EXPORT gs_upload_buffer_t *device_upload_buffer_create(gs_device_t *device, size_t size, uint8_t **map);
+EXPORT bool device_texture_set_image_from_buffer(gs_device_t *device, gs_texture_t *tex, gs_upload_buffer_t *buf,
+						 size_t offset, uint32_t linesize);
 
 #ifdef __APPLE__
 EXPORT gs_texture_t *device_texture_create_from_iosurface(gs_device_t *device, void *iosurf);
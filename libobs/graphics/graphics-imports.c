@@ -146,6 +146,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module, const char
 	GRAPHICS_IMPORT(gs_stagesurface_get_color_format);
 	GRAPHICS_IMPORT(gs_stagesurface_map);
 	GRAPHICS_IMPORT(gs_stagesurface_unmap);
+	GRAPHICS_IMPORT_OPTIONAL(gs_stagesurface_is_ready);
 
 	GRAPHICS_IMPORT(gs_zstencil_destroy);
 
@@ -199,6 +200,12 @@ bool load_graphics_imports(struct gs_exports *exports, void *module, const char
 
 	GRAPHICS_IMPORT(device_is_monitor_hdr);
 
+	GRAPHICS_IMPORT_OPTIONAL(device_upload_buffer_create);
+	GRAPHICS_IMPORT_OPTIONAL(gs_upload_buffer_destroy);
+	GRAPHICS_IMPORT_OPTIONAL(device_texture_set_image_from_buffer);
+	GRAPHICS_IMPORT_OPTIONAL(gs_upload_buffer_fence);
+	GRAPHICS_IMPORT_OPTIONAL(gs_upload_buffer_poll);
+
 	GRAPHICS_IMPORT(device_debug_marker_begin);
 	GRAPHICS_IMPORT(device_debug_marker_end);
 
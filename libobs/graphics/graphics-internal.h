@@ -150,6 +150,7 @@ struct gs_exports {
 	enum gs_color_format (*gs_stagesurface_get_color_format)(const gs_stagesurf_t *stagesurf);
 	bool (*gs_stagesurface_map)(gs_stagesurf_t *stagesurf, uint8_t **data, uint32_t *linesize);
 	void (*gs_stagesurface_unmap)(gs_stagesurf_t *stagesurf);
+	bool (*gs_stagesurface_is_ready)(gs_stagesurf_t *stagesurf);
 
 	void (*gs_zstencil_destroy)(gs_zstencil_t *zstencil);
 
@@ -205,6 +206,13 @@ struct gs_exports {
 
 	bool (*device_is_monitor_hdr)(gs_device_t *device, void *monitor);
 
+	gs_upload_buffer_t *(*device_upload_buffer_create)(gs_device_t *device, size_t size, uint8_t **map);
+	void (*gs_upload_buffer_destroy)(gs_upload_buffer_t *buf);
+	bool (*device_texture_set_image_from_buffer)(gs_device_t *device, gs_texture_t *tex, gs_upload_buffer_t *buf,
+						     size_t offset, uint32_t linesize);
+	void (*gs_upload_buffer_fence)(gs_upload_buffer_t *buf, uint64_t tag);
+	uint64_t (*gs_upload_buffer_poll)(gs_upload_buffer_t *buf);
+
 	void (*device_debug_marker_begin)(gs_device_t *device, const char *markername, const float color[4]);
 	void (*device_debug_marker_end)(gs_device_t *device);
 
@@ -276,6 +284,12 @@ struct blend_state {
 	enum gs_blend_op_type op;
 };
 
+struct sprite_rect {
+	float cx, cy;
+	float start_u, end_u;
+	float start_v, end_v;
+};
+
 struct graphics_subsystem {
 	void *module;
 	gs_device_t *device;
@@ -290,6 +304,9 @@ struct graphics_subsystem {
 	struct gs_effect *cur_effect;
 
 	gs_vertbuffer_t *sprite_buffer;
+	struct sprite_rect sprite_rect;
+	bool sprite_rect_valid;
+	gs_vertbuffer_t *sprite_batch_buffer;
 
 	bool using_immediate;
 	struct gs_vb_data *vbd;
@@ -228,6 +228,8 @@ void gs_destroy(graphics_t *graphics)
 		}
 
 		graphics->exports.gs_vertexbuffer_destroy(graphics->sprite_buffer);
+		if (graphics->sprite_batch_buffer)
+			graphics->exports.gs_vertexbuffer_destroy(graphics->sprite_batch_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(graphics->immediate_vertbuffer);
 		graphics->exports.device_destroy(graphics->device);
 
@@ -916,100 +918,113 @@ static inline void assign_sprite_uv(float *start, float *end, bool flip)
 	}
 }
 
-static void build_sprite(struct gs_vb_data *data, float fcx, float fcy, float start_u, float end_u, float start_v,
-			 float end_v)
+static inline void build_sprite_norm(struct sprite_rect *rect, float fcx, float fcy, uint32_t flip)
 {
-	struct vec2 *tvarray = data->tvarray[0].array;
-
-	vec3_zero(data->points);
-	vec3_set(data->points + 1, fcx, 0.0f, 0.0f);
-	vec3_set(data->points + 2, 0.0f, fcy, 0.0f);
-	vec3_set(data->points + 3, fcx, fcy, 0.0f);
-	vec2_set(tvarray, start_u, start_v);
-	vec2_set(tvarray + 1, end_u, start_v);
-	vec2_set(tvarray + 2, start_u, end_v);
-	vec2_set(tvarray + 3, end_u, end_v);
+	rect->cx = fcx;
+	rect->cy = fcy;
+	assign_sprite_uv(&rect->start_u, &rect->end_u, (flip & GS_FLIP_U) != 0);
+	assign_sprite_uv(&rect->start_v, &rect->end_v, (flip & GS_FLIP_V) != 0);
 }
 
-static inline void build_sprite_norm(struct gs_vb_data *data, float fcx, float fcy, uint32_t flip)
-{
-	float start_u, end_u;
-	float start_v, end_v;
-
-	assign_sprite_uv(&start_u, &end_u, (flip & GS_FLIP_U) != 0);
-	assign_sprite_uv(&start_v, &end_v, (flip & GS_FLIP_V) != 0);
-	build_sprite(data, fcx, fcy, start_u, end_u, start_v, end_v);
-}
-
-static inline void build_subsprite_norm(struct gs_vb_data *data, float fsub_x, float fsub_y, float fsub_cx,
+static inline void build_subsprite_norm(struct sprite_rect *rect, float fsub_x, float fsub_y, float fsub_cx,
 					float fsub_cy, float fcx, float fcy, uint32_t flip)
 {
-	float start_u, end_u;
-	float start_v, end_v;
+	rect->cx = fsub_cx;
+	rect->cy = fsub_cy;
 
 	if ((flip & GS_FLIP_U) == 0) {
-		start_u = fsub_x / fcx;
-		end_u = (fsub_x + fsub_cx) / fcx;
+		rect->start_u = fsub_x / fcx;
+		rect->end_u = (fsub_x + fsub_cx) / fcx;
 	} else {
-		start_u = (fsub_x + fsub_cx) / fcx;
-		end_u = fsub_x / fcx;
+		rect->start_u = (fsub_x + fsub_cx) / fcx;
+		rect->end_u = fsub_x / fcx;
 	}
 
 	if ((flip & GS_FLIP_V) == 0) {
-		start_v = fsub_y / fcy;
-		end_v = (fsub_y + fsub_cy) / fcy;
+		rect->start_v = fsub_y / fcy;
+		rect->end_v = (fsub_y + fsub_cy) / fcy;
 	} else {
-		start_v = (fsub_y + fsub_cy) / fcy;
-		end_v = fsub_y / fcy;
+		rect->start_v = (fsub_y + fsub_cy) / fcy;
+		rect->end_v = fsub_y / fcy;
 	}
-
-	build_sprite(data, fsub_cx, fsub_cy, start_u, end_u, start_v, end_v);
 }
 
-static inline void build_sprite_rect(struct gs_vb_data *data, gs_texture_t *tex, float fcx, float fcy, uint32_t flip)
+static inline void build_sprite_rect(struct sprite_rect *rect, gs_texture_t *tex, float fcx, float fcy, uint32_t flip)
 {
-	float start_u, end_u;
-	float start_v, end_v;
 	float width = (float)gs_texture_get_width(tex);
 	float height = (float)gs_texture_get_height(tex);
 
-	assign_sprite_rect(&start_u, &end_u, width, (flip & GS_FLIP_U) != 0);
-	assign_sprite_rect(&start_v, &end_v, height, (flip & GS_FLIP_V) != 0);
-	build_sprite(data, fcx, fcy, start_u, end_u, start_v, end_v);
+	rect->cx = fcx;
+	rect->cy = fcy;
+	assign_sprite_rect(&rect->start_u, &rect->end_u, width, (flip & GS_FLIP_U) != 0);
+	assign_sprite_rect(&rect->start_v, &rect->end_v, height, (flip & GS_FLIP_V) != 0);
 }
 
-void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height)
+static inline void build_sprite(struct vec3 *points, struct vec2 *tvarray, const struct sprite_rect *rect)
 {
-	graphics_t *graphics = thread_graphics;
-	float fcx, fcy;
-	struct gs_vb_data *data;
+	vec3_zero(points);
+	vec3_set(points + 1, rect->cx, 0.0f, 0.0f);
+	vec3_set(points + 2, 0.0f, rect->cy, 0.0f);
+	vec3_set(points + 3, rect->cx, rect->cy, 0.0f);
+	vec2_set(tvarray, rect->start_u, rect->start_v);
+	vec2_set(tvarray + 1, rect->end_u, rect->start_v);
+	vec2_set(tvarray + 2, rect->start_u, rect->end_v);
+	vec2_set(tvarray + 3, rect->end_u, rect->end_v);
+}
 
+static bool build_sprite_params(struct sprite_rect *rect, gs_texture_t *tex, uint32_t flip, uint32_t width,
+				uint32_t height)
+{
 	if (tex) {
 		if (gs_get_texture_type(tex) != GS_TEXTURE_2D) {
 			blog(LOG_ERROR, "A sprite must be a 2D texture");
-			return;
+			return false;
 		}
 	} else {
 		if (!width || !height) {
 			blog(LOG_ERROR, "A sprite cannot be drawn without "
 					"a width/height");
-			return;
+			return false;
 		}
 	}
 
-	fcx = width ? (float)width : (float)gs_texture_get_width(tex);
-	fcy = height ? (float)height : (float)gs_texture_get_height(tex);
+	float fcx = width ? (float)width : (float)gs_texture_get_width(tex);
+	float fcy = height ? (float)height : (float)gs_texture_get_height(tex);
 
-	data = gs_vertexbuffer_get_data(graphics->sprite_buffer);
 	if (tex && gs_texture_is_rect(tex))
-		build_sprite_rect(data, tex, fcx, fcy, flip);
+		build_sprite_rect(rect, tex, fcx, fcy, flip);
 	else
-		build_sprite_norm(data, fcx, fcy, flip);
+		build_sprite_norm(rect, fcx, fcy, flip);
+	return true;
+}
+
+/* Only rebuilds and flushes the sprite vertex buffer if the sprite differs
+ * from the previous one, consecutive sprites of the same size are common. */
+static void load_sprite(graphics_t *graphics, const struct sprite_rect *rect)
+{
+	if (!graphics->sprite_rect_valid || memcmp(&graphics->sprite_rect, rect, sizeof(*rect)) != 0) {
+		struct gs_vb_data *data = gs_vertexbuffer_get_data(graphics->sprite_buffer);
+
+		build_sprite(data->points, data->tvarray[0].array, rect);
+		gs_vertexbuffer_flush(graphics->sprite_buffer);
+
+		graphics->sprite_rect = *rect;
+		graphics->sprite_rect_valid = true;
+	}
 
-	gs_vertexbuffer_flush(graphics->sprite_buffer);
 	gs_load_vertexbuffer(graphics->sprite_buffer);
 	gs_load_indexbuffer(NULL);
+}
+
+void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height)
+{
+	graphics_t *graphics = thread_graphics;
+	struct sprite_rect rect;
+
+	if (!build_sprite_params(&rect, tex, flip, width, height))
+		return;
 
+	load_sprite(graphics, &rect);
 	gs_draw(GS_TRISTRIP, 0, 0);
 }
 
@@ -1017,8 +1032,8 @@ void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t sub_x,
 			      uint32_t sub_cy)
 {
 	graphics_t *graphics = thread_graphics;
+	struct sprite_rect rect;
 	float fcx, fcy;
-	struct gs_vb_data *data;
 
 	if (tex) {
 		if (gs_get_texture_type(tex) != GS_TEXTURE_2D) {
@@ -1030,16 +1045,79 @@ void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t sub_x,
 	fcx = (float)gs_texture_get_width(tex);
 	fcy = (float)gs_texture_get_height(tex);
 
-	data = gs_vertexbuffer_get_data(graphics->sprite_buffer);
-	build_subsprite_norm(data, (float)sub_x, (float)sub_y, (float)sub_cx, (float)sub_cy, fcx, fcy, flip);
-
-	gs_vertexbuffer_flush(graphics->sprite_buffer);
-	gs_load_vertexbuffer(graphics->sprite_buffer);
-	gs_load_indexbuffer(NULL);
+	build_subsprite_norm(&rect, (float)sub_x, (float)sub_y, (float)sub_cx, (float)sub_cy, fcx, fcy, flip);
 
+	load_sprite(graphics, &rect);
 	gs_draw(GS_TRISTRIP, 0, 0);
 }
 
+#define SPRITE_BATCH_SIZE 256
+#define SPRITE_BATCH_VERTS (SPRITE_BATCH_SIZE * 6)
+
+static bool init_sprite_batch_vb(graphics_t *graphics)
+{
+	struct gs_vb_data *vbd;
+
+	vbd = gs_vbdata_create();
+	vbd->num = SPRITE_BATCH_VERTS;
+	vbd->points = bzalloc(sizeof(struct vec3) * SPRITE_BATCH_VERTS);
+	vbd->num_tex = 1;
+	vbd->tvarray = bmalloc(sizeof(struct gs_tvertarray));
+	vbd->tvarray[0].width = 2;
+	vbd->tvarray[0].array = bzalloc(sizeof(struct vec2) * SPRITE_BATCH_VERTS);
+
+	graphics->sprite_batch_buffer = gs_vertexbuffer_create(vbd, GS_DYNAMIC);
+	return graphics->sprite_batch_buffer != NULL;
+}
+
+void gs_draw_sprite_batch(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height,
+			  const struct matrix4 *transforms, size_t count)
+{
+	static const size_t strip_to_list[6] = {0, 1, 2, 2, 1, 3};
+	graphics_t *graphics = thread_graphics;
+	struct sprite_rect rect;
+	struct vec3 points[4];
+	struct vec2 uvs[4];
+
+	if (!gs_valid_p("gs_draw_sprite_batch", transforms))
+		return;
+	if (!build_sprite_params(&rect, tex, flip, width, height))
+		return;
+	if (!graphics->sprite_batch_buffer && !init_sprite_batch_vb(graphics))
+		return;
+
+	build_sprite(points, uvs, &rect);
+
+	struct gs_vb_data *data = gs_vertexbuffer_get_data(graphics->sprite_batch_buffer);
+	struct vec2 *tvarray = data->tvarray[0].array;
+
+	/* sprites are transformed on the CPU and drawn as a triangle list, so
+	 * a whole batch only needs one upload and one draw call */
+	while (count) {
+		size_t num = count > SPRITE_BATCH_SIZE ? SPRITE_BATCH_SIZE : count;
+
+		for (size_t i = 0; i < num; i++) {
+			struct vec3 transformed[4];
+
+			for (size_t v = 0; v < 4; v++)
+				vec3_transform(&transformed[v], &points[v], &transforms[i]);
+
+			for (size_t v = 0; v < 6; v++) {
+				data->points[i * 6 + v] = transformed[strip_to_list[v]];
+				tvarray[i * 6 + v] = uvs[strip_to_list[v]];
+			}
+		}
+
+		gs_vertexbuffer_flush(graphics->sprite_batch_buffer);
+		gs_load_vertexbuffer(graphics->sprite_batch_buffer);
+		gs_load_indexbuffer(NULL);
+		gs_draw(GS_TRIS, 0, (uint32_t)(num * 6));
+
+		transforms += num;
+		count -= num;
+	}
+}
+
 void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot, float left, float right, float top,
 			   float bottom, float znear)
 {
@@ -2516,6 +2594,19 @@ void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 	graphics->exports.gs_stagesurface_unmap(stagesurf);
 }
 
+bool gs_stagesurface_is_ready(gs_stagesurf_t *stagesurf)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_stagesurface_is_ready", stagesurf))
+		return false;
+
+	if (!graphics->exports.gs_stagesurface_is_ready)
+		return true;
+
+	return graphics->exports.gs_stagesurface_is_ready(stagesurf);
+}
+
 void gs_zstencil_destroy(gs_zstencil_t *zstencil)
 {
 	if (!gs_valid("gs_zstencil_destroy"))
@@ -2854,6 +2945,60 @@ bool gs_texture_create_p010(gs_texture_t **tex_y, gs_texture_t **tex_uv, uint32_
 	return true;
 }
 
+gs_upload_buffer_t *gs_upload_buffer_create(size_t size, uint8_t **map)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_upload_buffer_create", map))
+		return NULL;
+	if (!graphics->exports.device_upload_buffer_create)
+		return NULL;
+
+	return graphics->exports.device_upload_buffer_create(graphics->device, size, map);
+}
+
+void gs_upload_buffer_destroy(gs_upload_buffer_t *buf)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_upload_buffer_destroy"))
+		return;
+	if (!buf)
+		return;
+
+	graphics->exports.gs_upload_buffer_destroy(buf);
+}
+
+bool gs_texture_set_image_from_buffer(gs_texture_t *tex, gs_upload_buffer_t *buf, size_t offset, uint32_t linesize)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p2("gs_texture_set_image_from_buffer", tex, buf))
+		return false;
+
+	return graphics->exports.device_texture_set_image_from_buffer(graphics->device, tex, buf, offset, linesize);
+}
+
+void gs_upload_buffer_fence(gs_upload_buffer_t *buf, uint64_t tag)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_upload_buffer_fence", buf))
+		return;
+
+	graphics->exports.gs_upload_buffer_fence(buf, tag);
+}
+
+uint64_t gs_upload_buffer_poll(gs_upload_buffer_t *buf)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_upload_buffer_poll", buf))
+		return 0;
+
+	return graphics->exports.gs_upload_buffer_poll(buf);
+}
+
 uint32_t gs_get_adapter_count(void)
 {
 	if (!gs_valid("gs_get_adapter_count"))
@@ -274,6 +274,8 @@ struct gs_shader;
 struct gs_swap_chain;
 struct gs_timer;
 struct gs_texrender;
+struct gs_upload_buffer;
+struct gs_upload_ring;
 struct gs_shader_param;
 struct gs_effect;
 struct gs_effect_technique;
@@ -292,6 +294,8 @@ typedef struct gs_swap_chain gs_swapchain_t;
 typedef struct gs_timer gs_timer_t;
 typedef struct gs_timer_range gs_timer_range_t;
 typedef struct gs_texture_render gs_texrender_t;
+typedef struct gs_upload_buffer gs_upload_buffer_t;
+typedef struct gs_upload_ring gs_upload_ring_t;
 typedef struct gs_shader gs_shader_t;
 typedef struct gs_shader_param gs_sparam_t;
 typedef struct gs_effect gs_effect_t;
@@ -454,6 +458,32 @@ EXPORT void gs_texrender_reset(gs_texrender_t *texrender);
 EXPORT gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender);
 EXPORT enum gs_color_format gs_texrender_get_format(const gs_texrender_t *texrender);
 
+/* ---------------------------------------------------
+ * streaming texture upload helper functions
+ *
+ *   A ring of persistently mapped upload memory.  Space is allocated and
+ * written from any thread; uploads and releases happen on the graphics
+ * thread.  Space is recycled in allocation order, once the GPU has finished
+ * the uploads issued before the release.
+ * --------------------------------------------------- */
+
+/** Returns NULL if the renderer does not support persistent mapping */
+EXPORT gs_upload_ring_t *gs_upload_ring_create(size_t size);
+EXPORT void gs_upload_ring_destroy(gs_upload_ring_t *ring);
+
+/**
+ * Allocates space in the ring from any thread.  Returns NULL if the ring is
+ * full.  In either case, end receives the position to pass to
+ * gs_upload_ring_release once the data allocated so far has been consumed.
+ */
+EXPORT uint8_t *gs_upload_ring_alloc(gs_upload_ring_t *ring, size_t size, uint64_t *pos, uint64_t *end);
+
+/** Uploads a whole 2D texture from data previously written at pos */
+EXPORT bool gs_upload_ring_upload(gs_upload_ring_t *ring, gs_texture_t *tex, uint64_t pos, uint32_t linesize);
+
+/** Allows everything allocated before end to be reused */
+EXPORT void gs_upload_ring_release(gs_upload_ring_t *ring, uint64_t end);
+
 /* ---------------------------------------------------
  * graphics subsystem
  * --------------------------------------------------- */
@@ -580,6 +610,16 @@ EXPORT void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uin
 EXPORT void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t x, uint32_t y, uint32_t cx,
 				     uint32_t cy);
 
+/**
+ * Draws the same 2D sprite once per transform with a single draw call
+ *
+ *   Each transform is applied on top of the current matrix, as if
+ * gs_draw_sprite was called with the transform multiplied in.  The effect
+ * parameters and states are shared by all sprites.
+ */
+EXPORT void gs_draw_sprite_batch(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height,
+				 const struct matrix4 *transforms, size_t count);
+
 EXPORT void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot, float left, float right, float top,
 				  float bottom, float znear);
 
@@ -752,6 +792,13 @@ EXPORT enum gs_color_format gs_stagesurface_get_color_format(const gs_stagesurf_
 EXPORT bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data, uint32_t *linesize);
 EXPORT void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf);
 
+/**
+ * Returns true if the last gs_stage_texture into this surface has completed,
+ * so it can be mapped without waiting for the GPU.  Always true on renderers
+ * that cannot tell.
+ */
+EXPORT bool gs_stagesurface_is_ready(gs_stagesurf_t *stagesurf);
+
 EXPORT void gs_zstencil_destroy(gs_zstencil_t *zstencil);
 
 EXPORT void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate);
@@ -786,6 +833,13 @@ EXPORT bool gs_texture_create_p010(gs_texture_t **tex_y, gs_texture_t **tex_uv,
 
 EXPORT bool gs_is_monitor_hdr(void *monitor);
 
+EXPORT gs_upload_buffer_t *gs_upload_buffer_create(size_t size, uint8_t **map);
+EXPORT void gs_upload_buffer_destroy(gs_upload_buffer_t *buf);
+EXPORT bool gs_texture_set_image_from_buffer(gs_texture_t *tex, gs_upload_buffer_t *buf, size_t offset,
+					     uint32_t linesize);
+EXPORT void gs_upload_buffer_fence(gs_upload_buffer_t *buf, uint64_t tag);
+EXPORT uint64_t gs_upload_buffer_poll(gs_upload_buffer_t *buf);
+
 #define GS_USE_DEBUG_MARKERS 0
 #if GS_USE_DEBUG_MARKERS
 static const float GS_DEBUG_COLOR_DEFAULT[] = {0.5f, 0.5f, 0.5f, 1.0f};
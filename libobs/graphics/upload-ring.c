@@ -0,0 +1,127 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ *   Ring allocator on top of a persistently mapped upload buffer.  Positions
+ * are free-running byte counters; space behind the tail is reusable once the
+ * GPU has signaled the fence inserted by the release that covered it.
+ */
+
+#include "../util/threading.h"
+#include "graphics.h"
+
+#define UPLOAD_ALIGN 256
+
+struct gs_upload_ring {
+	gs_upload_buffer_t *buffer;
+	uint8_t *map;
+	size_t size;
+
+	pthread_mutex_t mutex;
+	uint64_t head;
+	uint64_t tail;
+
+	/* graphics thread only */
+	uint64_t fenced;
+};
+
+gs_upload_ring_t *gs_upload_ring_create(size_t size)
+{
+	struct gs_upload_ring *ring;
+	uint8_t *map = NULL;
+
+	size = (size + UPLOAD_ALIGN - 1) & ~(size_t)(UPLOAD_ALIGN - 1);
+
+	gs_upload_buffer_t *buffer = gs_upload_buffer_create(size, &map);
+	if (!buffer)
+		return NULL;
+
+	ring = bzalloc(sizeof(struct gs_upload_ring));
+	ring->buffer = buffer;
+	ring->map = map;
+	ring->size = size;
+	pthread_mutex_init(&ring->mutex, NULL);
+	return ring;
+}
+
+void gs_upload_ring_destroy(gs_upload_ring_t *ring)
+{
+	if (!ring)
+		return;
+
+	gs_upload_buffer_destroy(ring->buffer);
+	pthread_mutex_destroy(&ring->mutex);
+	bfree(ring);
+}
+
+uint8_t *gs_upload_ring_alloc(gs_upload_ring_t *ring, size_t size, uint64_t *pos, uint64_t *end)
+{
+	uint8_t *data = NULL;
+
+	if (!ring)
+		return NULL;
+
+	size = (size + UPLOAD_ALIGN - 1) & ~(size_t)(UPLOAD_ALIGN - 1);
+
+	pthread_mutex_lock(&ring->mutex);
+
+	uint64_t start = ring->head;
+	size_t offset = (size_t)(start % ring->size);
+
+	/* allocations are never split across the end of the buffer */
+	if (offset + size > ring->size) {
+		start += ring->size - offset;
+		offset = 0;
+	}
+
+	if (start + size - ring->tail <= ring->size) {
+		ring->head = start + size;
+		data = ring->map + offset;
+		*pos = start;
+	}
+
+	*end = ring->head;
+
+	pthread_mutex_unlock(&ring->mutex);
+	return data;
+}
+
+bool gs_upload_ring_upload(gs_upload_ring_t *ring, gs_texture_t *tex, uint64_t pos, uint32_t linesize)
+{
+	if (!ring)
+		return false;
+
+	return gs_texture_set_image_from_buffer(tex, ring->buffer, (size_t)(pos % ring->size), linesize);
+}
+
+void gs_upload_ring_release(gs_upload_ring_t *ring, uint64_t end)
+{
+	if (!ring)
+		return;
+
+	if (end > ring->fenced) {
+		gs_upload_buffer_fence(ring->buffer, end);
+		ring->fenced = end;
+	}
+
+	uint64_t signaled = gs_upload_buffer_poll(ring->buffer);
+
+	pthread_mutex_lock(&ring->mutex);
+	if (signaled > ring->tail)
+		ring->tail = signaled;
+	pthread_mutex_unlock(&ring->mutex);
+}
@@ -0,0 +1,279 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "../util/sse-intrin.h"
+#include "../graphics/math-defs.h"
+#include "media-io-defs.h"
+#include "audio-dsp.h"
+
+struct audio_dsp_kernels {
+	void (*gain)(float *dst, const float *src, float gain, size_t frames);
+	void (*gain_env)(float *dst, const float *src, const float *gains, size_t frames);
+	void (*gain_ramp)(float *dst, const float *src, float start, float step, size_t frames);
+	void (*mix)(float *dst, const float *src, float gain, size_t frames);
+	void (*downmix)(float *dst, const float *const src[], const float *matrix, size_t channels, size_t frames);
+	void (*downmix_mono)(float *const data[], size_t channels, size_t frames);
+};
+
+/* ------------------------------------------------------------------------- */
+/* scalar */
+
+static void gain_scalar(float *dst, const float *src, float gain, size_t frames)
+{
+	for (size_t i = 0; i < frames; i++)
+		dst[i] = src[i] * gain;
+}
+
+static void gain_env_scalar(float *dst, const float *src, const float *gains, size_t frames)
+{
+	for (size_t i = 0; i < frames; i++)
+		dst[i] = src[i] * gains[i];
+}
+
+static void gain_ramp_scalar(float *dst, const float *src, float start, float step, size_t frames)
+{
+	for (size_t i = 0; i < frames; i++)
+		dst[i] = src[i] * (start + step * (float)i);
+}
+
+static void mix_scalar(float *dst, const float *src, float gain, size_t frames)
+{
+	for (size_t i = 0; i < frames; i++)
+		dst[i] += src[i] * gain;
+}
+
+static void downmix_scalar(float *dst, const float *const src[], const float *matrix, size_t channels,
+			   size_t frames)
+{
+	for (size_t i = 0; i < frames; i++) {
+		float sum = src[0][i] * matrix[0];
+		for (size_t ch = 1; ch < channels; ch++)
+			sum += src[ch][i] * matrix[ch];
+		dst[i] = sum;
+	}
+}
+
+static void downmix_mono_scalar(float *const data[], size_t channels, size_t frames)
+{
+	const float channels_i = 1.0f / (float)channels;
+
+	for (size_t i = 0; i < frames; i++) {
+		float sum = data[0][i];
+		for (size_t ch = 1; ch < channels; ch++)
+			sum += data[ch][i];
+		sum *= channels_i;
+
+		for (size_t ch = 0; ch < channels; ch++)
+			data[ch][i] = sum;
+	}
+}
+
+static const struct audio_dsp_kernels scalar_kernels = {
+	gain_scalar, gain_env_scalar, gain_ramp_scalar, mix_scalar, downmix_scalar, downmix_mono_scalar,
+};
+
+/* ------------------------------------------------------------------------- */
+/* SSE, or NEON through simde */
+
+static void gain_simd(float *dst, const float *src, float gain, size_t frames)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 8 <= frames; i += 8) {
+		__m128 a = _mm_loadu_ps(src + i);
+		__m128 b = _mm_loadu_ps(src + i + 4);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(a, g));
+		_mm_storeu_ps(dst + i + 4, _mm_mul_ps(b, g));
+	}
+
+	gain_scalar(dst + i, src + i, gain, frames - i);
+}
+
+static void gain_env_simd(float *dst, const float *src, const float *gains, size_t frames)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4)
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), _mm_loadu_ps(gains + i)));
+
+	gain_env_scalar(dst + i, src + i, gains + i, frames - i);
+}
+
+static void gain_ramp_simd(float *dst, const float *src, float start, float step, size_t frames)
+{
+	const __m128 s = _mm_set1_ps(start);
+	const __m128 d = _mm_set1_ps(step);
+	const __m128i four = _mm_set1_epi32(4);
+	__m128i index = _mm_set_epi32(3, 2, 1, 0);
+	size_t i = 0;
+
+	/* the gain is computed from the index every time rather than
+	 * accumulated, so that it does not drift from the scalar version */
+	for (; i + 4 <= frames && i < 0x7FFFFFFC; i += 4) {
+		__m128 g = _mm_add_ps(s, _mm_mul_ps(d, _mm_cvtepi32_ps(index)));
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+		index = _mm_add_epi32(index, four);
+	}
+
+	for (; i < frames; i++)
+		dst[i] = src[i] * (start + step * (float)i);
+}
+
+static void mix_simd(float *dst, const float *src, float gain, size_t frames)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), a));
+	}
+
+	mix_scalar(dst + i, src + i, gain, frames - i);
+}
+
+static void downmix_simd(float *dst, const float *const src[], const float *matrix, size_t channels, size_t frames)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 sum = _mm_mul_ps(_mm_loadu_ps(src[0] + i), _mm_set1_ps(matrix[0]));
+		for (size_t ch = 1; ch < channels; ch++)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src[ch] + i), _mm_set1_ps(matrix[ch])));
+		_mm_storeu_ps(dst + i, sum);
+	}
+
+	if (i < frames) {
+		const float *tail[MAX_AV_PLANES];
+		for (size_t ch = 0; ch < channels; ch++)
+			tail[ch] = src[ch] + i;
+		downmix_scalar(dst + i, tail, matrix, channels, frames - i);
+	}
+}
+
+static void downmix_mono_simd(float *const data[], size_t channels, size_t frames)
+{
+	const float channels_i = 1.0f / (float)channels;
+	const __m128 scale = _mm_set1_ps(channels_i);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 sum = _mm_loadu_ps(data[0] + i);
+		for (size_t ch = 1; ch < channels; ch++)
+			sum = _mm_add_ps(sum, _mm_loadu_ps(data[ch] + i));
+		sum = _mm_mul_ps(sum, scale);
+
+		for (size_t ch = 0; ch < channels; ch++)
+			_mm_storeu_ps(data[ch] + i, sum);
+	}
+
+	if (i < frames) {
+		float *tail[MAX_AV_PLANES];
+		for (size_t ch = 0; ch < channels; ch++)
+			tail[ch] = data[ch] + i;
+		downmix_mono_scalar(tail, channels, frames - i);
+	}
+}
+
+static const struct audio_dsp_kernels simd_kernels = {
+	gain_simd, gain_env_simd, gain_ramp_simd, mix_simd, downmix_simd, downmix_mono_simd,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static const struct audio_dsp_kernels *kernels = &simd_kernels;
+
+void audio_dsp_set_impl(enum audio_dsp_impl impl)
+{
+	kernels = impl == AUDIO_DSP_SCALAR ? &scalar_kernels : &simd_kernels;
+}
+
+enum audio_dsp_impl audio_dsp_get_impl(void)
+{
+	return kernels == &scalar_kernels ? AUDIO_DSP_SCALAR : AUDIO_DSP_SIMD;
+}
+
+void audio_dsp_gain(float *dst, const float *src, float gain, size_t frames)
+{
+	kernels->gain(dst, src, gain, frames);
+}
+
+void audio_dsp_gain_env(float *dst, const float *src, const float *gains, size_t frames)
+{
+	kernels->gain_env(dst, src, gains, frames);
+}
+
+void audio_dsp_gain_ramp(float *dst, const float *src, float start, float end, size_t frames)
+{
+	if (!frames)
+		return;
+
+	kernels->gain_ramp(dst, src, start, (end - start) / (float)frames, frames);
+}
+
+void audio_dsp_mix(float *dst, const float *src, float gain, size_t frames)
+{
+	kernels->mix(dst, src, gain, frames);
+}
+
+void audio_dsp_pan_gains(enum audio_pan_law law, float balance, float *left, float *right)
+{
+	switch (law) {
+	case AUDIO_PAN_LAW_SINE:
+		*left = sinf((1.0f - balance) * (M_PI / 2.0f));
+		*right = sinf(balance * (M_PI / 2.0f));
+		break;
+	case AUDIO_PAN_LAW_SQUARE:
+		*left = sqrtf(1.0f - balance);
+		*right = sqrtf(balance);
+		break;
+	case AUDIO_PAN_LAW_LINEAR:
+	default:
+		*left = 1.0f - balance;
+		*right = balance;
+		break;
+	}
+}
+
+void audio_dsp_pan(float *left, float *right, enum audio_pan_law law, float balance, size_t frames)
+{
+	float l, r;
+
+	audio_dsp_pan_gains(law, balance, &l, &r);
+	kernels->gain(left, left, l, frames);
+	kernels->gain(right, right, r, frames);
+}
+
+void audio_dsp_downmix(float *dst, const float *const src[], const float *matrix, size_t channels, size_t frames)
+{
+	if (!channels) {
+		memset(dst, 0, frames * sizeof(float));
+		return;
+	}
+
+	kernels->downmix(dst, src, matrix, channels, frames);
+}
+
+void audio_dsp_downmix_mono(float *const data[], size_t channels, size_t frames)
+{
+	if (channels > 1)
+		kernels->downmix_mono(data, channels, frames);
+}
@@ -0,0 +1,81 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Basic float sample kernels for planar audio.  Every function has a scalar
+ * and a vectorized implementation; the vectorized one is used unless
+ * audio_dsp_set_impl() selects otherwise.  Both produce identical results
+ * for gains and the mono downmix; ramps and weighted downmixes may differ in
+ * the last bit where the compiler contracts a scalar multiply-add.
+ *
+ * Unless noted otherwise, dst may be the same buffer as src.
+ */
+
+enum audio_dsp_impl {
+	AUDIO_DSP_SCALAR,
+	AUDIO_DSP_SIMD,
+};
+
+enum audio_pan_law {
+	AUDIO_PAN_LAW_SINE,
+	AUDIO_PAN_LAW_SQUARE,
+	AUDIO_PAN_LAW_LINEAR,
+};
+
+/** Selects the implementation used by all threads; not thread safe */
+EXPORT void audio_dsp_set_impl(enum audio_dsp_impl impl);
+EXPORT enum audio_dsp_impl audio_dsp_get_impl(void);
+
+/** dst[i] = src[i] * gain */
+EXPORT void audio_dsp_gain(float *dst, const float *src, float gain, size_t frames);
+
+/** dst[i] = src[i] * gains[i] */
+EXPORT void audio_dsp_gain_env(float *dst, const float *src, const float *gains, size_t frames);
+
+/** dst[i] = src[i] * (start + (end - start) / frames * i) */
+EXPORT void audio_dsp_gain_ramp(float *dst, const float *src, float start, float end, size_t frames);
+
+/** dst[i] += src[i] * gain */
+EXPORT void audio_dsp_mix(float *dst, const float *src, float gain, size_t frames);
+
+/** Left and right gains for a balance between 0 (left) and 1 (right) */
+EXPORT void audio_dsp_pan_gains(enum audio_pan_law law, float balance, float *left, float *right);
+
+/** Applies the gains of audio_dsp_pan_gains() to a stereo pair in place */
+EXPORT void audio_dsp_pan(float *left, float *right, enum audio_pan_law law, float balance, size_t frames);
+
+/**
+ * dst[i] = sum of src[ch][i] * matrix[ch] over all channels.  dst may be
+ * one of the source channels.
+ */
+EXPORT void audio_dsp_downmix(float *dst, const float *const src[], const float *matrix, size_t channels,
+			      size_t frames);
+
+/** Replaces every channel with the average of all channels */
+EXPORT void audio_dsp_downmix_mono(float *const data[], size_t channels, size_t frames);
+
+#ifdef __cplusplus
+}
+#endif
@@ -35,6 +35,7 @@
 #endif
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
+extern void audio_profiler_tick_output(const audio_t *audio, uint64_t output_ns);
 
 /* #define DEBUG_AUDIO */
 
@@ -43,27 +44,41 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 		int invalid = 0; \
 	} while (0)
 
+/* conversion of a mix, shared by every input of that mix with the same
+ * conversion info and converted at most once per tick */
+struct audio_converter {
+	struct audio_convert_info info;
+	audio_resampler_t *resampler;
+	long refs;
+
+	uint8_t *buffer[MAX_AV_PLANES];
+	uint32_t capacity;
+	size_t planes;
+	size_t frame_size;
+
+	uint64_t tick;
+	bool success;
+	struct audio_data data;
+};
+
 struct audio_input {
 	struct audio_convert_info conversion;
-	audio_resampler_t *resampler;
+	struct audio_converter *converter;
 
 	audio_output_callback_t callback;
 	void *param;
 };
 
-static inline void audio_input_free(struct audio_input *input)
-{
-	audio_resampler_destroy(input->resampler);
-}
-
 struct audio_mix {
 	DARRAY(struct audio_input) inputs;
+	DARRAY(struct audio_converter *) converters;
 	float buffer[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
 	float buffer_unclamped[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
 };
 
 struct audio_output {
 	struct audio_output_info info;
+	uint32_t frames;
 	size_t block_size;
 	size_t channels;
 	size_t planes;
@@ -77,31 +92,49 @@ struct audio_output {
 	void *input_param;
 	pthread_mutex_t input_mutex;
 	struct audio_mix mixes[MAX_AUDIO_MIXES];
+	uint64_t tick;
+	uint64_t output_time;
 };
 
 /* ------------------------------------------------------------------------- */
 
-static bool resample_audio_output(struct audio_input *input, struct audio_data *data)
+static void reserve_converter_buffer(struct audio_converter *conv, uint32_t frames)
 {
-	bool success = true;
-
-	if (input->resampler) {
-		uint8_t *output[MAX_AV_PLANES];
-		uint32_t frames;
-		uint64_t offset;
+	size_t plane_size = (frames * conv->frame_size + 31) & ~(size_t)31;
 
-		memset(output, 0, sizeof(output));
+	bfree(conv->buffer[0]);
+	conv->buffer[0] = bmalloc(plane_size * conv->planes);
+	for (size_t i = 1; i < conv->planes; i++)
+		conv->buffer[i] = conv->buffer[i - 1] + plane_size;
 
-		success = audio_resampler_resample(input->resampler, output, &frames, &offset,
-						   (const uint8_t *const *)data->data, data->frames);
+	conv->capacity = frames;
+}
 
-		for (size_t i = 0; i < MAX_AV_PLANES; i++)
-			data->data[i] = output[i];
-		data->frames = frames;
-		data->timestamp -= offset;
+static bool resample_audio_output(struct audio_converter *conv, uint64_t tick, struct audio_data *data)
+{
+	if (conv->tick != tick) {
+		uint32_t needed = audio_resampler_get_max_output(conv->resampler, data->frames);
+		uint64_t offset = 0;
+		uint32_t frames = 0;
+
+		/* only grows while the resampler's delay settles */
+		if (needed > conv->capacity)
+			reserve_converter_buffer(conv, needed);
+
+		conv->tick = tick;
+		conv->success = audio_resampler_convert(conv->resampler, conv->buffer, conv->capacity, &frames,
+							&offset, (const uint8_t *const *)data->data, data->frames);
+
+		memset(conv->data.data, 0, sizeof(conv->data.data));
+		for (size_t i = 0; i < conv->planes; i++)
+			conv->data.data[i] = conv->buffer[i];
+		conv->data.frames = frames;
+		conv->data.timestamp = data->timestamp - offset;
 	}
 
-	return success;
+	if (conv->success)
+		*data = conv->data;
+	return conv->success;
 }
 
 static inline void do_audio_output(struct audio_output *audio, size_t mix_idx, uint64_t timestamp, uint32_t frames)
@@ -122,7 +155,7 @@ static inline void do_audio_output(struct audio_output *audio, size_t mix_idx, u
 		data.frames = frames;
 		data.timestamp = timestamp;
 
-		if (resample_audio_output(input, &data))
+		if (!input->converter || resample_audio_output(input->converter, audio->tick, &data))
 			input->callback(input->param, mix_idx, &data);
 	}
 
@@ -159,7 +192,7 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 
 static void input_and_output(struct audio_output *audio, uint64_t audio_time, uint64_t prev_time)
 {
-	size_t bytes = AUDIO_OUTPUT_FRAMES * audio->block_size;
+	size_t bytes = audio->frames * audio->block_size;
 	struct audio_output_data data[MAX_AUDIO_MIXES];
 	uint32_t active_mixes = 0;
 	uint64_t new_ts = 0;
@@ -183,10 +216,10 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time, ui
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
-		memset(mix->buffer, 0, sizeof(mix->buffer));
-
-		for (size_t i = 0; i < audio->planes; i++)
+		for (size_t i = 0; i < audio->planes; i++) {
+			memset(mix->buffer[i], 0, bytes);
 			data[mix_idx].data[i] = mix->buffer[i];
+		}
 	}
 
 	/* get new audio data */
@@ -198,8 +231,14 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time, ui
 	clamp_audio_output(audio, bytes);
 
 	/* output */
+	uint64_t output_start = os_gettime_ns();
+
+	audio->tick++;
 	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
-		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+		do_audio_output(audio, i, new_ts, audio->frames);
+
+	audio->output_time = os_gettime_ns() - output_start;
+	audio_profiler_tick_output(audio, audio->output_time);
 }
 
 static void *audio_thread(void *param)
@@ -221,7 +260,7 @@ static void *audio_thread(void *param)
 		profile_store_name(obs_get_profiler_name_store(), "audio_thread(%s)", audio->info.name);
 
 	while (os_event_try(audio->stop_event) == EAGAIN) {
-		samples += AUDIO_OUTPUT_FRAMES;
+		samples += audio->frames;
 		uint64_t audio_time = start_time + audio_frames_to_ns(rate, samples);
 
 		os_sleepto_ns_fast(audio_time);
@@ -260,27 +299,76 @@ static size_t audio_get_input_idx(const audio_t *audio, size_t mix_idx, audio_ou
 	return DARRAY_INVALID;
 }
 
-static inline bool audio_input_init(struct audio_input *input, struct audio_output *audio)
+static inline bool same_conversion(const struct audio_convert_info *a, const struct audio_convert_info *b)
+{
+	return a->format == b->format && a->samples_per_sec == b->samples_per_sec && a->speakers == b->speakers &&
+	       a->allow_clipping == b->allow_clipping;
+}
+
+static struct audio_converter *audio_converter_get(struct audio_output *audio, struct audio_mix *mix,
+						   const struct audio_convert_info *info)
+{
+	for (size_t i = 0; i < mix->converters.num; i++) {
+		struct audio_converter *conv = mix->converters.array[i];
+		if (same_conversion(&conv->info, info)) {
+			conv->refs++;
+			return conv;
+		}
+	}
+
+	struct resample_info from = {.format = audio->info.format,
+				     .samples_per_sec = audio->info.samples_per_sec,
+				     .speakers = audio->info.speakers};
+
+	struct resample_info to = {.format = info->format,
+				   .samples_per_sec = info->samples_per_sec,
+				   .speakers = info->speakers};
+
+	audio_resampler_t *resampler = audio_resampler_create(&to, &from);
+	if (!resampler)
+		return NULL;
+
+	struct audio_converter *conv = bzalloc(sizeof(struct audio_converter));
+	bool planar = is_audio_planar(info->format);
+	size_t channels = get_audio_channels(info->speakers);
+
+	conv->info = *info;
+	conv->resampler = resampler;
+	conv->refs = 1;
+	conv->planes = planar ? channels : 1;
+	conv->frame_size = (planar ? 1 : channels) * get_audio_bytes_per_channel(info->format);
+	conv->tick = UINT64_MAX;
+
+	reserve_converter_buffer(conv, audio_resampler_get_max_output(resampler, audio->frames));
+
+	da_push_back(mix->converters, &conv);
+	return conv;
+}
+
+static void audio_converter_release(struct audio_mix *mix, struct audio_converter *conv)
+{
+	if (!conv || --conv->refs > 0)
+		return;
+
+	da_erase_item(mix->converters, &conv);
+	audio_resampler_destroy(conv->resampler);
+	bfree(conv->buffer[0]);
+	bfree(conv);
+}
+
+static inline bool audio_input_init(struct audio_input *input, struct audio_output *audio, struct audio_mix *mix)
 {
 	if (input->conversion.format != audio->info.format ||
 	    input->conversion.samples_per_sec != audio->info.samples_per_sec ||
 	    input->conversion.speakers != audio->info.speakers) {
-		struct resample_info from = {.format = audio->info.format,
-					     .samples_per_sec = audio->info.samples_per_sec,
-					     .speakers = audio->info.speakers};
-
-		struct resample_info to = {.format = input->conversion.format,
-					   .samples_per_sec = input->conversion.samples_per_sec,
-					   .speakers = input->conversion.speakers};
-
-		input->resampler = audio_resampler_create(&to, &from);
-		if (!input->resampler) {
+		input->converter = audio_converter_get(audio, mix, &input->conversion);
+		if (!input->converter) {
 			blog(LOG_ERROR, "audio_input_init: Failed to "
 					"create resampler");
 			return false;
 		}
 	} else {
-		input->resampler = NULL;
+		input->converter = NULL;
 	}
 
 	return true;
@@ -318,7 +406,7 @@ bool audio_output_connect(audio_t *audio, size_t mi, const struct audio_convert_
 		if (input.conversion.samples_per_sec == 0)
 			input.conversion.samples_per_sec = audio->info.samples_per_sec;
 
-		success = audio_input_init(&input, audio);
+		success = audio_input_init(&input, audio, mix);
 		if (success)
 			da_push_back(mix->inputs, &input);
 	}
@@ -338,7 +426,7 @@ void audio_output_disconnect(audio_t *audio, size_t mix_idx, audio_output_callba
 	size_t idx = audio_get_input_idx(audio, mix_idx, callback, param);
 	if (idx != DARRAY_INVALID) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
-		audio_input_free(mix->inputs.array + idx);
+		audio_converter_release(mix, mix->inputs.array[idx].converter);
 		da_erase(mix->inputs, idx);
 	}
 
@@ -351,11 +439,16 @@ static inline bool valid_audio_params(const struct audio_output_info *info)
 }
 
 int audio_output_open(audio_t **audio, struct audio_output_info *info)
+{
+	return audio_output_open2(audio, info, AUDIO_OUTPUT_FRAMES);
+}
+
+int audio_output_open2(audio_t **audio, struct audio_output_info *info, uint32_t frames)
 {
 	struct audio_output *out;
 	bool planar = is_audio_planar(info->format);
 
-	if (!valid_audio_params(info))
+	if (!valid_audio_params(info) || frames > AUDIO_OUTPUT_FRAMES)
 		return AUDIO_OUTPUT_INVALIDPARAM;
 
 	out = bzalloc(sizeof(struct audio_output));
@@ -363,6 +456,7 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 		goto fail0;
 
 	memcpy(&out->info, info, sizeof(struct audio_output_info));
+	out->frames = frames ? frames : AUDIO_OUTPUT_FRAMES;
 	out->channels = get_audio_channels(info->speakers);
 	out->planes = planar ? out->channels : 1;
 	out->input_cb = info->input_callback;
@@ -407,9 +501,10 @@ void audio_output_close(audio_t *audio)
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
 		for (size_t i = 0; i < mix->inputs.num; i++)
-			audio_input_free(mix->inputs.array + i);
+			audio_converter_release(mix, mix->inputs.array[i].converter);
 
 		da_free(mix->inputs);
+		da_free(mix->converters);
 	}
 	bfree(audio);
 }
@@ -449,6 +544,16 @@ size_t audio_output_get_channels(const audio_t *audio)
 	return audio->channels;
 }
 
+uint32_t audio_output_get_frames(const audio_t *audio)
+{
+	return audio ? audio->frames : 0;
+}
+
+uint64_t audio_output_get_output_time(const audio_t *audio)
+{
+	return audio ? audio->output_time : 0;
+}
+
 uint32_t audio_output_get_sample_rate(const audio_t *audio)
 {
 	return audio->info.samples_per_sec;
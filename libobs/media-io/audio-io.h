@@ -28,6 +28,7 @@ extern "C" {
 #define MAX_AUDIO_MIXES 6
 #define MAX_AUDIO_CHANNELS 8
 #define MAX_DEVICE_INPUT_CHANNELS 64
+/* Default and maximum number of frames per audio tick */
 #define AUDIO_OUTPUT_FRAMES 1024
 
 #define TOTAL_AUDIO_SIZE (MAX_AUDIO_MIXES * MAX_AUDIO_CHANNELS * AUDIO_OUTPUT_FRAMES * sizeof(float))
@@ -207,6 +208,9 @@ static inline uint64_t ns_to_audio_frames(size_t sample_rate, uint64_t frames)
 #define AUDIO_OUTPUT_FAIL -2
 
 EXPORT int audio_output_open(audio_t **audio, struct audio_output_info *info);
+/* Same as audio_output_open, but with up to AUDIO_OUTPUT_FRAMES frames per
+ * tick (0 for the default) */
+EXPORT int audio_output_open2(audio_t **audio, struct audio_output_info *info, uint32_t frames);
 EXPORT void audio_output_close(audio_t *audio);
 
 typedef void (*audio_output_callback_t)(void *param, size_t mix_idx, struct audio_data *data);
@@ -221,8 +225,13 @@ EXPORT size_t audio_output_get_block_size(const audio_t *audio);
 EXPORT size_t audio_output_get_planes(const audio_t *audio);
 EXPORT size_t audio_output_get_channels(const audio_t *audio);
 EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
+EXPORT uint32_t audio_output_get_frames(const audio_t *audio);
 EXPORT const struct audio_output_info *audio_output_get_info(const audio_t *audio);
 
+/** Time spent in the output callbacks of the last tick in ns, only
+ * meaningful on the audio thread */
+EXPORT uint64_t audio_output_get_output_time(const audio_t *audio);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,309 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "../util/bmem.h"
+#include "../util/sse-intrin.h"
+#include "../graphics/math-defs.h"
+#include "audio-loudness.h"
+
+/* These are pointless warnings generated not by our code, but by a standard
+ * library macro, INFINITY */
+#ifdef _MSC_VER
+#pragma warning(disable : 4056)
+#pragma warning(disable : 4756)
+#endif
+
+/* x4(d, c, b, a)  -->  a + b + c + d */
+#define hsum_ps(r, x4)                      \
+	do {                                \
+		float x4_mem[4];            \
+		_mm_storeu_ps(x4_mem, x4);  \
+		r = x4_mem[0] + x4_mem[1];  \
+		r += x4_mem[2] + x4_mem[3]; \
+	} while (false)
+
+#define LOUDNESS_BLOCK_MS 100
+#define LOUDNESS_MOMENTARY_BLOCKS 4
+#define LOUDNESS_SHORT_TERM_BLOCKS 30
+#define LOUDNESS_ABSOLUTE_GATE -70.0
+#define LOUDNESS_RELATIVE_GATE -10.0
+#define LOUDNESS_HISTOGRAM_BINS 1000 /* 0.1 LU steps from -70 LUFS */
+#define LOUDNESS_GROUPS (MAX_AUDIO_CHANNELS / 4)
+
+struct biquad_coeffs {
+	__m128 b0, b1, b2, a1, a2;
+};
+
+/* Two-stage K-weighting filter, run on four channels at once (one per lane).
+ * The filters are recursive, so the samples of a channel cannot be computed
+ * in parallel, but its channels can. */
+struct k_filter {
+	struct biquad_coeffs shelf;
+	struct biquad_coeffs highpass;
+	__m128 z[LOUDNESS_GROUPS][4];
+	__m128 weights[LOUDNESS_GROUPS];
+};
+
+struct audio_loudness {
+	struct k_filter filter;
+	size_t block_frames;
+	size_t block_pos;
+	double block_energy;
+
+	double blocks[LOUDNESS_SHORT_TERM_BLOCKS];
+	size_t num_blocks;
+	size_t block_idx;
+
+	uint32_t histogram[LOUDNESS_HISTOGRAM_BINS];
+	double bin_energy[LOUDNESS_HISTOGRAM_BINS];
+
+	float momentary;
+	float short_term;
+	float integrated;
+};
+
+static inline double energy_to_lufs(double energy)
+{
+	return energy > 0.0 ? -0.691 + 10.0 * log10(energy) : -INFINITY;
+}
+
+static void set_biquad_coeffs(struct biquad_coeffs *c, double b0, double b1, double b2, double a0, double a1,
+			      double a2)
+{
+	c->b0 = _mm_set1_ps((float)(b0 / a0));
+	c->b1 = _mm_set1_ps((float)(b1 / a0));
+	c->b2 = _mm_set1_ps((float)(b2 / a0));
+	c->a1 = _mm_set1_ps((float)(a1 / a0));
+	c->a2 = _mm_set1_ps((float)(a2 / a0));
+}
+
+/* Coefficients of the BS.1770 pre-filter and RLB high-pass for any sample
+ * rate, from the analog prototypes through the bilinear transform. */
+static void k_filter_init(struct k_filter *f, uint32_t sample_rate, enum speaker_layout speakers)
+{
+	double k, q, vh, vb, a0;
+
+	k = tan(M_PI * 1681.974450955533 / sample_rate);
+	q = 0.7071752369554196;
+	vh = pow(10.0, 3.999843853973347 / 20.0);
+	vb = pow(vh, 0.4996667741545416);
+	set_biquad_coeffs(&f->shelf, vh + vb * k / q + k * k, 2.0 * (k * k - vh), vh - vb * k / q + k * k,
+			  1.0 + k / q + k * k, 2.0 * (k * k - 1.0), 1.0 - k / q + k * k);
+
+	/* only the denominator of the high-pass is normalized, as in the
+	 * reference filter */
+	k = tan(M_PI * 38.13547087602444 / sample_rate);
+	q = 0.5003270373238773;
+	a0 = 1.0 + k / q + k * k;
+	set_biquad_coeffs(&f->highpass, a0, -2.0 * a0, a0, a0, 2.0 * (k * k - 1.0), 1.0 - k / q + k * k);
+
+	/* LFE is left out, surround channels are weighted by +1.5 dB */
+	float weights[MAX_AUDIO_CHANNELS] = {1.0f, 1.0f, 1.0f, 1.0f, 1.41f, 1.41f, 1.41f, 1.41f};
+
+	switch (speakers) {
+	case SPEAKERS_2POINT1:
+		weights[2] = 0.0f;
+		break;
+	case SPEAKERS_4POINT0:
+		weights[3] = 1.41f;
+		break;
+	case SPEAKERS_4POINT1:
+	case SPEAKERS_5POINT1:
+	case SPEAKERS_7POINT1:
+		weights[3] = 0.0f;
+		break;
+	default:;
+	}
+
+	for (size_t g = 0; g < LOUDNESS_GROUPS; g++)
+		f->weights[g] = _mm_loadu_ps(&weights[g * 4]);
+
+	memset(f->z, 0, sizeof(f->z));
+}
+
+/* transposed direct form II */
+#define BIQUAD_PS(y, x, c, z1, z2)                                                         \
+	do {                                                                               \
+		y = _mm_add_ps(_mm_mul_ps(c.b0, x), z1);                                   \
+		z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c.b1, x), _mm_mul_ps(c.a1, y)), z2); \
+		z2 = _mm_sub_ps(_mm_mul_ps(c.b2, x), _mm_mul_ps(c.a2, y));                 \
+	} while (false)
+
+/* Filters frames [start, start + count) of up to four channels and returns
+ * their weighted sum of squares. */
+static float k_filter_run(struct k_filter *f, size_t group, const float *const *planes, size_t start, size_t count)
+{
+	__m128 *z = f->z[group];
+	__m128 sum = _mm_setzero_ps();
+	float in[4] = {0};
+	float r;
+
+	for (size_t i = start; i < start + count; i++) {
+		__m128 x, y;
+
+		for (size_t c = 0; c < 4; c++) {
+			if (planes[c])
+				in[c] = planes[c][i];
+		}
+
+		x = _mm_loadu_ps(in);
+		BIQUAD_PS(y, x, f->shelf, z[0], z[1]);
+		BIQUAD_PS(x, y, f->highpass, z[2], z[3]);
+		sum = _mm_add_ps(sum, _mm_mul_ps(x, x));
+	}
+
+	hsum_ps(r, _mm_mul_ps(sum, f->weights[group]));
+	return r;
+}
+
+static double blocks_mean(const struct audio_loudness *ld, size_t count)
+{
+	double sum = 0.0;
+
+	if (count > ld->num_blocks)
+		count = ld->num_blocks;
+
+	for (size_t i = 0; i < count; i++) {
+		size_t idx = (ld->block_idx + LOUDNESS_SHORT_TERM_BLOCKS - 1 - i) % LOUDNESS_SHORT_TERM_BLOCKS;
+		sum += ld->blocks[idx];
+	}
+
+	return count ? sum / (double)count : 0.0;
+}
+
+/* Gated integrated loudness over every 400 ms block (with 75% overlap) seen
+ * so far.  Blocks are kept as a histogram of counts and summed energy, so
+ * memory does not grow with the length of the measurement and only the
+ * relative gate is quantized. */
+static float loudness_integrated(const struct audio_loudness *ld)
+{
+	double sum = 0.0;
+	uint64_t count = 0;
+
+	for (size_t i = 0; i < LOUDNESS_HISTOGRAM_BINS; i++) {
+		sum += ld->bin_energy[i];
+		count += ld->histogram[i];
+	}
+
+	if (!count)
+		return -INFINITY;
+
+	double gate = energy_to_lufs(sum / (double)count) + LOUDNESS_RELATIVE_GATE;
+	long first = (long)ceil((gate - LOUDNESS_ABSOLUTE_GATE) * 10.0);
+
+	sum = 0.0;
+	count = 0;
+
+	for (long i = first < 0 ? 0 : first; i < LOUDNESS_HISTOGRAM_BINS; i++) {
+		sum += ld->bin_energy[i];
+		count += ld->histogram[i];
+	}
+
+	return count ? (float)energy_to_lufs(sum / (double)count) : -INFINITY;
+}
+
+static void loudness_finish_block(struct audio_loudness *ld)
+{
+	ld->blocks[ld->block_idx] = ld->block_energy / (double)ld->block_frames;
+	ld->block_idx = (ld->block_idx + 1) % LOUDNESS_SHORT_TERM_BLOCKS;
+	if (ld->num_blocks < LOUDNESS_SHORT_TERM_BLOCKS)
+		ld->num_blocks++;
+
+	ld->block_energy = 0.0;
+	ld->block_pos = 0;
+
+	double momentary_energy = blocks_mean(ld, LOUDNESS_MOMENTARY_BLOCKS);
+	double momentary = energy_to_lufs(momentary_energy);
+	ld->momentary = (float)momentary;
+	ld->short_term = (float)energy_to_lufs(blocks_mean(ld, LOUDNESS_SHORT_TERM_BLOCKS));
+
+	if (ld->num_blocks >= LOUDNESS_MOMENTARY_BLOCKS && momentary > LOUDNESS_ABSOLUTE_GATE) {
+		long bin = (long)((momentary - LOUDNESS_ABSOLUTE_GATE) * 10.0);
+		if (bin >= LOUDNESS_HISTOGRAM_BINS)
+			bin = LOUDNESS_HISTOGRAM_BINS - 1;
+		ld->histogram[bin]++;
+		ld->bin_energy[bin] += momentary_energy;
+		ld->integrated = loudness_integrated(ld);
+	}
+}
+
+void audio_loudness_reset(struct audio_loudness *ld, uint32_t sample_rate, enum speaker_layout speakers)
+{
+	memset(ld, 0, sizeof(*ld));
+
+	k_filter_init(&ld->filter, sample_rate, speakers);
+	ld->block_frames = sample_rate * LOUDNESS_BLOCK_MS / 1000;
+
+	ld->momentary = -INFINITY;
+	ld->short_term = -INFINITY;
+	ld->integrated = -INFINITY;
+}
+
+struct audio_loudness *audio_loudness_create(uint32_t sample_rate, enum speaker_layout speakers)
+{
+	struct audio_loudness *ld = bmalloc(sizeof(struct audio_loudness));
+	audio_loudness_reset(ld, sample_rate, speakers);
+	return ld;
+}
+
+void audio_loudness_destroy(struct audio_loudness *ld)
+{
+	bfree(ld);
+}
+
+void audio_loudness_process(struct audio_loudness *ld, const float *const planes[], size_t channels, size_t frames,
+			    float mul)
+{
+	const double gain = (double)mul * (double)mul;
+	size_t pos = 0;
+
+	while (pos < frames) {
+		size_t count = ld->block_frames - ld->block_pos;
+		float energy = 0.0f;
+
+		if (count > frames - pos)
+			count = frames - pos;
+
+		for (size_t g = 0; g < LOUDNESS_GROUPS && g * 4 < channels; g++) {
+			const float *group[4] = {0};
+
+			for (size_t c = 0; c < 4 && g * 4 + c < channels; c++)
+				group[c] = planes[g * 4 + c];
+			energy += k_filter_run(&ld->filter, g, group, pos, count);
+		}
+
+		ld->block_energy += energy * gain;
+		ld->block_pos += count;
+		pos += count;
+
+		if (ld->block_pos == ld->block_frames)
+			loudness_finish_block(ld);
+	}
+}
+
+void audio_loudness_get(const struct audio_loudness *ld, float *momentary, float *short_term, float *integrated)
+{
+	if (momentary)
+		*momentary = ld->momentary;
+	if (short_term)
+		*short_term = ld->short_term;
+	if (integrated)
+		*integrated = ld->integrated;
+}
@@ -0,0 +1,53 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "audio-io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * EBU R128 / ITU-R BS.1770 loudness meter.  Audio is K-weighted and summed
+ * in 100 ms blocks; the momentary (400 ms) and short-term (3 s) loudness
+ * are updated after every block, and the gated integrated loudness covers
+ * everything since the meter was created or last reset.  All values are in
+ * LUFS, -INFINITY until there is enough audio.
+ */
+
+struct audio_loudness;
+
+EXPORT struct audio_loudness *audio_loudness_create(uint32_t sample_rate, enum speaker_layout speakers);
+EXPORT void audio_loudness_destroy(struct audio_loudness *ld);
+EXPORT void audio_loudness_reset(struct audio_loudness *ld, uint32_t sample_rate, enum speaker_layout speakers);
+
+/**
+ * Measures one channel per plane, in speaker layout order.  mul is a gain
+ * applied to the audio before it is measured.
+ */
+EXPORT void audio_loudness_process(struct audio_loudness *ld, const float *const planes[], size_t channels,
+				   size_t frames, float mul);
+
+/** Any of the values may be NULL */
+EXPORT void audio_loudness_get(const struct audio_loudness *ld, float *momentary, float *short_term,
+			       float *integrated);
+
+#ifdef __cplusplus
+}
+#endif
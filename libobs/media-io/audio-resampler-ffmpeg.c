@@ -22,18 +22,14 @@
 #include <libavformat/avformat.h>
 #include <libswresample/swresample.h>
 
-struct audio_resampler {
+struct swr_resampler {
 	struct SwrContext *context;
-	bool opened;
 
 	uint32_t input_freq;
 	enum AVSampleFormat input_format;
-	uint8_t *output_buffer[MAX_AV_PLANES];
 	enum AVSampleFormat output_format;
-	int output_size;
 	uint32_t output_ch;
 	uint32_t output_freq;
-	uint32_t output_planes;
 #if LIBSWRESAMPLE_VERSION_INT < AV_VERSION_INT(4, 5, 100)
 	uint64_t input_layout;
 	uint64_t output_layout;
@@ -97,19 +93,18 @@ static inline uint64_t convert_speaker_layout(enum speaker_layout layout)
 }
 #endif
 
-audio_resampler_t *audio_resampler_create(const struct resample_info *dst, const struct resample_info *src)
+static void swr_resampler_destroy(void *data);
+
+static void *swr_resampler_create(const struct resample_info *dst, const struct resample_info *src)
 {
-	struct audio_resampler *rs = bzalloc(sizeof(struct audio_resampler));
+	struct swr_resampler *rs = bzalloc(sizeof(struct swr_resampler));
 	int errcode;
 
-	rs->opened = false;
 	rs->input_freq = src->samples_per_sec;
 	rs->input_format = convert_audio_format(src->format);
-	rs->output_size = 0;
 	rs->output_ch = get_audio_channels(dst->speakers);
 	rs->output_freq = dst->samples_per_sec;
 	rs->output_format = convert_audio_format(dst->format);
-	rs->output_planes = is_audio_planar(dst->format) ? rs->output_ch : 1;
 
 #if (LIBSWRESAMPLE_VERSION_INT < AV_VERSION_INT(4, 5, 100))
 	rs->input_layout = convert_speaker_layout(src->speakers);
@@ -132,7 +127,7 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst, const
 
 	if (!rs->context) {
 		blog(LOG_ERROR, "swr_alloc_set_opts failed");
-		audio_resampler_destroy(rs);
+		swr_resampler_destroy(rs);
 		return NULL;
 	}
 
@@ -159,60 +154,63 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst, const
 	errcode = swr_init(rs->context);
 	if (errcode != 0) {
 		blog(LOG_ERROR, "avresample_open failed: error code %d", errcode);
-		audio_resampler_destroy(rs);
+		swr_resampler_destroy(rs);
 		return NULL;
 	}
 
 	return rs;
 }
 
-void audio_resampler_destroy(audio_resampler_t *rs)
+static void swr_resampler_destroy(void *data)
 {
+	struct swr_resampler *rs = data;
+
 	if (rs) {
 		if (rs->context)
 			swr_free(&rs->context);
-		if (rs->output_buffer[0])
-			av_freep(&rs->output_buffer[0]);
 
 		bfree(rs);
 	}
 }
 
-bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[], uint32_t *out_frames, uint64_t *ts_offset,
-			      const uint8_t *const input[], uint32_t in_frames)
+static uint32_t swr_resampler_get_max_output(void *data, uint32_t in_frames)
 {
-	if (!rs)
-		return false;
-
-	struct SwrContext *context = rs->context;
-	int ret;
-
-	int64_t delay = swr_get_delay(context, rs->input_freq);
-	int estimated = (int)av_rescale_rnd(delay + (int64_t)in_frames, (int64_t)rs->output_freq,
-					    (int64_t)rs->input_freq, AV_ROUND_UP);
+	struct swr_resampler *rs = data;
+	int64_t delay = swr_get_delay(rs->context, rs->input_freq);
 
-	*ts_offset = (uint64_t)swr_get_delay(context, 1000000000);
-
-	/* resize the buffer if bigger */
-	if (estimated > rs->output_size) {
-		if (rs->output_buffer[0])
-			av_freep(&rs->output_buffer[0]);
-
-		av_samples_alloc(rs->output_buffer, NULL, rs->output_ch, estimated, rs->output_format, 0);
+	return (uint32_t)av_rescale_rnd(delay + (int64_t)in_frames, (int64_t)rs->output_freq, (int64_t)rs->input_freq,
+					AV_ROUND_UP);
+}
 
-		rs->output_size = estimated;
-	}
+static uint64_t swr_resampler_get_delay(void *data)
+{
+	struct swr_resampler *rs = data;
+	return (uint64_t)swr_get_delay(rs->context, 1000000000);
+}
 
-	ret = swr_convert(context, rs->output_buffer, rs->output_size, (const uint8_t **)input, in_frames);
+static int swr_resampler_convert(void *data, uint8_t *const output[], uint32_t out_capacity,
+				 const uint8_t *const input[], uint32_t in_frames)
+{
+	struct swr_resampler *rs = data;
+	int ret = swr_convert(rs->context, (uint8_t **)output, (int)out_capacity, (const uint8_t **)input,
+			      (int)in_frames);
 
-	if (ret < 0) {
+	if (ret < 0)
 		blog(LOG_ERROR, "swr_convert failed: %d", ret);
-		return false;
-	}
 
-	for (uint32_t i = 0; i < rs->output_planes; i++)
-		output[i] = rs->output_buffer[i];
+	return ret;
+}
+
+static const struct audio_resampler_backend swr_backend = {
+	.name = "swresample",
+	.create = swr_resampler_create,
+	.destroy = swr_resampler_destroy,
+	.get_max_output = swr_resampler_get_max_output,
+	.get_delay = swr_resampler_get_delay,
+	.convert = swr_resampler_convert,
+};
 
-	*out_frames = (uint32_t)ret;
-	return true;
+const struct audio_resampler_backend *audio_resampler_swr_backend(void)
+{
+	return &swr_backend;
 }
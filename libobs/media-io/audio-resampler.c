@@ -0,0 +1,113 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "../util/bmem.h"
+#include "audio-resampler.h"
+#include "audio-io.h"
+
+struct audio_resampler {
+	const struct audio_resampler_backend *backend;
+	void *data;
+
+	/* buffers for audio_resampler_resample */
+	uint8_t *output_buffer[MAX_AV_PLANES];
+	uint32_t output_size;
+	uint32_t output_planes;
+	size_t output_frame_size;
+};
+
+audio_resampler_t *audio_resampler_create(const struct resample_info *dst, const struct resample_info *src)
+{
+	return audio_resampler_create_with_backend(audio_resampler_swr_backend(), dst, src);
+}
+
+audio_resampler_t *audio_resampler_create_with_backend(const struct audio_resampler_backend *backend,
+						       const struct resample_info *dst, const struct resample_info *src)
+{
+	void *data = backend->create(dst, src);
+	if (!data)
+		return NULL;
+
+	struct audio_resampler *rs = bzalloc(sizeof(struct audio_resampler));
+	bool planar = is_audio_planar(dst->format);
+	size_t channels = get_audio_channels(dst->speakers);
+
+	rs->backend = backend;
+	rs->data = data;
+	rs->output_planes = planar ? (uint32_t)channels : 1;
+	rs->output_frame_size = (planar ? 1 : channels) * get_audio_bytes_per_channel(dst->format);
+	return rs;
+}
+
+void audio_resampler_destroy(audio_resampler_t *rs)
+{
+	if (rs) {
+		rs->backend->destroy(rs->data);
+		bfree(rs->output_buffer[0]);
+		bfree(rs);
+	}
+}
+
+uint32_t audio_resampler_get_max_output(audio_resampler_t *rs, uint32_t in_frames)
+{
+	return rs ? rs->backend->get_max_output(rs->data, in_frames) : 0;
+}
+
+bool audio_resampler_convert(audio_resampler_t *rs, uint8_t *const output[], uint32_t out_capacity,
+			     uint32_t *out_frames, uint64_t *ts_offset, const uint8_t *const input[], uint32_t in_frames)
+{
+	if (!rs)
+		return false;
+
+	*ts_offset = rs->backend->get_delay(rs->data);
+
+	int ret = rs->backend->convert(rs->data, output, out_capacity, input, in_frames);
+	if (ret < 0)
+		return false;
+
+	*out_frames = (uint32_t)ret;
+	return true;
+}
+
+bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[], uint32_t *out_frames, uint64_t *ts_offset,
+			      const uint8_t *const input[], uint32_t in_frames)
+{
+	if (!rs)
+		return false;
+
+	uint32_t estimated = rs->backend->get_max_output(rs->data, in_frames);
+
+	/* resize the buffer if bigger */
+	if (estimated > rs->output_size) {
+		size_t plane_size = (estimated * rs->output_frame_size + 31) & ~(size_t)31;
+
+		bfree(rs->output_buffer[0]);
+		rs->output_buffer[0] = bmalloc(plane_size * rs->output_planes);
+		for (uint32_t i = 1; i < rs->output_planes; i++)
+			rs->output_buffer[i] = rs->output_buffer[i - 1] + plane_size;
+
+		rs->output_size = estimated;
+	}
+
+	if (!audio_resampler_convert(rs, rs->output_buffer, rs->output_size, out_frames, ts_offset, input, in_frames))
+		return false;
+
+	for (uint32_t i = 0; i < rs->output_planes; i++)
+		output[i] = rs->output_buffer[i];
+
+	return true;
+}
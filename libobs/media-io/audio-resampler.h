@@ -33,12 +33,51 @@ struct resample_info {
 	enum speaker_layout speakers;
 };
 
+/**
+ * Conversion implementation behind an audio_resampler.  Backends convert
+ * into buffers owned by the caller and must not allocate per call.
+ */
+struct audio_resampler_backend {
+	const char *name;
+
+	void *(*create)(const struct resample_info *dst, const struct resample_info *src);
+	void (*destroy)(void *data);
+
+	/** Upper bound of the frames the next convert call can produce */
+	uint32_t (*get_max_output)(void *data, uint32_t in_frames);
+
+	/** Input buffered inside the backend, in nanoseconds */
+	uint64_t (*get_delay)(void *data);
+
+	/** Returns the number of frames written, or a negative value on error */
+	int (*convert)(void *data, uint8_t *const output[], uint32_t out_capacity, const uint8_t *const input[],
+		       uint32_t in_frames);
+};
+
+/** The default backend, based on libswresample */
+EXPORT const struct audio_resampler_backend *audio_resampler_swr_backend(void);
+
 EXPORT audio_resampler_t *audio_resampler_create(const struct resample_info *dst, const struct resample_info *src);
+EXPORT audio_resampler_t *audio_resampler_create_with_backend(const struct audio_resampler_backend *backend,
+							     const struct resample_info *dst,
+							     const struct resample_info *src);
 EXPORT void audio_resampler_destroy(audio_resampler_t *resampler);
 
+/** Converts into buffers owned by the resampler, valid until the next call */
 EXPORT bool audio_resampler_resample(audio_resampler_t *resampler, uint8_t *output[], uint32_t *out_frames,
 				     uint64_t *ts_offset, const uint8_t *const input[], uint32_t in_frames);
 
+/** Upper bound of the output frames for in_frames of input at this point */
+EXPORT uint32_t audio_resampler_get_max_output(audio_resampler_t *resampler, uint32_t in_frames);
+
+/**
+ * Converts into caller-provided buffers with room for out_capacity frames,
+ * one per plane of the destination format.
+ */
+EXPORT bool audio_resampler_convert(audio_resampler_t *resampler, uint8_t *const output[], uint32_t out_capacity,
+				    uint32_t *out_frames, uint64_t *ts_offset, const uint8_t *const input[],
+				    uint32_t in_frames);
+
 #ifdef __cplusplus
 }
 #endif
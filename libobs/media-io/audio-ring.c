@@ -0,0 +1,353 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <string.h>
+
+#include "../util/bmem.h"
+#include "../util/threading.h"
+#include "audio-io.h"
+#include "audio-ring.h"
+
+/*
+ * A position and timestamp shared by one side with the other.  It is written
+ * to the slot the reader is not using and then made current by bumping the
+ * version, so a reader never waits on a writer that has been preempted; it
+ * only retries if the version changed while it was reading.
+ */
+struct ring_base_slot {
+	volatile long pos;
+	volatile long ts_lo;
+	volatile long ts_hi;
+	volatile long count;
+};
+
+struct ring_base {
+	struct ring_base_slot slots[2];
+	volatile long version;
+};
+
+struct audio_ring {
+	float *data[MAX_AUDIO_CHANNELS];
+	size_t channels;
+	uint32_t capacity;
+	uint32_t mask;
+
+	/* producer */
+	volatile long write_pos;
+	volatile long writes;
+	struct ring_base reset; /* count: number of resets */
+	uint8_t pad0[64];
+
+	/* consumer */
+	struct ring_base read; /* count: resets applied */
+	uint32_t read_pos;
+	long resets_applied;
+	uint8_t pad1[64];
+};
+
+static void set_base(struct ring_base *base, uint32_t pos, uint64_t ts, long count)
+{
+	long version = base->version;
+	struct ring_base_slot *slot = &base->slots[(version + 1) & 1];
+
+	os_atomic_store_long(&slot->pos, (long)pos);
+	os_atomic_store_long(&slot->ts_lo, (long)(uint32_t)ts);
+	os_atomic_store_long(&slot->ts_hi, (long)(uint32_t)(ts >> 32));
+	os_atomic_store_long(&slot->count, count);
+	os_atomic_store_long(&base->version, version + 1);
+}
+
+static void get_base(const struct ring_base *base, uint32_t *pos, uint64_t *ts, long *count)
+{
+	long version;
+
+	do {
+		version = os_atomic_load_long(&base->version);
+		const struct ring_base_slot *slot = &base->slots[version & 1];
+
+		*pos = (uint32_t)os_atomic_load_long(&slot->pos);
+		*ts = (uint64_t)(uint32_t)os_atomic_load_long(&slot->ts_lo) |
+		      ((uint64_t)(uint32_t)os_atomic_load_long(&slot->ts_hi) << 32);
+		*count = os_atomic_load_long(&slot->count);
+	} while (os_atomic_load_long(&base->version) != version);
+}
+
+struct audio_ring *audio_ring_create(size_t channels, uint32_t frames)
+{
+	struct audio_ring *ring;
+	uint32_t capacity = 1024;
+
+	if (!channels || channels > MAX_AUDIO_CHANNELS)
+		return NULL;
+
+	while (capacity < frames && capacity < 0x40000000U)
+		capacity <<= 1;
+
+	ring = bzalloc(sizeof(struct audio_ring));
+	ring->channels = channels;
+	ring->capacity = capacity;
+	ring->mask = capacity - 1;
+
+	ring->data[0] = bzalloc(sizeof(float) * capacity * channels);
+	for (size_t ch = 1; ch < channels; ch++)
+		ring->data[ch] = ring->data[ch - 1] + capacity;
+
+	return ring;
+}
+
+void audio_ring_destroy(struct audio_ring *ring)
+{
+	if (!ring)
+		return;
+
+	bfree(ring->data[0]);
+	bfree(ring);
+}
+
+size_t audio_ring_channels(const struct audio_ring *ring)
+{
+	return ring ? ring->channels : 0;
+}
+
+uint32_t audio_ring_capacity(const struct audio_ring *ring)
+{
+	return ring ? ring->capacity : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void write_frames(struct audio_ring *ring, uint32_t pos, const uint8_t *const data[], uint32_t offset,
+			 uint32_t frames)
+{
+	uint32_t start = pos & ring->mask;
+	uint32_t first = ring->capacity - start;
+	if (first > frames)
+		first = frames;
+
+	for (size_t ch = 0; ch < ring->channels; ch++) {
+		float *dst = ring->data[ch];
+
+		if (data && data[ch]) {
+			const float *src = (const float *)data[ch] + offset;
+			memcpy(dst + start, src, first * sizeof(float));
+			memcpy(dst, src + first, (frames - first) * sizeof(float));
+		} else {
+			memset(dst + start, 0, first * sizeof(float));
+			memset(dst, 0, (frames - first) * sizeof(float));
+		}
+	}
+}
+
+void audio_ring_get_base(const struct audio_ring *ring, uint32_t *pos, uint64_t *ts)
+{
+	uint32_t reset_pos;
+	uint64_t reset_ts;
+	long resets, applied;
+
+	get_base(&ring->reset, &reset_pos, &reset_ts, &resets);
+	get_base(&ring->read, pos, ts, &applied);
+
+	/* the consumer has not seen the latest reset yet */
+	if (applied != resets) {
+		*pos = reset_pos;
+		*ts = reset_ts;
+	}
+}
+
+uint32_t audio_ring_end(const struct audio_ring *ring)
+{
+	return (uint32_t)ring->write_pos;
+}
+
+uint32_t audio_ring_needed(const struct audio_ring *ring, uint32_t pos, uint32_t frames)
+{
+	uint32_t read_pos;
+	uint64_t ts;
+	long applied;
+
+	get_base(&ring->read, &read_pos, &ts, &applied);
+
+	int32_t needed = (int32_t)(pos + frames - read_pos);
+	return needed > 0 ? (uint32_t)needed : 0;
+}
+
+bool audio_ring_place(struct audio_ring *ring, uint32_t pos, const uint8_t *const data[], uint32_t frames)
+{
+	uint32_t write_pos = (uint32_t)ring->write_pos;
+	uint32_t end = pos + frames;
+	uint32_t read_pos;
+	uint64_t ts;
+	long applied;
+
+	get_base(&ring->read, &read_pos, &ts, &applied);
+
+	if ((int32_t)(end - read_pos) > (int32_t)ring->capacity)
+		return false;
+
+	/* nothing before the read position will be read again */
+	uint32_t skip = (int32_t)(read_pos - pos) > 0 ? read_pos - pos : 0;
+	if (skip > frames)
+		skip = frames;
+
+	if ((int32_t)(write_pos - read_pos) < 0)
+		write_pos = read_pos;
+	if ((int32_t)(pos + skip - write_pos) > 0)
+		write_frames(ring, write_pos, NULL, 0, pos + skip - write_pos);
+
+	write_frames(ring, pos + skip, data, skip, frames - skip);
+
+	if ((int32_t)(end - read_pos) < 0)
+		end = read_pos;
+
+	os_atomic_store_long(&ring->write_pos, (long)end);
+	os_atomic_inc_long(&ring->writes);
+	return true;
+}
+
+bool audio_ring_push_back(struct audio_ring *ring, const uint8_t *const data[], uint32_t frames)
+{
+	return audio_ring_place(ring, (uint32_t)ring->write_pos, data, frames);
+}
+
+void audio_ring_reset(struct audio_ring *ring, uint64_t ts)
+{
+	uint32_t pos;
+	uint64_t prev_ts;
+	long resets;
+
+	get_base(&ring->reset, &pos, &prev_ts, &resets);
+	set_base(&ring->reset, (uint32_t)ring->write_pos, ts, resets + 1);
+}
+
+void audio_ring_copy(struct audio_ring *dst, const struct audio_ring *src)
+{
+	uint32_t read_pos, reset_pos;
+	uint64_t read_ts, reset_ts;
+	long applied, resets;
+
+	get_base(&src->read, &read_pos, &read_ts, &applied);
+	get_base(&src->reset, &reset_pos, &reset_ts, &resets);
+
+	set_base(&dst->read, read_pos, read_ts, applied);
+	set_base(&dst->reset, reset_pos, reset_ts, resets);
+	dst->read_pos = read_pos;
+	dst->resets_applied = applied;
+
+	uint32_t write_pos = (uint32_t)src->write_pos;
+	int32_t queued = (int32_t)(write_pos - read_pos);
+	if (queued > (int32_t)dst->capacity)
+		queued = (int32_t)dst->capacity;
+
+	for (uint32_t done = 0; queued > 0 && done < (uint32_t)queued;) {
+		uint32_t pos = read_pos + done;
+		uint32_t start = pos & src->mask;
+		uint32_t count = src->capacity - start;
+		if (count > (uint32_t)queued - done)
+			count = (uint32_t)queued - done;
+
+		const uint8_t *data[MAX_AUDIO_CHANNELS] = {0};
+		for (size_t ch = 0; ch < src->channels && ch < dst->channels; ch++)
+			data[ch] = (const uint8_t *)(src->data[ch] + start);
+
+		write_frames(dst, pos, data, 0, count);
+		done += count;
+	}
+
+	dst->write_pos = (long)write_pos;
+	dst->writes = src->writes;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void audio_ring_adopt(struct audio_ring *ring, const struct audio_ring *src)
+{
+	if (!src)
+		return;
+
+	ring->read_pos = src->read_pos;
+	ring->resets_applied = src->resets_applied;
+}
+
+bool audio_ring_acquire(struct audio_ring *ring, uint64_t *ts)
+{
+	uint32_t pos;
+	long resets;
+
+	get_base(&ring->reset, &pos, ts, &resets);
+	if (resets == ring->resets_applied)
+		return false;
+
+	ring->read_pos = pos;
+	ring->resets_applied = resets;
+	return true;
+}
+
+static inline uint32_t read_end(const struct audio_ring *ring)
+{
+	uint32_t end = (uint32_t)os_atomic_load_long(&ring->write_pos);
+	uint32_t reset_pos;
+	uint64_t ts;
+	long resets;
+
+	/* data written after a reset belongs to the next timeline */
+	get_base(&ring->reset, &reset_pos, &ts, &resets);
+	return resets == ring->resets_applied ? end : reset_pos;
+}
+
+uint32_t audio_ring_size(const struct audio_ring *ring)
+{
+	int32_t size = (int32_t)(read_end(ring) - ring->read_pos);
+	return size > 0 ? (uint32_t)size : 0;
+}
+
+long audio_ring_writes(const struct audio_ring *ring)
+{
+	return os_atomic_load_long(&ring->writes);
+}
+
+void audio_ring_peek(const struct audio_ring *ring, float *const data[], size_t channels, uint32_t frames)
+{
+	uint32_t start = ring->read_pos & ring->mask;
+	uint32_t first = ring->capacity - start;
+	if (first > frames)
+		first = frames;
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		if (ch >= ring->channels) {
+			memset(data[ch], 0, frames * sizeof(float));
+			continue;
+		}
+
+		memcpy(data[ch], ring->data[ch] + start, first * sizeof(float));
+		memcpy(data[ch] + first, ring->data[ch], (frames - first) * sizeof(float));
+	}
+}
+
+void audio_ring_pop(struct audio_ring *ring, uint32_t frames)
+{
+	ring->read_pos += frames;
+}
+
+void audio_ring_clear(struct audio_ring *ring)
+{
+	ring->read_pos = read_end(ring);
+}
+
+void audio_ring_release(struct audio_ring *ring, uint64_t ts)
+{
+	set_base(&ring->read, ring->read_pos, ts, ring->resets_applied);
+}
@@ -0,0 +1,103 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed-capacity planar float ring with one producer and one consumer and no
+ * locking between them.
+ *
+ * Positions are free-running frame counters wrapped to 32 bits.  The
+ * consumer owns the read position and the timestamp of the frame at it, and
+ * publishes both once per tick with audio_ring_release().  The producer
+ * places data at positions relative to that published base, and can start a
+ * new timeline with audio_ring_reset(), which the consumer picks up on its
+ * next audio_ring_acquire().  Until then the consumer never reads past the
+ * point where the reset happened.
+ */
+
+struct audio_ring;
+
+EXPORT struct audio_ring *audio_ring_create(size_t channels, uint32_t frames);
+EXPORT void audio_ring_destroy(struct audio_ring *ring);
+
+EXPORT size_t audio_ring_channels(const struct audio_ring *ring);
+EXPORT uint32_t audio_ring_capacity(const struct audio_ring *ring);
+
+/* ------------------------------------------------------------------------- */
+/* producer */
+
+/** Position and timestamp new data is placed relative to */
+EXPORT void audio_ring_get_base(const struct audio_ring *ring, uint32_t *pos, uint64_t *ts);
+
+/** Position after the last frame written */
+EXPORT uint32_t audio_ring_end(const struct audio_ring *ring);
+
+/** Frames between the consumer's published read position and pos + frames */
+EXPORT uint32_t audio_ring_needed(const struct audio_ring *ring, uint32_t pos, uint32_t frames);
+
+/**
+ * Writes frames at an absolute position and drops anything after them.  A
+ * gap to the previous end is filled with silence.  Fails if the ring is too
+ * small, see audio_ring_needed().
+ */
+EXPORT bool audio_ring_place(struct audio_ring *ring, uint32_t pos, const uint8_t *const data[], uint32_t frames);
+
+/** Appends frames after the current end */
+EXPORT bool audio_ring_push_back(struct audio_ring *ring, const uint8_t *const data[], uint32_t frames);
+
+/** Drops all queued data and starts a new timeline at ts */
+EXPORT void audio_ring_reset(struct audio_ring *ring, uint64_t ts);
+
+/**
+ * Copies the queued data and the state of both sides into a larger ring.
+ * The producer continues on dst right away, the consumer has to call
+ * audio_ring_adopt() before it reads from dst.
+ */
+EXPORT void audio_ring_copy(struct audio_ring *dst, const struct audio_ring *src);
+
+/* ------------------------------------------------------------------------- */
+/* consumer */
+
+/** Takes over the consumer side of src after audio_ring_copy() */
+EXPORT void audio_ring_adopt(struct audio_ring *ring, const struct audio_ring *src);
+
+/** Applies a pending reset; returns true and its timestamp if there was one */
+EXPORT bool audio_ring_acquire(struct audio_ring *ring, uint64_t *ts);
+
+/** Number of frames that can be read */
+EXPORT uint32_t audio_ring_size(const struct audio_ring *ring);
+
+/** Counts writes, so that a stalled producer can be told apart */
+EXPORT long audio_ring_writes(const struct audio_ring *ring);
+
+EXPORT void audio_ring_peek(const struct audio_ring *ring, float *const data[], size_t channels, uint32_t frames);
+EXPORT void audio_ring_pop(struct audio_ring *ring, uint32_t frames);
+EXPORT void audio_ring_clear(struct audio_ring *ring);
+
+/** Publishes the read position along with the timestamp of the frame at it */
+EXPORT void audio_ring_release(struct audio_ring *ring, uint64_t ts);
+
+#ifdef __cplusplus
+}
+#endif
@@ -47,14 +47,13 @@ struct video_input {
 	int cur_frame;
 
 	// allow outputting at fractions of main composition FPS,
-	// e.g. 60 FPS with frame_rate_divisor = 1 turns into 30 FPS
+	// e.g. 60 FPS with frame_rate_divisor = 2 turns into 30 FPS
 	//
-	// a separate counter is used in favor of using remainder calculations
-	// to allow "inputs" started at the same time to start on the same frame
-	// whereas with remainder calculation the frame alignment would depend on
-	// the total frame count at the time the encoder was started
+	// an input takes the frames whose index (counted from when the first
+	// input connected) is a multiple of its divisor, so that all inputs
+	// take the same frames and the frames in between never need to be
+	// rendered (see video_output_get_frame_rate_divisor)
 	uint32_t frame_rate_divisor;
-	uint32_t frame_rate_divisor_counter;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
@@ -81,6 +80,8 @@ struct video_output {
 
 	pthread_mutex_t input_mutex;
 	DARRAY(struct video_input) inputs;
+	uint64_t frame_index;
+	volatile long frame_rate_divisor;
 
 	size_t available_frames;
 	size_t first_added;
@@ -145,20 +146,15 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		struct video_input *input = video->inputs.array + i;
 		struct video_data frame = frame_info->frame;
 
-		// an explicit counter is used instead of remainder calculation
-		// to allow multiple encoders started at the same time to start on
-		// the same frame
-		uint32_t skip = input->frame_rate_divisor_counter++;
-		if (input->frame_rate_divisor_counter == input->frame_rate_divisor)
-			input->frame_rate_divisor_counter = 0;
-
-		if (skip)
+		if (video->frame_index % input->frame_rate_divisor)
 			continue;
 
 		if (scale_video_output(input, &frame))
 			input->callback(input->param, &frame);
 	}
 
+	video->frame_index++;
+
 	pthread_mutex_unlock(&video->input_mutex);
 
 	/* -------------------------------- */
@@ -375,6 +371,27 @@ static inline void reset_frames(video_t *video)
 	os_atomic_set_long(&video->total_frames, 0);
 }
 
+static inline uint32_t gcd_u32(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* must be called with input_mutex held */
+static void update_frame_rate_divisor(video_t *video)
+{
+	uint32_t divisor = 0;
+
+	for (size_t i = 0; i < video->inputs.num; i++)
+		divisor = gcd_u32(divisor, video->inputs.array[i].frame_rate_divisor);
+
+	os_atomic_set_long(&video->frame_rate_divisor, divisor ? (long)divisor : 1);
+}
+
 static const video_t *get_const_root(const video_t *video)
 {
 	while (video->parent)
@@ -438,8 +455,10 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 					reset_frames(video);
 				}
 				os_atomic_set_bool(&video->raw_active, true);
+				video->frame_index = 0;
 			}
 			da_push_back(video->inputs, &input);
+			update_frame_rate_divisor(video);
 		}
 	}
 
@@ -475,6 +494,7 @@ void video_output_disconnect(video_t *video, void (*callback)(void *param, struc
 	if (idx != DARRAY_INVALID) {
 		video_input_free(video->inputs.array + idx);
 		da_erase(video->inputs, idx);
+		update_frame_rate_divisor(video);
 
 		if (video->inputs.num == 0) {
 			os_atomic_set_bool(&video->raw_active, false);
@@ -606,6 +626,15 @@ double video_output_get_frame_rate(const video_t *video)
 	return (double)video->info.fps_num / (double)video->info.fps_den;
 }
 
+uint32_t video_output_get_frame_rate_divisor(const video_t *video)
+{
+	if (!video)
+		return 1;
+
+	long divisor = os_atomic_load_long(&get_const_root(video)->frame_rate_divisor);
+	return divisor ? (uint32_t)divisor : 1;
+}
+
 uint32_t video_output_get_skipped_frames(const video_t *video)
 {
 	return (uint32_t)os_atomic_load_long(&get_const_root(video)->skipped_frames);
@@ -319,6 +319,7 @@ EXPORT enum video_format video_output_get_format(const video_t *video);
 EXPORT uint32_t video_output_get_width(const video_t *video);
 EXPORT uint32_t video_output_get_height(const video_t *video);
 EXPORT double video_output_get_frame_rate(const video_t *video);
+EXPORT uint32_t video_output_get_frame_rate_divisor(const video_t *video);
 
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util/threading.h"
 #include "util/bmem.h"
 #include "media-io/audio-math.h"
+#include "media-io/audio-loudness.h"
 #include "obs.h"
 #include "obs-internal.h"
 
@@ -76,6 +77,11 @@ struct obs_volmeter {
 
 	float magnitude[MAX_AUDIO_CHANNELS];
 	float peak[MAX_AUDIO_CHANNELS];
+
+	/* last levels reported, in dB */
+	struct obs_volmeter_levels levels;
+
+	struct audio_loudness *loudness;
 };
 
 static float cubic_def_to_db(const float def)
@@ -293,6 +299,16 @@ static int get_nr_channels_from_audio_data(const struct audio_data *data)
 		out = _mm_add_ps(out, mul3);              \
 	}
 
+/* x4(d, c, b, a)  -->  a + b + c + d
+ */
+#define hsum_ps(r, x4)                      \
+	do {                                \
+		float x4_mem[4];            \
+		_mm_storeu_ps(x4_mem, x4);  \
+		r = x4_mem[0] + x4_mem[1];  \
+		r += x4_mem[2] + x4_mem[3]; \
+	} while (false)
+
 /* x4(d, c, b, a)  -->  max(a, b, c, d)
  */
 #define hmax_ps(r, x4)                     \
@@ -312,12 +328,15 @@ static int get_nr_channels_from_audio_data(const struct audio_data *data)
  * The four samples have location t=-1.5, -0.5, +0.5, +1.5
  * The oversamples are taken at locations t=-0.3, -0.1, +0.1, +0.3
  *
+ * The sum of squares for the magnitude is accumulated in the same pass.
+ *
  * @param previous_samples  Last 4 samples from the previous iteration.
  * @param samples           The samples to find the peak in.
  * @param nr_samples        Number of sets of 4 samples.
+ * @param sum_squares       Sum of the squares of the samples read.
  * @returns 5 times oversampled true-peak from the set of samples.
  */
-static float get_true_peak(__m128 previous_samples, const float *samples, size_t nr_samples)
+static float get_true_peak(__m128 previous_samples, const float *samples, size_t nr_samples, float *sum_squares)
 {
 	/* These are normalized-sinc parameters for interpolating over sample
 	 * points which are located at x-coords: -1.5, -0.5, +0.5, +1.5.
@@ -329,10 +348,13 @@ static float get_true_peak(__m128 previous_samples, const float *samples, size_t
 
 	__m128 work = previous_samples;
 	__m128 peak = previous_samples;
+	__m128 sum = _mm_setzero_ps();
 	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
 		__m128 new_work = _mm_load_ps(&samples[i]);
 		__m128 intrp_samples;
 
+		sum = _mm_add_ps(sum, _mm_mul_ps(new_work, new_work));
+
 		/* Include the actual sample values in the peak. */
 		__m128 abs_new_work = abs_ps(new_work);
 		peak = _mm_max_ps(peak, abs_new_work);
@@ -355,6 +377,8 @@ static float get_true_peak(__m128 previous_samples, const float *samples, size_t
 		peak = _mm_max_ps(peak, abs_ps(intrp_samples));
 	}
 
+	hsum_ps(*sum_squares, sum);
+
 	float r;
 	hmax_ps(r, peak);
 	return r;
@@ -362,20 +386,50 @@ static float get_true_peak(__m128 previous_samples, const float *samples, size_t
 
 /* points contain the first four samples to calculate the sinc interpolation
  * over. They will have come from a previous iteration.
+ *
+ * Works on 8 samples per iteration with two sets of accumulators to keep
+ * more independent operations in flight.
  */
-static float get_sample_peak(__m128 previous_samples, const float *samples, size_t nr_samples)
-{
-	__m128 peak = previous_samples;
-	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
-		__m128 new_work = _mm_load_ps(&samples[i]);
-		peak = _mm_max_ps(peak, abs_ps(new_work));
+static float get_sample_peak(__m128 previous_samples, const float *samples, size_t nr_samples, float *sum_squares)
+{
+	__m128 peak0 = previous_samples;
+	__m128 peak1 = previous_samples;
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	size_t i = 0;
+
+	for (; (i + 7) < nr_samples; i += 8) {
+		__m128 work0 = _mm_load_ps(&samples[i]);
+		__m128 work1 = _mm_load_ps(&samples[i + 4]);
+		peak0 = _mm_max_ps(peak0, abs_ps(work0));
+		peak1 = _mm_max_ps(peak1, abs_ps(work1));
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(work0, work0));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(work1, work1));
+	}
+
+	for (; (i + 3) < nr_samples; i += 4) {
+		__m128 work = _mm_load_ps(&samples[i]);
+		peak0 = _mm_max_ps(peak0, abs_ps(work));
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(work, work));
 	}
 
+	hsum_ps(*sum_squares, _mm_add_ps(sum0, sum1));
+
 	float r;
-	hmax_ps(r, peak);
+	hmax_ps(r, _mm_max_ps(peak0, peak1));
 	return r;
 }
 
+/* Sum of squares of the samples past the last full set of 4, which the peak
+ * kernels leave out */
+static inline float sum_squares_tail(const float *samples, size_t start, size_t nr_samples)
+{
+	float sum = 0.0f;
+	for (size_t i = start; i < nr_samples; i++)
+		sum += samples[i] * samples[i];
+	return sum;
+}
+
 static void volmeter_process_peak_last_samples(obs_volmeter_t *volmeter, int channel_nr, float *samples,
 					       size_t nr_samples)
 {
@@ -412,12 +466,18 @@ static void volmeter_process_peak_last_samples(obs_volmeter_t *volmeter, int cha
 	}
 }
 
-static void volmeter_process_peak(obs_volmeter_t *volmeter, const struct audio_data *data, int nr_channels)
+/* Peak and magnitude of every channel, reading each channel once. */
+static void volmeter_process_audio_data(obs_volmeter_t *volmeter, const struct audio_data *data)
 {
-	int nr_samples = data->frames;
+	int nr_channels = get_nr_channels_from_audio_data(data);
+	size_t nr_samples = data->frames;
 	int channel_nr = 0;
+
 	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
 		float *samples = (float *)data->data[plane_nr];
+		float sum_squares;
+		float peak;
+
 		if (!samples) {
 			continue;
 		}
@@ -426,6 +486,8 @@ static void volmeter_process_peak(obs_volmeter_t *volmeter, const struct audio_d
 			       "peak volume measurement.\n",
 			       plane_nr, samples);
 			volmeter->peak[channel_nr] = 1.0;
+			volmeter->magnitude[channel_nr] =
+				nr_samples ? sqrtf(sum_squares_tail(samples, 0, nr_samples) / nr_samples) : 0.0f;
 			channel_nr++;
 			continue;
 		}
@@ -434,21 +496,23 @@ static void volmeter_process_peak(obs_volmeter_t *volmeter, const struct audio_d
 		 * use unaligned load. */
 		__m128 previous_samples = _mm_loadu_ps(volmeter->prev_samples[channel_nr]);
 
-		float peak;
 		switch (volmeter->peak_meter_type) {
 		case TRUE_PEAK_METER:
-			peak = get_true_peak(previous_samples, samples, nr_samples);
+			peak = get_true_peak(previous_samples, samples, nr_samples, &sum_squares);
 			break;
 
 		case SAMPLE_PEAK_METER:
 		default:
-			peak = get_sample_peak(previous_samples, samples, nr_samples);
+			peak = get_sample_peak(previous_samples, samples, nr_samples, &sum_squares);
 			break;
 		}
 
+		sum_squares += sum_squares_tail(samples, nr_samples & ~(size_t)3, nr_samples);
+
 		volmeter_process_peak_last_samples(volmeter, channel_nr, samples, nr_samples);
 
 		volmeter->peak[channel_nr] = peak;
+		volmeter->magnitude[channel_nr] = nr_samples ? sqrtf(sum_squares / nr_samples) : 0.0f;
 
 		channel_nr++;
 	}
@@ -459,34 +523,19 @@ static void volmeter_process_peak(obs_volmeter_t *volmeter, const struct audio_d
 	}
 }
 
-static void volmeter_process_magnitude(obs_volmeter_t *volmeter, const struct audio_data *data, int nr_channels)
+/* mul is the volume applied to the source, so that the loudness matches
+ * what is heard */
+static void volmeter_process_loudness(struct obs_volmeter *volmeter, const struct audio_data *data, float mul)
 {
-	size_t nr_samples = data->frames;
-
-	int channel_nr = 0;
-	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
-		float *samples = (float *)data->data[plane_nr];
-		if (!samples) {
-			continue;
-		}
-
-		float sum = 0.0;
-		for (size_t i = 0; i < nr_samples; i++) {
-			float sample = samples[i];
-			sum += sample * sample;
-		}
-		volmeter->magnitude[channel_nr] = sqrtf(sum / nr_samples);
+	const float *planes[MAX_AUDIO_CHANNELS] = {0};
+	int nr_channels = get_nr_channels_from_audio_data(data);
 
-		channel_nr++;
+	for (int plane_nr = 0, channel_nr = 0; channel_nr < nr_channels; plane_nr++) {
+		if (data->data[plane_nr])
+			planes[channel_nr++] = (const float *)data->data[plane_nr];
 	}
-}
-
-static void volmeter_process_audio_data(obs_volmeter_t *volmeter, const struct audio_data *data)
-{
-	int nr_channels = get_nr_channels_from_audio_data(data);
 
-	volmeter_process_peak(volmeter, data, nr_channels);
-	volmeter_process_magnitude(volmeter, data, nr_channels);
+	audio_loudness_process(volmeter->loudness, planes, (size_t)nr_channels, data->frames, mul);
 }
 
 static void volmeter_source_data_received(void *vptr, obs_source_t *source, const struct audio_data *data, bool muted)
@@ -513,6 +562,13 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source, cons
 		input_peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr]);
 	}
 
+	memcpy(volmeter->levels.magnitude, magnitude, sizeof(magnitude));
+	memcpy(volmeter->levels.peak, peak, sizeof(peak));
+	memcpy(volmeter->levels.input_peak, input_peak, sizeof(input_peak));
+
+	if (volmeter->loudness)
+		volmeter_process_loudness(volmeter, data, mul);
+
 	pthread_mutex_unlock(&volmeter->mutex);
 
 	signal_levels_updated(volmeter, magnitude, peak, input_peak);
@@ -743,6 +799,12 @@ obs_volmeter_t *obs_volmeter_create(enum obs_fader_type type)
 
 	volmeter->type = type;
 
+	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
+		volmeter->levels.magnitude[channel_nr] = -INFINITY;
+		volmeter->levels.peak[channel_nr] = -INFINITY;
+		volmeter->levels.input_peak[channel_nr] = -INFINITY;
+	}
+
 	return volmeter;
 fail:
 	obs_volmeter_destroy(volmeter);
@@ -756,6 +818,7 @@ void obs_volmeter_destroy(obs_volmeter_t *volmeter)
 
 	obs_volmeter_detach_source(volmeter);
 	da_free(volmeter->callbacks);
+	audio_loudness_destroy(volmeter->loudness);
 	pthread_mutex_destroy(&volmeter->callback_mutex);
 	pthread_mutex_destroy(&volmeter->mutex);
 
@@ -862,6 +925,83 @@ void obs_volmeter_remove_callback(obs_volmeter_t *volmeter, obs_volmeter_updated
 	pthread_mutex_unlock(&volmeter->callback_mutex);
 }
 
+void obs_volmeter_get_levels(obs_volmeter_t *const *volmeters, size_t count, struct obs_volmeter_levels *levels)
+{
+	for (size_t i = 0; i < count; i++) {
+		obs_volmeter_t *volmeter = volmeters[i];
+
+		if (!volmeter) {
+			for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
+				levels[i].magnitude[channel_nr] = -INFINITY;
+				levels[i].peak[channel_nr] = -INFINITY;
+				levels[i].input_peak[channel_nr] = -INFINITY;
+			}
+			continue;
+		}
+
+		pthread_mutex_lock(&volmeter->mutex);
+		levels[i] = volmeter->levels;
+		pthread_mutex_unlock(&volmeter->mutex);
+	}
+}
+
+void obs_volmeter_enable_loudness(obs_volmeter_t *volmeter, bool enable)
+{
+	struct audio_loudness *loudness = NULL;
+
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_enable_loudness"))
+		return;
+
+	if (enable) {
+		struct obs_audio_info oai;
+		if (!obs_get_audio_info(&oai))
+			return;
+
+		loudness = audio_loudness_create(oai.samples_per_sec, oai.speakers);
+	}
+
+	pthread_mutex_lock(&volmeter->mutex);
+	if (!enable || !volmeter->loudness) {
+		struct audio_loudness *prev = volmeter->loudness;
+		volmeter->loudness = loudness;
+		loudness = prev;
+	}
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	audio_loudness_destroy(loudness);
+}
+
+void obs_volmeter_reset_loudness(obs_volmeter_t *volmeter)
+{
+	struct obs_audio_info oai;
+
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_reset_loudness"))
+		return;
+	if (!obs_get_audio_info(&oai))
+		return;
+
+	pthread_mutex_lock(&volmeter->mutex);
+	if (volmeter->loudness)
+		audio_loudness_reset(volmeter->loudness, oai.samples_per_sec, oai.speakers);
+	pthread_mutex_unlock(&volmeter->mutex);
+}
+
+bool obs_volmeter_get_loudness(obs_volmeter_t *volmeter, float *momentary, float *short_term, float *integrated)
+{
+	bool enabled;
+
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_get_loudness"))
+		return false;
+
+	pthread_mutex_lock(&volmeter->mutex);
+	enabled = volmeter->loudness != NULL;
+	if (enabled)
+		audio_loudness_get(volmeter->loudness, momentary, short_term, integrated);
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	return enabled;
+}
+
 float obs_mul_to_db(float mul)
 {
 	return mul_to_db(mul);
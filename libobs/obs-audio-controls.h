@@ -238,6 +238,53 @@ typedef void (*obs_volmeter_updated_t)(void *param, const float magnitude[MAX_AU
 EXPORT void obs_volmeter_add_callback(obs_volmeter_t *volmeter, obs_volmeter_updated_t callback, void *param);
 EXPORT void obs_volmeter_remove_callback(obs_volmeter_t *volmeter, obs_volmeter_updated_t callback, void *param);
 
+/** Levels of a volume meter in dB, as passed to obs_volmeter_updated_t */
+struct obs_volmeter_levels {
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float input_peak[MAX_AUDIO_CHANNELS];
+};
+
+/**
+ * @brief Get the last levels of several volume meters at once
+ * @param volmeters array of volume meter objects
+ * @param count number of volume meters
+ * @param levels array of count levels to fill in
+ *
+ * Meant for polling many meters (e.g. on a timer) instead of handling a
+ * callback from the audio thread for every source.  Meters that have not
+ * received audio yet, or are NULL, report -inf.
+ */
+EXPORT void obs_volmeter_get_levels(obs_volmeter_t *const *volmeters, size_t count,
+				    struct obs_volmeter_levels *levels);
+
+/**
+ * @brief Enable or disable EBU R128 loudness measurement
+ * @param volmeter pointer to the volume meter object
+ * @param enable true to start measuring
+ *
+ * Loudness is measured on the audio as heard, i.e. after the source volume,
+ * and the integrated loudness runs from when it was enabled or last reset.
+ */
+EXPORT void obs_volmeter_enable_loudness(obs_volmeter_t *volmeter, bool enable);
+
+/**
+ * @brief Restart the loudness measurement of a volume meter
+ * @param volmeter pointer to the volume meter object
+ */
+EXPORT void obs_volmeter_reset_loudness(obs_volmeter_t *volmeter);
+
+/**
+ * @brief Get the loudness measured by a volume meter
+ * @param volmeter pointer to the volume meter object
+ * @param momentary momentary loudness (400 ms) in LUFS, may be NULL
+ * @param short_term short-term loudness (3 s) in LUFS, may be NULL
+ * @param integrated gated integrated loudness in LUFS, may be NULL
+ * @return false if loudness measurement is not enabled
+ */
+EXPORT bool obs_volmeter_get_loudness(obs_volmeter_t *volmeter, float *momentary, float *short_term,
+				      float *integrated);
+
 EXPORT float obs_mul_to_db(float mul);
 EXPORT float obs_db_to_mul(float db);
 
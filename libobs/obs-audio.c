@@ -27,17 +27,67 @@ struct ts_info {
 #define DEBUG_AUDIO 0
 #define DEBUG_LAGGED_AUDIO 0
 
+#define AUDIO_RENDER_MAX_WORKERS 3
+#define AUDIO_RENDER_PARALLEL_MIN 16
+
+struct audio_render_job {
+	uint32_t mixers;
+	size_t channels;
+	size_t sample_rate;
+	size_t size;
+	uint64_t start_ts;
+	bool buffering_maxed;
+};
+
+struct audio_render_pool {
+	pthread_t threads[AUDIO_RENDER_MAX_WORKERS];
+	size_t num_threads;
+	os_sem_t *start;
+	os_sem_t *done;
+	volatile bool stop;
+
+	struct audio_render_job job;
+	volatile long next_group;
+};
+
 static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 {
 	struct obs_core_audio *audio = p;
 
-	if (da_find(audio->render_order, &source, 0) == DARRAY_INVALID) {
+	if (source->audio_graph_stamp != audio->graph_stamp) {
 		obs_source_t *s = obs_source_get_ref(source);
-		if (s)
+		if (s) {
+			s->audio_graph_stamp = audio->graph_stamp;
+			s->audio_graph_index = audio->render_order.num;
 			da_push_back(audio->render_order, &s);
+		}
 	}
 
-	UNUSED_PARAMETER(parent);
+	/* linked to the root of the tree once that has been pushed */
+	if (parent && source->audio_graph_stamp == audio->graph_stamp) {
+		struct audio_graph_edge edge = {DARRAY_INVALID, source->audio_graph_index};
+		da_push_back(audio->graph_edges, &edge);
+	}
+}
+
+static void push_audio_root(struct obs_core_audio *audio, obs_source_t *source)
+{
+	size_t first_edge = audio->graph_edges.num;
+	size_t root;
+
+	obs_source_enum_active_tree(source, push_audio_tree, audio);
+	push_audio_tree(NULL, source, audio);
+
+	if (first_edge == audio->graph_edges.num)
+		return;
+
+	if (source->audio_graph_stamp == audio->graph_stamp)
+		root = source->audio_graph_index;
+	else
+		root = audio->graph_edges.array[first_edge].child;
+
+	for (size_t i = first_edge; i < audio->graph_edges.num; i++)
+		audio->graph_edges.array[i].parent = root;
 }
 
 static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
@@ -48,7 +98,8 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *source, size_t channels, size_t sample_rate,
 			     struct ts_info *ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	const size_t frames = obs->audio.frames;
+	size_t total_floats = frames;
 	size_t start_point = 0;
 
 	if (source->audio_ts < ts->start || ts->end <= source->audio_ts)
@@ -56,7 +107,7 @@ static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *sour
 
 	if (source->audio_ts != ts->start) {
 		start_point = convert_time_to_frames(sample_rate, source->audio_ts - ts->start);
-		if (start_point == AUDIO_OUTPUT_FRAMES)
+		if (start_point == frames)
 			return;
 
 		total_floats -= start_point;
@@ -77,18 +128,18 @@ static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *sour
 	}
 }
 
-static bool ignore_audio(obs_source_t *source, size_t channels, size_t sample_rate, uint64_t start_ts)
+static bool ignore_audio(obs_source_t *source, size_t sample_rate, uint64_t start_ts)
 {
-	size_t num_floats = source->audio_input_buf[0].size / sizeof(float);
+	struct audio_ring *ring = obs_source_audio_input(source);
+	size_t num_floats = obs_source_audio_input_frames(source);
 	const char *name = obs_source_get_name(source);
 
 	if (!source->audio_ts && num_floats) {
 #if DEBUG_LAGGED_AUDIO == 1
 		blog(LOG_DEBUG, "[src: %s] no timestamp, but audio available?", name);
 #endif
-		for (size_t ch = 0; ch < channels; ch++)
-			deque_pop_front(&source->audio_input_buf[ch], NULL, source->audio_input_buf[0].size);
-		source->last_audio_input_buf_size = 0;
+		audio_ring_clear(ring);
+		source->last_audio_input_frames = 0;
 		return false;
 	}
 
@@ -102,10 +153,9 @@ static bool ignore_audio(obs_source_t *source, size_t channels, size_t sample_ra
 		blog(LOG_DEBUG, "[src: %s] ignored %" PRIu64 "/%" PRIu64 " samples", name, (uint64_t)drop,
 		     (uint64_t)num_floats);
 #endif
-		for (size_t ch = 0; ch < channels; ch++)
-			deque_pop_front(&source->audio_input_buf[ch], NULL, drop * sizeof(float));
+		audio_ring_pop(ring, (uint32_t)drop);
 
-		source->last_audio_input_buf_size = 0;
+		source->last_audio_input_frames = 0;
 		source->audio_ts += util_mul_div64(drop, 1000000000ULL, sample_rate);
 		blog(LOG_DEBUG, "[src: %s] ts lag after ignoring: %" PRIu64, name, start_ts - source->audio_ts);
 
@@ -137,20 +187,23 @@ static bool ignore_audio(obs_source_t *source, size_t channels, size_t sample_ra
 	return false;
 }
 
-static bool discard_if_stopped(obs_source_t *source, size_t channels)
+static bool discard_if_stopped(obs_source_t *source)
 {
+	struct audio_ring *ring = obs_source_audio_input(source);
 	size_t last_size;
 	size_t size;
+	long writes;
 
-	last_size = source->last_audio_input_buf_size;
-	size = source->audio_input_buf[0].size;
+	last_size = source->last_audio_input_frames;
+	size = obs_source_audio_input_frames(source);
 
 	if (!size)
 		return false;
 
 	/* if perpetually pending data, it means the audio has stopped,
 	 * so clear the audio data */
-	if (last_size == size) {
+	writes = audio_ring_writes(ring);
+	if (last_size == size && source->last_audio_input_writes == writes) {
 		if (!source->pending_stop) {
 			source->pending_stop = true;
 #if DEBUG_AUDIO == 1
@@ -159,32 +212,27 @@ static bool discard_if_stopped(obs_source_t *source, size_t channels)
 			return false;
 		}
 
-		for (size_t ch = 0; ch < channels; ch++)
-			deque_pop_front(&source->audio_input_buf[ch], NULL, source->audio_input_buf[ch].size);
+		audio_ring_clear(ring);
 
 		source->pending_stop = false;
 		source->audio_ts = 0;
-		source->last_audio_input_buf_size = 0;
+		source->last_audio_input_frames = 0;
 #if DEBUG_AUDIO == 1
 		blog(LOG_DEBUG, "source audio data appears to have "
 				"stopped, clearing");
 #endif
 		return true;
 	} else {
-		source->last_audio_input_buf_size = size;
+		source->last_audio_input_frames = size;
+		source->last_audio_input_writes = writes;
 		return false;
 	}
 }
 
-#define MAX_AUDIO_SIZE (AUDIO_OUTPUT_FRAMES * sizeof(float))
-
-static inline void discard_audio(struct obs_core_audio *audio, obs_source_t *source, size_t channels,
-				 size_t sample_rate, struct ts_info *ts)
+static inline void discard_audio(struct obs_core_audio *audio, obs_source_t *source, size_t sample_rate,
+				 struct ts_info *ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
-	size_t size;
-	/* debug assert only */
-	UNUSED_PARAMETER(audio);
+	size_t total_floats = audio->frames;
 
 #if DEBUG_AUDIO == 1
 	bool is_audio_source = source->info.output_flags & OBS_SOURCE_AUDIO;
@@ -207,8 +255,8 @@ static inline void discard_audio(struct obs_core_audio *audio, obs_source_t *sou
 	}
 
 	if (source->audio_ts < (ts->start - 1)) {
-		if (source->audio_pending && source->audio_input_buf[0].size < MAX_AUDIO_SIZE &&
-		    discard_if_stopped(source, channels))
+		if (source->audio_pending && obs_source_audio_input_frames(source) < audio->frames &&
+		    discard_if_stopped(source))
 			return;
 
 #if DEBUG_AUDIO == 1
@@ -230,7 +278,7 @@ static inline void discard_audio(struct obs_core_audio *audio, obs_source_t *sou
 
 	if (source->audio_ts != ts->start && source->audio_ts != (ts->start - 1)) {
 		size_t start_point = convert_time_to_frames(sample_rate, source->audio_ts - ts->start);
-		if (start_point == AUDIO_OUTPUT_FRAMES) {
+		if (start_point == audio->frames) {
 #if DEBUG_AUDIO == 1
 			if (is_audio_source)
 				blog(LOG_DEBUG, "can't discard, start point is "
@@ -242,10 +290,8 @@ static inline void discard_audio(struct obs_core_audio *audio, obs_source_t *sou
 		total_floats -= start_point;
 	}
 
-	size = total_floats * sizeof(float);
-
-	if (source->audio_input_buf[0].size < size) {
-		if (discard_if_stopped(source, channels))
+	if (obs_source_audio_input_frames(source) < total_floats) {
+		if (discard_if_stopped(source))
 			return;
 
 #if DEBUG_AUDIO == 1
@@ -256,10 +302,9 @@ static inline void discard_audio(struct obs_core_audio *audio, obs_source_t *sou
 		return;
 	}
 
-	for (size_t ch = 0; ch < channels; ch++)
-		deque_pop_front(&source->audio_input_buf[ch], NULL, size);
+	audio_ring_pop(obs_source_audio_input(source), (uint32_t)total_floats);
 
-	source->last_audio_input_buf_size = 0;
+	source->last_audio_input_frames = 0;
 
 #if DEBUG_AUDIO == 1
 	if (is_audio_source)
@@ -290,21 +335,24 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio, size_t sampl
 	ticks = audio->max_buffering_ticks - audio->total_buffering_ticks;
 	audio->total_buffering_ticks += ticks;
 
-	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
+	total_ms = audio->total_buffering_ticks * audio->frames * 1000 / sample_rate;
 
 	blog(LOG_INFO,
 	     "Enabling fixed audio buffering, total "
 	     "audio buffering is now %d milliseconds",
 	     (int)total_ms);
 
+	audio_profiler_buffering_added(NULL, ts->start, (uint32_t)(ticks * audio->frames * 1000 / sample_rate),
+				       (uint32_t)total_ms, true, true);
+
 	new_ts.start =
-		audio->buffered_ts - audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks * AUDIO_OUTPUT_FRAMES);
+		audio->buffered_ts - audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks * audio->frames);
 
 	while (ticks--) {
 		const uint64_t cur_ticks = ++audio->buffering_wait_ticks;
 
 		new_ts.end = new_ts.start;
-		new_ts.start = audio->buffered_ts - audio_frames_to_ns(sample_rate, cur_ticks * AUDIO_OUTPUT_FRAMES);
+		new_ts.start = audio->buffered_ts - audio_frames_to_ns(sample_rate, cur_ticks * audio->frames);
 
 #if DEBUG_AUDIO == 1
 		blog(LOG_DEBUG, "add buffered ts: %" PRIu64 "-%" PRIu64, new_ts.start, new_ts.end);
@@ -317,8 +365,9 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio, size_t sampl
 }
 
 static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate, struct ts_info *ts, uint64_t min_ts,
-				const char *buffering_name)
+				obs_source_t *buffering_source)
 {
+	const char *buffering_name = buffering_source ? obs_source_get_name(buffering_source) : NULL;
 	struct ts_info new_ts;
 	uint64_t offset;
 	uint64_t frames;
@@ -334,7 +383,7 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 
 	offset = ts->start - min_ts;
 	frames = ns_to_audio_frames(sample_rate, offset);
-	ticks = (int)((frames + AUDIO_OUTPUT_FRAMES - 1) / AUDIO_OUTPUT_FRAMES);
+	ticks = (int)((frames + audio->frames - 1) / audio->frames);
 
 	audio->total_buffering_ticks += ticks;
 
@@ -344,14 +393,17 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 		blog(LOG_WARNING, "Max audio buffering reached!");
 	}
 
-	ms = ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
-	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
+	ms = ticks * audio->frames * 1000 / sample_rate;
+	total_ms = audio->total_buffering_ticks * audio->frames * 1000 / sample_rate;
 
 	blog(LOG_INFO,
 	     "adding %d milliseconds of audio buffering, total "
 	     "audio buffering is now %d milliseconds"
 	     " (source: %s)\n",
 	     (int)ms, (int)total_ms, buffering_name);
+
+	audio_profiler_buffering_added(buffering_source, ts->start, (uint32_t)ms, (uint32_t)total_ms, false,
+				       audio_buffering_maxed(audio));
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG,
 	     "min_ts (%" PRIu64 ") < start timestamp "
@@ -361,13 +413,13 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 #endif
 
 	new_ts.start =
-		audio->buffered_ts - audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks * AUDIO_OUTPUT_FRAMES);
+		audio->buffered_ts - audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks * audio->frames);
 
 	while (ticks--) {
 		const uint64_t cur_ticks = ++audio->buffering_wait_ticks;
 
 		new_ts.end = new_ts.start;
-		new_ts.start = audio->buffered_ts - audio_frames_to_ns(sample_rate, cur_ticks * AUDIO_OUTPUT_FRAMES);
+		new_ts.start = audio->buffered_ts - audio_frames_to_ns(sample_rate, cur_ticks * audio->frames);
 
 #if DEBUG_AUDIO == 1
 		blog(LOG_DEBUG, "add buffered ts: %" PRIu64 "-%" PRIu64, new_ts.start, new_ts.end);
@@ -381,8 +433,7 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 
 static bool audio_buffer_insufficient(struct obs_source *source, size_t sample_rate, uint64_t min_ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
-	size_t size;
+	size_t total_floats = obs->audio.frames;
 
 	if (source->info.audio_render || source->audio_pending || !source->audio_ts) {
 		return false;
@@ -390,15 +441,13 @@ static bool audio_buffer_insufficient(struct obs_source *source, size_t sample_r
 
 	if (source->audio_ts != min_ts && source->audio_ts != (min_ts - 1)) {
 		size_t start_point = convert_time_to_frames(sample_rate, source->audio_ts - min_ts);
-		if (start_point >= AUDIO_OUTPUT_FRAMES)
+		if (start_point >= obs->audio.frames)
 			return false;
 
 		total_floats -= start_point;
 	}
 
-	size = total_floats * sizeof(float);
-
-	if (source->audio_input_buf[0].size < size) {
+	if (obs_source_audio_input_frames(source) < total_floats) {
 		source->audio_pending = true;
 		return true;
 	}
@@ -406,7 +455,7 @@ static bool audio_buffer_insufficient(struct obs_source *source, size_t sample_r
 	return false;
 }
 
-static inline const char *find_min_ts(struct obs_core_data *data, uint64_t *min_ts)
+static inline obs_source_t *find_min_ts(struct obs_core_data *data, uint64_t *min_ts)
 {
 	obs_source_t *buffering_source = NULL;
 	struct obs_source *source = data->first_audio_source;
@@ -418,7 +467,7 @@ static inline const char *find_min_ts(struct obs_core_data *data, uint64_t *min_
 
 		source = (struct obs_source *)source->next_audio_source;
 	}
-	return buffering_source ? obs_source_get_name(buffering_source) : NULL;
+	return buffering_source;
 }
 
 static inline bool mark_invalid_sources(struct obs_core_data *data, size_t sample_rate, uint64_t min_ts)
@@ -434,12 +483,12 @@ static inline bool mark_invalid_sources(struct obs_core_data *data, size_t sampl
 	return recalculate;
 }
 
-static inline const char *calc_min_ts(struct obs_core_data *data, size_t sample_rate, uint64_t *min_ts)
+static inline obs_source_t *calc_min_ts(struct obs_core_data *data, size_t sample_rate, uint64_t *min_ts)
 {
-	const char *buffering_name = find_min_ts(data, min_ts);
+	obs_source_t *buffering_source = find_min_ts(data, min_ts);
 	if (mark_invalid_sources(data, sample_rate, *min_ts))
-		buffering_name = find_min_ts(data, min_ts);
-	return buffering_name;
+		buffering_source = find_min_ts(data, min_ts);
+	return buffering_source;
 }
 
 static inline void release_audio_sources(struct obs_core_audio *audio)
@@ -465,34 +514,106 @@ static inline void execute_audio_tasks(void)
 	}
 }
 
-bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts, uint32_t mixers,
-		    struct audio_output_data *mixes)
+static inline void release_audio_graph_refs(struct obs_core_audio *audio)
 {
-	struct obs_core_data *data = &obs->data;
-	struct obs_core_audio *audio = &obs->audio;
-	struct obs_source *source;
-	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
-	size_t channels = audio_output_get_channels(audio->audio);
-	struct ts_info ts = {start_ts_in, end_ts_in};
-	size_t audio_size;
-	uint64_t min_ts;
+	for (size_t i = 0; i < audio->graph_order.num; i++)
+		obs_weak_source_release(audio->graph_order.array[i]);
+	da_resize(audio->graph_order, 0);
+}
 
-	da_resize(audio->render_order, 0);
-	da_resize(audio->root_nodes, 0);
+static inline size_t find_audio_group(size_t *links, size_t i)
+{
+	while (links[i] != i) {
+		links[i] = links[links[i]];
+		i = links[i];
+	}
+	return i;
+}
 
-	deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
-	deque_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
-	min_ts = ts.start;
+/* Sorts render_order so that sources reachable from the same root end up in
+ * the same contiguous group.  Groups are numbered by their first
+ * source and keep the relative render order, so children still come before
+ * their parents. */
+static void group_audio_graph(struct obs_core_audio *audio)
+{
+	const size_t num = audio->render_order.num;
+	size_t num_groups = 0;
 
-	audio_size = AUDIO_OUTPUT_FRAMES * sizeof(float);
+	da_resize(audio->graph_scratch, num * 3);
+	size_t *links = audio->graph_scratch.array;
+	size_t *group_of = links + num;
+	size_t *pos = group_of + num;
 
-#if DEBUG_AUDIO == 1
-	blog(LOG_DEBUG, "ts %llu-%llu", ts.start, ts.end);
-#endif
+	for (size_t i = 0; i < num; i++) {
+		links[i] = i;
+		group_of[i] = DARRAY_INVALID;
+	}
 
-	/* ------------------------------------------------ */
-	/* build audio render order */
+	for (size_t i = 0; i < audio->graph_edges.num; i++) {
+		struct audio_graph_edge *edge = &audio->graph_edges.array[i];
+		size_t a = find_audio_group(links, edge->parent);
+		size_t b = find_audio_group(links, edge->child);
+		if (a != b)
+			links[a > b ? a : b] = a > b ? b : a;
+	}
+
+	da_resize(audio->graph_groups, 0);
+
+	for (size_t i = 0; i < num; i++) {
+		size_t root = find_audio_group(links, i);
+		if (group_of[root] == DARRAY_INVALID) {
+			size_t count = 0;
+			group_of[root] = num_groups++;
+			da_push_back(audio->graph_groups, &count);
+		}
 
+		pos[i] = audio->graph_groups.array[group_of[root]]++;
+		group_of[i] = group_of[root];
+	}
+
+	/* group sizes to end offsets */
+	size_t offset = 0;
+	for (size_t g = 0; g < num_groups; g++) {
+		offset += audio->graph_groups.array[g];
+		audio->graph_groups.array[g] = offset;
+	}
+
+	da_resize(audio->graph_sorted, num);
+	for (size_t i = 0; i < num; i++) {
+		size_t g = group_of[i];
+		size_t start = g ? audio->graph_groups.array[g - 1] : 0;
+		obs_source_t *source = audio->render_order.array[i];
+
+		source->audio_graph_index = start + pos[i];
+		audio->graph_sorted.array[source->audio_graph_index] = source;
+	}
+
+	memcpy(audio->render_order.array, audio->graph_sorted.array, num * sizeof(obs_source_t *));
+}
+
+static inline void clear_added_audio_sources(struct obs_core_audio *audio)
+{
+	for (size_t i = 0; i < audio->graph_added.num; i++)
+		obs_weak_source_release(audio->graph_added.array[i]);
+	da_resize(audio->graph_added, 0);
+	audio->graph_added_pending = false;
+}
+
+static void build_audio_graph(struct obs_core_audio *audio)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_source *source;
+
+	release_audio_graph_refs(audio);
+	da_resize(audio->render_order, 0);
+	da_resize(audio->root_nodes, 0);
+	da_resize(audio->graph_roots, 0);
+	da_resize(audio->graph_edges, 0);
+	da_resize(audio->graph_channel_roots, 0);
+	audio->graph_stamp++;
+
+	/* only collect the channel sources under the locks, the trees are
+	 * walked afterwards */
 	pthread_mutex_lock(&obs->video.mixes_mutex);
 	for (size_t j = 0; j < obs->video.mixes.num; j++) {
 		struct obs_view *view = obs->video.mixes.array[j]->view;
@@ -509,18 +630,31 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 			if (!obs_source_active(source))
 				continue;
 
-			obs_source_enum_active_tree(source, push_audio_tree, audio);
-			push_audio_tree(NULL, source, audio);
-
-			if (obs->video.mixes.array[j] == obs->video.main_mix)
-				da_push_back(audio->root_nodes, &source);
+			struct audio_graph_root root = {
+				.source = obs_source_get_ref(source),
+				.main = obs->video.mixes.array[j] == obs->video.main_mix,
+			};
+			if (root.source)
+				da_push_back(audio->graph_channel_roots, &root);
 		}
 		pthread_mutex_unlock(&view->channels_mutex);
 	}
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 
+	for (size_t i = 0; i < audio->graph_channel_roots.num; i++) {
+		struct audio_graph_root *root = &audio->graph_channel_roots.array[i];
+
+		push_audio_root(audio, root->source);
+
+		if (root->main && root->source->audio_graph_stamp == audio->graph_stamp)
+			da_push_back(audio->root_nodes, &root->source);
+	}
+
 	pthread_mutex_lock(&data->audio_sources_mutex);
 
+	/* sources added from here on are appended by the next tick */
+	clear_added_audio_sources(audio);
+
 	source = data->first_audio_source;
 	while (source) {
 		push_audio_tree(NULL, source, audio);
@@ -529,43 +663,345 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 
 	pthread_mutex_unlock(&data->audio_sources_mutex);
 
-	/* ------------------------------------------------ */
-	/* render audio data */
+	for (size_t i = 0; i < audio->graph_channel_roots.num; i++)
+		obs_source_release(audio->graph_channel_roots.array[i].source);
+
+	group_audio_graph(audio);
+
 	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_weak_source_t *weak = obs_source_get_weak_source(audio->render_order.array[i]);
+		da_push_back(audio->graph_order, &weak);
+	}
+
+	for (size_t i = 0; i < audio->root_nodes.num; i++)
+		da_push_back(audio->graph_roots, &audio->root_nodes.array[i]->audio_graph_index);
+}
+
+void audio_graph_add_source(struct obs_source *source)
+{
+	struct obs_core_audio *audio = &obs->audio;
+	obs_weak_source_t *weak = obs_source_get_weak_source(source);
+
+	/* called with data.audio_sources_mutex held */
+	da_push_back(audio->graph_added, &weak);
+	os_atomic_set_bool(&audio->graph_added_pending, true);
+}
+
+/* Newly created audio sources are not part of any tree yet, so each one is
+ * appended to the cached graph as a group of its own.  A source that has
+ * since been added to a tree was picked up by a rebuild already. */
+static void append_audio_sources(struct obs_core_audio *audio)
+{
+	struct obs_core_data *data = &obs->data;
+	DARRAY(obs_weak_source_t *) added;
+	da_init(added);
+
+	pthread_mutex_lock(&data->audio_sources_mutex);
+	da_move(added, audio->graph_added);
+	audio->graph_added_pending = false;
+	pthread_mutex_unlock(&data->audio_sources_mutex);
+
+	for (size_t i = 0; i < added.num; i++) {
+		obs_weak_source_t *weak = added.array[i];
+		obs_source_t *source = obs_weak_source_get_source(weak);
+
+		if (!source || source->audio_graph_stamp == audio->graph_stamp) {
+			obs_weak_source_release(weak);
+		} else {
+			source->audio_graph_stamp = audio->graph_stamp;
+			source->audio_graph_index = audio->graph_order.num;
+			da_push_back(audio->graph_order, &weak);
+			da_push_back(audio->graph_groups, &audio->graph_order.num);
+		}
+
+		obs_source_release(source);
+	}
+
+	da_free(added);
+}
+
+/* Drops destroyed sources (NULL in render_order) from the cached graph.
+ * Removing sources never reorders the remaining ones, so groups and roots
+ * only need their indices shifted. */
+static void prune_audio_graph(struct obs_core_audio *audio)
+{
+	const size_t num = audio->graph_order.num;
+	size_t num_groups = 0;
+	size_t num_roots = 0;
+	size_t *kept_before;
+
+	da_resize(audio->graph_scratch, num + 1);
+	kept_before = audio->graph_scratch.array;
+
+	kept_before[0] = 0;
+	for (size_t i = 0; i < num; i++)
+		kept_before[i + 1] = kept_before[i] + (audio->render_order.array[i] ? 1 : 0);
+
+	for (size_t g = 0; g < audio->graph_groups.num; g++) {
+		size_t end = kept_before[audio->graph_groups.array[g]];
+		if (end != (num_groups ? audio->graph_groups.array[num_groups - 1] : 0))
+			audio->graph_groups.array[num_groups++] = end;
+	}
+	da_resize(audio->graph_groups, num_groups);
+
+	for (size_t r = 0; r < audio->graph_roots.num; r++) {
+		size_t idx = audio->graph_roots.array[r];
+		if (audio->render_order.array[idx])
+			audio->graph_roots.array[num_roots++] = kept_before[idx];
+	}
+	da_resize(audio->graph_roots, num_roots);
+
+	for (size_t i = 0; i < num; i++) {
 		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
-
-		/* if a source has gone backward in time and we can no
-		 * longer buffer, drop some or all of its audio */
-		if (audio_buffering_maxed(audio) && source->audio_ts != 0 && source->audio_ts < ts.start) {
-			if (source->info.audio_render) {
-				blog(LOG_DEBUG,
-				     "render audio source %s timestamp has "
-				     "gone backwards",
-				     obs_source_get_name(source));
-
-				/* just avoid further damage */
-				source->audio_pending = true;
+		if (!source) {
+			obs_weak_source_release(audio->graph_order.array[i]);
+			continue;
+		}
+
+		source->audio_graph_index = kept_before[i];
+		audio->render_order.array[kept_before[i]] = source;
+		audio->graph_order.array[kept_before[i]] = audio->graph_order.array[i];
+	}
+
+	da_resize(audio->render_order, kept_before[num]);
+	da_resize(audio->graph_order, kept_before[num]);
+}
+
+/* takes strong references to the cached graph for this tick */
+static void resolve_audio_graph(struct obs_core_audio *audio)
+{
+	const size_t num = audio->graph_order.num;
+	bool pruned = false;
+
+	da_resize(audio->render_order, num);
+	da_resize(audio->root_nodes, 0);
+
+	for (size_t i = 0; i < num; i++) {
+		obs_source_t *source = obs_weak_source_get_source(audio->graph_order.array[i]);
+		audio->render_order.array[i] = source;
+		pruned |= !source;
+	}
+
+	if (pruned)
+		prune_audio_graph(audio);
+
+	for (size_t i = 0; i < audio->graph_roots.num; i++)
+		da_push_back(audio->root_nodes, &audio->render_order.array[audio->graph_roots.array[i]]);
+}
+
+static void render_audio_source(obs_source_t *source, const struct audio_render_job *job)
+{
+	obs_source_audio_render(source, job->mixers, job->channels, job->sample_rate, job->size);
+
+	/* if a source has gone backward in time and we can no
+	 * longer buffer, drop some or all of its audio */
+	if (job->buffering_maxed && source->audio_ts != 0 && source->audio_ts < job->start_ts) {
+		if (source->info.audio_render) {
+			blog(LOG_DEBUG,
+			     "render audio source %s timestamp has "
+			     "gone backwards",
+			     obs_source_get_name(source));
+
+			/* just avoid further damage */
+			source->audio_pending = true;
 #if DEBUG_AUDIO == 1
-				/* this should really be fixed */
-				assert(false);
+			/* this should really be fixed */
+			assert(false);
 #endif
-			} else {
-				pthread_mutex_lock(&source->audio_buf_mutex);
-				bool rerender = ignore_audio(source, channels, sample_rate, ts.start);
-				pthread_mutex_unlock(&source->audio_buf_mutex);
-
-				/* if we (potentially) recovered, re-render */
-				if (rerender)
-					obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
-			}
+		} else {
+			bool rerender = ignore_audio(source, job->sample_rate, job->start_ts);
+
+			/* if we (potentially) recovered, re-render */
+			if (rerender)
+				obs_source_audio_render(source, job->mixers, job->channels, job->sample_rate,
+							job->size);
 		}
 	}
+}
+
+static inline void render_audio_group(struct obs_core_audio *audio, size_t group, const struct audio_render_job *job)
+{
+	size_t start = group ? audio->graph_groups.array[group - 1] : 0;
+	size_t end = audio->graph_groups.array[group];
+
+	for (size_t i = start; i < end; i++)
+		render_audio_source(audio->render_order.array[i], job);
+}
+
+static void render_audio_groups(struct obs_core_audio *audio, struct audio_render_pool *pool)
+{
+	const size_t num_groups = audio->graph_groups.num;
+	size_t group;
+
+	while ((group = (size_t)os_atomic_inc_long(&pool->next_group) - 1) < num_groups)
+		render_audio_group(audio, group, &pool->job);
+}
+
+static void *audio_render_worker(void *param)
+{
+	struct audio_render_pool *pool = param;
+
+	os_set_thread_name("libobs: audio render worker");
+
+	for (;;) {
+		os_sem_wait(pool->start);
+		if (pool->stop)
+			break;
+
+		render_audio_groups(&obs->audio, pool);
+		os_sem_post(pool->done);
+	}
+
+	return NULL;
+}
+
+/* Groups share no sources, so they can render on any thread; the mixes are
+ * still summed afterwards on the audio thread in root order. */
+static void render_audio_graph(struct obs_core_audio *audio, const struct audio_render_job *job)
+{
+	struct audio_render_pool *pool = audio->render_pool;
+	const size_t num_groups = audio->graph_groups.num;
+
+	if (!pool || num_groups < 2 || audio->render_order.num < AUDIO_RENDER_PARALLEL_MIN) {
+		for (size_t i = 0; i < audio->render_order.num; i++)
+			render_audio_source(audio->render_order.array[i], job);
+		return;
+	}
+
+	size_t workers = num_groups - 1;
+	if (workers > pool->num_threads)
+		workers = pool->num_threads;
+
+	pool->job = *job;
+	os_atomic_set_long(&pool->next_group, 0);
+
+	for (size_t i = 0; i < workers; i++)
+		os_sem_post(pool->start);
+
+	render_audio_groups(audio, pool);
+
+	for (size_t i = 0; i < workers; i++)
+		os_sem_wait(pool->done);
+}
+
+void init_audio_render_pool(struct obs_core_audio *audio)
+{
+	struct audio_render_pool *pool;
+	int workers = os_get_logical_cores() / 4;
+
+	if (workers > AUDIO_RENDER_MAX_WORKERS)
+		workers = AUDIO_RENDER_MAX_WORKERS;
+	if (workers <= 0)
+		return;
+
+	pool = bzalloc(sizeof(struct audio_render_pool));
+	if (os_sem_init(&pool->start, 0) != 0 || os_sem_init(&pool->done, 0) != 0)
+		goto fail;
+
+	for (int i = 0; i < workers; i++) {
+		if (pthread_create(&pool->threads[i], NULL, audio_render_worker, pool) != 0)
+			break;
+		pool->num_threads++;
+	}
+
+	if (!pool->num_threads)
+		goto fail;
+
+	audio->render_pool = pool;
+	return;
+
+fail:
+	os_sem_destroy(pool->start);
+	os_sem_destroy(pool->done);
+	bfree(pool);
+}
+
+void free_audio_render_pool(struct obs_core_audio *audio)
+{
+	struct audio_render_pool *pool = audio->render_pool;
+	if (!pool)
+		return;
+
+	pool->stop = true;
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_post(pool->start);
+	for (size_t i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	os_sem_destroy(pool->start);
+	os_sem_destroy(pool->done);
+	bfree(pool);
+	audio->render_pool = NULL;
+}
+
+void free_audio_graph(struct obs_core_audio *audio)
+{
+	release_audio_graph_refs(audio);
+	clear_added_audio_sources(audio);
+	da_free(audio->graph_added);
+	da_free(audio->graph_channel_roots);
+	da_free(audio->graph_order);
+	da_free(audio->graph_roots);
+	da_free(audio->graph_groups);
+	da_free(audio->graph_scratch);
+	da_free(audio->graph_sorted);
+	da_free(audio->graph_edges);
+}
+
+bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts, uint32_t mixers,
+		    struct audio_output_data *mixes)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_core_audio *audio = &obs->audio;
+	struct obs_source *source;
+	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
+	size_t channels = audio_output_get_channels(audio->audio);
+	struct ts_info ts = {start_ts_in, end_ts_in};
+	size_t audio_size;
+	uint64_t min_ts;
+
+	const uint64_t profiler_start = audio_profiler_tick_start();
+
+	deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+	deque_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
+	min_ts = ts.start;
+
+	audio_size = audio->frames * sizeof(float);
+
+#if DEBUG_AUDIO == 1
+	blog(LOG_DEBUG, "ts %llu-%llu", ts.start, ts.end);
+#endif
+
+	/* ------------------------------------------------ */
+	/* build audio render order */
+	long generation = os_atomic_load_long(&audio->graph_generation);
+	if (generation != audio->graph_cached_generation) {
+		audio->graph_cached_generation = generation;
+		build_audio_graph(audio);
+	} else {
+		if (os_atomic_load_bool(&audio->graph_added_pending))
+			append_audio_sources(audio);
+		resolve_audio_graph(audio);
+	}
+
+	/* ------------------------------------------------ */
+	/* render audio data */
+	struct audio_render_job job = {
+		.mixers = mixers,
+		.channels = channels,
+		.sample_rate = sample_rate,
+		.size = audio_size,
+		.start_ts = ts.start,
+		.buffering_maxed = audio_buffering_maxed(audio),
+	};
+
+	render_audio_graph(audio, &job);
 
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
 	pthread_mutex_lock(&data->audio_sources_mutex);
-	const char *buffering_name = calc_min_ts(data, sample_rate, &min_ts);
+	obs_source_t *buffering_source = calc_min_ts(data, sample_rate, &min_ts);
+	audio_profiler_record_sources(ts.start);
 	pthread_mutex_unlock(&data->audio_sources_mutex);
 
 	/* ------------------------------------------------ */
@@ -575,7 +1011,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 			set_fixed_audio_buffering(audio, sample_rate, &ts);
 		}
 	} else if (min_ts < ts.start) {
-		add_audio_buffering(audio, sample_rate, &ts, min_ts, buffering_name);
+		add_audio_buffering(audio, sample_rate, &ts, min_ts, buffering_source);
 	}
 
 	/* ------------------------------------------------ */
@@ -587,12 +1023,8 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 			if (source->audio_pending)
 				continue;
 
-			pthread_mutex_lock(&source->audio_buf_mutex);
-
 			if (source->audio_output_buf[0][0] && source->audio_ts)
 				mix_audio(mixes, source, channels, sample_rate, &ts);
-
-			pthread_mutex_unlock(&source->audio_buf_mutex);
 		}
 	}
 
@@ -602,9 +1034,8 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 
 	source = data->first_audio_source;
 	while (source) {
-		pthread_mutex_lock(&source->audio_buf_mutex);
-		discard_audio(audio, source, channels, sample_rate, &ts);
-		pthread_mutex_unlock(&source->audio_buf_mutex);
+		discard_audio(audio, source, sample_rate, &ts);
+		obs_source_audio_input_release(source);
 
 		source = (struct obs_source *)source->next_audio_source;
 	}
@@ -619,6 +1050,9 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 
 	*out_ts = ts.start;
 
+	audio_profiler_tick_end(profiler_start, ts.start,
+				(uint32_t)(audio->total_buffering_ticks * audio->frames * 1000 / sample_rate));
+
 	if (audio->buffering_wait_ticks) {
 		audio->buffering_wait_ticks--;
 		return false;
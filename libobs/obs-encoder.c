@@ -288,6 +288,7 @@ static void maybe_set_up_gpu_rescale(struct obs_encoder *encoder)
 	} else {
 		da_push_back(obs->video.mixes, &mix);
 		obs_encoder_set_video(encoder, mix->video);
+		obs_audio_graph_changed();
 	}
 
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
@@ -535,8 +536,14 @@ static inline void reset_audio_buffers(struct obs_encoder *encoder)
 {
 	free_audio_buffers(encoder);
 
-	for (size_t i = 0; i < encoder->planes; i++)
+	/* room for a frame and the audio tick completing it, so that input
+	 * buffering doesn't reallocate however small the ticks are */
+	size_t input_size = (encoder->framesize + AUDIO_OUTPUT_FRAMES) * encoder->blocksize;
+
+	for (size_t i = 0; i < encoder->planes; i++) {
 		encoder->audio_output_buffer[i] = bmalloc(encoder->framesize_bytes);
+		deque_reserve(&encoder->audio_input_buffer[i], input_size);
+	}
 }
 
 static void intitialize_audio_encoder(struct obs_encoder *encoder)
@@ -643,6 +650,7 @@ static void maybe_clear_encoder_core_video_mix(obs_encoder_t *encoder)
 		if (mix->encoder_refs == 0) {
 			da_erase(obs->video.mixes, i);
 			obs_free_video_mix(mix);
+			obs_audio_graph_changed();
 		}
 	}
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
@@ -657,7 +665,6 @@ void obs_encoder_shutdown(obs_encoder_t *encoder)
 		encoder->first_received = false;
 		encoder->offset_usec = 0;
 		encoder->start_ts = 0;
-		encoder->frame_rate_divisor_counter = 0;
 		maybe_clear_encoder_core_video_mix(encoder);
 
 		for (size_t i = 0; i < encoder->paired_encoders.num; i++) {
@@ -34,6 +34,7 @@
 #include "graphics/matrix4.h"
 
 #include "media-io/audio-resampler.h"
+#include "media-io/audio-ring.h"
 #include "media-io/video-io.h"
 #include "media-io/audio-io.h"
 
@@ -47,6 +48,8 @@
 #define HASH_ADD_UUID(head, uuid_field, add) HASH_ADD(hh_uuid, head, uuid_field[0], UUID_STR_LENGTH, add)
 
 #define NUM_TEXTURES 2
+#define MAX_READBACK_DEPTH 4
+#define DEFAULT_READBACK_DEPTH 2
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 10
@@ -243,9 +246,12 @@ extern void obs_display_free(struct obs_display *display);
 /* ------------------------------------------------------------------------- */
 /* core */
 
+/* repeats is how many of count are copies standing in for frames that were
+ * deliberately not rendered, as opposed to lag */
 struct obs_vframe_info {
 	uint64_t timestamp;
 	int count;
+	int repeats;
 };
 
 struct obs_tex_frame {
@@ -255,6 +261,7 @@ struct obs_tex_frame {
 	uint64_t timestamp;
 	uint64_t lock_key;
 	int count;
+	int repeats;
 	bool released;
 };
 
@@ -266,18 +273,19 @@ struct obs_task_info {
 struct obs_core_video_mix {
 	struct obs_view *view;
 
-	gs_stagesurf_t *active_copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
-	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *active_copy_surfaces[MAX_READBACK_DEPTH][NUM_CHANNELS];
+	gs_stagesurf_t *copy_surfaces[MAX_READBACK_DEPTH][NUM_CHANNELS];
 	gs_texture_t *convert_textures[NUM_CHANNELS];
 	gs_texture_t *convert_textures_encode[NUM_CHANNELS];
 #ifdef _WIN32
-	gs_stagesurf_t *copy_surfaces_encode[NUM_TEXTURES];
+	gs_stagesurf_t *copy_surfaces_encode[MAX_READBACK_DEPTH];
 #endif
 	gs_texture_t *render_texture;
+	gs_texture_t *source_texture; /* render_texture or another mix's */
 	gs_texture_t *output_texture;
 	enum gs_color_space render_space;
 	bool texture_rendered;
-	bool textures_copied[NUM_TEXTURES];
+	bool textures_copied[MAX_READBACK_DEPTH];
 	bool texture_converted;
 	bool using_nv12_tex;
 	bool using_p010_tex;
@@ -285,6 +293,19 @@ struct obs_core_video_mix {
 	struct deque vframe_info_buffer_gpu;
 	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
 	int cur_texture;
+	int readback_depth;
+	int pending_downloads;
+	uint64_t readback_start_time[MAX_READBACK_DEPTH];
+	uint64_t readback_frames;
+	uint64_t readback_stalls;
+	uint64_t readback_deferred;
+	uint64_t readback_total_latency;
+	uint64_t readback_max_latency;
+	uint64_t raw_frame_index;
+	uint64_t gpu_frames_queued;
+	uint64_t gpu_frames_encoded;
+	uint64_t renders_skipped;
+	bool frame_skipped;
 	volatile long raw_active;
 	volatile long gpu_encoder_active;
 	bool gpu_was_active;
@@ -357,6 +378,9 @@ struct obs_core_video {
 	float sdr_white_level;
 	float hdr_nominal_peak_level;
 
+	int readback_depth;
+	bool serial_mixes;
+
 	pthread_mutex_t task_mutex;
 	struct deque tasks;
 
@@ -371,6 +395,18 @@ struct obs_core_video {
 extern void add_ready_encoder_group(obs_encoder_t *encoder);
 
 struct audio_monitor;
+struct audio_render_pool;
+
+/* indices into render_order */
+struct audio_graph_edge {
+	size_t parent;
+	size_t child;
+};
+
+struct audio_graph_root {
+	struct obs_source *source;
+	bool main;
+};
 
 struct obs_core_audio {
 	audio_t *audio;
@@ -378,6 +414,30 @@ struct obs_core_audio {
 	DARRAY(struct obs_source *) render_order;
 	DARRAY(struct obs_source *) root_nodes;
 
+	/* The render order is cached between ticks as weak references and only
+	 * rebuilt after graph_generation changes.  Sources are grouped into
+	 * independent subtrees (graph_groups holds the end index of each group
+	 * in graph_order) so that groups can be rendered concurrently.  New
+	 * audio sources are appended from graph_added (protected by
+	 * data.audio_sources_mutex) and destroyed ones are pruned, neither of
+	 * which needs a rebuild. */
+	volatile long graph_generation;
+	volatile bool graph_added_pending;
+	DARRAY(obs_weak_source_t *) graph_added;
+	DARRAY(struct audio_graph_root) graph_channel_roots;
+	long graph_cached_generation;
+	uint64_t graph_stamp;
+	DARRAY(obs_weak_source_t *) graph_order;
+	DARRAY(size_t) graph_roots;
+	DARRAY(size_t) graph_groups;
+	DARRAY(size_t) graph_scratch;
+	DARRAY(struct obs_source *) graph_sorted;
+	DARRAY(struct audio_graph_edge) graph_edges;
+	struct audio_render_pool *render_pool;
+
+	/* frames per tick, see obs_audio_info3::frames_per_tick */
+	uint32_t frames;
+
 	uint64_t buffered_ts;
 	struct deque buffered_timestamps;
 	uint64_t buffering_wait_ticks;
@@ -389,6 +449,7 @@ struct obs_core_audio {
 	DARRAY(struct audio_monitor *) monitors;
 	char *monitoring_device_name;
 	char *monitoring_device_id;
+	bool monitoring_callback_mode;
 
 	pthread_mutex_t task_mutex;
 	struct deque tasks;
@@ -522,6 +583,18 @@ extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 
 extern bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts, uint32_t mixers,
 			   struct audio_output_data *mixes);
+extern void init_audio_render_pool(struct obs_core_audio *audio);
+extern void free_audio_render_pool(struct obs_core_audio *audio);
+extern void free_audio_graph(struct obs_core_audio *audio);
+extern void audio_graph_add_source(struct obs_source *source);
+
+/* Call after anything that changes which sources obs_source_enum_active_tree
+ * reaches from the audio roots, once the change is visible to it. */
+static inline void obs_audio_graph_changed(void)
+{
+	if (obs)
+		os_atomic_inc_long(&obs->audio.graph_generation);
+}
 
 extern struct obs_core_video_mix *get_mix_for_video(video_t *video);
 
@@ -635,8 +708,17 @@ static inline bool obs_weak_ref_expired(struct obs_weak_ref *ref)
 /* ------------------------------------------------------------------------- */
 /* sources  */
 
+/* location of a cached frame's copy in the source's upload ring */
+struct async_upload {
+	uint64_t pos;
+	uint64_t end;
+	uint64_t gen;
+	bool valid;
+};
+
 struct async_frame {
 	struct obs_source_frame *frame;
+	struct async_upload upload;
 	long unused_count;
 	bool used;
 };
@@ -705,6 +787,10 @@ struct obs_source {
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* incremented whenever the video of the source or any of its filters
+	 * may have changed, see OBS_SOURCE_STATIC_VIDEO */
+	volatile long video_generation;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -750,16 +836,27 @@ struct obs_source {
 	bool muted;
 	struct obs_source *next_audio_source;
 	struct obs_source **prev_next_audio_source;
+	uint64_t audio_graph_stamp; /* audio thread only */
+	size_t audio_graph_index;   /* audio thread only */
 	uint64_t audio_ts;
-	struct deque audio_input_buf[MAX_AUDIO_CHANNELS];
-	size_t last_audio_input_buf_size;
+
+	/* audio input is written by the thread outputting audio and read by
+	 * the audio thread without a lock between them.  to grow the ring,
+	 * the producer copies it to the other slot and flips audio_ring_idx;
+	 * the audio thread switches over and frees the old one in
+	 * obs_source_audio_input_acquire, then flips audio_read_idx. */
+	struct audio_ring *audio_rings[2];
+	volatile long audio_ring_idx;
+	volatile long audio_read_idx;
+	size_t last_audio_input_frames; /* audio thread only */
+	long last_audio_input_writes;   /* audio thread only */
 	DARRAY(struct audio_action) audio_actions;
 	float *audio_output_buf[MAX_AUDIO_MIXES][MAX_AUDIO_CHANNELS];
 	float *audio_mix_buf[MAX_AUDIO_CHANNELS];
 	struct resample_info sample_info;
 	audio_resampler_t *resampler;
 	pthread_mutex_t audio_actions_mutex;
-	pthread_mutex_t audio_buf_mutex;
+	pthread_mutex_t audio_buf_mutex; /* between audio producers only */
 	pthread_mutex_t audio_mutex;
 	pthread_mutex_t audio_cb_mutex;
 	DARRAY(struct audio_cb_info) audio_cb_list;
@@ -802,6 +899,23 @@ struct obs_source {
 	uint32_t async_cache_height;
 	uint32_t async_convert_width[MAX_AV_PLANES];
 	uint32_t async_convert_height[MAX_AV_PLANES];
+
+	/* async frames are copied into a persistently mapped upload ring on
+	 * the source's thread, laid out for the current async textures.
+	 * async_upload_cur is only touched by the graphics thread. */
+	pthread_mutex_t async_upload_mutex;
+	gs_upload_ring_t *async_upload_ring;
+	uint64_t async_upload_gen;
+	uint32_t async_upload_width;
+	uint32_t async_upload_height;
+	enum video_format async_upload_format;
+	bool async_upload_full_range;
+	uint8_t async_upload_trc;
+	size_t async_upload_offset[MAX_AV_PLANES];
+	uint32_t async_upload_linesize[MAX_AV_PLANES];
+	uint32_t async_upload_rows[MAX_AV_PLANES];
+	size_t async_upload_frame_size;
+	struct async_upload async_upload_cur;
 	uint64_t async_last_rendered_ts;
 
 	pthread_mutex_t caption_cb_mutex;
@@ -995,6 +1109,22 @@ extern uint64_t obs_source_get_last_async_ts(const obs_source_t *source);
 extern void obs_source_audio_render(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate,
 				    size_t size);
 
+/* audio thread only: switches to a grown input ring and applies a pending
+ * reset before the input is read, and publishes the read position after */
+extern void obs_source_audio_input_acquire(obs_source_t *source);
+extern void obs_source_audio_input_release(obs_source_t *source);
+
+static inline struct audio_ring *obs_source_audio_input(const obs_source_t *source)
+{
+	return source->audio_rings[source->audio_read_idx];
+}
+
+static inline size_t obs_source_audio_input_frames(const obs_source_t *source)
+{
+	struct audio_ring *ring = obs_source_audio_input(source);
+	return ring ? audio_ring_size(ring) : 0;
+}
+
 extern void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy);
 
 extern struct obs_source_frame *filter_async_video(obs_source_t *source, struct obs_source_frame *in);
@@ -1002,7 +1132,10 @@ extern bool update_async_texture(struct obs_source *source, const struct obs_sou
 				 gs_texrender_t *texrender);
 extern bool update_async_textures(struct obs_source *source, const struct obs_source_frame *frame,
 				  gs_texture_t *tex[MAX_AV_PLANES], gs_texrender_t *texrender);
+extern bool upload_async_frame(obs_source_t *source, const struct obs_source_frame *frame,
+			       gs_texture_t *tex[MAX_AV_PLANES], gs_texrender_t *texrender);
 extern bool set_async_texture_size(struct obs_source *source, const struct obs_source_frame *frame);
+extern bool obs_source_video_static(obs_source_t *source);
 extern void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame);
 
 extern void set_deinterlace_texture_size(obs_source_t *source);
@@ -1251,14 +1384,12 @@ struct obs_encoder {
 	uint32_t timebase_den;
 
 	// allow outputting at fractions of main composition FPS,
-	// e.g. 60 FPS with frame_rate_divisor = 1 turns into 30 FPS
+	// e.g. 60 FPS with frame_rate_divisor = 2 turns into 30 FPS
 	//
-	// a separate counter is used in favor of using remainder calculations
-	// to allow "inputs" started at the same time to start on the same frame
-	// whereas with remainder calculation the frame alignment would depend on
-	// the total frame count at the time the encoder was started
+	// frames are taken by their index rather than with a per-encoder
+	// counter so that the mix only has to render frames some encoder
+	// actually takes
 	uint32_t frame_rate_divisor;
-	uint32_t frame_rate_divisor_counter; // only used for GPU encoders
 	video_t *fps_override;
 
 	// Number of frames successfully encoded
@@ -1384,3 +1515,24 @@ extern void source_profiler_source_render_end(obs_source_t *source, uint64_t sta
 
 /* Remove source from profiler hashmaps */
 extern void source_profiler_remove_source(obs_source_t *source);
+
+/** Internal Audio Profiler functions **/
+
+/* Get timestamp for start of audio tick */
+extern uint64_t audio_profiler_tick_start(void);
+/* Submit the tick, its output time is added by audio_profiler_tick_output */
+extern void audio_profiler_tick_end(uint64_t start, uint64_t audio_ts, uint32_t buffering_ms);
+extern void audio_profiler_tick_output(const audio_t *audio, uint64_t output_ns);
+
+/* Record lateness of all audio sources (audio_sources_mutex must be held) */
+extern void audio_profiler_record_sources(uint64_t audio_ts);
+/* Record buffering added for source, or fixed buffering if source is NULL */
+extern void audio_profiler_buffering_added(obs_source_t *source, uint64_t audio_ts, uint32_t added_ms,
+					   uint32_t total_ms, bool fixed, bool maxed);
+
+/* Remove source from profiler hashmap */
+extern void audio_profiler_remove_source(obs_source_t *source);
+/* Free all collected data */
+extern void audio_profiler_shutdown(void);
+/* Register profiler procs with the core proc handler */
+extern void audio_profiler_add_procs(proc_handler_t *procs);
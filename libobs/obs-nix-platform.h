@@ -27,6 +27,7 @@ enum obs_nix_platform_type {
 	OBS_NIX_PLATFORM_INVALID,
 	OBS_NIX_PLATFORM_X11_EGL,
 	OBS_NIX_PLATFORM_WAYLAND,
+	OBS_NIX_PLATFORM_SURFACELESS,
 };
 
 /**
@@ -40,6 +41,7 @@ EXPORT void obs_set_nix_platform(enum obs_nix_platform_type platform);
 EXPORT enum obs_nix_platform_type obs_get_nix_platform(void);
 /**
  * Sets the host platform's display connection.
+ * Not used by OBS_NIX_PLATFORM_SURFACELESS, which needs no display.
  * @param display The host display connection.
  */
 EXPORT void obs_set_nix_platform_display(void *display);
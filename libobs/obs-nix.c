@@ -415,6 +415,52 @@ void log_system_info(void)
 		obs_nix_x11_log_info();
 }
 
+/* Headless platforms have no keyboard to read hotkeys from */
+static bool null_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
+{
+	hotkeys->platform_context = NULL;
+	return true;
+}
+
+static void null_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
+{
+	UNUSED_PARAMETER(hotkeys);
+}
+
+static bool null_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *context, obs_key_t key)
+{
+	UNUSED_PARAMETER(context);
+	UNUSED_PARAMETER(key);
+	return false;
+}
+
+static void null_key_to_str(obs_key_t key, struct dstr *dstr)
+{
+	if (key < OBS_KEY_LAST_VALUE && obs->hotkeys.translations[key])
+		dstr_copy(dstr, obs->hotkeys.translations[key]);
+}
+
+static obs_key_t null_key_from_virtual_key(int sym)
+{
+	UNUSED_PARAMETER(sym);
+	return OBS_KEY_NONE;
+}
+
+static int null_key_to_virtual_key(obs_key_t key)
+{
+	UNUSED_PARAMETER(key);
+	return 0;
+}
+
+static const struct obs_nix_hotkeys_vtable null_hotkeys_vtable = {
+	.init = null_hotkeys_platform_init,
+	.free = null_hotkeys_platform_free,
+	.is_pressed = null_hotkeys_platform_is_pressed,
+	.key_to_str = null_key_to_str,
+	.key_from_virtual_key = null_key_from_virtual_key,
+	.key_to_virtual_key = null_key_to_virtual_key,
+};
+
 bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 {
 	switch (obs_get_nix_platform()) {
@@ -426,6 +472,9 @@ bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 		hotkeys_vtable = obs_nix_wayland_get_hotkeys_vtable();
 		break;
 #endif
+	case OBS_NIX_PLATFORM_SURFACELESS:
+		hotkeys_vtable = &null_hotkeys_vtable;
+		break;
 	default:
 		break;
 	}
@@ -2308,6 +2308,7 @@ static void default_raw_audio_callback(void *param, size_t mix_idx, struct audio
 {
 	struct obs_output *output = param;
 	struct audio_data out;
+	uint32_t frame_size;
 	size_t frame_size_bytes;
 
 	if (!data_active(output))
@@ -2323,7 +2324,8 @@ static void default_raw_audio_callback(void *param, size_t mix_idx, struct audio
 		output->audio_start_ts = out.timestamp;
 	}
 
-	frame_size_bytes = AUDIO_OUTPUT_FRAMES * output->audio_size;
+	frame_size = audio_output_get_frames(output->audio);
+	frame_size_bytes = frame_size * output->audio_size;
 
 	for (size_t i = 0; i < output->planes; i++)
 		deque_push_back(&output->audio_buffer[mix_idx][i], out.data[i], out.frames * output->audio_size);
@@ -2336,7 +2338,7 @@ static void default_raw_audio_callback(void *param, size_t mix_idx, struct audio
 			out.data[i] = (uint8_t *)output->audio_data[i];
 		}
 
-		out.frames = AUDIO_OUTPUT_FRAMES;
+		out.frames = frame_size;
 		out.timestamp =
 			output->audio_start_ts + audio_frames_to_ns(output->sample_rate, output->total_audio_frames);
 
@@ -2344,7 +2346,7 @@ static void default_raw_audio_callback(void *param, size_t mix_idx, struct audio
 		out.timestamp += output->pause.ts_offset;
 		pthread_mutex_unlock(&output->pause.mutex);
 
-		output->total_audio_frames += AUDIO_OUTPUT_FRAMES;
+		output->total_audio_frames += frame_size;
 
 		if (output->info.raw_audio2)
 			output->info.raw_audio2(output->context.data, mix_idx, &out);
@@ -736,8 +736,29 @@ static inline bool item_texture_enabled(const struct obs_scene_item *item)
 	       (item_is_scene(item) && !item->is_group);
 }
 
+static void draw_item_texture_batch(gs_texture_t *tex, const struct matrix4 *transforms, size_t count)
+{
+	gs_effect_t *effect = gs_get_effect();
+	const bool linear_srgb = gs_get_linear_srgb();
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(linear_srgb);
+
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	if (linear_srgb)
+		gs_effect_set_texture_srgb(image, tex);
+	else
+		gs_effect_set_texture(image, tex);
+
+	gs_draw_sprite_batch(tex, 0, 0, 0, transforms, count);
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
+/* Draws the item texture, or when batch_count is non-zero, draws it once
+ * for each of the batch transforms instead. */
 static void render_item_texture(struct obs_scene_item *item, enum gs_color_space current_space,
-				enum gs_color_space source_space)
+				enum gs_color_space source_space, const struct matrix4 *batch, size_t batch_count)
 {
 	gs_texture_t *tex = gs_texrender_get_texture(item->item_render);
 	if (!tex) {
@@ -868,8 +889,12 @@ static void render_item_texture(struct obs_scene_item *item, enum gs_color_space
 				   obs_blend_mode_params[item->blend_type].dst_alpha);
 	gs_blend_op(obs_blend_mode_params[item->blend_type].op);
 
-	while (gs_effect_loop(effect, tech_name))
-		obs_source_draw(tex, 0, 0, 0, 0, 0);
+	while (gs_effect_loop(effect, tech_name)) {
+		if (batch_count)
+			draw_item_texture_batch(tex, batch, batch_count);
+		else
+			obs_source_draw(tex, 0, 0, 0, 0, 0);
+	}
 
 	gs_blend_state_pop();
 
@@ -890,6 +915,28 @@ static bool are_texcoords_centered(struct matrix4 *m)
 	return memcmp(m, &copy, sizeof(*m)) == 0;
 }
 
+static inline bool item_render_cache_valid(const struct obs_scene_item *item, uint32_t width, uint32_t height,
+					   enum gs_color_space space, long generation)
+{
+	return item->item_render_cached && item->item_render_generation == generation &&
+	       item->item_render_width == width && item->item_render_height == height &&
+	       item->item_render_space == space &&
+	       memcmp(&item->item_render_crop, &item->crop, sizeof(item->crop)) == 0 &&
+	       memcmp(&item->item_render_bounds_crop, &item->bounds_crop, sizeof(item->bounds_crop)) == 0;
+}
+
+static inline void item_render_cache_store(struct obs_scene_item *item, uint32_t width, uint32_t height,
+					   enum gs_color_space space, long generation)
+{
+	item->item_render_cached = true;
+	item->item_render_generation = generation;
+	item->item_render_width = width;
+	item->item_render_height = height;
+	item->item_render_space = space;
+	item->item_render_crop = item->crop;
+	item->item_render_bounds_crop = item->bounds_crop;
+}
+
 static inline void render_item(struct obs_scene_item *item)
 {
 	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_ITEM, "Item: %s", obs_source_get_name(item->source));
@@ -904,6 +951,7 @@ static inline void render_item(struct obs_scene_item *item)
 	if (item->item_render && (!use_texrender || (gs_texrender_get_format(item->item_render) != format))) {
 		gs_texrender_destroy(item->item_render);
 		item->item_render = NULL;
+		item->item_render_cached = false;
 	}
 
 	if (!item->item_render && use_texrender) {
@@ -921,7 +969,13 @@ static inline void render_item(struct obs_scene_item *item)
 		uint32_t cx = calc_cx(item, width);
 		uint32_t cy = calc_cy(item, height);
 
-		if (cx && cy && gs_texrender_begin_with_color_space(item->item_render, cx, cy, source_space)) {
+		const bool transitioning = (item->user_visible && transition_active(item->show_transition)) ||
+					   (!item->user_visible && transition_active(item->hide_transition));
+		const long generation = os_atomic_load_long(&source->video_generation);
+		const bool cacheable = !transitioning && obs_source_video_static(source);
+		const bool reuse = cacheable && item_render_cache_valid(item, width, height, source_space, generation);
+
+		if (!reuse && cx && cy && gs_texrender_begin_with_color_space(item->item_render, cx, cy, source_space)) {
 			float cx_scale = (float)width / (float)cx;
 			float cy_scale = (float)height / (float)cy;
 			struct vec4 clear_color;
@@ -951,6 +1005,11 @@ static inline void render_item(struct obs_scene_item *item)
 			}
 
 			gs_texrender_end(item->item_render);
+
+			if (cacheable)
+				item_render_cache_store(item, width, height, source_space, generation);
+			else
+				item->item_render_cached = false;
 		}
 	}
 
@@ -959,7 +1018,7 @@ static inline void render_item(struct obs_scene_item *item)
 	gs_matrix_push();
 	gs_matrix_mul(&item->draw_transform);
 	if (item->item_render) {
-		render_item_texture(item, current_space, source_space);
+		render_item_texture(item, current_space, source_space, NULL, 0);
 	} else if (item->user_visible && transition_active(item->show_transition)) {
 		const int cx = obs_source_get_width(item->source);
 		const int cy = obs_source_get_height(item->source);
@@ -983,6 +1042,63 @@ cleanup:
 	GS_DEBUG_MARKER_END();
 }
 
+#define MAX_ITEM_BATCH 64
+
+static inline bool item_transitioning(const struct obs_scene_item *item)
+{
+	return transition_active(item->show_transition) || transition_active(item->hide_transition);
+}
+
+/* Items of the same source with the same crop, scaling and blending end up
+ * with identical item textures, so the leader's texture can be drawn for
+ * all of them at once. */
+static inline bool item_batch_compatible(const struct obs_scene_item *leader, const struct obs_scene_item *item)
+{
+	return item->source == leader->source && item->user_visible && !item_transitioning(item) &&
+	       item_texture_enabled(item) && memcmp(&item->crop, &leader->crop, sizeof(item->crop)) == 0 &&
+	       memcmp(&item->bounds_crop, &leader->bounds_crop, sizeof(item->bounds_crop)) == 0 &&
+	       item->scale_filter == leader->scale_filter && item->blend_method == leader->blend_method &&
+	       item->blend_type == leader->blend_type &&
+	       close_float(item->output_scale.x, leader->output_scale.x, EPSILON) &&
+	       close_float(item->output_scale.y, leader->output_scale.y, EPSILON);
+}
+
+/* Draws the run of items following a rendered item that can share its
+ * texture with a single draw call, returns the first item after the run. */
+static struct obs_scene_item *render_item_batch(struct obs_scene_item *leader)
+{
+	struct matrix4 transforms[MAX_ITEM_BATCH];
+	struct obs_scene_item *item = leader->next;
+	size_t count = 0;
+
+	if (!leader->item_render || !leader->user_visible || item_transitioning(leader))
+		return item;
+	if (!obs_source_get_width(leader->source) || !obs_source_get_height(leader->source))
+		return item;
+
+	while (item && count < MAX_ITEM_BATCH && item_batch_compatible(leader, item)) {
+		transforms[count++] = item->draw_transform;
+		item = item->next;
+	}
+
+	if (!count)
+		return item;
+
+	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_ITEM, "Item batch: %s (%zu)", obs_source_get_name(leader->source),
+				     count);
+
+	const enum gs_color_space current_space = gs_get_color_space();
+	const enum gs_color_space source_space = obs_source_get_color_space(leader->source, 1, &current_space);
+	const bool previous = gs_set_linear_srgb(leader->blend_method != OBS_BLEND_METHOD_SRGB_OFF);
+
+	render_item_texture(leader, current_space, source_space, transforms, count);
+
+	gs_set_linear_srgb(previous);
+
+	GS_DEBUG_MARKER_END();
+	return item;
+}
+
 static void scene_video_tick(void *data, float seconds)
 {
 	struct obs_scene *scene = data;
@@ -1072,8 +1188,11 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 
 	item = scene->first_item;
 	while (item) {
-		if (item->user_visible || transition_active(item->hide_transition))
+		if (item->user_visible || transition_active(item->hide_transition)) {
 			render_item(item);
+			item = render_item_batch(item);
+			continue;
+		}
 
 		item = item->next;
 	}
@@ -1107,6 +1226,8 @@ static void set_visibility(struct obs_scene_item *item, bool vis)
 	item->user_visible = vis;
 
 	pthread_mutex_unlock(&item->actions_mutex);
+
+	obs_audio_graph_changed();
 }
 
 static obs_sceneitem_t *obs_scene_add_internal(obs_scene_t *scene, obs_source_t *source, obs_sceneitem_t *insert_after,
@@ -1477,6 +1598,7 @@ static uint32_t scene_getheight(void *data)
 
 static void apply_scene_item_audio_actions(struct obs_scene_item *item, float *buf, uint64_t ts, size_t sample_rate)
 {
+	const bool visible_before = item->visible;
 	bool cur_visible = item->visible;
 	uint64_t frame_num = 0;
 	size_t deref_count = 0;
@@ -1493,7 +1615,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item, float *b
 
 		new_frame_num = util_mul_div64(timestamp - ts, sample_rate, 1000000000ULL);
 
-		if (ts && new_frame_num >= AUDIO_OUTPUT_FRAMES)
+		if (ts && new_frame_num >= obs->audio.frames)
 			break;
 
 		da_erase(item->audio_actions, i--);
@@ -1511,10 +1633,12 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item, float *b
 	}
 
 	if (buf) {
-		for (; frame_num < AUDIO_OUTPUT_FRAMES; frame_num++)
+		for (; frame_num < obs->audio.frames; frame_num++)
 			buf[frame_num] = cur_visible ? 1.0f : 0.0f;
 	}
 
+	bool changed = item->visible != visible_before;
+
 	pthread_mutex_unlock(&item->actions_mutex);
 
 	while (deref_count--) {
@@ -1522,6 +1646,10 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item, float *b
 			obs_source_remove_active_child(item->parent->source, item->source);
 		}
 	}
+
+	/* which transition is enumerated depends on item->visible */
+	if (changed)
+		obs_audio_graph_changed();
 }
 
 static bool apply_scene_item_volume(struct obs_scene_item *item, float *buf, uint64_t ts, size_t sample_rate)
@@ -1538,7 +1666,7 @@ static bool apply_scene_item_volume(struct obs_scene_item *item, float *buf, uin
 	pthread_mutex_unlock(&item->actions_mutex);
 
 	if (actions_pending) {
-		uint64_t duration = util_mul_div64(AUDIO_OUTPUT_FRAMES, 1000000000ULL, sample_rate);
+		uint64_t duration = util_mul_div64(obs->audio.frames, 1000000000ULL, sample_rate);
 
 		if (!ts || action.timestamp < (ts + duration)) {
 			apply_scene_item_audio_actions(item, buf, ts, sample_rate);
@@ -1591,6 +1719,7 @@ static bool scene_audio_render_internal(struct obs_scene *scene, struct obs_scen
 					struct obs_source_audio_mix *audio_output, uint32_t mixers, size_t channels,
 					size_t sample_rate, float *parent_buf)
 {
+	const size_t frames = obs->audio.frames;
 	uint64_t timestamp = 0;
 	float buf[AUDIO_OUTPUT_FRAMES];
 	struct obs_source_audio_mix child_audio;
@@ -1662,7 +1791,7 @@ static bool scene_audio_render_internal(struct obs_scene *scene, struct obs_scen
 
 		pos = (size_t)ns_to_audio_frames(sample_rate, source_ts - timestamp);
 
-		if (pos >= AUDIO_OUTPUT_FRAMES) {
+		if (pos >= frames) {
 			item = item->next;
 			continue;
 		}
@@ -1672,7 +1801,7 @@ static bool scene_audio_render_internal(struct obs_scene *scene, struct obs_scen
 			continue;
 		}
 
-		size_t count = AUDIO_OUTPUT_FRAMES - pos;
+		size_t count = frames - pos;
 
 		/* Update buf so that parent mute state applies to all current
 		 * scene items as well */
@@ -2403,6 +2532,8 @@ static obs_sceneitem_t *obs_scene_add_internal(obs_scene_t *scene, obs_source_t
 
 	full_unlock(scene);
 
+	obs_audio_graph_changed();
+
 	if (!scene->source->context.private)
 		init_hotkeys(scene, item, obs_source_get_name(source));
 
@@ -2483,6 +2614,8 @@ static void obs_sceneitem_remove_internal(obs_sceneitem_t *item)
 
 	obs_sceneitem_set_transition(item, true, NULL);
 	obs_sceneitem_set_transition(item, false, NULL);
+
+	obs_audio_graph_changed();
 }
 
 void obs_sceneitem_remove(obs_sceneitem_t *item)
@@ -3317,6 +3450,7 @@ bool obs_scene_reorder_items(obs_scene_t *scene, obs_sceneitem_t *const *item_or
 
 	full_unlock(scene);
 
+	obs_audio_graph_changed();
 	signal_reorder(scene->first_item);
 	obs_scene_release(scene);
 	return true;
@@ -3749,6 +3883,8 @@ obs_sceneitem_t *obs_scene_insert_group(obs_scene_t *scene, const char *name, ob
 	full_unlock(sub_scene);
 	full_unlock(scene);
 
+	obs_audio_graph_changed();
+
 	struct calldata params;
 	uint8_t stack[128];
 
@@ -3851,6 +3987,8 @@ void obs_sceneitem_group_ungroup(obs_sceneitem_t *item)
 	detach_sceneitem(item);
 	full_unlock(scene);
 
+	obs_audio_graph_changed();
+
 	obs_sceneitem_release(item);
 }
 
@@ -3895,6 +4033,7 @@ void obs_sceneitem_group_add_item(obs_sceneitem_t *group, obs_sceneitem_t *item)
 
 	/* ------------------------- */
 
+	obs_audio_graph_changed();
 	signal_refresh(scene);
 }
 
@@ -3923,6 +4062,7 @@ void obs_sceneitem_group_remove_item(obs_sceneitem_t *group, obs_sceneitem_t *it
 
 	/* ------------------------- */
 
+	obs_audio_graph_changed();
 	signal_refresh(scene);
 }
 
@@ -4106,6 +4246,7 @@ bool obs_scene_reorder_items2(obs_scene_t *scene, struct obs_sceneitem_order_inf
 
 	full_unlock(scene);
 
+	obs_audio_graph_changed();
 	signal_reorder(scene->first_item);
 	obs_scene_release(scene);
 	return true;
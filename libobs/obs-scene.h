@@ -51,6 +51,16 @@ struct obs_scene_item {
 	gs_texrender_t *item_render;
 	struct obs_sceneitem_crop crop;
 
+	/* item_render is reused while the source is static and none of the
+	 * inputs it was rendered with have changed */
+	bool item_render_cached;
+	long item_render_generation;
+	uint32_t item_render_width;
+	uint32_t item_render_height;
+	enum gs_color_space item_render_space;
+	struct obs_sceneitem_crop item_render_crop;
+	struct obs_sceneitem_crop item_render_bounds_crop;
+
 	bool absolute_coordinates;
 	struct vec2 pos;
 	struct vec2 scale;
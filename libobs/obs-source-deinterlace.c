@@ -247,7 +247,7 @@ void deinterlace_update_async_video(obs_source_t *source)
 		os_atomic_inc_long(&frame->refs);
 
 		if (set_async_texture_size(source, frame)) {
-			update_async_textures(source, frame, source->async_prev_textures, source->async_prev_texrender);
+			upload_async_frame(source, frame, source->async_prev_textures, source->async_prev_texrender);
 		}
 
 		obs_source_release_frame(source, frame);
@@ -254,6 +254,8 @@ static void set_source(obs_source_t *transition, enum obs_transition_target targ
 
 	unlock_transition(transition);
 
+	obs_audio_graph_changed();
+
 	if (add_success) {
 		if (transition->transition_cx == 0 || transition->transition_cy == 0) {
 			recalculate_transition_size(transition);
@@ -631,6 +633,8 @@ static void obs_transition_stop(obs_source_t *transition)
 	transition->transition_source_active[1] = false;
 	transition->transition_sources[0] = transition->transition_sources[1];
 	transition->transition_sources[1] = NULL;
+
+	obs_audio_graph_changed();
 }
 
 static inline void handle_stop(obs_source_t *transition)
@@ -866,7 +870,7 @@ static void process_audio(obs_source_t *transition, obs_source_t *child, struct
 	obs_source_get_audio_mix(child, &child_audio);
 	pos = (size_t)ns_to_audio_frames(sample_rate, ts - min_ts);
 
-	if (pos > AUDIO_OUTPUT_FRAMES)
+	if (pos > obs->audio.frames)
 		return;
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
@@ -880,7 +884,7 @@ static void process_audio(obs_source_t *transition, obs_source_t *child, struct
 			float *out = output->data[ch];
 			float *in = input->data[ch];
 
-			mix_child(transition, out + pos, in, AUDIO_OUTPUT_FRAMES - pos, sample_rate, ts, mix);
+			mix_child(transition, out + pos, in, obs->audio.frames - pos, sample_rate, ts, mix);
 		}
 	}
 }
@@ -21,6 +21,7 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-dsp.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/util_uint64.h"
@@ -176,6 +177,7 @@ static bool obs_source_init(struct obs_source *source)
 	source->audio_active = true;
 	pthread_mutex_init_value(&source->filter_mutex);
 	pthread_mutex_init_value(&source->async_mutex);
+	pthread_mutex_init_value(&source->async_upload_mutex);
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
@@ -194,6 +196,8 @@ static bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init_recursive(&source->async_mutex) != 0)
 		return false;
+	if (pthread_mutex_init(&source->async_upload_mutex, NULL) != 0)
+		return false;
 	if (pthread_mutex_init(&source->caption_cb_mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&source->media_actions_mutex, NULL) != 0)
@@ -228,6 +232,7 @@ static void obs_source_init_finalize(struct obs_source *source)
 		if (obs->data.first_audio_source)
 			obs->data.first_audio_source->prev_next_audio_source = &source->next_audio_source;
 		obs->data.first_audio_source = source;
+		audio_graph_add_source(source);
 
 		pthread_mutex_unlock(&obs->data.audio_sources_mutex);
 	}
@@ -617,6 +622,7 @@ void obs_source_destroy(struct obs_source *source)
 		obs_context_data_remove_name(&source->context, &obs->data.public_sources);
 
 	source_profiler_remove_source(source);
+	audio_profiler_remove_source(source);
 
 	/* defer source destroy */
 	os_task_queue_queue_task(obs->destruction_task_thread, (os_task_t)obs_source_destroy_defer, source);
@@ -657,6 +663,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 		gs_texture_destroy(source->async_textures[c]);
 		gs_texture_destroy(source->async_prev_textures[c]);
 	}
+	gs_upload_ring_destroy(source->async_upload_ring);
 	if (source->filter_texrender)
 		gs_texrender_destroy(source->filter_texrender);
 	if (source->color_space_texrender)
@@ -665,8 +672,8 @@ static void obs_source_destroy_defer(struct obs_source *source)
 
 	for (i = 0; i < MAX_AV_PLANES; i++)
 		bfree(source->audio_data.data[i]);
-	for (i = 0; i < MAX_AUDIO_CHANNELS; i++)
-		deque_free(&source->audio_input_buf[i]);
+	for (i = 0; i < 2; i++)
+		audio_ring_destroy(source->audio_rings[i]);
 	audio_resampler_destroy(source->resampler);
 	bfree(source->audio_output_buf[0][0]);
 	bfree(source->audio_mix_buf[0]);
@@ -690,6 +697,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->caption_cb_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
+	pthread_mutex_destroy(&source->async_upload_mutex);
 	pthread_mutex_destroy(&source->media_actions_mutex);
 	obs_data_release(source->private_settings);
 	obs_context_data_free(&source->context);
@@ -909,12 +917,59 @@ uint32_t obs_get_source_output_flags(const char *id)
 	return info ? info->output_flags : 0;
 }
 
+static inline void invalidate_video(obs_source_t *source)
+{
+	obs_source_t *parent = source->filter_parent;
+
+	os_atomic_inc_long(&source->video_generation);
+	if (parent)
+		os_atomic_inc_long(&parent->video_generation);
+}
+
+void obs_source_invalidate_video(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_invalidate_video"))
+		return;
+
+	invalidate_video(source);
+}
+
+/* Whether the source and all of its enabled filters only change on updates,
+ * which also requires no update to be pending. */
+bool obs_source_video_static(obs_source_t *source)
+{
+	const uint32_t flags = source->info.output_flags;
+	bool is_static = true;
+
+	if ((flags & OBS_SOURCE_STATIC_VIDEO) == 0 || (flags & OBS_SOURCE_ASYNC) != 0)
+		return false;
+	if (os_atomic_load_long(&source->defer_update_count) > 0)
+		return false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+
+		if (!filter->enabled)
+			continue;
+		if ((filter->info.output_flags & OBS_SOURCE_STATIC_VIDEO) == 0 ||
+		    os_atomic_load_long(&filter->defer_update_count) > 0) {
+			is_static = false;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return is_static;
+}
+
 static void obs_source_deferred_update(obs_source_t *source)
 {
 	if (source->context.data && source->info.update) {
 		long count = os_atomic_load_long(&source->defer_update_count);
 		source->info.update(source->context.data, source->context.settings);
 		os_atomic_compare_swap_long(&source->defer_update_count, count, 0);
+		invalidate_video(source);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -1096,6 +1151,8 @@ void obs_source_activate(obs_source_t *source, enum view_type type)
 		os_atomic_inc_long(&source->activate_refs);
 		obs_source_enum_active_tree(source, activate_tree, NULL);
 	}
+
+	obs_audio_graph_changed();
 }
 
 void obs_source_deactivate(obs_source_t *source, enum view_type type)
@@ -1114,6 +1171,8 @@ void obs_source_deactivate(obs_source_t *source, enum view_type type)
 			obs_source_enum_active_tree(source, deactivate_tree, NULL);
 		}
 	}
+
+	obs_audio_graph_changed();
 }
 
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source, uint64_t sys_time);
@@ -1300,8 +1359,9 @@ static inline size_t conv_time_to_frames(const size_t sample_rate, const uint64_
 	return (size_t)util_mul_div64(duration, sample_rate, 1000000000ULL);
 }
 
-/* maximum buffer size */
-#define MAX_BUF_SIZE (1000 * AUDIO_OUTPUT_FRAMES * sizeof(float))
+/* maximum and initial buffer size */
+#define MAX_BUF_FRAMES (1000 * AUDIO_OUTPUT_FRAMES)
+#define MIN_BUF_FRAMES (8 * AUDIO_OUTPUT_FRAMES)
 
 /* time threshold in nanoseconds to ensure audio timing is as seamless as
  * possible */
@@ -1313,15 +1373,44 @@ static inline void reset_audio_timing(obs_source_t *source, uint64_t timestamp,
 	source->timing_adjust = os_time - timestamp;
 }
 
-static void reset_audio_data(obs_source_t *source, uint64_t os_time)
+/* returns the ring audio is written to, created or grown to hold at least
+ * the given number of frames if the audio thread has switched over to the
+ * last one; otherwise the current ring is returned as it is */
+static struct audio_ring *reserve_audio_input(obs_source_t *source, uint32_t frames)
 {
-	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
-		if (source->audio_input_buf[i].size)
-			deque_pop_front(&source->audio_input_buf[i], NULL, source->audio_input_buf[i].size);
-	}
+	long idx = source->audio_ring_idx;
+	struct audio_ring *ring = source->audio_rings[idx];
+
+	if (ring && (audio_ring_capacity(ring) >= frames || os_atomic_load_long(&source->audio_read_idx) != idx))
+		return ring;
+
+	size_t channels = audio_output_get_channels(obs->audio.audio);
+	struct audio_ring *grown = audio_ring_create(channels, frames < MIN_BUF_FRAMES ? MIN_BUF_FRAMES : frames);
+	if (ring)
+		audio_ring_copy(grown, ring);
+
+	source->audio_rings[idx ^ 1] = grown;
+	os_atomic_store_long(&source->audio_ring_idx, idx ^ 1);
+	return grown;
+}
+
+static inline uint64_t audio_input_base_ts(obs_source_t *source)
+{
+	struct audio_ring *ring = source->audio_rings[source->audio_ring_idx];
+	uint32_t pos;
+	uint64_t ts;
 
-	source->last_audio_input_buf_size = 0;
-	source->audio_ts = os_time;
+	if (!ring)
+		return 0;
+
+	audio_ring_get_base(ring, &pos, &ts);
+	return ts;
+}
+
+static void reset_audio_data(obs_source_t *source, uint64_t os_time)
+{
+	/* the audio thread picks the new timestamp up on its next tick */
+	audio_ring_reset(reserve_audio_input(source, 0), os_time);
 	source->next_audio_sys_ts_min = os_time;
 }
 
@@ -1364,50 +1453,46 @@ static inline size_t get_buf_placement(audio_t *audio, uint64_t offset)
 static void source_output_audio_place(obs_source_t *source, const struct audio_data *in)
 {
 	audio_t *audio = obs->audio.audio;
+	struct audio_ring *ring;
 	size_t buf_placement;
-	size_t channels = audio_output_get_channels(audio);
-	size_t size = in->frames * sizeof(float);
+	uint32_t base_pos;
+	uint64_t base_ts = audio_input_base_ts(source);
 
-	if (!source->audio_ts || in->timestamp < source->audio_ts)
+	if (!base_ts || in->timestamp < base_ts)
 		reset_audio_data(source, in->timestamp);
 
-	buf_placement = get_buf_placement(audio, in->timestamp - source->audio_ts) * sizeof(float);
+	ring = source->audio_rings[source->audio_ring_idx];
+	audio_ring_get_base(ring, &base_pos, &base_ts);
+
+	buf_placement = get_buf_placement(audio, in->timestamp - base_ts);
 
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG, "frames: %lu, size: %lu, placement: %lu, base_ts: %llu, ts: %llu", (unsigned long)in->frames,
-	     (unsigned long)source->audio_input_buf[0].size, (unsigned long)buf_placement, source->audio_ts,
-	     in->timestamp);
+	     (unsigned long)(audio_ring_end(ring) - base_pos), (unsigned long)buf_placement, base_ts, in->timestamp);
 #endif
 
 	/* do not allow the circular buffers to become too big */
-	if ((buf_placement + size) > MAX_BUF_SIZE)
+	if (buf_placement > MAX_BUF_FRAMES)
 		return;
 
-	for (size_t i = 0; i < channels; i++) {
-		deque_place(&source->audio_input_buf[i], buf_placement, in->data[i], size);
-		deque_pop_back(&source->audio_input_buf[i], NULL,
-			       source->audio_input_buf[i].size - (buf_placement + size));
-	}
+	uint32_t pos = base_pos + (uint32_t)buf_placement;
+	uint32_t needed = audio_ring_needed(ring, pos, in->frames);
+	if (needed > MAX_BUF_FRAMES)
+		return;
 
-	source->last_audio_input_buf_size = 0;
+	audio_ring_place(reserve_audio_input(source, needed), pos, (const uint8_t *const *)in->data, in->frames);
 }
 
 static inline void source_output_audio_push_back(obs_source_t *source, const struct audio_data *in)
 {
-	audio_t *audio = obs->audio.audio;
-	size_t channels = audio_output_get_channels(audio);
-	size_t size = in->frames * sizeof(float);
+	struct audio_ring *ring = source->audio_rings[source->audio_ring_idx];
+	uint32_t needed = audio_ring_needed(ring, audio_ring_end(ring), in->frames);
 
 	/* do not allow the circular buffers to become too big */
-	if ((source->audio_input_buf[0].size + size) > MAX_BUF_SIZE)
+	if (needed > MAX_BUF_FRAMES)
 		return;
 
-	for (size_t i = 0; i < channels; i++)
-		deque_push_back(&source->audio_input_buf[i], in->data[i], size);
-
-	/* reset audio input buffer size to ensure that audio doesn't get
-	 * perpetually cut */
-	source->last_audio_input_buf_size = 0;
+	audio_ring_push_back(reserve_audio_input(source, needed), (const uint8_t *const *)in->data, in->frames);
 }
 
 static inline bool source_muted(obs_source_t *source, uint64_t os_time)
@@ -1504,7 +1589,7 @@ static void source_output_audio_data(obs_source_t *source, const struct audio_da
 	}
 
 	if (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY) {
-		if (push_back && source->audio_ts)
+		if (push_back && audio_input_base_ts(source))
 			source_output_audio_push_back(source, &in);
 		else
 			source_output_audio_place(source, &in);
@@ -1959,6 +2044,53 @@ static inline bool init_gpu_conversion(struct obs_source *source, const struct o
 	return false;
 }
 
+#define ASYNC_UPLOAD_FRAMES 4
+
+/* Lays out one frame's planes exactly as the async textures expect them and
+ * recreates the upload ring to match.  The previous-frame textures used for
+ * deinterlacing have the same layout, so they are uploaded from it too. */
+static void reset_async_upload(struct obs_source *source)
+{
+	size_t frame_size = 0;
+
+	pthread_mutex_lock(&source->async_upload_mutex);
+
+	gs_upload_ring_destroy(source->async_upload_ring);
+	source->async_upload_ring = NULL;
+	source->async_upload_gen++;
+
+	if (!source->async_textures[0])
+		goto unlock;
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		gs_texture_t *tex = source->async_textures[c];
+		uint32_t linesize = 0;
+		uint32_t rows = 0;
+
+		if (tex) {
+			uint32_t bpp = gs_get_format_bpp(gs_texture_get_color_format(tex)) / 8;
+			linesize = (gs_texture_get_width(tex) * bpp + 3) & ~3;
+			rows = gs_texture_get_height(tex);
+		}
+
+		source->async_upload_offset[c] = frame_size;
+		source->async_upload_linesize[c] = linesize;
+		source->async_upload_rows[c] = rows;
+		frame_size += ((size_t)linesize * rows + 255) & ~(size_t)255;
+	}
+
+	source->async_upload_frame_size = frame_size;
+	source->async_upload_width = source->async_width;
+	source->async_upload_height = source->async_height;
+	source->async_upload_format = source->async_format;
+	source->async_upload_full_range = source->async_full_range;
+	source->async_upload_trc = source->async_trc;
+	source->async_upload_ring = gs_upload_ring_create(frame_size * ASYNC_UPLOAD_FRAMES);
+
+unlock:
+	pthread_mutex_unlock(&source->async_upload_mutex);
+}
+
 bool set_async_texture_size(struct obs_source *source, const struct obs_source_frame *frame)
 {
 	enum convert_type cur = get_convert_type(frame->format, frame->full_range, frame->trc);
@@ -2005,12 +2137,26 @@ bool set_async_texture_size(struct obs_source *source, const struct obs_source_f
 	if (deinterlacing_enabled(source))
 		set_deinterlace_texture_size(source);
 
+	reset_async_upload(source);
+
 	gs_leave_context();
 
 	return source->async_textures[0] != NULL;
 }
 
-static void upload_raw_frame(gs_texture_t *tex[MAX_AV_PLANES], const struct obs_source_frame *frame)
+static inline bool upload_async_plane(struct obs_source *source, gs_texture_t *tex, size_t plane)
+{
+	const struct async_upload *upload = &source->async_upload_cur;
+
+	if (!upload->valid || (tex != source->async_textures[plane] && tex != source->async_prev_textures[plane]))
+		return false;
+
+	return gs_upload_ring_upload(source->async_upload_ring, tex, upload->pos + source->async_upload_offset[plane],
+				     source->async_upload_linesize[plane]);
+}
+
+static void upload_raw_frame(struct obs_source *source, gs_texture_t *tex[MAX_AV_PLANES],
+			     const struct obs_source_frame *frame)
 {
 	switch (get_convert_type(frame->format, frame->full_range, frame->trc)) {
 	case CONVERT_422_PACK:
@@ -2034,7 +2180,7 @@ static void upload_raw_frame(gs_texture_t *tex[MAX_AV_PLANES], const struct obs_
 	case CONVERT_V210:
 	case CONVERT_R10L:
 		for (size_t c = 0; c < MAX_AV_PLANES; c++) {
-			if (tex[c])
+			if (tex[c] && !upload_async_plane(source, tex[c], c))
 				gs_texture_set_image(tex[c], frame->data[c], frame->linesize[c], false);
 		}
 		break;
@@ -2212,7 +2358,7 @@ static bool update_async_texrender(struct obs_source *source, const struct obs_s
 
 	gs_texrender_reset(texrender);
 
-	upload_raw_frame(tex, frame);
+	upload_raw_frame(source, tex, frame);
 
 	uint32_t cx = source->async_width;
 	uint32_t cy = source->async_height;
@@ -2313,7 +2459,8 @@ bool update_async_textures(struct obs_source *source, const struct obs_source_fr
 
 	type = get_convert_type(frame->format, frame->full_range, frame->trc);
 	if (type == CONVERT_NONE) {
-		gs_texture_set_image(tex[0], frame->data[0], frame->linesize[0], false);
+		if (!upload_async_plane(source, tex[0], 0))
+			gs_texture_set_image(tex[0], frame->data[0], frame->linesize[0], false);
 		return true;
 	}
 
@@ -2367,6 +2514,69 @@ static inline void check_to_swap_bgrx_bgra(obs_source_t *source, struct obs_sour
 	}
 }
 
+/* The ring copy is taken before async filters run, so it can only be used
+ * when no filter could have changed the frame afterwards */
+static bool has_async_video_filters(obs_source_t *source)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		struct obs_source *filter = source->filters.array[i];
+
+		if (filter->enabled && filter->info.filter_video) {
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return found;
+}
+
+static struct async_upload take_async_upload(obs_source_t *source, const struct obs_source_frame *frame)
+{
+	struct async_upload upload = {0};
+
+	pthread_mutex_lock(&source->async_mutex);
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *af = &source->async_cache.array[i];
+		if (af->frame == frame) {
+			upload = af->upload;
+			memset(&af->upload, 0, sizeof(af->upload));
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->async_mutex);
+
+	/* the ring was recreated since the frame was cached */
+	if (upload.gen != source->async_upload_gen || !source->async_upload_ring)
+		upload.gen = 0;
+	if (!upload.gen || has_async_video_filters(source))
+		upload.valid = false;
+	return upload;
+}
+
+/* Uploads a frame taken from the async queue, from the upload ring if it was
+ * copied there when cached. */
+bool upload_async_frame(obs_source_t *source, const struct obs_source_frame *frame, gs_texture_t *tex[MAX_AV_PLANES],
+			gs_texrender_t *texrender)
+{
+	struct async_upload upload = take_async_upload(source, frame);
+	bool success;
+
+	source->async_upload_cur = upload;
+	success = update_async_textures(source, frame, tex, texrender);
+	source->async_upload_cur.valid = false;
+
+	/* frames are consumed in order, so everything cached before this
+	 * one is no longer needed */
+	if (upload.gen)
+		gs_upload_ring_release(source->async_upload_ring, upload.end);
+
+	return success;
+}
+
 static void obs_source_update_async_video(obs_source_t *source)
 {
 	if (!source->async_rendered) {
@@ -2382,7 +2592,7 @@ static void obs_source_update_async_video(obs_source_t *source)
 			}
 
 			if (source->async_update_texture) {
-				update_async_textures(source, frame, source->async_textures, source->async_texrender);
+				upload_async_frame(source, frame, source->async_textures, source->async_texrender);
 				source->async_update_texture = false;
 			}
 
@@ -2964,6 +3174,8 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	invalidate_video(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -3001,6 +3213,8 @@ static bool obs_source_filter_remove_refless(obs_source_t *source, obs_source_t
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	invalidate_video(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -3126,8 +3340,10 @@ void obs_source_filter_set_order(obs_source_t *source, obs_source_t *filter, enu
 	success = move_filter_dir(source, filter, movement);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		invalidate_video(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 int obs_source_filter_get_index(obs_source_t *source, obs_source_t *filter)
@@ -3171,8 +3387,10 @@ void obs_source_filter_set_index(obs_source_t *source, obs_source_t *filter, siz
 	success = set_filter_index(source, filter, index);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		invalidate_video(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 obs_data_t *obs_source_get_settings(const obs_source_t *source)
@@ -3356,6 +3574,67 @@ static void clean_cache(obs_source_t *source)
 	}
 }
 
+static inline void copy_upload_plane(uint8_t *dst, uint32_t dst_linesize, const uint8_t *src, uint32_t src_linesize,
+				     uint32_t rows)
+{
+	if (dst_linesize == src_linesize) {
+		memcpy(dst, src, (size_t)dst_linesize * rows);
+		return;
+	}
+
+	const uint32_t size = dst_linesize < src_linesize ? dst_linesize : src_linesize;
+	for (uint32_t y = 0; y < rows; y++)
+		memcpy(dst + (size_t)dst_linesize * y, src + (size_t)src_linesize * y, size);
+}
+
+/* Copies the frame into the upload ring on the source's own thread, so the
+ * graphics thread only has to issue the texture uploads from it.  The ring
+ * position is recorded even if it is full, so that consuming the frame still
+ * releases everything cached before it. */
+static void cache_upload_frame(struct obs_source *source, struct obs_source_frame *cached,
+			       const struct obs_source_frame *frame)
+{
+	struct async_upload upload = {0};
+
+	if (has_async_video_filters(source))
+		return;
+
+	pthread_mutex_lock(&source->async_upload_mutex);
+
+	gs_upload_ring_t *ring = source->async_upload_ring;
+	if (ring && source->async_upload_width == frame->width && source->async_upload_height == frame->height &&
+	    source->async_upload_format == frame->format && source->async_upload_full_range == frame->full_range &&
+	    source->async_upload_trc == frame->trc) {
+		uint8_t *data = gs_upload_ring_alloc(ring, source->async_upload_frame_size, &upload.pos, &upload.end);
+
+		if (data) {
+			for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+				if (!source->async_upload_linesize[c] || !frame->data[c])
+					continue;
+
+				copy_upload_plane(data + source->async_upload_offset[c],
+						  source->async_upload_linesize[c], frame->data[c], frame->linesize[c],
+						  source->async_upload_rows[c]);
+			}
+			upload.valid = true;
+		}
+
+		upload.gen = source->async_upload_gen;
+	}
+
+	pthread_mutex_unlock(&source->async_upload_mutex);
+
+	pthread_mutex_lock(&source->async_mutex);
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *af = &source->async_cache.array[i];
+		if (af->frame == cached) {
+			af->upload = upload;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
 #define MAX_ASYNC_FRAMES 30
 //if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
 static inline struct obs_source_frame *cache_video(struct obs_source *source, const struct obs_source_frame *frame)
@@ -3396,7 +3675,7 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 	clean_cache(source);
 
 	if (!new_frame) {
-		struct async_frame new_af;
+		struct async_frame new_af = {0};
 
 		new_frame = obs_source_frame_create(format, frame->width, frame->height);
 		new_af.frame = new_frame;
@@ -3412,6 +3691,7 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 	pthread_mutex_unlock(&source->async_mutex);
 
 	copy_frame_data(new_frame, frame);
+	cache_upload_frame(source, new_frame, frame);
 
 	return new_frame;
 }
@@ -3795,25 +4075,10 @@ static void copy_audio_data(obs_source_t *source, const uint8_t *const data[], u
 		source->audio_storage_size = size;
 }
 
-/* TODO: SSE optimization */
 static void downmix_to_mono_planar(struct obs_source *source, uint32_t frames)
 {
 	size_t channels = audio_output_get_channels(obs->audio.audio);
-	const float channels_i = 1.0f / (float)channels;
-	float **data = (float **)source->audio_data.data;
-
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[0][frame] += data[channel][frame];
-	}
-
-	for (uint32_t frame = 0; frame < frames; frame++)
-		data[0][frame] *= channels_i;
-
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[channel][frame] = data[0][frame];
-	}
+	audio_dsp_downmix_mono((float **)source->audio_data.data, channels, frames);
 }
 
 static void process_audio_balancing(struct obs_source *source, uint32_t frames, float balance,
@@ -3823,22 +4088,13 @@ static void process_audio_balancing(struct obs_source *source, uint32_t frames,
 
 	switch (type) {
 	case OBS_BALANCE_TYPE_SINE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * sinf((1.0f - balance) * (M_PI / 2.0f));
-			data[1][frame] = data[1][frame] * sinf(balance * (M_PI / 2.0f));
-		}
+		audio_dsp_pan(data[0], data[1], AUDIO_PAN_LAW_SINE, balance, frames);
 		break;
 	case OBS_BALANCE_TYPE_SQUARE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * sqrtf(1.0f - balance);
-			data[1][frame] = data[1][frame] * sqrtf(balance);
-		}
+		audio_dsp_pan(data[0], data[1], AUDIO_PAN_LAW_SQUARE, balance, frames);
 		break;
 	case OBS_BALANCE_TYPE_LINEAR:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * (1.0f - balance);
-			data[1][frame] = data[1][frame] * balance;
-		}
+		audio_dsp_pan(data[0], data[1], AUDIO_PAN_LAW_LINEAR, balance, frames);
 		break;
 	default:
 		break;
@@ -4866,6 +5122,7 @@ void obs_source_set_enabled(obs_source_t *source, bool enabled)
 		return;
 
 	source->enabled = enabled;
+	invalidate_video(source);
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
@@ -5064,25 +5321,15 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 	return source->volume;
 }
 
-static inline void multiply_output_audio(obs_source_t *source, size_t mix, size_t channels, float vol)
-{
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
-
-	while (out < end)
-		*(out++) *= vol;
-}
-
-static inline void multiply_vol_data(obs_source_t *source, size_t mix, size_t channels, float *vol_data)
+/* copies src to dst with either a constant volume or one volume per frame */
+static inline void copy_with_volume(float *dst, const float *src, size_t frames, float vol, const float *vol_data)
 {
-	for (size_t ch = 0; ch < channels; ch++) {
-		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
-		register float *vol = vol_data;
-
-		while (out < end)
-			*(out++) *= *(vol++);
-	}
+	if (vol_data)
+		audio_dsp_gain_env(dst, src, vol_data, frames);
+	else if (vol != 1.0f)
+		audio_dsp_gain(dst, src, vol, frames);
+	else if (dst != src)
+		memcpy(dst, src, frames * sizeof(float));
 }
 
 static inline void apply_audio_action(obs_source_t *source, const struct audio_action *action)
@@ -5103,9 +5350,8 @@ static inline void apply_audio_action(obs_source_t *source, const struct audio_a
 	}
 }
 
-static void apply_audio_actions(obs_source_t *source, size_t channels, size_t sample_rate)
+static void apply_audio_actions(obs_source_t *source, size_t sample_rate, size_t frames, float *vol_data)
 {
-	float vol_data[AUDIO_OUTPUT_FRAMES];
 	float cur_vol = get_source_volume(source, source->audio_ts);
 	size_t frame_num = 0;
 
@@ -5121,7 +5367,7 @@ static void apply_audio_actions(obs_source_t *source, size_t channels, size_t sa
 
 		new_frame_num = conv_time_to_frames(sample_rate, timestamp - source->audio_ts);
 
-		if (new_frame_num >= AUDIO_OUTPUT_FRAMES)
+		if (new_frame_num >= frames)
 			break;
 
 		da_erase(source->audio_actions, i--);
@@ -5136,22 +5382,18 @@ static void apply_audio_actions(obs_source_t *source, size_t channels, size_t sa
 		cur_vol = get_source_volume(source, timestamp);
 	}
 
-	for (; frame_num < AUDIO_OUTPUT_FRAMES; frame_num++)
+	for (; frame_num < frames; frame_num++)
 		vol_data[frame_num] = cur_vol;
 
 	pthread_mutex_unlock(&source->audio_actions_mutex);
-
-	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		if ((source->audio_mixers & (1 << mix)) != 0)
-			multiply_vol_data(source, mix, channels, vol_data);
-	}
 }
 
-static void apply_audio_volume(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate)
+/* returns true if the volume changes during this tick, in which case it is
+ * written to vol_data for every frame, otherwise it is returned in vol */
+static bool get_audio_volume(obs_source_t *source, size_t sample_rate, size_t frames, float *vol, float *vol_data)
 {
 	struct audio_action action;
 	bool actions_pending;
-	float vol;
 
 	pthread_mutex_lock(&source->audio_actions_mutex);
 
@@ -5162,32 +5404,66 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers, size_t cha
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
 	if (actions_pending) {
-		uint64_t duration = conv_frames_to_time(sample_rate, AUDIO_OUTPUT_FRAMES);
+		uint64_t duration = conv_frames_to_time(sample_rate, frames);
 
 		if (action.timestamp < (source->audio_ts + duration)) {
-			apply_audio_actions(source, channels, sample_rate);
-			return;
+			apply_audio_actions(source, sample_rate, frames, vol_data);
+			return true;
+		}
+	}
+
+	*vol = get_source_volume(source, source->audio_ts);
+	return false;
+}
+
+/* channels are AUDIO_OUTPUT_FRAMES apart, of which the tick uses frames */
+static inline void clear_audio_output(obs_source_t *source, size_t mix, size_t channels, size_t frames)
+{
+	for (size_t ch = 0; ch < channels; ch++)
+		memset(source->audio_output_buf[mix][ch], 0, frames * sizeof(float));
+}
+
+static void apply_audio_volume(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate,
+			       size_t frames)
+{
+	float vol_data[AUDIO_OUTPUT_FRAMES];
+	float vol;
+
+	if (get_audio_volume(source, sample_rate, frames, &vol, vol_data)) {
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+			if ((source->audio_mixers & (1 << mix)) == 0)
+				continue;
+
+			for (size_t ch = 0; ch < channels; ch++) {
+				float *out = source->audio_output_buf[mix][ch];
+				audio_dsp_gain_env(out, out, vol_data, frames);
+			}
 		}
+		return;
 	}
 
-	vol = get_source_volume(source, source->audio_ts);
 	if (vol == 1.0f)
 		return;
 
 	if (vol == 0.0f || mixers == 0) {
-		memset(source->audio_output_buf[0][0], 0,
-		       AUDIO_OUTPUT_FRAMES * sizeof(float) * MAX_AUDIO_CHANNELS * MAX_AUDIO_MIXES);
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+			clear_audio_output(source, mix, channels, frames);
 		return;
 	}
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		uint32_t mix_and_val = (1 << mix);
-		if ((source->audio_mixers & mix_and_val) != 0 && (mixers & mix_and_val) != 0)
-			multiply_output_audio(source, mix, channels, vol);
+		if ((source->audio_mixers & mix_and_val) != 0 && (mixers & mix_and_val) != 0) {
+			for (size_t ch = 0; ch < channels; ch++) {
+				float *out = source->audio_output_buf[mix][ch];
+				audio_dsp_gain(out, out, vol, frames);
+			}
+		}
 	}
 }
 
-static void custom_audio_render(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate)
+static void custom_audio_render(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate,
+				size_t frames)
 {
 	struct obs_source_audio_mix audio_data;
 	bool success;
@@ -5199,7 +5475,7 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers, size_t ch
 		}
 
 		if ((source->audio_mixers & mixers & (1 << mix)) != 0) {
-			memset(source->audio_output_buf[mix][0], 0, sizeof(float) * AUDIO_OUTPUT_FRAMES * channels);
+			clear_audio_output(source, mix, channels, frames);
 		}
 	}
 
@@ -5217,14 +5493,14 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers, size_t ch
 			continue;
 
 		if ((source->audio_mixers & mix_bit) == 0) {
-			memset(source->audio_output_buf[mix][0], 0, sizeof(float) * AUDIO_OUTPUT_FRAMES * channels);
+			clear_audio_output(source, mix, channels, frames);
 		}
 	}
 
-	apply_audio_volume(source, mixers, channels, sample_rate);
+	apply_audio_volume(source, mixers, channels, sample_rate, frames);
 }
 
-static void audio_submix(obs_source_t *source, size_t channels, size_t sample_rate)
+static void audio_submix(obs_source_t *source, size_t channels, size_t sample_rate, size_t frames)
 {
 	struct audio_output_data audio_data;
 	struct obs_source_audio audio = {0};
@@ -5233,10 +5509,9 @@ static void audio_submix(obs_source_t *source, size_t channels, size_t sample_ra
 
 	for (size_t ch = 0; ch < channels; ch++) {
 		audio_data.data[ch] = source->audio_mix_buf[ch];
+		memset(source->audio_mix_buf[ch], 0, sizeof(float) * frames);
 	}
 
-	memset(source->audio_mix_buf[0], 0, sizeof(float) * AUDIO_OUTPUT_FRAMES * channels);
-
 	success = source->info.audio_mix(source->context.data, &ts, &audio_data, channels, sample_rate);
 
 	if (!success)
@@ -5246,7 +5521,7 @@ static void audio_submix(obs_source_t *source, size_t channels, size_t sample_ra
 		audio.data[i] = (const uint8_t *)audio_data.data[i];
 
 	audio.samples_per_sec = (uint32_t)sample_rate;
-	audio.frames = AUDIO_OUTPUT_FRAMES;
+	audio.frames = (uint32_t)frames;
 	audio.format = AUDIO_FORMAT_FLOAT_PLANAR;
 	audio.speakers = (enum speaker_layout)channels;
 	audio.timestamp = ts;
@@ -5259,51 +5534,92 @@ static inline void process_audio_source_tick(obs_source_t *source, uint32_t mixe
 {
 	bool audio_submix = !!(source->info.output_flags & OBS_SOURCE_SUBMIX);
 
-	pthread_mutex_lock(&source->audio_buf_mutex);
+	struct audio_ring *ring = obs_source_audio_input(source);
+	uint32_t frames = (uint32_t)(size / sizeof(float));
 
-	if (source->audio_input_buf[0].size < size) {
+	if (!ring || audio_ring_size(ring) < frames) {
 		source->audio_pending = true;
-		pthread_mutex_unlock(&source->audio_buf_mutex);
 		return;
 	}
 
-	for (size_t ch = 0; ch < channels; ch++)
-		deque_peek_front(&source->audio_input_buf[ch], source->audio_output_buf[0][ch], size);
+	audio_ring_peek(ring, source->audio_output_buf[0], channels, frames);
 
-	pthread_mutex_unlock(&source->audio_buf_mutex);
+	if (audio_submix) {
+		if ((source->audio_mixers & 1) == 0) {
+			clear_audio_output(source, 1, channels, frames);
+		} else {
+			for (size_t ch = 0; ch < channels; ch++)
+				memcpy(source->audio_output_buf[1][ch], source->audio_output_buf[0][ch], size);
+		}
 
-	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
-		uint32_t mix_and_val = (1 << mix);
+		source->audio_pending = false;
+		return;
+	}
 
-		if (audio_submix) {
-			if (mix > 1)
-				break;
+	/* the volume is applied while copying to the other mixes, so every
+	 * mix is only written once */
+	float vol_data[AUDIO_OUTPUT_FRAMES];
+	float vol = 1.0f;
+	bool vol_changes = get_audio_volume(source, sample_rate, frames, &vol, vol_data);
 
-			mixers = 1;
-			mix_and_val = 1;
-		}
+	if (!vol_changes && (vol == 0.0f || mixers == 0)) {
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+			clear_audio_output(source, mix, channels, frames);
+		source->audio_pending = false;
+		return;
+	}
+
+	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
+		uint32_t mix_and_val = (1 << mix);
 
 		if ((source->audio_mixers & mix_and_val) == 0 || (mixers & mix_and_val) == 0) {
-			memset(source->audio_output_buf[mix][0], 0, size * channels);
+			clear_audio_output(source, mix, channels, frames);
 			continue;
 		}
 
 		for (size_t ch = 0; ch < channels; ch++)
-			memcpy(source->audio_output_buf[mix][ch], source->audio_output_buf[0][ch], size);
+			copy_with_volume(source->audio_output_buf[mix][ch], source->audio_output_buf[0][ch], frames,
+					 vol, vol_changes ? vol_data : NULL);
 	}
 
-	if (audio_submix) {
-		source->audio_pending = false;
-		return;
+	if ((source->audio_mixers & 1) == 0 || (mixers & 1) == 0) {
+		clear_audio_output(source, 0, channels, frames);
+	} else {
+		for (size_t ch = 0; ch < channels; ch++)
+			copy_with_volume(source->audio_output_buf[0][ch], source->audio_output_buf[0][ch], frames,
+					 vol, vol_changes ? vol_data : NULL);
 	}
 
-	if ((source->audio_mixers & 1) == 0 || (mixers & 1) == 0)
-		memset(source->audio_output_buf[0][0], 0, size * channels);
-
-	apply_audio_volume(source, mixers, channels, sample_rate);
 	source->audio_pending = false;
 }
 
+void obs_source_audio_input_acquire(obs_source_t *source)
+{
+	long idx = os_atomic_load_long(&source->audio_ring_idx);
+	long read_idx = source->audio_read_idx;
+	struct audio_ring *ring = source->audio_rings[idx];
+	uint64_t ts;
+
+	if (idx != read_idx) {
+		audio_ring_adopt(ring, source->audio_rings[read_idx]);
+		audio_ring_destroy(source->audio_rings[read_idx]);
+		source->audio_rings[read_idx] = NULL;
+		os_atomic_store_long(&source->audio_read_idx, idx);
+	}
+
+	if (ring && audio_ring_acquire(ring, &ts)) {
+		source->audio_ts = ts;
+		source->last_audio_input_frames = 0;
+	}
+}
+
+void obs_source_audio_input_release(obs_source_t *source)
+{
+	struct audio_ring *ring = obs_source_audio_input(source);
+	if (ring)
+		audio_ring_release(ring, source->audio_ts);
+}
+
 void obs_source_audio_render(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate, size_t size)
 {
 	if (!source->audio_output_buf[0][0]) {
@@ -5316,14 +5632,16 @@ void obs_source_audio_render(obs_source_t *source, uint32_t mixers, size_t chann
 			source->audio_pending = true;
 			return;
 		}
-		custom_audio_render(source, mixers, channels, sample_rate);
+		custom_audio_render(source, mixers, channels, sample_rate, size / sizeof(float));
 		return;
 	}
 
 	if (source->info.audio_mix) {
-		audio_submix(source, channels, sample_rate);
+		audio_submix(source, channels, sample_rate, size / sizeof(float));
 	}
 
+	obs_source_audio_input_acquire(source);
+
 	if (!source->audio_ts) {
 		source->audio_pending = true;
 		return;
@@ -203,6 +203,14 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CAP_DONT_SHOW_PROPERTIES (1 << 16)
 
+/**
+ * Source's video output only changes when its settings are updated, or when
+ * obs_source_invalidate_video is called.  Scene items may reuse the last
+ * rendered texture of a static source (and its static filters) instead of
+ * rendering it every frame.
+ */
+#define OBS_SOURCE_STATIC_VIDEO (1 << 17)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent, obs_source_t *child, void *param);
@@ -36,6 +36,7 @@ static void *gpu_encode_thread(void *data)
 	while (os_sem_wait(video->gpu_encode_semaphore) == 0) {
 		struct obs_tex_frame tf;
 		uint64_t timestamp;
+		uint64_t frame_index;
 		uint64_t lock_key;
 		uint64_t next_key;
 		size_t lock_count = 0;
@@ -58,6 +59,7 @@ static void *gpu_encode_thread(void *data)
 		pthread_mutex_lock(&video->gpu_encoder_mutex);
 
 		deque_pop_front(&video->gpu_encoder_queue, &tf, sizeof(tf));
+		frame_index = video->gpu_frames_encoded++;
 		timestamp = tf.timestamp;
 		lock_key = tf.lock_key;
 		next_key = tf.lock_key;
@@ -78,7 +80,6 @@ static void *gpu_encode_thread(void *data)
 			struct encoder_packet pkt = {0};
 			bool received = false;
 			bool success = false;
-			uint32_t skip = 0;
 
 			obs_encoder_t *encoder = encoders.array[i];
 			obs_weak_encoder_t **paired = encoder->paired_encoders.array;
@@ -125,13 +126,10 @@ static void *gpu_encode_thread(void *data)
 				encoder->info.update(encoder->context.data, encoder->context.settings);
 			}
 
-			// an explicit counter is used instead of remainder calculation
-			// to allow multiple encoders started at the same time to start on
-			// the same frame
-			skip = encoder->frame_rate_divisor_counter++;
-			if (encoder->frame_rate_divisor_counter == encoder->frame_rate_divisor)
-				encoder->frame_rate_divisor_counter = 0;
-			if (skip)
+			// frames are numbered in the order they were queued by the
+			// graphics thread, which does not render the ones no
+			// encoder takes
+			if (frame_index % encoder->frame_rate_divisor)
 				continue;
 
 			if (!encoder->start_ts)
@@ -198,9 +196,14 @@ static void *gpu_encode_thread(void *data)
 
 		if (--tf.count) {
 			tf.timestamp += interval;
-			deque_push_front(&video->gpu_encoder_queue, &tf, sizeof(tf));
 
-			video_output_inc_texture_skipped_frames(video->video);
+			/* only repeats caused by lag count as skipped */
+			if (tf.repeats)
+				tf.repeats--;
+			else
+				video_output_inc_texture_skipped_frames(video->video);
+
+			deque_push_front(&video->gpu_encoder_queue, &tf, sizeof(tf));
 		} else {
 			deque_push_back(&video->gpu_encoder_avail_queue, &tf, sizeof(tf));
 		}
@@ -229,6 +232,8 @@ bool init_gpu_encoding(struct obs_core_video_mix *video)
 	const struct video_output_info *info = video_output_get_info(video->video);
 
 	video->gpu_encode_stop = false;
+	video->gpu_frames_queued = 0;
+	video->gpu_frames_encoded = 0;
 
 	deque_reserve(&video->gpu_encoder_avail_queue, NUM_ENCODE_TEXTURES);
 	for (size_t i = 0; i < NUM_ENCODE_TEXTURES; i++) {
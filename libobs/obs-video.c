@@ -143,7 +143,9 @@ static inline bool can_reuse_mix_texture(const struct obs_core_video_mix *mix, s
 			continue;
 		if (other->ovi.base_width != mix->ovi.base_width || other->ovi.base_height != mix->ovi.base_height)
 			continue;
-		if (!other->texture_rendered)
+		if (!other->texture_rendered || other->frame_skipped)
+			continue;
+		if (other->source_texture != other->render_texture)
 			continue;
 
 		*idx = i;
@@ -153,25 +155,24 @@ static inline bool can_reuse_mix_texture(const struct obs_core_video_mix *mix, s
 	return false;
 }
 
-static inline void draw_mix_texture(const size_t mix_idx)
-{
-	gs_texture_t *tex = obs->video.mixes.array[mix_idx]->render_texture;
-	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
-	gs_eparam_t *param = gs_effect_get_param_by_name(effect, "image");
-	gs_effect_set_texture_srgb(param, tex);
-
-	gs_enable_framebuffer_srgb(true);
-	while (gs_effect_loop(effect, "Draw"))
-		gs_draw_sprite(tex, 0, 0, 0);
-	gs_enable_framebuffer_srgb(false);
-}
-
 static const char *render_main_texture_name = "render_main_texture";
 static inline void render_main_texture(struct obs_core_video_mix *video)
 {
 	uint32_t base_width = video->ovi.base_width;
 	uint32_t base_height = video->ovi.base_height;
 
+	/* Mixes showing the same view at the same base size (e.g. one per
+	 * rescaled encoder) scale and convert straight from the texture of the
+	 * first one rather than rendering or copying it again */
+	size_t reuse_idx;
+	if (can_reuse_mix_texture(video, &reuse_idx)) {
+		video->source_texture = obs->video.mixes.array[reuse_idx]->render_texture;
+		video->texture_rendered = true;
+		return;
+	}
+
+	video->source_texture = video->render_texture;
+
 	profile_start(render_main_texture_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_MAIN_TEXTURE, render_main_texture_name);
 
@@ -192,12 +193,7 @@ static inline void render_main_texture(struct obs_core_video_mix *video)
 
 	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
 
-	/* In some cases we can reuse a previous mix's texture and save re-rendering everything */
-	size_t reuse_idx;
-	if (can_reuse_mix_texture(video, &reuse_idx))
-		draw_mix_texture(reuse_idx);
-	else
-		obs_view_render(video->view);
+	obs_view_render(video->view);
 
 	video->texture_rendered = true;
 
@@ -268,7 +264,7 @@ static const char *render_output_texture_name = "render_output_texture";
 static inline gs_texture_t *render_output_texture(struct obs_core_video_mix *mix)
 {
 	struct obs_video_info *const ovi = &mix->ovi;
-	gs_texture_t *texture = mix->render_texture;
+	gs_texture_t *texture = mix->source_texture;
 	gs_texture_t *target = mix->output_texture;
 	const uint32_t width = gs_texture_get_width(target);
 	const uint32_t height = gs_texture_get_height(target);
@@ -406,6 +402,8 @@ static inline void stage_output_texture(struct obs_core_video_mix *video, int cu
 					gs_texture_t *const *const convert_textures, gs_texture_t *output_texture,
 					gs_stagesurf_t *const *const copy_surfaces, size_t channel_count)
 {
+	bool staged = false;
+
 	profile_start(stage_output_texture_name);
 
 	unmap_last_surface(video);
@@ -419,7 +417,7 @@ static inline void stage_output_texture(struct obs_core_video_mix *video, int cu
 		for (size_t i = 1; i < NUM_CHANNELS; ++i)
 			video->active_copy_surfaces[cur_texture][i] = NULL;
 
-		video->textures_copied[cur_texture] = true;
+		staged = true;
 	} else if (video->texture_converted) {
 		for (size_t i = 0; i < channel_count; i++) {
 			gs_stagesurf_t *copy = copy_surfaces[i];
@@ -431,7 +429,16 @@ static inline void stage_output_texture(struct obs_core_video_mix *video, int cu
 		for (size_t i = channel_count; i < NUM_CHANNELS; ++i)
 			video->active_copy_surfaces[cur_texture][i] = NULL;
 
+		staged = true;
+	}
+
+	if (staged) {
 		video->textures_copied[cur_texture] = true;
+		video->readback_start_time[cur_texture] = os_gettime_ns();
+		video->pending_downloads++;
+
+		if (++video->cur_texture == video->readback_depth)
+			video->cur_texture = 0;
 	}
 
 	profile_end(stage_output_texture_name);
@@ -452,6 +459,10 @@ static inline bool queue_frame(struct obs_core_video_mix *video, bool raw_active
 		}
 
 		tf->count++;
+		if (vframe_info->repeats) {
+			vframe_info->repeats--;
+			tf->repeats++;
+		}
 		os_sem_post(video->gpu_encode_semaphore);
 		goto finish;
 	}
@@ -491,6 +502,7 @@ static inline bool queue_frame(struct obs_core_video_mix *video, bool raw_active
 	}
 
 	tf.count = 1;
+	tf.repeats = 0;
 	tf.timestamp = vframe_info->timestamp;
 	tf.released = true;
 #ifdef _WIN32
@@ -502,6 +514,7 @@ static inline bool queue_frame(struct obs_core_video_mix *video, bool raw_active
 	os_sem_post(video->gpu_encode_semaphore);
 
 finish:
+	video->gpu_frames_queued++;
 	return --vframe_info->count;
 }
 
@@ -580,13 +593,44 @@ static inline void render_video(struct obs_core_video_mix *video, bool raw_activ
 	gs_end_scene();
 }
 
-static inline bool download_frame(struct obs_core_video_mix *video, int prev_texture, struct video_data *frame)
+static inline bool staged_frame_ready(struct obs_core_video_mix *video, int texture)
+{
+	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
+		gs_stagesurf_t *surface = video->active_copy_surfaces[texture][channel];
+		if (surface && !gs_stagesurface_is_ready(surface))
+			return false;
+	}
+	return true;
+}
+
+/* Maps the oldest staged frame once the GPU has finished copying it.  Only
+ * waits on the GPU when every readback slot is in flight, since the next
+ * frame would otherwise have to overwrite it. */
+static inline bool download_frame(struct obs_core_video_mix *video, struct video_data *frame)
 {
-	if (!video->textures_copied[prev_texture])
+	const int depth = video->readback_depth;
+
+	/* Always leave the frame staged this tick in flight */
+	if (video->pending_downloads < 2)
+		return false;
+
+	int texture = (video->cur_texture - video->pending_downloads + depth) % depth;
+	if (!video->textures_copied[texture])
 		return false;
 
+	if (!staged_frame_ready(video, texture)) {
+		if (video->pending_downloads < depth) {
+			video->readback_deferred++;
+			return false;
+		}
+
+		video->readback_stalls++;
+	}
+
+	video->pending_downloads--;
+
 	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
-		gs_stagesurf_t *surface = video->active_copy_surfaces[prev_texture][channel];
+		gs_stagesurf_t *surface = video->active_copy_surfaces[texture][channel];
 		if (surface) {
 			if (!gs_stagesurface_map(surface, &frame->data[channel], &frame->linesize[channel]))
 				return false;
@@ -594,6 +638,12 @@ static inline bool download_frame(struct obs_core_video_mix *video, int prev_tex
 			video->mapped_surfaces[channel] = surface;
 		}
 	}
+
+	uint64_t latency = os_gettime_ns() - video->readback_start_time[texture];
+	video->readback_total_latency += latency;
+	if (latency > video->readback_max_latency)
+		video->readback_max_latency = latency;
+	video->readback_frames++;
 	return true;
 }
 
@@ -802,6 +852,21 @@ void add_ready_encoder_group(obs_encoder_t *encoder)
 	pthread_mutex_unlock(&obs->video.encoder_group_mutex);
 }
 
+/* Adds the frame info of this tick to a mix's queue.  If the mix skipped
+ * rendering, the count goes to the last rendered frame instead, which is then
+ * output once for every tick it stands in for. */
+static inline void push_vframe_info(struct deque *buf, const struct obs_vframe_info *vframe_info, bool skipped)
+{
+	if (skipped && buf->size) {
+		struct obs_vframe_info *last = deque_data(buf, buf->size - sizeof(*last));
+		last->count += vframe_info->count;
+		last->repeats++;
+		return;
+	}
+
+	deque_push_back(buf, vframe_info, sizeof(*vframe_info));
+}
+
 static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time, uint64_t interval_ns)
 {
 	struct obs_vframe_info vframe_info;
@@ -826,6 +891,7 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time, u
 
 	vframe_info.timestamp = cur_time;
 	vframe_info.count = count;
+	vframe_info.repeats = 0;
 
 	pthread_mutex_lock(&video->encoder_group_mutex);
 	for (size_t i = 0; i < video->ready_encoder_groups.num; i++) {
@@ -851,11 +917,14 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time, u
 		struct obs_core_video_mix *video = obs->video.mixes.array[i];
 		bool raw_active = video->raw_was_active;
 		bool gpu_active = video->gpu_was_active;
+		bool skipped = video->frame_skipped;
 
-		if (raw_active)
-			deque_push_back(&video->vframe_info_buffer, &vframe_info, sizeof(vframe_info));
+		if (raw_active) {
+			push_vframe_info(&video->vframe_info_buffer, &vframe_info, skipped);
+			video->raw_frame_index += count;
+		}
 		if (gpu_active)
-			deque_push_back(&video->vframe_info_buffer_gpu, &vframe_info, sizeof(vframe_info));
+			push_vframe_info(&video->vframe_info_buffer_gpu, &vframe_info, skipped);
 	}
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
@@ -865,41 +934,54 @@ static const char *output_frame_render_video_name = "render_video";
 static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
 static const char *output_frame_output_video_data_name = "output_video_data";
-static inline void output_frame(struct obs_core_video_mix *video)
+/* shared by all mixes, mixes come and go and names are never freed */
+static const char *render_mix_name = "render_mix";
+static const char *output_mix_name = "output_mix";
+static inline void render_frame(struct obs_core_video_mix *video)
 {
 	const bool raw_active = video->raw_was_active;
 	const bool gpu_active = video->gpu_was_active;
 
-	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1 : cur_texture - 1;
-	struct video_data frame;
-	bool frame_ready = 0;
-
-	memset(&frame, 0, sizeof(struct video_data));
-
+	profile_start(render_mix_name);
 	profile_start(output_frame_gs_context_name);
 	gs_enter_context(obs->video.graphics);
 
 	profile_start(output_frame_render_video_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_RENDER_VIDEO, output_frame_render_video_name);
-	render_video(video, raw_active, gpu_active, cur_texture);
+	render_video(video, raw_active, gpu_active, video->cur_texture);
 	GS_DEBUG_MARKER_END();
 	profile_end(output_frame_render_video_name);
 
-	if (raw_active) {
-		profile_start(output_frame_download_frame_name);
-		frame_ready = download_frame(video, prev_texture, &frame);
-		profile_end(output_frame_download_frame_name);
-	}
-
 	profile_start(output_frame_gs_flush_name);
 	gs_flush();
 	profile_end(output_frame_gs_flush_name);
 
 	gs_leave_context();
 	profile_end(output_frame_gs_context_name);
+	profile_end(render_mix_name);
+}
+
+/* Reads back the oldest finished frame of the mix, if any, and hands it to
+ * the video output. */
+static inline void finish_frame(struct obs_core_video_mix *video)
+{
+	struct video_data frame;
+	bool frame_ready;
+
+	if (!video->raw_was_active)
+		return;
+
+	memset(&frame, 0, sizeof(struct video_data));
 
-	if (raw_active && frame_ready) {
+	profile_start(output_mix_name);
+
+	profile_start(output_frame_download_frame_name);
+	gs_enter_context(obs->video.graphics);
+	frame_ready = download_frame(video, &frame);
+	gs_leave_context();
+	profile_end(output_frame_download_frame_name);
+
+	if (frame_ready) {
 		struct obs_vframe_info vframe_info;
 		deque_pop_front(&video->vframe_info_buffer, &vframe_info, sizeof(vframe_info));
 
@@ -909,25 +991,91 @@ static inline void output_frame(struct obs_core_video_mix *video)
 		profile_end(output_frame_output_video_data_name);
 	}
 
-	if (++video->cur_texture == NUM_TEXTURES)
-		video->cur_texture = 0;
+	profile_end(output_mix_name);
+}
+
+static inline uint32_t gcd_u32(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* The frame rendered this tick is queued to the texture encoders as the last
+ * copy of the oldest pending frame info, see queue_frame. */
+static bool gpu_frame_wanted(struct obs_core_video_mix *video)
+{
+	struct obs_vframe_info *vframe_info = deque_data(&video->vframe_info_buffer_gpu, 0);
+	uint32_t divisor = 0;
+	bool wanted;
+
+	if (!vframe_info)
+		return false;
+
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	for (size_t i = 0; i < video->gpu_encoders.num; i++)
+		divisor = gcd_u32(divisor, video->gpu_encoders.array[i]->frame_rate_divisor);
+
+	wanted = !divisor || (video->gpu_frames_queued + vframe_info->count - 1) % divisor == 0;
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+
+	return wanted;
+}
+
+/* Raw outputs and texture encoders with a frame rate divisor only take every
+ * Nth frame, so mixes other than the main mix (whose render texture is also
+ * drawn by displays) are only rendered on ticks where one of them takes the
+ * frame.  Mixes nothing is connected to are not rendered at all. */
+static bool mix_frame_wanted(struct obs_core_video_mix *video)
+{
+	if (video == obs->video.main_mix)
+		return true;
+
+	if (video->raw_was_active &&
+	    video->raw_frame_index % video_output_get_frame_rate_divisor(video->video) == 0)
+		return true;
+
+	return video->gpu_was_active && gpu_frame_wanted(video);
 }
 
 static inline void output_frames(void)
 {
+	struct obs_core_video_mix *prev = NULL;
+
 	pthread_mutex_lock(&obs->video.mixes_mutex);
 	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
 		struct obs_core_video_mix *mix = obs->video.mixes.array[i];
-		if (mix->view) {
-			output_frame(mix);
-		} else {
+		if (!mix->view) {
 			obs->video.mixes.array[i] = NULL;
 			obs_free_video_mix(mix);
 			da_erase(obs->video.mixes, i);
 			i--;
 			num--;
+			continue;
+		}
+
+		mix->frame_skipped = !mix_frame_wanted(mix);
+		if (mix->frame_skipped)
+			mix->renders_skipped++;
+		else
+			render_frame(mix);
+
+		/* the previous mix is read back and output while the GPU is
+		 * busy with this one */
+		if (obs->video.serial_mixes) {
+			finish_frame(mix);
+		} else {
+			if (prev)
+				finish_frame(prev);
+			prev = mix;
 		}
 	}
+
+	if (prev)
+		finish_frame(prev);
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
@@ -939,12 +1087,15 @@ static void clear_base_frame_data(struct obs_core_video_mix *video)
 	video->texture_converted = false;
 	deque_free(&video->vframe_info_buffer);
 	video->cur_texture = 0;
+	video->pending_downloads = 0;
 }
 
 static void clear_raw_frame_data(struct obs_core_video_mix *video)
 {
 	memset(video->textures_copied, 0, sizeof(video->textures_copied));
 	deque_free(&video->vframe_info_buffer);
+	video->pending_downloads = 0;
+	video->raw_frame_index = 0;
 }
 
 static void clear_gpu_frame_data(struct obs_core_video_mix *video)
@@ -157,6 +157,8 @@ static inline void set_main_mix()
 	if (idx != DARRAY_INVALID)
 		mix = obs->video.mixes.array[idx];
 	obs->video.main_mix = mix;
+
+	obs_audio_graph_changed();
 }
 
 video_t *obs_view_add(obs_view_t *view)
@@ -370,7 +370,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 		break;
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (size_t i = 0; i < (size_t)video->readback_depth; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces_encode[i] = gs_stagesurface_create_nv12(info->width, info->height);
@@ -434,7 +434,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 	if (success) {
 		video->render_space = space;
 	} else {
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(video->copy_surfaces[i][c]);
@@ -623,6 +623,8 @@ static int obs_init_video_mix(struct obs_video_info *ovi, struct obs_core_video_
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 
 	video->gpu_conversion = ovi->gpu_conversion;
+	video->readback_depth = obs->video.readback_depth ? obs->video.readback_depth : DEFAULT_READBACK_DEPTH;
+
 	video->gpu_was_active = false;
 	video->raw_was_active = false;
 	video->was_active = false;
@@ -728,7 +730,7 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 		}
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
 		for (size_t c = 0; c < NUM_CHANNELS; c++) {
 			if (video->copy_surfaces[i][c]) {
 				gs_stagesurface_destroy(video->copy_surfaces[i][c]);
@@ -760,14 +762,33 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 
 	gs_texture_destroy(video->output_texture);
 	video->render_texture = NULL;
+	video->source_texture = NULL;
 	video->output_texture = NULL;
 
 	gs_leave_context();
 }
 
+static void log_readback_stats(const struct obs_core_video_mix *video)
+{
+	if (video->renders_skipped)
+		blog(LOG_INFO, "Video mix: %" PRIu64 " frames not rendered (no consumer)", video->renders_skipped);
+
+	if (!video->readback_frames)
+		return;
+
+	blog(LOG_INFO,
+	     "Video readback (depth %d): %" PRIu64 " frames, %" PRIu64 " stalled, %" PRIu64
+	     " deferred, latency avg %.2f ms, max %.2f ms",
+	     video->readback_depth, video->readback_frames, video->readback_stalls, video->readback_deferred,
+	     (double)video->readback_total_latency / (double)video->readback_frames / 1000000.0,
+	     (double)video->readback_max_latency / 1000000.0);
+}
+
 void obs_free_video_mix(struct obs_core_video_mix *video)
 {
 	if (video->video) {
+		log_readback_stats(video);
+
 		video_output_close(video->video);
 		video->video = NULL;
 
@@ -786,6 +807,7 @@ void obs_free_video_mix(struct obs_core_video_mix *video)
 
 		video->gpu_encoder_active = 0;
 		video->cur_texture = 0;
+		video->pending_downloads = 0;
 	}
 	bfree(video);
 }
@@ -869,10 +891,14 @@ static bool obs_init_audio(struct audio_output_info *ai)
 	struct obs_task_info audio_init = {.task = set_audio_thread};
 	deque_push_back(&audio->tasks, &audio_init, sizeof(audio_init));
 
+	/* nothing has been built yet */
+	audio->graph_cached_generation = -1;
+	init_audio_render_pool(audio);
+
 	audio->monitoring_device_name = bstrdup("Default");
 	audio->monitoring_device_id = bstrdup("default");
 
-	errorcode = audio_output_open(&audio->audio, ai);
+	errorcode = audio_output_open2(&audio->audio, ai, audio->frames);
 	if (errorcode == AUDIO_OUTPUT_SUCCESS)
 		return true;
 	else if (errorcode == AUDIO_OUTPUT_INVALIDPARAM)
@@ -899,6 +925,10 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	free_audio_render_pool(audio);
+	free_audio_graph(audio);
+	audio_profiler_shutdown();
+
 	deque_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
@@ -1066,6 +1096,8 @@ static inline bool obs_init_handlers(void)
 	if (!obs->procs)
 		return false;
 
+	audio_profiler_add_procs(obs->procs);
+
 	return signal_handler_add_array(obs->signals, obs_signals);
 }
 
@@ -1510,7 +1542,7 @@ int obs_reset_video(struct obs_video_info *ovi)
 #define SEC_TO_MSEC 1000
 #endif
 
-bool obs_reset_audio2(const struct obs_audio_info2 *oai)
+bool obs_reset_audio3(const struct obs_audio_info3 *oai)
 {
 	struct obs_core_audio *audio = &obs->audio;
 	struct audio_output_info ai;
@@ -1519,21 +1551,28 @@ bool obs_reset_audio2(const struct obs_audio_info2 *oai)
 	if (!obs || (audio->audio && audio_output_active(audio->audio)))
 		return false;
 
+	if (oai && oai->frames_per_tick > AUDIO_OUTPUT_FRAMES) {
+		blog(LOG_ERROR, "Invalid audio frames per tick: %" PRIu32, oai->frames_per_tick);
+		return false;
+	}
+
 	obs_free_audio();
 	if (!oai)
 		return true;
 
+	audio->frames = oai->frames_per_tick ? oai->frames_per_tick : AUDIO_OUTPUT_FRAMES;
+
 	if (oai->max_buffering_ms) {
 		uint32_t max_frames = oai->max_buffering_ms * oai->samples_per_sec / SEC_TO_MSEC;
-		max_frames += (AUDIO_OUTPUT_FRAMES - 1);
-		audio->max_buffering_ticks = max_frames / AUDIO_OUTPUT_FRAMES;
+		max_frames += (audio->frames - 1);
+		audio->max_buffering_ticks = max_frames / audio->frames;
 	} else {
-		audio->max_buffering_ticks = 45;
+		/* same amount of time regardless of the tick size */
+		audio->max_buffering_ticks = 45 * AUDIO_OUTPUT_FRAMES / audio->frames;
 	}
 	audio->fixed_buffer = oai->fixed_buffering;
 
-	int max_buffering_ms =
-		audio->max_buffering_ticks * AUDIO_OUTPUT_FRAMES * SEC_TO_MSEC / (int)oai->samples_per_sec;
+	int max_buffering_ms = audio->max_buffering_ticks * audio->frames * SEC_TO_MSEC / (int)oai->samples_per_sec;
 
 	ai.name = "Audio";
 	ai.samples_per_sec = oai->samples_per_sec;
@@ -1546,14 +1585,30 @@ bool obs_reset_audio2(const struct obs_audio_info2 *oai)
 	     "audio settings reset:\n"
 	     "\tsamples per sec: %d\n"
 	     "\tspeakers:        %d\n"
+	     "\tframes per tick: %d\n"
 	     "\tmax buffering:   %d milliseconds\n"
 	     "\tbuffering type:  %s",
-	     (int)ai.samples_per_sec, (int)ai.speakers, max_buffering_ms,
+	     (int)ai.samples_per_sec, (int)ai.speakers, (int)audio->frames, max_buffering_ms,
 	     oai->fixed_buffering ? "fixed" : "dynamically increasing");
 
 	return obs_init_audio(&ai);
 }
 
+bool obs_reset_audio2(const struct obs_audio_info2 *oai)
+{
+	if (!oai)
+		return obs_reset_audio3(NULL);
+
+	struct obs_audio_info3 oai3 = {
+		.samples_per_sec = oai->samples_per_sec,
+		.speakers = oai->speakers,
+		.max_buffering_ms = oai->max_buffering_ms,
+		.fixed_buffering = oai->fixed_buffering,
+	};
+
+	return obs_reset_audio3(&oai3);
+}
+
 bool obs_reset_audio(const struct obs_audio_info *oai)
 {
 	struct obs_audio_info2 oai2 = {
@@ -1594,6 +1649,49 @@ void obs_set_video_levels(float sdr_white_level, float hdr_nominal_peak_level)
 	video->hdr_nominal_peak_level = hdr_nominal_peak_level;
 }
 
+void obs_set_video_readback_depth(uint32_t depth)
+{
+	if (depth < 2)
+		depth = 2;
+	else if (depth > MAX_READBACK_DEPTH)
+		depth = MAX_READBACK_DEPTH;
+
+	obs->video.readback_depth = (int)depth;
+}
+
+void obs_set_video_mix_pipelining(bool enable)
+{
+	obs->video.serial_mixes = !enable;
+}
+
+bool obs_get_video_readback_stats(video_t *v, struct obs_video_readback_stats *stats)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&obs->video.mixes_mutex);
+	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
+		struct obs_core_video_mix *mix = obs->video.mixes.array[i];
+
+		if ((v && v != mix->video) || (!v && mix != obs->video.main_mix))
+			continue;
+
+		stats->depth = (uint32_t)mix->readback_depth;
+		stats->frames = mix->readback_frames;
+		stats->stalls = mix->readback_stalls;
+		stats->deferred = mix->readback_deferred;
+		stats->avg_latency_ms =
+			mix->readback_frames
+				? (double)mix->readback_total_latency / (double)mix->readback_frames / 1000000.0
+				: 0.0;
+		stats->max_latency_ms = (double)mix->readback_max_latency / 1000000.0;
+		found = true;
+		break;
+	}
+	pthread_mutex_unlock(&obs->video.mixes_mutex);
+
+	return found;
+}
+
 bool obs_get_audio_info(struct obs_audio_info *oai)
 {
 	struct obs_core_audio *audio = &obs->audio;
@@ -2843,6 +2941,26 @@ void obs_get_audio_monitoring_device(const char **name, const char **id)
 		*id = obs->audio.monitoring_device_id;
 }
 
+void obs_set_audio_monitoring_callback_mode(bool enable)
+{
+	if (!obs_audio_monitoring_available())
+		return;
+
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+
+	if (obs->audio.monitoring_callback_mode != enable) {
+		obs->audio.monitoring_callback_mode = enable;
+		obs_reset_audio_monitoring();
+	}
+
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+}
+
+bool obs_get_audio_monitoring_callback_mode(void)
+{
+	return obs->audio.monitoring_callback_mode;
+}
+
 void obs_add_tick_callback(void (*tick)(void *param, float seconds), void *param)
 {
 	struct tick_callback data = {tick, param};
@@ -216,6 +216,19 @@ struct obs_audio_info2 {
 	bool fixed_buffering;
 };
 
+struct obs_audio_info3 {
+	uint32_t samples_per_sec;
+	enum speaker_layout speakers;
+
+	uint32_t max_buffering_ms;
+	bool fixed_buffering;
+
+	/* Frames per audio tick, up to AUDIO_OUTPUT_FRAMES (which 0 defaults
+	 * to).  Smaller ticks lower the latency of monitoring at the cost of
+	 * running the audio thread more often. */
+	uint32_t frames_per_tick;
+};
+
 /**
  * Sent to source filters via the filter_audio callback to allow filtering of
  * audio data
@@ -424,6 +437,7 @@ EXPORT int obs_reset_video(struct obs_video_info *ovi);
  */
 EXPORT bool obs_reset_audio(const struct obs_audio_info *oai);
 EXPORT bool obs_reset_audio2(const struct obs_audio_info2 *oai);
+EXPORT bool obs_reset_audio3(const struct obs_audio_info3 *oai);
 
 /** Gets the current video settings, returns false if no video */
 EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
@@ -437,6 +451,38 @@ EXPORT float obs_get_video_hdr_nominal_peak_level(void);
 /** Sets the video levels */
 EXPORT void obs_set_video_levels(float sdr_white_level, float hdr_nominal_peak_level);
 
+struct obs_video_readback_stats {
+	uint32_t depth;
+	uint64_t frames;   /* frames read back from the GPU */
+	uint64_t stalls;   /* reads that had to wait for the GPU */
+	uint64_t deferred; /* frames where no staged surface was ready yet */
+	double avg_latency_ms;
+	double max_latency_ms;
+};
+
+/**
+ * Sets how many raw video frames may be in flight between the GPU and the
+ * CPU (2-4, default 2).  Deeper readback avoids stalling the graphics thread
+ * on a busy GPU at the cost of output latency.  Applies to video mixes
+ * created after the call, e.g. on the next obs_reset_video.
+ */
+EXPORT void obs_set_video_readback_depth(uint32_t depth);
+
+/**
+ * Enables or disables pipelined output of video mixes (enabled by default).
+ * When enabled, the next mix is rendered and submitted to the GPU before
+ * the previous mix's frame is read back and handed to its video output, so
+ * the CPU side of one mix overlaps with the GPU work of the next.  Each mix
+ * has its own render_mix and output_mix profiler sections either way.
+ */
+EXPORT void obs_set_video_mix_pipelining(bool enable);
+
+/**
+ * Gets the raw video readback stats of a video mix, or of the main mix if
+ * video is NULL.  Returns false if the mix was not found.
+ */
+EXPORT bool obs_get_video_readback_stats(video_t *video, struct obs_video_readback_stats *stats);
+
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
@@ -803,6 +849,21 @@ EXPORT void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb, void
 EXPORT bool obs_set_audio_monitoring_device(const char *name, const char *id);
 EXPORT void obs_get_audio_monitoring_device(const char **name, const char **id);
 
+/**
+ * Mixes monitored audio when the audio server asks for it instead of on a
+ * thread of its own, which suits servers like JACK or PipeWire that drive
+ * their clients.  Only used by backends that mix monitored sources
+ * themselves (currently PulseAudio).
+ */
+EXPORT void obs_set_audio_monitoring_callback_mode(bool enable);
+EXPORT bool obs_get_audio_monitoring_callback_mode(void);
+
+/**
+ * Estimated time from a source outputting audio to it being played back by
+ * the monitoring device.  Returns false if the backend does not know it.
+ */
+EXPORT bool obs_get_audio_monitoring_latency(uint64_t *latency_ns);
+
 EXPORT void obs_add_tick_callback(void (*tick)(void *param, float seconds), void *param);
 EXPORT void obs_remove_tick_callback(void (*tick)(void *param, float seconds), void *param);
 
@@ -1001,6 +1062,12 @@ EXPORT uint32_t obs_source_get_output_flags(const obs_source_t *source);
 /** Returns capability flags of a source type */
 EXPORT uint32_t obs_get_source_output_flags(const char *id);
 
+/**
+ * Signals that the video of a source with OBS_SOURCE_STATIC_VIDEO has changed
+ * outside of an update, so cached renders of it must be discarded.
+ */
+EXPORT void obs_source_invalidate_video(obs_source_t *source);
+
 /** Gets the default settings for a source type */
 EXPORT obs_data_t *obs_get_source_defaults(const char *id);
 
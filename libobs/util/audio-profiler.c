@@ -0,0 +1,537 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-profiler.h"
+
+#include "darray.h"
+#include "dstr.h"
+#include "obs-internal.h"
+#include "platform.h"
+#include "threading.h"
+#include "uthash.h"
+
+/* About 20 seconds of ticks at 48 kHz */
+#define MAX_TICKS 1024
+#define MAX_EVENTS 128
+
+#define MS_TO_NS 1000000ULL
+
+struct source_entry {
+	/* the pointer address of the source is the hashtable key */
+	uintptr_t key;
+	struct audio_profiler_source data;
+
+	UT_hash_handle hh;
+};
+
+static const uint64_t bucket_limits[AUDIO_PROFILER_BUCKETS] = {
+	0,
+	1 * MS_TO_NS,
+	2 * MS_TO_NS,
+	5 * MS_TO_NS,
+	10 * MS_TO_NS,
+	20 * MS_TO_NS,
+	50 * MS_TO_NS,
+	100 * MS_TO_NS,
+	200 * MS_TO_NS,
+	500 * MS_TO_NS,
+	1000 * MS_TO_NS,
+	UINT64_MAX,
+};
+
+/* Everything below is written by the audio thread and read by snapshots */
+static pthread_mutex_t profiler_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static struct source_entry *hm_sources = NULL;
+
+static struct audio_profiler_tick ticks[MAX_TICKS];
+static size_t tick_idx = 0;
+static size_t num_ticks = 0;
+
+static struct audio_profiler_event events[MAX_EVENTS];
+static size_t event_idx = 0;
+static size_t num_events = 0;
+
+/* Only used by the audio thread */
+static bool enabled = false;
+/* Can be set from other threads, mark it volatile */
+static volatile bool enable_next = false;
+
+static inline void free_source_data(struct audio_profiler_source *data)
+{
+	bfree(data->name);
+	bfree(data->uuid);
+}
+
+static inline void free_event(struct audio_profiler_event *event)
+{
+	bfree(event->source_name);
+	bfree(event->source_uuid);
+}
+
+static void clear_data(void)
+{
+	struct source_entry *ent, *tmp;
+	HASH_ITER (hh, hm_sources, ent, tmp) {
+		HASH_DEL(hm_sources, ent);
+		free_source_data(&ent->data);
+		bfree(ent);
+	}
+
+	for (size_t i = 0; i < num_events; i++)
+		free_event(&events[i]);
+
+	memset(events, 0, sizeof(events));
+	event_idx = num_events = 0;
+	tick_idx = num_ticks = 0;
+}
+
+void audio_profiler_enable(bool enable)
+{
+	enable_next = enable;
+}
+
+bool audio_profiler_enabled(void)
+{
+	return enable_next;
+}
+
+void audio_profiler_reset(void)
+{
+	pthread_mutex_lock(&profiler_mutex);
+	clear_data();
+	pthread_mutex_unlock(&profiler_mutex);
+}
+
+uint64_t audio_profiler_bucket_limit(size_t bucket)
+{
+	return bucket < AUDIO_PROFILER_BUCKETS ? bucket_limits[bucket] : UINT64_MAX;
+}
+
+void audio_profiler_shutdown(void)
+{
+	enabled = enable_next = false;
+	audio_profiler_reset();
+}
+
+/* ------------------------------------------------------------------------- */
+/* Audio thread */
+
+uint64_t audio_profiler_tick_start(void)
+{
+	if (enabled != enable_next) {
+		enabled = enable_next;
+		if (!enabled)
+			audio_profiler_reset();
+	}
+
+	return enabled ? os_gettime_ns() : 0;
+}
+
+static inline void update_string(char **dst, const char *src)
+{
+	if (!src)
+		src = "";
+	if (!*dst || strcmp(*dst, src) != 0) {
+		bfree(*dst);
+		*dst = bstrdup(src);
+	}
+}
+
+static struct source_entry *get_entry(obs_source_t *source)
+{
+	struct source_entry *ent;
+
+	HASH_FIND_PTR(hm_sources, &source, ent);
+	if (!ent) {
+		ent = bzalloc(sizeof(struct source_entry));
+		ent->key = (uintptr_t)source;
+		ent->data.uuid = bstrdup(obs_source_get_uuid(source));
+		HASH_ADD_PTR(hm_sources, key, ent);
+	}
+
+	/* sources can be renamed at any time */
+	update_string(&ent->data.name, obs_source_get_name(source));
+	return ent;
+}
+
+static inline size_t lateness_bucket(uint64_t lateness)
+{
+	size_t bucket = 0;
+	while (lateness > bucket_limits[bucket])
+		bucket++;
+	return bucket;
+}
+
+void audio_profiler_record_sources(uint64_t audio_ts)
+{
+	if (!enabled)
+		return;
+
+	pthread_mutex_lock(&profiler_mutex);
+
+	struct obs_source *source = obs->data.first_audio_source;
+	while (source) {
+		if (!source->info.audio_render) {
+			struct audio_profiler_source *data = &get_entry(source)->data;
+
+			if (source->audio_pending || !source->audio_ts) {
+				data->pending_ticks++;
+			} else {
+				uint64_t lateness = audio_ts > source->audio_ts ? audio_ts - source->audio_ts : 0;
+
+				data->ticks++;
+				data->lateness[lateness_bucket(lateness)]++;
+				if (lateness > data->lateness_max)
+					data->lateness_max = lateness;
+			}
+		}
+
+		source = (struct obs_source *)source->next_audio_source;
+	}
+
+	pthread_mutex_unlock(&profiler_mutex);
+}
+
+void audio_profiler_buffering_added(obs_source_t *source, uint64_t audio_ts, uint32_t added_ms, uint32_t total_ms,
+				    bool fixed, bool maxed)
+{
+	if (!enabled)
+		return;
+
+	pthread_mutex_lock(&profiler_mutex);
+
+	struct audio_profiler_event *event = &events[event_idx];
+	free_event(event);
+
+	event->time = os_gettime_ns();
+	event->audio_ts = audio_ts;
+	event->source_name = NULL;
+	event->source_uuid = NULL;
+	event->added_ms = added_ms;
+	event->total_ms = total_ms;
+	event->fixed = fixed;
+	event->maxed = maxed;
+
+	if (source) {
+		struct audio_profiler_source *data = &get_entry(source)->data;
+		data->buffering_events++;
+		data->buffering_ms += added_ms;
+
+		event->source_name = bstrdup(data->name);
+		event->source_uuid = bstrdup(data->uuid);
+	}
+
+	event_idx = (event_idx + 1) % MAX_EVENTS;
+	if (num_events < MAX_EVENTS)
+		num_events++;
+
+	pthread_mutex_unlock(&profiler_mutex);
+}
+
+void audio_profiler_tick_end(uint64_t start, uint64_t audio_ts, uint32_t buffering_ms)
+{
+	if (!enabled || !start)
+		return;
+
+	const uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&profiler_mutex);
+
+	struct audio_profiler_tick *tick = &ticks[tick_idx];
+	tick->time = start;
+	tick->audio_ts = audio_ts;
+	tick->render_ns = now - start;
+	tick->output_ns = 0;
+	tick->buffering_ms = buffering_ms;
+
+	tick_idx = (tick_idx + 1) % MAX_TICKS;
+	if (num_ticks < MAX_TICKS)
+		num_ticks++;
+
+	pthread_mutex_unlock(&profiler_mutex);
+}
+
+/* Called by audio-io once the outputs of the tick have run, which is after
+ * the tick was submitted */
+void audio_profiler_tick_output(const audio_t *audio, uint64_t output_ns)
+{
+	if (!enabled || !obs || audio != obs->audio.audio)
+		return;
+
+	pthread_mutex_lock(&profiler_mutex);
+	if (num_ticks)
+		ticks[(tick_idx + MAX_TICKS - 1) % MAX_TICKS].output_ns = output_ns;
+	pthread_mutex_unlock(&profiler_mutex);
+}
+
+void audio_profiler_remove_source(obs_source_t *source)
+{
+	pthread_mutex_lock(&profiler_mutex);
+
+	struct source_entry *ent;
+	HASH_FIND_PTR(hm_sources, &source, ent);
+	if (ent) {
+		HASH_DEL(hm_sources, ent);
+		free_source_data(&ent->data);
+		bfree(ent);
+	}
+
+	pthread_mutex_unlock(&profiler_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Snapshots */
+
+audio_profiler_snapshot_t *audio_profiler_snapshot_create(void)
+{
+	audio_profiler_snapshot_t *snap = bzalloc(sizeof(audio_profiler_snapshot_t));
+	uint64_t render_sum = 0, output_sum = 0;
+
+	snap->time = os_gettime_ns();
+	if (obs && obs->audio.audio)
+		snap->sample_rate = audio_output_get_sample_rate(obs->audio.audio);
+
+	pthread_mutex_lock(&profiler_mutex);
+
+	struct source_entry *ent, *tmp;
+	HASH_ITER (hh, hm_sources, ent, tmp) {
+		struct audio_profiler_source *data = da_push_back_new(snap->sources);
+		*data = ent->data;
+		data->name = bstrdup(ent->data.name);
+		data->uuid = bstrdup(ent->data.uuid);
+	}
+
+	size_t first = (event_idx + MAX_EVENTS - num_events) % MAX_EVENTS;
+	for (size_t i = 0; i < num_events; i++) {
+		const struct audio_profiler_event *src = &events[(first + i) % MAX_EVENTS];
+		struct audio_profiler_event *event = da_push_back_new(snap->events);
+		*event = *src;
+		event->source_name = src->source_name ? bstrdup(src->source_name) : NULL;
+		event->source_uuid = src->source_uuid ? bstrdup(src->source_uuid) : NULL;
+	}
+
+	first = (tick_idx + MAX_TICKS - num_ticks) % MAX_TICKS;
+	da_reserve(snap->ticks, num_ticks);
+	for (size_t i = 0; i < num_ticks; i++)
+		da_push_back(snap->ticks, &ticks[(first + i) % MAX_TICKS]);
+
+	pthread_mutex_unlock(&profiler_mutex);
+
+	for (size_t i = 0; i < snap->ticks.num; i++) {
+		const struct audio_profiler_tick *tick = &snap->ticks.array[i];
+
+		render_sum += tick->render_ns;
+		if (tick->render_ns > snap->render_max)
+			snap->render_max = tick->render_ns;
+
+		output_sum += tick->output_ns;
+		if (tick->output_ns > snap->output_max)
+			snap->output_max = tick->output_ns;
+	}
+
+	if (snap->ticks.num) {
+		snap->render_avg = render_sum / snap->ticks.num;
+		snap->buffering_ms = snap->ticks.array[snap->ticks.num - 1].buffering_ms;
+	}
+	/* the newest tick has no output time yet */
+	if (snap->ticks.num > 1)
+		snap->output_avg = output_sum / (snap->ticks.num - 1);
+
+	return snap;
+}
+
+void audio_profiler_snapshot_free(audio_profiler_snapshot_t *snap)
+{
+	if (!snap)
+		return;
+
+	for (size_t i = 0; i < snap->sources.num; i++)
+		free_source_data(&snap->sources.array[i]);
+	for (size_t i = 0; i < snap->events.num; i++)
+		free_event(&snap->events.array[i]);
+
+	da_free(snap->sources);
+	da_free(snap->events);
+	da_free(snap->ticks);
+	bfree(snap);
+}
+
+static obs_data_t *source_get_data(const struct audio_profiler_source *src)
+{
+	obs_data_t *data = obs_data_create();
+	obs_data_array_t *lateness = obs_data_array_create();
+
+	obs_data_set_string(data, "name", src->name);
+	obs_data_set_string(data, "uuid", src->uuid);
+	obs_data_set_int(data, "ticks", (long long)src->ticks);
+	obs_data_set_int(data, "pending_ticks", (long long)src->pending_ticks);
+	obs_data_set_int(data, "lateness_max_ns", (long long)src->lateness_max);
+	obs_data_set_int(data, "buffering_events", src->buffering_events);
+	obs_data_set_int(data, "buffering_ms", src->buffering_ms);
+
+	for (size_t i = 0; i < AUDIO_PROFILER_BUCKETS; i++) {
+		obs_data_t *bucket = obs_data_create();
+		/* the last bucket is unbounded */
+		if (i + 1 < AUDIO_PROFILER_BUCKETS)
+			obs_data_set_int(bucket, "limit_ns", (long long)bucket_limits[i]);
+		obs_data_set_int(bucket, "count", (long long)src->lateness[i]);
+		obs_data_array_push_back(lateness, bucket);
+		obs_data_release(bucket);
+	}
+
+	obs_data_set_array(data, "lateness", lateness);
+	obs_data_array_release(lateness);
+	return data;
+}
+
+static obs_data_t *event_get_data(const struct audio_profiler_event *event)
+{
+	obs_data_t *data = obs_data_create();
+
+	obs_data_set_int(data, "time", (long long)event->time);
+	obs_data_set_int(data, "audio_ts", (long long)event->audio_ts);
+	if (event->source_name) {
+		obs_data_set_string(data, "source_name", event->source_name);
+		obs_data_set_string(data, "source_uuid", event->source_uuid);
+	}
+	obs_data_set_int(data, "added_ms", event->added_ms);
+	obs_data_set_int(data, "total_ms", event->total_ms);
+	obs_data_set_bool(data, "fixed", event->fixed);
+	obs_data_set_bool(data, "maxed", event->maxed);
+	return data;
+}
+
+static obs_data_t *tick_get_data(const struct audio_profiler_tick *tick)
+{
+	obs_data_t *data = obs_data_create();
+
+	obs_data_set_int(data, "time", (long long)tick->time);
+	obs_data_set_int(data, "audio_ts", (long long)tick->audio_ts);
+	obs_data_set_int(data, "render_ns", (long long)tick->render_ns);
+	obs_data_set_int(data, "output_ns", (long long)tick->output_ns);
+	obs_data_set_int(data, "buffering_ms", tick->buffering_ms);
+	return data;
+}
+
+#define push_items(data, name, items, get_data)                           \
+	do {                                                              \
+		obs_data_array_t *array = obs_data_array_create();        \
+		for (size_t i = 0; i < items.num; i++) {                  \
+			obs_data_t *item = get_data(&items.array[i]);     \
+			obs_data_array_push_back(array, item);            \
+			obs_data_release(item);                           \
+		}                                                         \
+		obs_data_set_array(data, name, array);                    \
+		obs_data_array_release(array);                            \
+	} while (false)
+
+obs_data_t *audio_profiler_snapshot_get_data(const audio_profiler_snapshot_t *snap)
+{
+	obs_data_t *data = obs_data_create();
+
+	obs_data_set_int(data, "time", (long long)snap->time);
+	obs_data_set_int(data, "sample_rate", snap->sample_rate);
+	obs_data_set_int(data, "buffering_ms", snap->buffering_ms);
+	obs_data_set_int(data, "render_avg_ns", (long long)snap->render_avg);
+	obs_data_set_int(data, "render_max_ns", (long long)snap->render_max);
+	obs_data_set_int(data, "output_avg_ns", (long long)snap->output_avg);
+	obs_data_set_int(data, "output_max_ns", (long long)snap->output_max);
+
+	push_items(data, "sources", snap->sources, source_get_data);
+	push_items(data, "events", snap->events, event_get_data);
+	push_items(data, "ticks", snap->ticks, tick_get_data);
+	return data;
+}
+
+bool audio_profiler_snapshot_dump_json(const audio_profiler_snapshot_t *snap, const char *filename)
+{
+	obs_data_t *data = audio_profiler_snapshot_get_data(snap);
+	bool success = obs_data_save_json(data, filename);
+	obs_data_release(data);
+	return success;
+}
+
+static void csv_quote(struct dstr *buffer, const char *str)
+{
+	dstr_cat_ch(buffer, '"');
+	for (; str && *str; str++) {
+		if (*str == '"')
+			dstr_cat_ch(buffer, '"');
+		dstr_cat_ch(buffer, *str);
+	}
+	dstr_cat_ch(buffer, '"');
+}
+
+bool audio_profiler_snapshot_dump_csv(const audio_profiler_snapshot_t *snap, const char *filename)
+{
+	FILE *f = os_fopen(filename, "wb+");
+	if (!f)
+		return false;
+
+	struct dstr buffer = {0};
+	size_t tick = 0, event = 0;
+
+	dstr_copy(&buffer, "type,time,audio_ts,render_ns,output_ns,buffering_ms,"
+			   "added_ms,fixed,maxed,source_name,source_uuid\n");
+	fwrite(buffer.array, 1, buffer.len, f);
+
+	while (tick < snap->ticks.num || event < snap->events.num) {
+		const struct audio_profiler_tick *t = tick < snap->ticks.num ? &snap->ticks.array[tick] : NULL;
+		const struct audio_profiler_event *e = event < snap->events.num ? &snap->events.array[event] : NULL;
+
+		/* events happen during their tick, so they go after it */
+		if (t && (!e || t->time <= e->time)) {
+			dstr_printf(&buffer, "tick,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu32 ",,,,,\n",
+				    t->time, t->audio_ts, t->render_ns, t->output_ns, t->buffering_ms);
+			tick++;
+		} else {
+			dstr_printf(&buffer, "buffering,%" PRIu64 ",%" PRIu64 ",,,%" PRIu32 ",%" PRIu32 ",%d,%d,",
+				    e->time, e->audio_ts, e->total_ms, e->added_ms, e->fixed, e->maxed);
+			csv_quote(&buffer, e->source_name);
+			dstr_cat_ch(&buffer, ',');
+			csv_quote(&buffer, e->source_uuid);
+			dstr_cat_ch(&buffer, '\n');
+			event++;
+		}
+
+		fwrite(buffer.array, 1, buffer.len, f);
+	}
+
+	dstr_free(&buffer);
+	fclose(f);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void get_audio_timeline_proc(void *param, calldata_t *cd)
+{
+	audio_profiler_snapshot_t *snap = audio_profiler_snapshot_create();
+	obs_data_t *data = audio_profiler_snapshot_get_data(snap);
+
+	calldata_set_string(cd, "timeline", obs_data_get_json(data));
+
+	obs_data_release(data);
+	audio_profiler_snapshot_free(snap);
+	UNUSED_PARAMETER(param);
+}
+
+void audio_profiler_add_procs(proc_handler_t *procs)
+{
+	proc_handler_add(procs, "void get_audio_timeline(out string timeline)", get_audio_timeline_proc, NULL);
+}
@@ -0,0 +1,114 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "obs.h"
+#include "darray.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Lateness histogram buckets, see audio_profiler_bucket_limit() */
+#define AUDIO_PROFILER_BUCKETS 12
+
+struct audio_profiler_source {
+	char *name;
+	char *uuid;
+
+	/* Ticks the source had audio for, and ticks it had none */
+	uint64_t ticks;
+	uint64_t pending_ticks;
+
+	/* How far the source's audio was behind the tick being rendered,
+	 * in ns; on time ticks are counted in the first bucket */
+	uint64_t lateness[AUDIO_PROFILER_BUCKETS];
+	uint64_t lateness_max;
+
+	/* Buffering added because of this source */
+	uint32_t buffering_events;
+	uint32_t buffering_ms;
+};
+
+struct audio_profiler_event {
+	/* os_gettime_ns() and audio timestamp of the tick */
+	uint64_t time;
+	uint64_t audio_ts;
+
+	/* Source the buffering was added for, NULL for fixed buffering */
+	char *source_name;
+	char *source_uuid;
+
+	uint32_t added_ms;
+	uint32_t total_ms;
+	bool fixed;
+	bool maxed;
+};
+
+struct audio_profiler_tick {
+	uint64_t time;
+	uint64_t audio_ts;
+
+	/* Time spent rendering and mixing sources, and time spent in the
+	 * output callbacks of the mixes (encoders and outputs) in ns.  The
+	 * output time of the newest tick is not known yet and is 0. */
+	uint64_t render_ns;
+	uint64_t output_ns;
+
+	uint32_t buffering_ms;
+};
+
+typedef struct audio_profiler_snapshot {
+	uint64_t time;
+	uint32_t sample_rate;
+	uint32_t buffering_ms;
+
+	uint64_t render_avg;
+	uint64_t render_max;
+	uint64_t output_avg;
+	uint64_t output_max;
+
+	DARRAY(struct audio_profiler_source) sources;
+	DARRAY(struct audio_profiler_event) events;
+	DARRAY(struct audio_profiler_tick) ticks;
+} audio_profiler_snapshot_t;
+
+/* Enable/disable the audio profiler (applied on next audio tick), disabling
+ * discards all collected data */
+EXPORT void audio_profiler_enable(bool enable);
+EXPORT bool audio_profiler_enabled(void);
+/* Discard all collected data */
+EXPORT void audio_profiler_reset(void);
+
+/* Upper limit of a lateness bucket in ns (UINT64_MAX for the last one) */
+EXPORT uint64_t audio_profiler_bucket_limit(size_t bucket);
+
+/* Copy of the collected data (must be freed by user) */
+EXPORT audio_profiler_snapshot_t *audio_profiler_snapshot_create(void);
+EXPORT void audio_profiler_snapshot_free(audio_profiler_snapshot_t *snap);
+
+/* Snapshot as obs_data, as written by audio_profiler_snapshot_dump_json */
+EXPORT obs_data_t *audio_profiler_snapshot_get_data(const audio_profiler_snapshot_t *snap);
+
+/* Ticks and buffering events in time order */
+EXPORT bool audio_profiler_snapshot_dump_csv(const audio_profiler_snapshot_t *snap, const char *filename);
+EXPORT bool audio_profiler_snapshot_dump_json(const audio_profiler_snapshot_t *snap, const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
@@ -14,6 +14,10 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#ifdef HAVE_LIBURING
+#define _GNU_SOURCE
+#endif
+
 #include "buffered-file-serializer.h"
 
 #include <inttypes.h>
@@ -23,9 +27,27 @@
 #include "deque.h"
 #include "dstr.h"
 
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 static const size_t DEFAULT_BUF_SIZE = 256ULL * 1048576ULL; // 256 MiB
 static const size_t DEFAULT_CHUNK_SIZE = 1048576;           // 1 MiB
 
+#ifndef _WIN32
+static inline size_t max(size_t a, size_t b)
+{
+	return a > b ? a : b;
+}
+
+static inline size_t min(size_t a, size_t b)
+{
+	return a < b ? a : b;
+}
+#endif
+
 /* ========================================================================== */
 /* Buffered writer based on ffmpeg-mux implementation                         */
 
@@ -34,6 +56,10 @@ struct io_header {
 	uint64_t data_length;
 };
 
+#ifdef HAVE_LIBURING
+struct uring_writer;
+#endif
+
 struct io_buffer {
 	bool active;
 	bool shutdown_requested;
@@ -48,6 +74,14 @@ struct io_buffer {
 
 	size_t buffer_size;
 	size_t chunk_size;
+
+	pthread_mutex_t stats_mutex;
+	struct buffered_file_serializer_stats stats;
+	uint64_t start_ts;
+
+#ifdef HAVE_LIBURING
+	struct uring_writer *uring;
+#endif
 };
 
 struct file_output_data {
@@ -55,6 +89,17 @@ struct file_output_data {
 	struct io_buffer io;
 };
 
+static void record_write(struct io_buffer *io, size_t bytes, uint64_t latency_ns)
+{
+	pthread_mutex_lock(&io->stats_mutex);
+	io->stats.bytes_written += bytes;
+	io->stats.writes++;
+	io->stats.total_latency_ns += latency_ns;
+	if (latency_ns > io->stats.max_latency_ns)
+		io->stats.max_latency_ns = latency_ns;
+	pthread_mutex_unlock(&io->stats_mutex);
+}
+
 static void *io_thread(void *opaque)
 {
 	struct file_output_data *out = opaque;
@@ -177,7 +222,9 @@ static void *io_thread(void *opaque)
 			}
 
 			// Write the current chunk to the output file
+			uint64_t write_start = os_gettime_ns();
 			size_t bytes_written = fwrite(chunk, 1, chunk_used, out->io.output_file);
+			record_write(&out->io, bytes_written, os_gettime_ns() - write_start);
 			if (bytes_written != chunk_used) {
 				blog(LOG_ERROR, "Error writing to '%s': %s (%zu != %zu)\n", out->filename.array,
 				     strerror(errno), bytes_written, chunk_used);
@@ -203,6 +250,370 @@ error:
 	return NULL;
 }
 
+#ifdef HAVE_LIBURING
+/* ========================================================================== */
+/* io_uring writer (Linux)                                                    */
+
+/* Sequential data is collected in page aligned buffers that are written with
+ * O_DIRECT, several of them in flight at a time. Anything that cannot be
+ * written that way (seeks back to patch headers, the unaligned tail of the
+ * file) goes through a second, regular file descriptor instead. */
+
+#define URING_QUEUE_DEPTH 8
+#define DIRECT_IO_ALIGNMENT 4096
+
+struct uring_slot {
+	uint8_t *buf;
+	size_t len;
+	uint64_t offset;
+	uint64_t submit_ts;
+	bool in_flight;
+};
+
+struct uring_writer {
+	struct io_uring ring;
+	bool fixed_buffers;
+
+	int direct_fd;
+	int fd;
+
+	struct uring_slot slots[URING_QUEUE_DEPTH];
+	size_t buf_size;
+	size_t in_flight;
+
+	/* Slot currently being filled */
+	size_t cur;
+
+	uint8_t *scratch;
+};
+
+static inline struct uring_slot *uring_cur_slot(struct uring_writer *w)
+{
+	return &w->slots[w->cur];
+}
+
+static inline uint64_t uring_stage_end(struct uring_writer *w)
+{
+	struct uring_slot *slot = uring_cur_slot(w);
+	return slot->offset + slot->len;
+}
+
+static bool pwrite_all(struct file_output_data *out, const uint8_t *data, size_t size, uint64_t offset)
+{
+	uint64_t start = os_gettime_ns();
+	size_t total = size;
+
+	if (!size)
+		return true;
+
+	while (size) {
+		ssize_t ret = pwrite(out->io.uring->fd, data, size, (off_t)offset);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			blog(LOG_ERROR, "Error writing to '%s': %s", out->filename.array, strerror(errno));
+			return false;
+		}
+
+		data += ret;
+		size -= (size_t)ret;
+		offset += (uint64_t)ret;
+	}
+
+	record_write(&out->io, total, os_gettime_ns() - start);
+	return true;
+}
+
+static void uring_writer_free(struct uring_writer *w)
+{
+	if (!w)
+		return;
+
+	if (w->ring.ring_fd > 0)
+		io_uring_queue_exit(&w->ring);
+	if (w->direct_fd >= 0)
+		close(w->direct_fd);
+	if (w->fd >= 0)
+		close(w->fd);
+
+	for (size_t i = 0; i < URING_QUEUE_DEPTH; i++)
+		free(w->slots[i].buf);
+
+	bfree(w->scratch);
+	bfree(w);
+}
+
+static struct uring_writer *uring_writer_create(const char *path, size_t chunk_size)
+{
+	struct uring_writer *w = bzalloc(sizeof(*w));
+	struct iovec iovecs[URING_QUEUE_DEPTH];
+	int ret;
+
+	w->direct_fd = -1;
+	w->fd = -1;
+
+	w->direct_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT | O_CLOEXEC, 0644);
+	if (w->direct_fd < 0) {
+		blog(LOG_INFO, "Unable to open '%s' with O_DIRECT: %s", path, strerror(errno));
+		goto fail;
+	}
+
+	w->fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (w->fd < 0)
+		goto fail;
+
+	ret = io_uring_queue_init(URING_QUEUE_DEPTH, &w->ring, 0);
+	if (ret < 0) {
+		blog(LOG_INFO, "io_uring_queue_init failed: %s", strerror(-ret));
+		w->ring.ring_fd = 0;
+		goto fail;
+	}
+
+	w->buf_size = (chunk_size + DIRECT_IO_ALIGNMENT - 1) & ~(size_t)(DIRECT_IO_ALIGNMENT - 1);
+	w->scratch = bmalloc(chunk_size);
+
+	for (size_t i = 0; i < URING_QUEUE_DEPTH; i++) {
+		void *buf;
+		if (posix_memalign(&buf, DIRECT_IO_ALIGNMENT, w->buf_size) != 0)
+			goto fail;
+
+		w->slots[i].buf = buf;
+		iovecs[i].iov_base = buf;
+		iovecs[i].iov_len = w->buf_size;
+	}
+
+	/* Registering pins the buffers, which can fail against a low
+	 * RLIMIT_MEMLOCK. Regular writes from the same buffers still work. */
+	ret = io_uring_register_buffers(&w->ring, iovecs, URING_QUEUE_DEPTH);
+	w->fixed_buffers = ret == 0;
+	if (!w->fixed_buffers)
+		blog(LOG_DEBUG, "io_uring_register_buffers failed: %s", strerror(-ret));
+
+	return w;
+
+fail:
+	uring_writer_free(w);
+	return NULL;
+}
+
+static bool uring_reap(struct file_output_data *out, bool wait)
+{
+	struct uring_writer *w = out->io.uring;
+	struct io_uring_cqe *cqe;
+	int ret;
+
+	while (w->in_flight) {
+		ret = wait ? io_uring_wait_cqe(&w->ring, &cqe) : io_uring_peek_cqe(&w->ring, &cqe);
+		if (ret == -EINTR)
+			continue;
+		if (ret == -EAGAIN && !wait)
+			break;
+		if (ret < 0) {
+			blog(LOG_ERROR, "io_uring wait failed for '%s': %s", out->filename.array, strerror(-ret));
+			return false;
+		}
+
+		struct uring_slot *slot = io_uring_cqe_get_data(cqe);
+		int res = cqe->res;
+		io_uring_cqe_seen(&w->ring, cqe);
+
+		slot->in_flight = false;
+		w->in_flight--;
+
+		if (res < 0) {
+			blog(LOG_ERROR, "Error writing to '%s': %s", out->filename.array, strerror(-res));
+			return false;
+		}
+
+		record_write(&out->io, (size_t)res, os_gettime_ns() - slot->submit_ts);
+
+		/* Short writes are rare with O_DIRECT, finish them off with a
+		 * regular write rather than dealing with realignment. */
+		if ((size_t)res < slot->len &&
+		    !pwrite_all(out, slot->buf + res, slot->len - (size_t)res, slot->offset + (uint64_t)res))
+			return false;
+
+		wait = false;
+	}
+
+	return true;
+}
+
+static inline bool uring_wait_all(struct file_output_data *out)
+{
+	while (out->io.uring->in_flight) {
+		if (!uring_reap(out, true))
+			return false;
+	}
+	return true;
+}
+
+/* Submits the (full) current slot and moves on to the next one, waiting for
+ * it to be written first if it is still in flight. */
+static bool uring_submit(struct file_output_data *out)
+{
+	struct uring_writer *w = out->io.uring;
+	struct uring_slot *slot = uring_cur_slot(w);
+	struct io_uring_sqe *sqe = io_uring_get_sqe(&w->ring);
+	uint64_t next_offset = uring_stage_end(w);
+
+	if (!sqe) {
+		blog(LOG_ERROR, "io_uring submission queue full for '%s'", out->filename.array);
+		return false;
+	}
+
+	if (w->fixed_buffers)
+		io_uring_prep_write_fixed(sqe, w->direct_fd, slot->buf, (unsigned)slot->len, slot->offset,
+					  (int)w->cur);
+	else
+		io_uring_prep_write(sqe, w->direct_fd, slot->buf, (unsigned)slot->len, slot->offset);
+
+	io_uring_sqe_set_data(sqe, slot);
+	slot->submit_ts = os_gettime_ns();
+	slot->in_flight = true;
+	w->in_flight++;
+
+	int ret = io_uring_submit(&w->ring);
+	if (ret < 0) {
+		blog(LOG_ERROR, "io_uring_submit failed for '%s': %s", out->filename.array, strerror(-ret));
+		return false;
+	}
+
+	w->cur = (w->cur + 1) % URING_QUEUE_DEPTH;
+	slot = uring_cur_slot(w);
+
+	while (slot->in_flight) {
+		if (!uring_reap(out, true))
+			return false;
+	}
+
+	slot->offset = next_offset;
+	slot->len = 0;
+
+	/* Pick up any other completions without blocking */
+	return uring_reap(out, false);
+}
+
+/* Non-sequential write, e.g. patching a box size written earlier. Whatever
+ * overlaps the slot being filled is patched in memory, the rest is written
+ * through the regular file descriptor. */
+static bool uring_write_at(struct file_output_data *out, uint64_t offset, const uint8_t *data, size_t size)
+{
+	struct uring_writer *w = out->io.uring;
+	struct uring_slot *slot = uring_cur_slot(w);
+	uint64_t stage_start = slot->offset;
+	uint64_t stage_end = uring_stage_end(w);
+	uint64_t end = offset + size;
+
+	if (offset < stage_start) {
+		/* Must not race with a pending write of the same range */
+		if (!uring_wait_all(out))
+			return false;
+		if (!pwrite_all(out, data, (size_t)(min(end, stage_start) - offset), offset))
+			return false;
+	}
+
+	if (offset < stage_end && end > stage_start) {
+		uint64_t start = offset > stage_start ? offset : stage_start;
+		uint64_t stop = end < stage_end ? end : stage_end;
+		memcpy(slot->buf + (start - stage_start), data + (start - offset), (size_t)(stop - start));
+	}
+
+	if (end > stage_end) {
+		uint64_t start = offset > stage_end ? offset : stage_end;
+		if (!pwrite_all(out, data + (start - offset), (size_t)(end - start), start))
+			return false;
+	}
+
+	return true;
+}
+
+static void *io_thread_uring(void *opaque)
+{
+	struct file_output_data *out = opaque;
+	struct uring_writer *w = out->io.uring;
+	os_set_thread_name("buffered writer io_uring thread");
+
+	// Entry currently being consumed from the deque, data_length is the
+	// part of it that is still left in the deque.
+	struct io_header entry = {0};
+	bool shutting_down;
+
+	for (;;) {
+		os_event_wait(out->io.new_data_available_event);
+
+		for (;;) {
+			struct uring_slot *slot = uring_cur_slot(w);
+
+			// Make room before taking the lock so the writer is
+			// never blocked on the disk
+			if (slot->len == w->buf_size) {
+				if (!uring_submit(out))
+					goto error;
+				slot = uring_cur_slot(w);
+			}
+
+			pthread_mutex_lock(&out->io.data_mutex);
+
+			shutting_down = os_atomic_load_bool(&out->io.shutdown_requested);
+
+			if (!entry.data_length) {
+				if (!out->io.data.size) {
+					os_event_reset(out->io.new_data_available_event);
+					pthread_mutex_unlock(&out->io.data_mutex);
+					break;
+				}
+
+				deque_pop_front(&out->io.data, &entry, sizeof(entry));
+			}
+
+			bool sequential = entry.seek_offset == uring_stage_end(w);
+			size_t size;
+			uint8_t *dst;
+
+			if (sequential) {
+				size = min((size_t)entry.data_length, w->buf_size - slot->len);
+				dst = slot->buf + slot->len;
+			} else {
+				// Entries are never larger than chunk_size
+				size = (size_t)entry.data_length;
+				dst = w->scratch;
+			}
+
+			deque_pop_front(&out->io.data, dst, size);
+
+			// Signal that there is more room in the buffer
+			os_event_signal(out->io.buffer_space_available_event);
+			pthread_mutex_unlock(&out->io.data_mutex);
+
+			if (sequential)
+				slot->len += size;
+			else if (!uring_write_at(out, entry.seek_offset, w->scratch, size))
+				goto error;
+
+			entry.seek_offset += size;
+			entry.data_length -= size;
+		}
+
+		if (shutting_down)
+			break;
+	}
+
+	// Write the remainder, which is usually not a multiple of the block
+	// size, through the regular file descriptor.
+	if (uring_wait_all(out)) {
+		struct uring_slot *slot = uring_cur_slot(w);
+		if (pwrite_all(out, slot->buf, slot->len, slot->offset))
+			return NULL;
+	}
+
+error:
+	os_atomic_set_bool(&out->io.output_error, true);
+	uring_wait_all(out);
+	return NULL;
+}
+#endif
+
 /* ========================================================================== */
 /* Serializer Implementation                                                  */
 
@@ -234,18 +645,6 @@ static int64_t file_output_seek(void *opaque, int64_t offset, enum serialize_see
 	return (int64_t)out->io.next_pos;
 }
 
-#ifndef _WIN32
-static inline size_t max(size_t a, size_t b)
-{
-	return a > b ? a : b;
-}
-
-static inline size_t min(size_t a, size_t b)
-{
-	return a < b ? a : b;
-}
-#endif
-
 static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 {
 	struct file_output_data *out = opaque;
@@ -321,34 +720,64 @@ static int64_t file_output_get_pos(void *opaque)
 
 bool buffered_file_serializer_init_defaults(struct serializer *s, const char *path)
 {
-	return buffered_file_serializer_init(s, path, 0, 0);
+	return buffered_file_serializer_init_ex(s, path, 0, 0, 0);
 }
 
 bool buffered_file_serializer_init(struct serializer *s, const char *path, size_t max_bufsize, size_t chunk_size)
+{
+	return buffered_file_serializer_init_ex(s, path, max_bufsize, chunk_size, 0);
+}
+
+bool buffered_file_serializer_init_ex(struct serializer *s, const char *path, size_t max_bufsize, size_t chunk_size,
+				      uint32_t flags)
 {
 	struct file_output_data *out;
+	void *(*thread_func)(void *) = io_thread;
 
 	out = bzalloc(sizeof(*out));
 
 	dstr_init_copy(&out->filename, path);
 
-	out->io.output_file = os_fopen(path, "wb");
-	if (!out->io.output_file)
-		return false;
-
 	out->io.buffer_size = max_bufsize ? max_bufsize : DEFAULT_BUF_SIZE;
 	out->io.chunk_size = chunk_size ? chunk_size : DEFAULT_CHUNK_SIZE;
 
+#ifdef HAVE_LIBURING
+	if (flags & BUFFERED_FILE_DIRECT_IO) {
+		out->io.uring = uring_writer_create(path, out->io.chunk_size);
+		if (out->io.uring) {
+			out->io.stats.direct_io = true;
+			thread_func = io_thread_uring;
+		} else {
+			blog(LOG_WARNING, "Direct I/O unavailable for '%s', using regular writes", path);
+		}
+	}
+
+	if (!out->io.uring)
+#else
+	if (flags & BUFFERED_FILE_DIRECT_IO)
+		blog(LOG_DEBUG, "Direct I/O not supported on this platform, using regular writes");
+#endif
+	{
+		out->io.output_file = os_fopen(path, "wb");
+		if (!out->io.output_file) {
+			dstr_free(&out->filename);
+			bfree(out);
+			return false;
+		}
+	}
+
 	// Start at 1MB, this can grow up to max_bufsize depending
 	// on how fast data is going in and out.
 	deque_reserve(&out->io.data, 1048576);
 
 	pthread_mutex_init(&out->io.data_mutex, NULL);
+	pthread_mutex_init(&out->io.stats_mutex, NULL);
 
 	os_event_init(&out->io.buffer_space_available_event, OS_EVENT_TYPE_AUTO);
 	os_event_init(&out->io.new_data_available_event, OS_EVENT_TYPE_AUTO);
 
-	pthread_create(&out->io.io_thread, NULL, io_thread, out);
+	out->io.start_ts = os_gettime_ns();
+	pthread_create(&out->io.io_thread, NULL, thread_func, out);
 
 	out->io.active = true;
 
@@ -360,6 +789,38 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path, size_
 	return true;
 }
 
+static void log_stats(struct file_output_data *out)
+{
+	struct buffered_file_serializer_stats *stats = &out->io.stats;
+	double seconds = (double)stats->duration_ns / 1000000000.0;
+
+	if (!stats->writes || seconds <= 0.0)
+		return;
+
+	blog(LOG_INFO,
+	     "Wrote %" PRIu64 " MiB to '%s' in %" PRIu64 " writes (%s): "
+	     "%.1f MiB/s, write latency avg %.2f ms, max %.2f ms",
+	     stats->bytes_written / 1048576, out->filename.array, stats->writes,
+	     stats->direct_io ? "io_uring" : "buffered", (double)stats->bytes_written / 1048576.0 / seconds,
+	     (double)stats->total_latency_ns / (double)stats->writes / 1000000.0,
+	     (double)stats->max_latency_ns / 1000000.0);
+}
+
+bool buffered_file_serializer_get_stats(struct serializer *s, struct buffered_file_serializer_stats *stats)
+{
+	struct file_output_data *out = s->data;
+
+	if (!out || !out->io.active)
+		return false;
+
+	pthread_mutex_lock(&out->io.stats_mutex);
+	*stats = out->io.stats;
+	pthread_mutex_unlock(&out->io.stats_mutex);
+
+	stats->duration_ns = os_gettime_ns() - out->io.start_ts;
+	return true;
+}
+
 void buffered_file_serializer_free(struct serializer *s)
 {
 	struct file_output_data *out = s->data;
@@ -376,10 +837,18 @@ void buffered_file_serializer_free(struct serializer *s)
 		pthread_mutex_unlock(&out->io.data_mutex);
 		pthread_join(out->io.io_thread, NULL);
 
+		out->io.stats.duration_ns = os_gettime_ns() - out->io.start_ts;
+		log_stats(out);
+
+#ifdef HAVE_LIBURING
+		uring_writer_free(out->io.uring);
+#endif
+
 		os_event_destroy(out->io.new_data_available_event);
 		os_event_destroy(out->io.buffer_space_available_event);
 
 		pthread_mutex_destroy(&out->io.data_mutex);
+		pthread_mutex_destroy(&out->io.stats_mutex);
 
 		blog(LOG_DEBUG, "Final buffer capacity: %zu KiB", out->io.data.capacity / 1024);
 
@@ -22,11 +22,33 @@
 extern "C" {
 #endif
 
+enum buffered_file_serializer_flags {
+	/* Write through io_uring with O_DIRECT and several writes in flight.
+	 * Only available on Linux builds with liburing, the regular writer
+	 * thread is used if the file system or kernel does not support it. */
+	BUFFERED_FILE_DIRECT_IO = 1 << 0,
+};
+
+struct buffered_file_serializer_stats {
+	uint64_t bytes_written;
+	uint64_t writes;
+	uint64_t total_latency_ns;
+	uint64_t max_latency_ns;
+	uint64_t duration_ns;
+	bool direct_io;
+};
+
 EXPORT bool buffered_file_serializer_init_defaults(struct serializer *s, const char *path);
 EXPORT bool buffered_file_serializer_init(struct serializer *s, const char *path, size_t max_bufsize,
 					  size_t chunk_size);
+EXPORT bool buffered_file_serializer_init_ex(struct serializer *s, const char *path, size_t max_bufsize,
+					     size_t chunk_size, uint32_t flags);
 EXPORT void buffered_file_serializer_free(struct serializer *s);
 
+/* Write statistics of the file so far, latency is measured per write call
+ * (or from submission to completion for io_uring). */
+EXPORT bool buffered_file_serializer_get_stats(struct serializer *s, struct buffered_file_serializer_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
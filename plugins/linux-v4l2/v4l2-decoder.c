@@ -16,13 +16,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <obs-module.h>
+#include <util/platform.h>
 #include <linux/videodev2.h>
 
 #include "v4l2-decoder.h"
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: decoder: " msg, ##__VA_ARGS__)
 
-int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt)
+/* Frame threading adds a frame of latency per thread, so it is opt-in and
+ * kept small */
+#define MAX_DECODE_THREADS 4
+
+int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt, bool frame_threading)
 {
 	if (pixfmt == V4L2_PIX_FMT_MJPEG) {
 		decoder->codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
@@ -54,6 +59,16 @@ int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt)
 	}
 
 	decoder->context->flags2 |= AV_CODEC_FLAG2_FAST;
+	decoder->context->thread_type = frame_threading ? FF_THREAD_FRAME | FF_THREAD_SLICE : FF_THREAD_SLICE;
+	decoder->context->thread_count = os_get_logical_cores();
+	if (decoder->context->thread_count > MAX_DECODE_THREADS)
+		decoder->context->thread_count = MAX_DECODE_THREADS;
+
+	os_atomic_set_long(&decoder->decoded, 0);
+	os_atomic_set_long(&decoder->dropped, 0);
+	os_atomic_set_long(&decoder->errors, 0);
+	os_atomic_set_long(&decoder->total_latency_ns, 0);
+	os_atomic_set_long(&decoder->max_latency_ns, 0);
 
 	if (avcodec_open2(decoder->context, decoder->codec, NULL) < 0) {
 		blog(LOG_ERROR, "failed to open codec");
@@ -84,20 +99,8 @@ void v4l2_destroy_decoder(struct v4l2_decoder *decoder)
 	}
 }
 
-int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data, size_t length, struct v4l2_decoder *decoder)
+static void v4l2_set_frame_format(struct obs_source_frame *out, struct v4l2_decoder *decoder)
 {
-	decoder->packet->data = data;
-	decoder->packet->size = length;
-	if (avcodec_send_packet(decoder->context, decoder->packet) < 0) {
-		blog(LOG_ERROR, "failed to send frame to codec");
-		return -1;
-	}
-
-	if (avcodec_receive_frame(decoder->context, decoder->frame) < 0) {
-		blog(LOG_ERROR, "failed to receive frame from codec");
-		return -1;
-	}
-
 	for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i) {
 		out->data[i] = decoder->frame->data[i];
 		out->linesize[i] = decoder->frame->linesize[i];
@@ -122,6 +125,188 @@ int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data, size_t length
 	default:
 		break;
 	}
+}
+
+static void v4l2_record_latency(struct v4l2_decoder *decoder, uint64_t timestamp)
+{
+	for (size_t i = 0; i < V4L2_DECODE_WINDOW * 4; i++) {
+		if (decoder->pending_ts[i] != timestamp || !decoder->pending_queued_ts[i])
+			continue;
+
+		long latency = (long)(os_gettime_ns() - decoder->pending_queued_ts[i]);
+		decoder->pending_queued_ts[i] = 0;
+
+		os_atomic_set_long(&decoder->total_latency_ns, decoder->total_latency_ns + latency);
+		if (latency > decoder->max_latency_ns)
+			os_atomic_set_long(&decoder->max_latency_ns, latency);
+		break;
+	}
+}
+
+static void v4l2_decode_error(struct v4l2_decoder *decoder, const char *msg)
+{
+	/* a single corrupt frame should not stop the capture */
+	if (os_atomic_inc_long(&decoder->errors) == 1)
+		blog(LOG_ERROR, "%s", msg);
+}
+
+static void v4l2_decode_job(struct v4l2_decoder *decoder, struct v4l2_decode_job *job)
+{
+	size_t idx = decoder->pending_idx++ % (V4L2_DECODE_WINDOW * 4);
+	decoder->pending_ts[idx] = job->timestamp;
+	decoder->pending_queued_ts[idx] = job->queued_ts;
+
+	decoder->packet->data = job->data;
+	decoder->packet->size = (int)job->size;
+	decoder->packet->pts = (int64_t)job->timestamp;
+
+	/* the packet is not reference counted, so the codec copies it */
+	if (avcodec_send_packet(decoder->context, decoder->packet) < 0) {
+		v4l2_decode_error(decoder, "failed to send frame to codec");
+		return;
+	}
+
+	for (;;) {
+		int ret = avcodec_receive_frame(decoder->context, decoder->frame);
+		if (ret == AVERROR(EAGAIN))
+			break;
+		if (ret < 0) {
+			v4l2_decode_error(decoder, "failed to receive frame from codec");
+			break;
+		}
+
+		uint64_t timestamp = decoder->frame->pts != AV_NOPTS_VALUE ? (uint64_t)decoder->frame->pts
+									    : job->timestamp;
+
+		v4l2_set_frame_format(&decoder->out, decoder);
+		decoder->out.timestamp = timestamp;
+		obs_source_output_video(decoder->source, &decoder->out);
+
+		os_atomic_inc_long(&decoder->decoded);
+		v4l2_record_latency(decoder, timestamp);
+	}
+}
+
+static void *v4l2_decode_thread(void *vptr)
+{
+	struct v4l2_decoder *decoder = vptr;
+
+	os_set_thread_name("v4l2: decode");
+
+	for (;;) {
+		os_sem_wait(decoder->sem);
+		if (os_atomic_load_bool(&decoder->stop))
+			break;
 
+		/* only the capture thread adds jobs, and only behind the
+		 * first one */
+		pthread_mutex_lock(&decoder->mutex);
+		struct v4l2_decode_job *job = &decoder->jobs[decoder->first_job];
+		pthread_mutex_unlock(&decoder->mutex);
+
+		v4l2_decode_job(decoder, job);
+
+		pthread_mutex_lock(&decoder->mutex);
+		decoder->first_job = (decoder->first_job + 1) % V4L2_DECODE_WINDOW;
+		decoder->num_jobs--;
+		pthread_mutex_unlock(&decoder->mutex);
+	}
+
+	return NULL;
+}
+
+int v4l2_start_decoder(struct v4l2_decoder *decoder, obs_source_t *source, const struct obs_source_frame *frame)
+{
+	decoder->source = source;
+	decoder->out = *frame;
+	decoder->first_job = 0;
+	decoder->num_jobs = 0;
+	decoder->pending_idx = 0;
+	memset(decoder->pending_queued_ts, 0, sizeof(decoder->pending_queued_ts));
+	os_atomic_set_bool(&decoder->stop, false);
+
+	if (os_sem_init(&decoder->sem, 0) != 0)
+		return -1;
+
+	pthread_mutex_init(&decoder->mutex, NULL);
+
+	if (pthread_create(&decoder->thread, NULL, v4l2_decode_thread, decoder) != 0) {
+		pthread_mutex_destroy(&decoder->mutex);
+		os_sem_destroy(decoder->sem);
+		decoder->sem = NULL;
+		return -1;
+	}
+
+	decoder->thread_active = true;
 	return 0;
 }
+
+void v4l2_stop_decoder(struct v4l2_decoder *decoder)
+{
+	if (!decoder->thread_active)
+		return;
+
+	os_atomic_set_bool(&decoder->stop, true);
+	os_sem_post(decoder->sem);
+	pthread_join(decoder->thread, NULL);
+	decoder->thread_active = false;
+
+	pthread_mutex_destroy(&decoder->mutex);
+	os_sem_destroy(decoder->sem);
+	decoder->sem = NULL;
+
+	for (size_t i = 0; i < V4L2_DECODE_WINDOW; i++) {
+		bfree(decoder->jobs[i].data);
+		decoder->jobs[i].data = NULL;
+		decoder->jobs[i].capacity = 0;
+	}
+}
+
+bool v4l2_queue_frame(struct v4l2_decoder *decoder, uint8_t *data, size_t length, uint64_t timestamp)
+{
+	uint64_t queued_ts = os_gettime_ns();
+
+	pthread_mutex_lock(&decoder->mutex);
+	bool full = decoder->num_jobs == V4L2_DECODE_WINDOW;
+	size_t idx = (decoder->first_job + decoder->num_jobs) % V4L2_DECODE_WINDOW;
+	pthread_mutex_unlock(&decoder->mutex);
+
+	if (full) {
+		os_atomic_inc_long(&decoder->dropped);
+		return false;
+	}
+
+	/* the decode thread does not touch jobs past num_jobs */
+	struct v4l2_decode_job *job = &decoder->jobs[idx];
+	if (job->capacity < length + AV_INPUT_BUFFER_PADDING_SIZE) {
+		job->capacity = length + AV_INPUT_BUFFER_PADDING_SIZE;
+		job->data = brealloc(job->data, job->capacity);
+	}
+
+	memcpy(job->data, data, length);
+	memset(job->data + length, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+	job->size = length;
+	job->timestamp = timestamp;
+	job->queued_ts = queued_ts;
+
+	pthread_mutex_lock(&decoder->mutex);
+	decoder->num_jobs++;
+	pthread_mutex_unlock(&decoder->mutex);
+
+	os_sem_post(decoder->sem);
+	return true;
+}
+
+void v4l2_log_decoder_stats(struct v4l2_decoder *decoder, const char *device_id)
+{
+	long decoded = os_atomic_load_long(&decoder->decoded);
+	long total_latency = os_atomic_load_long(&decoder->total_latency_ns);
+	long max_latency = os_atomic_load_long(&decoder->max_latency_ns);
+
+	blog(LOG_INFO,
+	     "%s: decoded %ld frames (%d threads), dropped %ld, errors %ld, "
+	     "decode latency avg %.2f ms, max %.2f ms",
+	     device_id, decoded, decoder->context ? decoder->context->thread_count : 0,
+	     os_atomic_load_long(&decoder->dropped), os_atomic_load_long(&decoder->errors),
+	     decoded ? (double)total_latency / (double)decoded / 1000000.0 : 0.0, (double)max_latency / 1000000.0);
+}
@@ -25,6 +25,22 @@ extern "C" {
 #include <libavformat/avformat.h>
 #include <libavutil/pixfmt.h>
 
+#include <util/threading.h>
+
+/** Number of compressed frames that can wait for the decode thread */
+#define V4L2_DECODE_WINDOW 4
+
+/**
+ * Compressed frame waiting to be decoded
+ */
+struct v4l2_decode_job {
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+	uint64_t timestamp;
+	uint64_t queued_ts;
+};
+
 /**
  * Data structure for decoder
  */
@@ -33,6 +49,31 @@ struct v4l2_decoder {
 	AVCodecContext *context;
 	AVPacket *packet;
 	AVFrame *frame;
+
+	/* decode thread */
+	obs_source_t *source;
+	struct obs_source_frame out;
+	pthread_t thread;
+	bool thread_active;
+	volatile bool stop;
+	os_sem_t *sem;
+	pthread_mutex_t mutex;
+	struct v4l2_decode_job jobs[V4L2_DECODE_WINDOW];
+	size_t first_job;
+	size_t num_jobs;
+
+	/* times the jobs were queued, to match frames leaving the
+	 * (frame-threaded) codec with some delay */
+	uint64_t pending_ts[V4L2_DECODE_WINDOW * 4];
+	uint64_t pending_queued_ts[V4L2_DECODE_WINDOW * 4];
+	size_t pending_idx;
+
+	/* statistics, written by one thread each */
+	volatile long decoded;
+	volatile long dropped;
+	volatile long errors;
+	volatile long total_latency_ns;
+	volatile long max_latency_ns;
 };
 
 /**
@@ -41,9 +82,11 @@ struct v4l2_decoder {
  *
  * @param decoder the decoder structure
  * @param pixfmt which codec is used
+ * @param frame_threading also decode several frames in parallel, which adds
+ *                        a frame of latency per thread
  * @return non-zero on failure
  */
-int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt);
+int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt, bool frame_threading);
 
 /**
  * Free any data associated with the decoder.
@@ -53,15 +96,46 @@ int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt);
 void v4l2_destroy_decoder(struct v4l2_decoder *decoder);
 
 /**
- * Decode a jpeg or h264 frame into an obs frame
+ * Start the decode thread.
+ *
+ * Decoded frames are passed to obs_source_output_video, using the frame
+ * template for everything except the plane data, format and timestamp.
  *
- * @param out the obs frame to decode into
- * @param data the codec data
- * @param length length of the data
  * @param decoder the decoder as initialized by v4l2_init_decoder
+ * @param source the source to output frames to
+ * @param frame frame properties known before capture starts
  * @return non-zero on failure
  */
-int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data, size_t length, struct v4l2_decoder *decoder);
+int v4l2_start_decoder(struct v4l2_decoder *decoder, obs_source_t *source, const struct obs_source_frame *frame);
+
+/**
+ * Stop the decode thread, dropping any frames still waiting.
+ *
+ * @param decoder the decoder structure
+ */
+void v4l2_stop_decoder(struct v4l2_decoder *decoder);
+
+/**
+ * Queue a jpeg or h264 frame for decoding
+ *
+ * The data is copied, so the capture buffer can be requeued right away.
+ * If the decode thread is too far behind the frame is dropped.
+ *
+ * @param decoder the decoder as started by v4l2_start_decoder
+ * @param data the codec data
+ * @param length length of the data
+ * @param timestamp timestamp of the frame
+ * @return false if the frame was dropped
+ */
+bool v4l2_queue_frame(struct v4l2_decoder *decoder, uint8_t *data, size_t length, uint64_t timestamp);
+
+/**
+ * Log decode statistics
+ *
+ * @param decoder the decoder structure
+ * @param device_id device name to log with
+ */
+void v4l2_log_decoder_stats(struct v4l2_decoder *decoder, const char *device_id);
 
 #ifdef __cplusplus
 }
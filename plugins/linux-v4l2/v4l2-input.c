@@ -76,6 +76,7 @@ struct v4l2_data {
 	int64_t resolution;
 	int64_t framerate;
 	int color_range;
+	bool frame_threading;
 
 	/* internal data */
 	obs_source_t *source;
@@ -172,6 +173,9 @@ static void *v4l2_thread(void *vptr)
 	int fps_num, fps_denom;
 	float ffps;
 	uint64_t timeout_usec;
+	uint32_t last_sequence = 0;
+	uint64_t missed = 0;
+	bool decode = data->pixfmt == V4L2_PIX_FMT_MJPEG || data->pixfmt == V4L2_PIX_FMT_H264;
 
 	blog(LOG_DEBUG, "%s: new capture thread", data->device_id);
 	os_set_thread_name("v4l2: capture");
@@ -196,6 +200,13 @@ static void *v4l2_thread(void *vptr)
 
 	blog(LOG_DEBUG, "%s: obs frame prepared", data->device_id);
 
+	/* Decoding happens on its own thread so that dequeueing buffers here
+	 * does not fall behind when decoding takes longer than a frame. */
+	if (decode && v4l2_start_decoder(&data->decoder, data->source, &out) < 0) {
+		blog(LOG_ERROR, "%s: failed to start decode thread", data->device_id);
+		goto exit;
+	}
+
 	while (os_event_try(data->event) == EAGAIN) {
 		FD_ZERO(&fds);
 		FD_SET(data->dev, &fds);
@@ -251,18 +262,20 @@ static void *v4l2_thread(void *vptr)
 			first_ts = out.timestamp;
 		out.timestamp -= first_ts;
 
+		/* the driver drops frames when buffers are not requeued in time */
+		if (frames && buf.sequence > last_sequence + 1)
+			missed += buf.sequence - last_sequence - 1;
+		last_sequence = buf.sequence;
+
 		start = (uint8_t *)data->buffers.info[buf.index].start;
 
-		if (data->pixfmt == V4L2_PIX_FMT_MJPEG || data->pixfmt == V4L2_PIX_FMT_H264) {
-			if (v4l2_decode_frame(&out, start, buf.bytesused, &data->decoder) < 0) {
-				blog(LOG_ERROR, "failed to unpack jpeg or h264");
-				break;
-			}
+		if (decode) {
+			v4l2_queue_frame(&data->decoder, start, buf.bytesused, out.timestamp);
 		} else {
 			for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
 				out.data[i] = start + plane_offsets[i];
+			obs_source_output_video(data->source, &out);
 		}
-		obs_source_output_video(data->source, &out);
 
 		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) < 0) {
 			blog(LOG_ERROR, "%s: failed to enqueue buffer", data->device_id);
@@ -272,7 +285,13 @@ static void *v4l2_thread(void *vptr)
 		frames++;
 	}
 
-	blog(LOG_INFO, "%s: Stopped capture after %" PRIu64 " frames", data->device_id, frames);
+	blog(LOG_INFO, "%s: Stopped capture after %" PRIu64 " frames, %" PRIu64 " frames missed", data->device_id,
+	     frames, missed);
+
+	if (decode) {
+		v4l2_stop_decoder(&data->decoder);
+		v4l2_log_decoder_stats(&data->decoder, data->device_id);
+	}
 
 exit:
 	v4l2_stop_capture(data->dev);
@@ -297,6 +316,7 @@ static void v4l2_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, "buffering", true);
 	obs_data_set_default_bool(settings, "auto_reset", false);
 	obs_data_set_default_int(settings, "timeout_frames", 5);
+	obs_data_set_default_bool(settings, "frame_threading", false);
 }
 
 /**
@@ -807,6 +827,8 @@ static obs_properties_t *v4l2_properties(void *vptr)
 
 	obs_properties_add_int(props, "timeout_frames", obs_module_text("FramesUntilTimeout"), 2, 120, 1);
 
+	obs_properties_add_bool(props, "frame_threading", obs_module_text("FrameThreading"));
+
 	// a group to contain the camera control
 	obs_properties_t *ctrl_props = obs_properties_create();
 	obs_properties_add_group(props, "controls", obs_module_text("CameraCtrls"), OBS_GROUP_NORMAL, ctrl_props);
@@ -953,7 +975,7 @@ static void v4l2_init(struct v4l2_data *data)
 	}
 
 	if (data->pixfmt == V4L2_PIX_FMT_MJPEG || data->pixfmt == V4L2_PIX_FMT_H264) {
-		if (v4l2_init_decoder(&data->decoder, data->pixfmt) < 0) {
+		if (v4l2_init_decoder(&data->decoder, data->pixfmt, data->frame_threading) < 0) {
 			blog(LOG_ERROR, "Failed to initialize decoder");
 			goto fail;
 		}
@@ -1014,6 +1036,7 @@ static bool v4l2_settings_changed(struct v4l2_data *data, obs_data_t *settings)
 		}
 
 		res |= data->color_range != obs_data_get_int(settings, "color_range");
+		res |= data->frame_threading != obs_data_get_bool(settings, "frame_threading");
 	} else {
 		res = true;
 	}
@@ -1051,6 +1074,7 @@ static void v4l2_update(void *vptr, obs_data_t *settings)
 	data->color_range = obs_data_get_int(settings, "color_range");
 	data->auto_reset = obs_data_get_bool(settings, "auto_reset");
 	data->timeout_frames = obs_data_get_int(settings, "timeout_frames");
+	data->frame_threading = obs_data_get_bool(settings, "frame_threading");
 
 	v4l2_update_source_flags(data, settings);
 
@@ -12,6 +12,13 @@ if(NOT TARGET OBS::opts-parser)
   add_subdirectory("${CMAKE_SOURCE_DIR}/shared/opts-parser" "${CMAKE_BINARY_DIR}/shared/opts-parser")
 endif()
 
+if(NOT TARGET OBS::shared-memory-ring)
+  add_subdirectory(
+    "${CMAKE_SOURCE_DIR}/shared/obs-shared-memory-ring"
+    "${CMAKE_BINARY_DIR}/shared/obs-shared-memory-ring"
+  )
+endif()
+
 if(OS_WINDOWS)
   find_package(AMF 1.4.29 REQUIRED)
   add_subdirectory(obs-amf-test)
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "ffmpeg-mux.h"
+#include "shared-memory-ring.h"
 
 #include <util/threading.h>
 #include <util/platform.h>
@@ -44,6 +45,7 @@
 /* ------------------------------------------------------------------------- */
 
 static char *global_stream_key = "";
+static shm_ring_t *global_ring = NULL;
 
 struct resize_buf {
 	uint8_t *buf;
@@ -410,6 +412,19 @@ static bool init_params(int *argc, char ***argv, struct main_params *params, str
 
 	get_opt_str(argc, argv, &params->muxer_settings, "muxer settings");
 
+	/* Optional, packet data goes through the pipe without it */
+	if (*argc) {
+		char *ring_name;
+		get_opt_str(argc, argv, &ring_name, "shared memory ring");
+
+		if (!global_ring) {
+			global_ring = shm_ring_open(ring_name);
+			/* The parent keeps using the pipe if this fails */
+			if (!global_ring)
+				fprintf(stderr, "Failed to open shared memory ring '%s'\n", ring_name);
+		}
+	}
+
 	return true;
 }
 
@@ -612,6 +627,14 @@ static size_t safe_read(void *vdata, size_t size)
 	return total;
 }
 
+static bool read_packet_data(struct ffm_packet_info *info, void *data)
+{
+	if (info->shared)
+		return global_ring && shm_ring_read(global_ring, data, info->size);
+
+	return safe_read(data, info->size) == info->size;
+}
+
 static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
 {
 	struct ffm_packet_info info = {0};
@@ -620,7 +643,7 @@ static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
 	if (success) {
 		uint8_t *data = malloc(info.size);
 
-		if (safe_read(data, info.size) == info.size) {
+		if (read_packet_data(&info, data)) {
 			ffmpeg_mux_header(ffm, data, &info);
 		} else {
 			success = false;
@@ -1176,7 +1199,7 @@ int main(int argc, char *argv[])
 
 		resize_buf_resize(&rb, info.size);
 
-		if (safe_read(rb.buf, info.size) == info.size) {
+		if (read_packet_data(&info, rb.buf)) {
 			fail = !ffmpeg_mux_packet(&ffm, rb.buf, &info);
 		} else {
 			fail = true;
@@ -1186,6 +1209,7 @@ int main(int argc, char *argv[])
 	ffmpeg_mux_free(&ffm);
 	resize_buf_free(&rb);
 	resize_buf_free(&rb_filename);
+	shm_ring_close(global_ring);
 
 #ifdef _WIN32
 	for (int i = 0; i < argc; i++)
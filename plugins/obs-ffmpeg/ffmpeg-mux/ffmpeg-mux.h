@@ -36,4 +36,7 @@ struct ffm_packet_info {
 	uint32_t index;
 	enum ffm_packet_type type;
 	bool keyframe;
+
+	/* Packet data follows in the shared memory ring instead of the pipe */
+	bool shared;
 };
@@ -73,7 +73,7 @@ static void ffmpeg_mux_destroy(void *data)
 	da_free(stream->mux_packets);
 	deque_free(&stream->packets);
 
-	os_process_pipe_destroy(stream->pipe);
+	stop_pipe(stream);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
 	dstr_free(&stream->stream_key);
@@ -300,14 +300,42 @@ static void build_command_line(struct ffmpeg_muxer *stream, os_process_args_t **
 
 	add_stream_key(*args, stream);
 	add_muxer_params(*args, stream);
+
+	if (stream->ring)
+		os_process_args_add_arg(*args, shm_ring_get_name(stream->ring));
 }
 
+/* Packet data goes through a shared memory ring when possible, the pipe only
+ * carries the packet headers (and data that does not fit into the ring). */
+#define SHM_RING_SIZE (64 * 1024 * 1024)
+
 void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	os_process_args_t *args = NULL;
+
+	stream->ring = shm_ring_create(SHM_RING_SIZE);
+	if (!stream->ring)
+		warn("Failed to create shared memory ring, sending packets through the pipe");
+
 	build_command_line(stream, &args, path);
 	stream->pipe = os_process_pipe_create2(args, "w");
 	os_process_args_destroy(args);
+
+	if (!stream->pipe) {
+		shm_ring_close(stream->ring);
+		stream->ring = NULL;
+	}
+}
+
+int stop_pipe(struct ffmpeg_muxer *stream)
+{
+	/* Waits for the process to exit, so the ring is no longer in use */
+	int ret = os_process_pipe_destroy(stream->pipe);
+	stream->pipe = NULL;
+
+	shm_ring_close(stream->ring);
+	stream->ring = NULL;
+	return ret;
 }
 
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream, obs_data_t *settings, const char *path)
@@ -466,8 +494,7 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -622,6 +649,12 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		}
 	}
 
+	/* Data has to be in the ring before the header announces it. Until the
+	 * child has opened the ring (or if it never does), it all goes through
+	 * the pipe. */
+	info.shared = stream->ring && shm_ring_reader_attached(stream->ring) &&
+		      shm_ring_try_write(stream->ring, packet->data, info.size);
+
 	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info, sizeof(info));
 	if (ret != sizeof(info)) {
 		warn("os_process_pipe_write for info structure failed");
@@ -629,11 +662,13 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		return false;
 	}
 
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
-	if (ret != packet->size) {
-		warn("os_process_pipe_write for packet data failed");
-		signal_failure(stream);
-		return false;
+	if (!info.shared) {
+		ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
+		if (ret != packet->size) {
+			warn("os_process_pipe_write for packet data failed");
+			signal_failure(stream);
+			return false;
+		}
 	}
 
 	stream->total_bytes += packet->size;
@@ -1118,8 +1153,7 @@ static void *replay_buffer_mux_thread(void *data)
 	info("Wrote replay buffer to '%s'", stream->path.array);
 
 error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
+	stop_pipe(stream);
 	if (error) {
 		for (size_t i = 0; i < stream->mux_packets.num; i++)
 			obs_encoder_packet_release(&stream->mux_packets.array[i]);
@@ -8,12 +8,14 @@
 #include <util/pipe.h>
 #include <util/platform.h>
 #include <util/threading.h>
+#include <shared-memory-ring.h>
 
 typedef DARRAY(struct encoder_packet) mux_packets_t;
 
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
+	shm_ring_t *ring;
 	int64_t stop_ts;
 	uint64_t total_bytes;
 	bool sent_headers;
@@ -69,6 +71,7 @@ struct ffmpeg_muxer {
 bool stopping(struct ffmpeg_muxer *stream);
 bool active(struct ffmpeg_muxer *stream);
 void start_pipe(struct ffmpeg_muxer *stream, const char *path);
+int stop_pipe(struct ffmpeg_muxer *stream);
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
 bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
@@ -45,7 +45,7 @@ if(ENABLE_RNNOISE)
     endif()
   endif()
 
-  target_sources(obs-filters PRIVATE noise-suppress-filter.c)
+  target_sources(obs-filters PRIVATE denoise-pool.c denoise-pool.h noise-suppress-filter.c)
 
   target_link_libraries(obs-filters PRIVATE Librnnoise::Librnnoise)
 
@@ -4,10 +4,13 @@
 
 #include <obs-module.h>
 #include <media-io/audio-math.h>
+#include <media-io/audio-dsp.h>
 #include <util/platform.h>
 #include <util/deque.h>
 #include <util/threading.h>
 
+#include "filter-dsp.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...) \
@@ -297,27 +300,8 @@ static void analyze_envelope(struct compressor_data *cd, float **samples, const
 		resize_env_buffer(cd, num_samples);
 	}
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-
-	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(samples[chan][i]);
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
-	cd->envelope = cd->envelope_buf[num_samples - 1];
+	cd->envelope = envelope_follow_linked(cd->envelope_buf, (const float *const *)samples, cd->num_channels,
+					      num_samples, cd->attack_gain, cd->release_gain, cd->envelope);
 }
 
 static void analyze_sidechain(struct compressor_data *cd, const uint32_t num_samples)
@@ -328,42 +312,25 @@ static void analyze_sidechain(struct compressor_data *cd, const uint32_t num_sam
 
 	get_sidechain_data(cd, num_samples);
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-	float **sidechain_buf = cd->sidechain_buf;
-
-	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!sidechain_buf[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(sidechain_buf[chan][i]);
-
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
-	cd->envelope = cd->envelope_buf[num_samples - 1];
+	cd->envelope = envelope_follow_linked(cd->envelope_buf, (const float *const *)cd->sidechain_buf,
+					      cd->num_channels, num_samples, cd->attack_gain, cd->release_gain,
+					      cd->envelope);
 }
 
 static inline void process_compression(const struct compressor_data *cd, float **samples, uint32_t num_samples)
 {
+	/* turns the envelope into the gain of every frame */
+	float *gains = cd->envelope_buf;
+
 	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
+		const float env_db = mul_to_db(gains[i]);
 		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
+		gains[i] = db_to_mul(fminf(0, gain)) * cd->output_gain;
+	}
 
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
+	for (size_t c = 0; c < cd->num_channels; ++c) {
+		if (samples[c]) {
+			audio_dsp_gain_env(samples[c], samples[c], gains, num_samples);
 		}
 	}
 }
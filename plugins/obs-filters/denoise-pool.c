@@ -0,0 +1,270 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/bmem.h>
+#include <util/base.h>
+#include <util/deque.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include "denoise-pool.h"
+
+#define DENOISE_MAX_WORKERS 4
+#define DENOISE_MAX_BATCH 8
+
+/* RNNoise expects samples in the 16-bit range */
+#define DENOISE_SCALE 32768.0f
+
+struct denoise_job {
+	DenoiseState *state;
+	float *data;
+	struct denoise_client *client;
+	uint64_t time;
+};
+
+struct denoise_client {
+	volatile long pending;
+	os_event_t *done;
+};
+
+struct denoise_pool {
+	long clients;
+
+	pthread_t threads[DENOISE_MAX_WORKERS];
+	size_t num_threads;
+	os_sem_t *work;
+	volatile bool stop;
+
+	pthread_mutex_t mutex;
+	struct deque jobs;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct denoise_pool *pool = NULL;
+
+/* ------------------------------------------------------------------------- */
+
+void denoise_process(DenoiseState *const *states, float *const *data, size_t count)
+{
+#ifdef RNNOISE_HAS_PROCESS_FRAMES
+	rnnoise_process_frames(states, data, (const float *const *)data, NULL, (int)count, DENOISE_SCALE);
+#else
+	for (size_t i = 0; i < count; i++) {
+		float *frame = data[i];
+
+		for (size_t j = 0; j < DENOISE_FRAME_SIZE; j++)
+			frame[j] *= DENOISE_SCALE;
+		rnnoise_process_frame(states[i], frame, frame);
+		for (size_t j = 0; j < DENOISE_FRAME_SIZE; j++)
+			frame[j] /= DENOISE_SCALE;
+	}
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+static size_t take_jobs(struct denoise_pool *p, struct denoise_job *jobs)
+{
+	size_t count;
+
+	pthread_mutex_lock(&p->mutex);
+
+	/* give other clients a moment to fill up the batch */
+	while (p->jobs.size && p->jobs.size < DENOISE_MAX_BATCH * sizeof(*jobs) && p->clients > 1) {
+		struct denoise_job oldest;
+		deque_peek_front(&p->jobs, &oldest, sizeof(oldest));
+
+		uint64_t deadline = oldest.time + DENOISE_BATCH_WAIT_NS;
+		if (os_gettime_ns() >= deadline || p->stop)
+			break;
+
+		pthread_mutex_unlock(&p->mutex);
+		os_sleepto_ns(deadline);
+		pthread_mutex_lock(&p->mutex);
+	}
+
+	count = p->jobs.size / sizeof(*jobs);
+	if (count > DENOISE_MAX_BATCH)
+		count = DENOISE_MAX_BATCH;
+	deque_pop_front(&p->jobs, jobs, count * sizeof(*jobs));
+
+	pthread_mutex_unlock(&p->mutex);
+	return count;
+}
+
+static void *denoise_worker(void *param)
+{
+	struct denoise_pool *p = param;
+	struct denoise_job jobs[DENOISE_MAX_BATCH];
+	DenoiseState *states[DENOISE_MAX_BATCH];
+	float *data[DENOISE_MAX_BATCH];
+
+	os_set_thread_name("obs-filters: denoise worker");
+
+	for (;;) {
+		os_sem_wait(p->work);
+		if (p->stop)
+			break;
+
+		/* the semaphore is posted once per job, so other workers may
+		 * find the jobs already taken */
+		size_t count = take_jobs(p, jobs);
+		if (!count)
+			continue;
+
+		for (size_t i = 0; i < count; i++) {
+			states[i] = jobs[i].state;
+			data[i] = jobs[i].data;
+		}
+
+		denoise_process(states, data, count);
+
+		for (size_t i = 0; i < count; i++) {
+			struct denoise_client *client = jobs[i].client;
+			if (os_atomic_dec_long(&client->pending) == 0)
+				os_event_signal(client->done);
+		}
+	}
+
+	return NULL;
+}
+
+static void pool_destroy(struct denoise_pool *p)
+{
+	p->stop = true;
+	for (size_t i = 0; i < p->num_threads; i++)
+		os_sem_post(p->work);
+	for (size_t i = 0; i < p->num_threads; i++)
+		pthread_join(p->threads[i], NULL);
+
+	os_sem_destroy(p->work);
+	pthread_mutex_destroy(&p->mutex);
+	deque_free(&p->jobs);
+	bfree(p);
+}
+
+static struct denoise_pool *pool_create(void)
+{
+	struct denoise_pool *p = bzalloc(sizeof(struct denoise_pool));
+	int workers = os_get_logical_cores() / 4;
+
+	if (workers < 1)
+		workers = 1;
+	if (workers > DENOISE_MAX_WORKERS)
+		workers = DENOISE_MAX_WORKERS;
+
+	if (pthread_mutex_init(&p->mutex, NULL) != 0) {
+		bfree(p);
+		return NULL;
+	}
+	if (os_sem_init(&p->work, 0) != 0) {
+		pthread_mutex_destroy(&p->mutex);
+		bfree(p);
+		return NULL;
+	}
+
+	for (int i = 0; i < workers; i++) {
+		if (pthread_create(&p->threads[i], NULL, denoise_worker, p) != 0)
+			break;
+		p->num_threads++;
+	}
+
+	if (!p->num_threads) {
+		pool_destroy(p);
+		return NULL;
+	}
+
+	blog(LOG_INFO, "[noise suppress] Started %zu shared RNNoise worker thread(s)", p->num_threads);
+	return p;
+}
+
+/* ------------------------------------------------------------------------- */
+
+denoise_client_t *denoise_client_create(void)
+{
+	struct denoise_client *client = bzalloc(sizeof(struct denoise_client));
+
+	if (os_event_init(&client->done, OS_EVENT_TYPE_AUTO) != 0) {
+		bfree(client);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&pool_mutex);
+	if (!pool)
+		pool = pool_create();
+	if (pool)
+		pool->clients++;
+	pthread_mutex_unlock(&pool_mutex);
+
+	if (!pool) {
+		os_event_destroy(client->done);
+		bfree(client);
+		return NULL;
+	}
+
+	return client;
+}
+
+void denoise_client_destroy(denoise_client_t *client)
+{
+	struct denoise_pool *old = NULL;
+
+	if (!client)
+		return;
+
+	denoise_client_wait(client);
+
+	pthread_mutex_lock(&pool_mutex);
+	if (--pool->clients == 0) {
+		old = pool;
+		pool = NULL;
+	}
+	pthread_mutex_unlock(&pool_mutex);
+
+	if (old)
+		pool_destroy(old);
+
+	os_event_destroy(client->done);
+	bfree(client);
+}
+
+void denoise_client_submit(denoise_client_t *client, DenoiseState *const *states, float *const *data, size_t count)
+{
+	uint64_t time = os_gettime_ns();
+
+	if (!count)
+		return;
+
+	os_atomic_set_long(&client->pending, (long)count);
+
+	/* the pool lives as long as there are clients */
+	pthread_mutex_lock(&pool->mutex);
+	for (size_t i = 0; i < count; i++) {
+		struct denoise_job job = {states[i], data[i], client, time};
+		deque_push_back(&pool->jobs, &job, sizeof(job));
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (size_t i = 0; i < count; i++)
+		os_sem_post(pool->work);
+}
+
+void denoise_client_wait(denoise_client_t *client)
+{
+	while (os_atomic_load_long(&client->pending) > 0)
+		os_event_wait(client->done);
+}
@@ -0,0 +1,64 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/c99defs.h>
+
+#ifdef _MSC_VER
+#define ssize_t intptr_t
+#endif
+#include <rnnoise.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Samples of an RNNoise frame, 10 ms at 48 kHz */
+#define DENOISE_FRAME_SIZE 480
+
+/*
+ * Runs RNNoise on frames of samples in [-1, 1], in place.  states[i] is used
+ * for data[i], and a state may only appear once.  With the bundled RNNoise
+ * the network runs on several frames at once.
+ */
+extern void denoise_process(DenoiseState *const *states, float *const *data, size_t count);
+
+/*
+ * Worker threads shared by all noise suppression filters.  Frames submitted
+ * by different clients around the same time are batched together; a worker
+ * waits at most DENOISE_BATCH_WAIT_NS for a batch to fill up.
+ *
+ * Submitting does not block.  A client must wait for its frames before it
+ * touches them or submits more.
+ */
+#define DENOISE_BATCH_WAIT_NS 1000000ULL
+
+typedef struct denoise_client denoise_client_t;
+
+/* Returns NULL if no worker thread could be started */
+extern denoise_client_t *denoise_client_create(void);
+/* Waits for frames still being processed */
+extern void denoise_client_destroy(denoise_client_t *client);
+
+extern void denoise_client_submit(denoise_client_t *client, DenoiseState *const *states, float *const *data,
+				  size_t count);
+extern void denoise_client_wait(denoise_client_t *client);
+
+#ifdef __cplusplus
+}
+#endif
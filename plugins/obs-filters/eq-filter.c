@@ -1,35 +1,27 @@
 #include <media-io/audio-math.h>
-#include <util/deque.h>
-#include <util/darray.h>
+#include <media-io/audio-dsp.h>
 #include <obs-module.h>
 
 #include <math.h>
 
+#include "filter-dsp.h"
+
 #define LOW_FREQ 800.0f
 #define HIGH_FREQ 5000.0f
 
-struct eq_channel_state {
-	float lf_delay0;
-	float lf_delay1;
-	float lf_delay2;
-	float lf_delay3;
-
-	float hf_delay0;
-	float hf_delay1;
-	float hf_delay2;
-	float hf_delay3;
-
-	float sample_delay1;
-	float sample_delay2;
-	float sample_delay3;
-};
+/* The bands are split with two four pole lowpass filters; the dry signal is
+ * delayed by three frames to line up with them */
+#define EQ_POLES 4
+#define EQ_DELAY 3
 
 struct eq_data {
 	obs_source_t *context;
 	size_t channels;
-	struct eq_channel_state eqs[MAX_AUDIO_CHANNELS];
-	float lf;
-	float hf;
+	struct biquad_cascade low;
+	struct biquad_cascade high;
+	struct lookahead_buffer delay;
+	float *buf;
+	size_t buf_frames;
 	float low_gain;
 	float mid_gain;
 	float high_gain;
@@ -74,6 +66,15 @@ static obs_properties_t *eq_properties(void *unused)
 	return props;
 }
 
+static void init_cascade(struct biquad_cascade *bq, size_t channels, float f)
+{
+	struct biquad_coeffs coeffs[EQ_POLES];
+
+	for (size_t i = 0; i < EQ_POLES; i++)
+		biquad_one_pole_lowpass(&coeffs[i], f);
+	biquad_cascade_init(bq, channels, coeffs, EQ_POLES);
+}
+
 static void *eq_create(obs_data_t *settings, obs_source_t *filter)
 {
 	struct eq_data *eq = bzalloc(sizeof(*eq));
@@ -81,8 +82,9 @@ static void *eq_create(obs_data_t *settings, obs_source_t *filter)
 	eq->context = filter;
 
 	float freq = (float)audio_output_get_sample_rate(obs_get_audio());
-	eq->lf = 2.0f * sinf(M_PI * LOW_FREQ / freq);
-	eq->hf = 2.0f * sinf(M_PI * HIGH_FREQ / freq);
+	init_cascade(&eq->low, eq->channels, 2.0f * sinf(M_PI * LOW_FREQ / freq));
+	init_cascade(&eq->high, eq->channels, 2.0f * sinf(M_PI * HIGH_FREQ / freq));
+	lookahead_buffer_init(&eq->delay, eq->channels, EQ_DELAY);
 
 	eq_update(eq, settings);
 	return eq;
@@ -91,53 +93,47 @@ static void *eq_create(obs_data_t *settings, obs_source_t *filter)
 static void eq_destroy(void *data)
 {
 	struct eq_data *eq = data;
+	lookahead_buffer_free(&eq->delay);
+	bfree(eq->buf);
 	bfree(eq);
 }
 
-#define EQ_EPSILON (1.0f / 4294967295.0f)
-
-static inline float eq_process(struct eq_data *eq, struct eq_channel_state *c, float sample)
+static struct obs_audio_data *eq_filter_audio(void *data, struct obs_audio_data *audio)
 {
-	float l, m, h;
-
-	c->lf_delay0 += eq->lf * (sample - c->lf_delay0) + EQ_EPSILON;
-	c->lf_delay1 += eq->lf * (c->lf_delay0 - c->lf_delay1);
-	c->lf_delay2 += eq->lf * (c->lf_delay1 - c->lf_delay2);
-	c->lf_delay3 += eq->lf * (c->lf_delay2 - c->lf_delay3);
-
-	l = c->lf_delay3;
-
-	c->hf_delay0 += eq->hf * (sample - c->hf_delay0) + EQ_EPSILON;
-	c->hf_delay1 += eq->hf * (c->hf_delay0 - c->hf_delay1);
-	c->hf_delay2 += eq->hf * (c->hf_delay1 - c->hf_delay2);
-	c->hf_delay3 += eq->hf * (c->hf_delay2 - c->hf_delay3);
-
-	h = c->sample_delay3 - c->hf_delay3;
-	m = c->sample_delay3 - (h + l);
+	struct eq_data *eq = data;
+	const uint32_t frames = audio->frames;
+	float *samples[MAX_AUDIO_CHANNELS];
+	float *low[MAX_AUDIO_CHANNELS];
+	float *high[MAX_AUDIO_CHANNELS];
 
-	l *= eq->low_gain;
-	m *= eq->mid_gain;
-	h *= eq->high_gain;
+	if (!frames)
+		return audio;
 
-	c->sample_delay3 = c->sample_delay2;
-	c->sample_delay2 = c->sample_delay1;
-	c->sample_delay1 = sample;
+	if (eq->buf_frames < frames) {
+		eq->buf_frames = frames;
+		eq->buf = brealloc(eq->buf, 2 * eq->channels * frames * sizeof(float));
+	}
 
-	return l + m + h;
-}
+	for (size_t c = 0; c < eq->channels; c++) {
+		samples[c] = (float *)audio->data[c];
+		low[c] = eq->buf + c * frames;
+		high[c] = eq->buf + (eq->channels + c) * frames;
+	}
 
-static struct obs_audio_data *eq_filter_audio(void *data, struct obs_audio_data *audio)
-{
-	struct eq_data *eq = data;
-	const uint32_t frames = audio->frames;
+	biquad_cascade_process(&eq->low, low, (const float *const *)samples, frames);
+	biquad_cascade_process(&eq->high, high, (const float *const *)samples, frames);
+	lookahead_buffer_process(&eq->delay, samples, frames);
 
+	/* With dry as the delayed input, the bands are l = low, h = dry - high
+	 * and m = dry - (h + l), which sums to:
+	 * dry * high_gain + low * (low_gain - mid_gain) + high * (mid_gain - high_gain) */
 	for (size_t c = 0; c < eq->channels; c++) {
-		float *adata = (float *)audio->data[c];
-		struct eq_channel_state *channel = &eq->eqs[c];
+		if (!samples[c])
+			continue;
 
-		for (size_t i = 0; i < frames; i++) {
-			adata[i] = eq_process(eq, channel, adata[i]);
-		}
+		audio_dsp_gain(samples[c], samples[c], eq->high_gain, frames);
+		audio_dsp_mix(samples[c], low[c], eq->low_gain - eq->mid_gain, frames);
+		audio_dsp_mix(samples[c], high[c], eq->mid_gain - eq->high_gain, frames);
 	}
 
 	return audio;
@@ -4,10 +4,13 @@
 
 #include <obs-module.h>
 #include <media-io/audio-math.h>
+#include <media-io/audio-dsp.h>
 #include <util/platform.h>
 #include <util/deque.h>
 #include <util/threading.h>
 
+#include "filter-dsp.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...) \
@@ -87,13 +90,9 @@ struct expander_data {
 	int detector;
 	float runave[MAX_AUDIO_CHANNELS];
 	bool is_gate;
-	float *runaverage[MAX_AUDIO_CHANNELS];
-	size_t runaverage_len;
 	float *gain_db[MAX_AUDIO_CHANNELS];
 	size_t gain_db_len;
 	float gain_db_buf[MAX_AUDIO_CHANNELS];
-	float *env_in;
-	size_t env_in_len;
 	bool is_upwcomp;
 	float knee;
 };
@@ -113,19 +112,6 @@ static void resize_env_buffer(struct expander_data *cd, size_t len)
 		cd->envelope_buf[i] = brealloc(cd->envelope_buf[i], cd->envelope_buf_len * sizeof(float));
 }
 
-static void resize_runaverage_buffer(struct expander_data *cd, size_t len)
-{
-	cd->runaverage_len = len;
-	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++)
-		cd->runaverage[i] = brealloc(cd->runaverage[i], cd->runaverage_len * sizeof(float));
-}
-
-static void resize_env_in_buffer(struct expander_data *cd, size_t len)
-{
-	cd->env_in_len = len;
-	cd->env_in = brealloc(cd->env_in, cd->env_in_len * sizeof(float));
-}
-
 static void resize_gain_db_buffer(struct expander_data *cd, size_t len)
 {
 	cd->gain_db_len = len;
@@ -222,10 +208,6 @@ static void expander_update(void *data, obs_data_t *s)
 	size_t sample_len = sample_rate * DEFAULT_AUDIO_BUF_MS / MS_IN_S;
 	if (cd->envelope_buf_len == 0)
 		resize_env_buffer(cd, sample_len);
-	if (cd->runaverage_len == 0)
-		resize_runaverage_buffer(cd, sample_len);
-	if (cd->env_in_len == 0)
-		resize_env_in_buffer(cd, sample_len);
 	if (cd->gain_db_len == 0)
 		resize_gain_db_buffer(cd, sample_len);
 }
@@ -264,10 +246,8 @@ static void expander_destroy(void *data)
 
 	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 		bfree(cd->envelope_buf[i]);
-		bfree(cd->runaverage[i]);
 		bfree(cd->gain_db[i]);
 	}
-	bfree(cd->env_in);
 	bfree(cd);
 }
 
@@ -276,53 +256,41 @@ static void analyze_envelope(struct expander_data *cd, float **samples, const ui
 {
 	if (cd->envelope_buf_len < num_samples)
 		resize_env_buffer(cd, num_samples);
-	if (cd->runaverage_len < num_samples)
-		resize_runaverage_buffer(cd, num_samples);
-	if (cd->env_in_len < num_samples)
-		resize_env_in_buffer(cd, num_samples);
 
 	// 10 ms RMS window
 	const float rmscoef = exp2f(-100.0f / cd->sample_rate);
 
-	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
-		memset(cd->envelope_buf[i], 0, num_samples * sizeof(cd->envelope_buf[i][0]));
-		memset(cd->runaverage[i], 0, num_samples * sizeof(cd->runaverage[i][0]));
+	if (cd->detector == RMS_DETECT) {
+		envelope_rms(cd->runave, cd->envelope_buf, (const float *const *)samples, cd->num_channels,
+			     num_samples, rmscoef);
 	}
-	memset(cd->env_in, 0, num_samples * sizeof(cd->env_in[0]));
 
 	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
+		float *envelope_buf = cd->envelope_buf[chan];
+
+		if (!samples[chan]) {
+			memset(envelope_buf, 0, num_samples * sizeof(envelope_buf[0]));
 			continue;
+		}
 
-		float *envelope_buf = cd->envelope_buf[chan];
-		float *runave = cd->runaverage[chan];
-		float *env_in = cd->env_in;
-
-		if (cd->detector == RMS_DETECT) {
-			runave[0] = rmscoef * cd->runave[chan] + (1 - rmscoef) * powf(samples[chan][0], 2.0f);
-			env_in[0] = sqrtf(fmaxf(runave[0], 0));
-			for (uint32_t i = 1; i < num_samples; ++i) {
-				runave[i] = rmscoef * runave[i - 1] + (1 - rmscoef) * powf(samples[chan][i], 2.0f);
-				env_in[i] = sqrtf(runave[i]);
-			}
-		} else if (cd->detector == PEAK_DETECT) {
-			for (uint32_t i = 0; i < num_samples; ++i) {
-				runave[i] = powf(samples[chan][i], 2);
-				env_in[i] = fabsf(samples[chan][i]);
-			}
+		if (cd->detector == PEAK_DETECT) {
+			const float last = samples[chan][num_samples - 1];
+			peak_level(envelope_buf, (const float *const *)&samples[chan], 1, num_samples);
+			cd->runave[chan] = last * last;
+		} else if (cd->detector != RMS_DETECT) {
+			memset(envelope_buf, 0, num_samples * sizeof(envelope_buf[0]));
+			cd->runave[chan] = 0.0f;
 		}
 
-		cd->runave[chan] = runave[num_samples - 1];
-		for (uint32_t i = 0; i < num_samples; ++i)
-			envelope_buf[i] = fmaxf(envelope_buf[i], env_in[i]);
-		cd->envelope[chan] = cd->envelope_buf[chan][num_samples - 1];
+		cd->envelope[chan] = envelope_buf[num_samples - 1];
 	}
 }
 
-static inline void process_sample(size_t idx, float *samples, float *env_buf, float *gain_db, bool is_upwcomp,
-				  float channel_gain, float threshold, float slope, float attack_gain,
-				  float inv_attack_gain, float release_gain, float inv_release_gain, float output_gain,
-				  float knee)
+/* Returns the linear gain of frame idx */
+static inline float process_sample(size_t idx, const float *env_buf, float *gain_db, bool is_upwcomp,
+				   float channel_gain, float threshold, float slope, float attack_gain,
+				   float inv_attack_gain, float release_gain, float inv_release_gain, float output_gain,
+				   float knee)
 {
 	/* --------------------------------- */
 	/* gain stage of expansion           */
@@ -370,7 +338,7 @@ static inline void process_sample(size_t idx, float *samples, float *env_buf, fl
 		gain = db_to_mul(gain_db[idx]);
 	}
 
-	samples[idx] *= gain * output_gain;
+	return gain * output_gain;
 }
 
 // gain stage and ballistics in dB domain
@@ -393,16 +361,20 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 		memset(cd->gain_db[i], 0, num_samples * sizeof(cd->gain_db[i][0]));
 
 	for (size_t chan = 0; chan < cd->num_channels; chan++) {
-		float *channel_samples = samples[chan];
 		float *env_buf = cd->envelope_buf[chan];
 		float *gain_db = cd->gain_db[chan];
 		float channel_gain = cd->gain_db_buf[chan];
 
+		/* the envelope is replaced with the gain of every frame */
 		for (size_t i = 0; i < num_samples; ++i) {
-			process_sample(i, channel_samples, env_buf, gain_db, is_upwcomp, channel_gain, threshold, slope,
-				       attack_gain, inv_attack_gain, release_gain, inv_release_gain, output_gain, knee);
+			env_buf[i] = process_sample(i, env_buf, gain_db, is_upwcomp, channel_gain, threshold, slope,
+						    attack_gain, inv_attack_gain, release_gain, inv_release_gain,
+						    output_gain, knee);
 		}
 		cd->gain_db_buf[chan] = gain_db[num_samples - 1];
+
+		if (samples[chan])
+			audio_dsp_gain_env(samples[chan], samples[chan], env_buf, num_samples);
 	}
 }
 
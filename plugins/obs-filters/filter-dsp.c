@@ -0,0 +1,484 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/sse-intrin.h>
+#include <graphics/math-defs.h>
+#include <media-io/audio-dsp.h>
+
+#include "filter-dsp.h"
+
+/* Added to the input of the first stage, so that the state of a lowpass
+ * decaying towards silence never becomes denormal */
+#define DENORMAL_GUARD 1e-20f
+
+/* Frames that are transposed into lanes at a time */
+#define LANE_BLOCK 64
+
+static inline bool use_simd(void)
+{
+	return audio_dsp_get_impl() == AUDIO_DSP_SIMD;
+}
+
+/* ------------------------------------------------------------------------- */
+/* lanes: up to four channels, one per lane of a vector per frame */
+
+static inline bool lane_valid(const float *const ch[], size_t count, size_t lane)
+{
+	return lane < count && ch[lane];
+}
+
+static void load_lanes(__m128 *lanes, const float *const src[], size_t count, uint32_t pos, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 r[4];
+		for (size_t c = 0; c < 4; c++)
+			r[c] = lane_valid(src, count, c) ? _mm_loadu_ps(src[c] + pos + i) : _mm_setzero_ps();
+
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		for (size_t j = 0; j < 4; j++)
+			lanes[i + j] = r[j];
+	}
+
+	for (; i < frames; i++) {
+		float v[4];
+		for (size_t c = 0; c < 4; c++)
+			v[c] = lane_valid(src, count, c) ? src[c][pos + i] : 0.0f;
+		lanes[i] = _mm_loadu_ps(v);
+	}
+}
+
+static void store_lanes(float *const dst[], const float *const src[], size_t count, const __m128 *lanes, uint32_t pos,
+			uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 r[4] = {lanes[i], lanes[i + 1], lanes[i + 2], lanes[i + 3]};
+
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		for (size_t c = 0; c < 4; c++) {
+			if (lane_valid(src, count, c) && dst[c])
+				_mm_storeu_ps(dst[c] + pos + i, r[c]);
+		}
+	}
+
+	for (; i < frames; i++) {
+		float v[4];
+		_mm_storeu_ps(v, lanes[i]);
+		for (size_t c = 0; c < 4; c++) {
+			if (lane_valid(src, count, c) && dst[c])
+				dst[c][pos + i] = v[c];
+		}
+	}
+}
+
+static inline __m128 abs_ps(__m128 v)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+/* ------------------------------------------------------------------------- */
+/* biquads */
+
+void biquad_one_pole_lowpass(struct biquad_coeffs *c, float f)
+{
+	c->b0 = f;
+	c->b1 = 0.0f;
+	c->b2 = 0.0f;
+	c->a1 = f - 1.0f;
+	c->a2 = 0.0f;
+}
+
+static void normalize(struct biquad_coeffs *c, float a0)
+{
+	c->b0 /= a0;
+	c->b1 /= a0;
+	c->b2 /= a0;
+	c->a1 /= a0;
+	c->a2 /= a0;
+}
+
+void biquad_lowpass(struct biquad_coeffs *c, float sample_rate, float freq, float q)
+{
+	const float w0 = 2.0f * M_PI * freq / sample_rate;
+	const float cos_w0 = cosf(w0);
+	const float alpha = sinf(w0) / (2.0f * q);
+
+	c->b0 = (1.0f - cos_w0) / 2.0f;
+	c->b1 = 1.0f - cos_w0;
+	c->b2 = (1.0f - cos_w0) / 2.0f;
+	c->a1 = -2.0f * cos_w0;
+	c->a2 = 1.0f - alpha;
+	normalize(c, 1.0f + alpha);
+}
+
+void biquad_highpass(struct biquad_coeffs *c, float sample_rate, float freq, float q)
+{
+	const float w0 = 2.0f * M_PI * freq / sample_rate;
+	const float cos_w0 = cosf(w0);
+	const float alpha = sinf(w0) / (2.0f * q);
+
+	c->b0 = (1.0f + cos_w0) / 2.0f;
+	c->b1 = -(1.0f + cos_w0);
+	c->b2 = (1.0f + cos_w0) / 2.0f;
+	c->a1 = -2.0f * cos_w0;
+	c->a2 = 1.0f - alpha;
+	normalize(c, 1.0f + alpha);
+}
+
+void biquad_peaking(struct biquad_coeffs *c, float sample_rate, float freq, float q, float gain)
+{
+	const float a = powf(10.0f, gain / 40.0f);
+	const float w0 = 2.0f * M_PI * freq / sample_rate;
+	const float cos_w0 = cosf(w0);
+	const float alpha = sinf(w0) / (2.0f * q);
+
+	c->b0 = 1.0f + alpha * a;
+	c->b1 = -2.0f * cos_w0;
+	c->b2 = 1.0f - alpha * a;
+	c->a1 = -2.0f * cos_w0;
+	c->a2 = 1.0f - alpha / a;
+	normalize(c, 1.0f + alpha / a);
+}
+
+void biquad_cascade_init(struct biquad_cascade *bq, size_t channels, const struct biquad_coeffs *coeffs, size_t stages)
+{
+	memset(bq, 0, sizeof(*bq));
+	bq->channels = channels < MAX_AUDIO_CHANNELS ? channels : MAX_AUDIO_CHANNELS;
+	biquad_cascade_set(bq, coeffs, stages);
+}
+
+void biquad_cascade_set(struct biquad_cascade *bq, const struct biquad_coeffs *coeffs, size_t stages)
+{
+	if (stages > BIQUAD_MAX_STAGES)
+		stages = BIQUAD_MAX_STAGES;
+
+	memcpy(bq->coeffs, coeffs, stages * sizeof(*coeffs));
+	bq->stages = stages;
+}
+
+void biquad_cascade_reset(struct biquad_cascade *bq)
+{
+	memset(bq->z1, 0, sizeof(bq->z1));
+	memset(bq->z2, 0, sizeof(bq->z2));
+}
+
+static void biquad_channel_scalar(struct biquad_cascade *bq, size_t ch, float *dst, const float *src, uint32_t frames)
+{
+	for (size_t s = 0; s < bq->stages; s++) {
+		const struct biquad_coeffs *c = &bq->coeffs[s];
+		const float guard = s == 0 ? DENORMAL_GUARD : 0.0f;
+		float z1 = bq->z1[s][ch];
+		float z2 = bq->z2[s][ch];
+
+		for (uint32_t i = 0; i < frames; i++) {
+			const float x = src[i] + guard;
+			const float y = c->b0 * x + z1;
+			z1 = c->b1 * x - c->a1 * y + z2;
+			z2 = c->b2 * x - c->a2 * y;
+			dst[i] = y;
+		}
+
+		bq->z1[s][ch] = z1;
+		bq->z2[s][ch] = z2;
+		src = dst;
+	}
+}
+
+static void biquad_lanes_simd(struct biquad_cascade *bq, size_t first, float *const dst[], const float *const src[],
+			      uint32_t frames)
+{
+	const size_t count = bq->channels - first;
+	__m128 lanes[LANE_BLOCK];
+
+	for (uint32_t pos = 0; pos < frames; pos += LANE_BLOCK) {
+		const uint32_t n = frames - pos < LANE_BLOCK ? frames - pos : LANE_BLOCK;
+
+		load_lanes(lanes, src + first, count, pos, n);
+
+		for (size_t s = 0; s < bq->stages; s++) {
+			const struct biquad_coeffs *c = &bq->coeffs[s];
+			const __m128 b0 = _mm_set1_ps(c->b0);
+			const __m128 b1 = _mm_set1_ps(c->b1);
+			const __m128 b2 = _mm_set1_ps(c->b2);
+			const __m128 a1 = _mm_set1_ps(c->a1);
+			const __m128 a2 = _mm_set1_ps(c->a2);
+			const __m128 guard = _mm_set1_ps(s == 0 ? DENORMAL_GUARD : 0.0f);
+			__m128 z1 = _mm_loadu_ps(&bq->z1[s][first]);
+			__m128 z2 = _mm_loadu_ps(&bq->z2[s][first]);
+
+			for (uint32_t i = 0; i < n; i++) {
+				const __m128 x = _mm_add_ps(lanes[i], guard);
+				const __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+				z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+				z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+				lanes[i] = y;
+			}
+
+			_mm_storeu_ps(&bq->z1[s][first], z1);
+			_mm_storeu_ps(&bq->z2[s][first], z2);
+		}
+
+		store_lanes(dst + first, src + first, count, lanes, pos, n);
+	}
+}
+
+void biquad_cascade_process(struct biquad_cascade *bq, float *const dst[], const float *const src[], uint32_t frames)
+{
+	if (!bq->stages || !frames)
+		return;
+
+	size_t ch = 0;
+
+	/* a single channel is not worth the transposes */
+	if (use_simd()) {
+		for (; ch + 1 < bq->channels; ch += 4)
+			biquad_lanes_simd(bq, ch, dst, src, frames);
+	}
+
+	for (; ch < bq->channels; ch++) {
+		if (src[ch] && dst[ch])
+			biquad_channel_scalar(bq, ch, dst[ch], src[ch], frames);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* envelopes */
+
+static void envelope_channel_scalar(float *out, const float *in, uint32_t frames, float attack, float release,
+				    float env)
+{
+	for (uint32_t i = 0; i < frames; i++) {
+		const float env_in = fabsf(in[i]);
+		if (env < env_in)
+			env = env_in + attack * (env - env_in);
+		else
+			env = env_in + release * (env - env_in);
+		out[i] = fmaxf(out[i], env);
+	}
+}
+
+static void envelope_lanes_simd(float *out, const float *const in[], size_t count, uint32_t frames, float attack,
+				float release, float start)
+{
+	const __m128 atk = _mm_set1_ps(attack);
+	const __m128 rls = _mm_set1_ps(release);
+	__m128 env = _mm_set1_ps(start);
+	__m128 lanes[LANE_BLOCK];
+	float valid[4];
+
+	/* channels that do not exist must not raise the maximum */
+	for (size_t c = 0; c < 4; c++)
+		valid[c] = lane_valid(in, count, c) ? 1.0f : 0.0f;
+	const __m128 mask = _mm_cmpgt_ps(_mm_loadu_ps(valid), _mm_setzero_ps());
+
+	for (uint32_t pos = 0; pos < frames; pos += LANE_BLOCK) {
+		const uint32_t n = frames - pos < LANE_BLOCK ? frames - pos : LANE_BLOCK;
+		uint32_t i = 0;
+
+		load_lanes(lanes, in, count, pos, n);
+
+		for (i = 0; i < n; i++) {
+			const __m128 x = abs_ps(lanes[i]);
+			const __m128 rising = _mm_cmplt_ps(env, x);
+			const __m128 g = _mm_or_ps(_mm_and_ps(rising, atk), _mm_andnot_ps(rising, rls));
+			env = _mm_add_ps(x, _mm_mul_ps(g, _mm_sub_ps(env, x)));
+			lanes[i] = _mm_and_ps(env, mask);
+		}
+
+		/* largest lane of every frame */
+		for (i = 0; i + 4 <= n; i += 4) {
+			__m128 r0 = lanes[i], r1 = lanes[i + 1], r2 = lanes[i + 2], r3 = lanes[i + 3];
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			__m128 m = _mm_max_ps(_mm_max_ps(r0, r1), _mm_max_ps(r2, r3));
+			float *dst = out + pos + i;
+			_mm_storeu_ps(dst, _mm_max_ps(_mm_loadu_ps(dst), m));
+		}
+
+		for (; i < n; i++) {
+			float v[4];
+			_mm_storeu_ps(v, lanes[i]);
+			out[pos + i] = fmaxf(out[pos + i], fmaxf(fmaxf(v[0], v[1]), fmaxf(v[2], v[3])));
+		}
+	}
+}
+
+float envelope_follow_linked(float *out, const float *const in[], size_t channels, uint32_t frames, float attack,
+			     float release, float start)
+{
+	if (!frames)
+		return start;
+
+	memset(out, 0, frames * sizeof(float));
+
+	if (use_simd()) {
+		for (size_t first = 0; first < channels; first += 4)
+			envelope_lanes_simd(out, in + first, channels - first, frames, attack, release, start);
+	} else {
+		for (size_t ch = 0; ch < channels; ch++) {
+			if (in[ch])
+				envelope_channel_scalar(out, in[ch], frames, attack, release, start);
+		}
+	}
+
+	return out[frames - 1];
+}
+
+static void rms_lanes_simd(float *state, float *const out[], const float *const in[], size_t count, uint32_t frames,
+			   float coef)
+{
+	const __m128 c = _mm_set1_ps(coef);
+	const __m128 inv_c = _mm_set1_ps(1.0f - coef);
+	__m128 lanes[LANE_BLOCK];
+	float ms_out[4];
+	__m128 ms;
+
+	for (size_t i = 0; i < 4; i++)
+		ms_out[i] = lane_valid(in, count, i) ? state[i] : 0.0f;
+	ms = _mm_loadu_ps(ms_out);
+
+	for (uint32_t pos = 0; pos < frames; pos += LANE_BLOCK) {
+		const uint32_t n = frames - pos < LANE_BLOCK ? frames - pos : LANE_BLOCK;
+
+		load_lanes(lanes, in, count, pos, n);
+
+		for (uint32_t i = 0; i < n; i++) {
+			const __m128 x = lanes[i];
+			ms = _mm_add_ps(_mm_mul_ps(c, ms), _mm_mul_ps(inv_c, _mm_mul_ps(x, x)));
+			lanes[i] = _mm_sqrt_ps(ms);
+		}
+
+		store_lanes(out, in, count, lanes, pos, n);
+	}
+
+	_mm_storeu_ps(ms_out, ms);
+	for (size_t i = 0; i < 4; i++) {
+		if (lane_valid(in, count, i))
+			state[i] = ms_out[i];
+	}
+}
+
+void envelope_rms(float *state, float *const out[], const float *const in[], size_t channels, uint32_t frames,
+		  float coef)
+{
+	if (!frames)
+		return;
+
+	if (use_simd()) {
+		for (size_t first = 0; first < channels; first += 4)
+			rms_lanes_simd(state + first, out + first, in + first, channels - first, frames, coef);
+		return;
+	}
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		const float *src = in[ch];
+		float ms = state[ch];
+
+		if (!src)
+			continue;
+
+		for (uint32_t i = 0; i < frames; i++) {
+			ms = coef * ms + (1.0f - coef) * (src[i] * src[i]);
+			out[ch][i] = sqrtf(ms);
+		}
+
+		state[ch] = ms;
+	}
+}
+
+void peak_level(float *out, const float *const in[], size_t channels, uint32_t frames)
+{
+	memset(out, 0, frames * sizeof(float));
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		const float *src = in[ch];
+		uint32_t i = 0;
+
+		if (!src)
+			continue;
+
+		if (use_simd()) {
+			for (; i + 4 <= frames; i += 4) {
+				__m128 level = _mm_max_ps(_mm_loadu_ps(out + i), abs_ps(_mm_loadu_ps(src + i)));
+				_mm_storeu_ps(out + i, level);
+			}
+		}
+
+		for (; i < frames; i++)
+			out[i] = fmaxf(out[i], fabsf(src[i]));
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* lookahead */
+
+void lookahead_buffer_init(struct lookahead_buffer *lb, size_t channels, uint32_t frames)
+{
+	memset(lb, 0, sizeof(*lb));
+	lb->channels = channels < MAX_AUDIO_CHANNELS ? channels : MAX_AUDIO_CHANNELS;
+	lb->frames = frames;
+
+	if (!frames || !lb->channels)
+		return;
+
+	lb->history[0] = bzalloc(lb->channels * frames * sizeof(float));
+	for (size_t ch = 1; ch < lb->channels; ch++)
+		lb->history[ch] = lb->history[ch - 1] + frames;
+	lb->scratch = bmalloc(frames * sizeof(float));
+}
+
+void lookahead_buffer_free(struct lookahead_buffer *lb)
+{
+	bfree(lb->history[0]);
+	bfree(lb->scratch);
+	memset(lb, 0, sizeof(*lb));
+}
+
+void lookahead_buffer_process(struct lookahead_buffer *lb, float *const data[], uint32_t frames)
+{
+	const uint32_t delay = lb->frames;
+
+	if (!delay)
+		return;
+
+	for (size_t ch = 0; ch < lb->channels; ch++) {
+		float *history = lb->history[ch];
+		float *samples = data[ch];
+
+		if (!samples)
+			continue;
+
+		if (frames >= delay) {
+			memcpy(lb->scratch, samples + frames - delay, delay * sizeof(float));
+			memmove(samples + delay, samples, (frames - delay) * sizeof(float));
+			memcpy(samples, history, delay * sizeof(float));
+			memcpy(history, lb->scratch, delay * sizeof(float));
+		} else {
+			memcpy(lb->scratch, samples, frames * sizeof(float));
+			memcpy(samples, history, frames * sizeof(float));
+			memmove(history, history + frames, (delay - frames) * sizeof(float));
+			memcpy(history + delay - frames, lb->scratch, frames * sizeof(float));
+		}
+	}
+}
@@ -0,0 +1,112 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/c99defs.h>
+#include <media-io/audio-io.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * DSP building blocks shared by the audio filters.  The recursive ones
+ * (biquads and envelope followers) run up to four channels at once, one per
+ * SIMD lane.  Like the libobs audio kernels, the scalar versions are used
+ * when audio_dsp_set_impl() selects AUDIO_DSP_SCALAR.
+ *
+ * Channel pointers that are NULL are skipped.
+ */
+
+/* ------------------------------------------------------------------------- */
+/* biquads */
+
+#define BIQUAD_MAX_STAGES 8
+
+/* y = b0 * x + b1 * x[-1] + b2 * x[-2] - a1 * y[-1] - a2 * y[-2] */
+struct biquad_coeffs {
+	float b0, b1, b2;
+	float a1, a2;
+};
+
+/* First order lowpass, y += f * (x - y) */
+extern void biquad_one_pole_lowpass(struct biquad_coeffs *c, float f);
+/* RBJ cookbook filters, gain in dB */
+extern void biquad_lowpass(struct biquad_coeffs *c, float sample_rate, float freq, float q);
+extern void biquad_highpass(struct biquad_coeffs *c, float sample_rate, float freq, float q);
+extern void biquad_peaking(struct biquad_coeffs *c, float sample_rate, float freq, float q, float gain);
+
+/* Stages run in series on every channel, in transposed direct form II */
+struct biquad_cascade {
+	size_t channels;
+	size_t stages;
+	struct biquad_coeffs coeffs[BIQUAD_MAX_STAGES];
+	float z1[BIQUAD_MAX_STAGES][MAX_AUDIO_CHANNELS];
+	float z2[BIQUAD_MAX_STAGES][MAX_AUDIO_CHANNELS];
+};
+
+extern void biquad_cascade_init(struct biquad_cascade *bq, size_t channels, const struct biquad_coeffs *coeffs,
+				size_t stages);
+/* Changes the coefficients but keeps the filter state */
+extern void biquad_cascade_set(struct biquad_cascade *bq, const struct biquad_coeffs *coeffs, size_t stages);
+extern void biquad_cascade_reset(struct biquad_cascade *bq);
+/* dst may be the same as src */
+extern void biquad_cascade_process(struct biquad_cascade *bq, float *const dst[], const float *const src[],
+				   uint32_t frames);
+
+/* ------------------------------------------------------------------------- */
+/* envelopes */
+
+/*
+ * Peak follower over all channels: every channel's envelope starts at
+ * start, and out[i] is the largest of them.  Returns out[frames - 1], which
+ * is the start of the next call.  attack and release are one-pole
+ * coefficients, exp(-1 / (sample_rate * time)).
+ */
+extern float envelope_follow_linked(float *out, const float *const in[], size_t channels, uint32_t frames,
+				    float attack, float release, float start);
+
+/*
+ * RMS of each channel over a one-pole window: ms = coef * ms + (1 - coef) *
+ * x * x, out = sqrt(ms).  state holds ms for every channel between calls.
+ */
+extern void envelope_rms(float *state, float *const out[], const float *const in[], size_t channels,
+			 uint32_t frames, float coef);
+
+/* out[i] is the largest absolute sample of all channels */
+extern void peak_level(float *out, const float *const in[], size_t channels, uint32_t frames);
+
+/* ------------------------------------------------------------------------- */
+/* lookahead */
+
+/* Delays audio by a fixed number of frames */
+struct lookahead_buffer {
+	size_t channels;
+	uint32_t frames;
+	float *history[MAX_AUDIO_CHANNELS];
+	float *scratch;
+};
+
+extern void lookahead_buffer_init(struct lookahead_buffer *lb, size_t channels, uint32_t frames);
+extern void lookahead_buffer_free(struct lookahead_buffer *lb);
+/* Replaces data with the audio from lb->frames frames earlier */
+extern void lookahead_buffer_process(struct lookahead_buffer *lb, float *const data[], uint32_t frames);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,7 +1,10 @@
 #include <media-io/audio-math.h>
+#include <media-io/audio-dsp.h>
 #include <obs-module.h>
 #include <math.h>
 
+#include "filter-dsp.h"
+
 #define do_log(level, format, ...) \
 	blog(level, "[noise gate: '%s'] " format, obs_source_get_name(ng->context), ##__VA_ARGS__)
 
@@ -42,6 +45,10 @@ struct noise_gate_data {
 	float attenuation;
 	float level;
 	float held_time;
+
+	/* level of every frame, then its attenuation */
+	float *level_buf;
+	size_t level_buf_len;
 };
 
 #define VOL_MIN -96.0
@@ -56,6 +63,7 @@ static const char *noise_gate_name(void *unused)
 static void noise_gate_destroy(void *data)
 {
 	struct noise_gate_data *ng = data;
+	bfree(ng->level_buf);
 	bfree(ng);
 }
 
@@ -120,12 +128,18 @@ static struct obs_audio_data *noise_gate_filter_audio(void *data, struct obs_aud
 	const float decay_rate = ng->decay_rate;
 	const float hold_time = ng->hold_time;
 	const size_t channels = ng->channels;
+	const uint32_t frames = audio->frames;
 
-	for (size_t i = 0; i < audio->frames; i++) {
-		float cur_level = fabsf(adata[0][i]);
-		for (size_t j = 0; j < channels; j++) {
-			cur_level = fmaxf(cur_level, fabsf(adata[j][i]));
-		}
+	if (ng->level_buf_len < frames) {
+		ng->level_buf_len = frames;
+		ng->level_buf = brealloc(ng->level_buf, frames * sizeof(float));
+	}
+
+	float *levels = ng->level_buf;
+	peak_level(levels, (const float *const *)adata, channels, frames);
+
+	for (size_t i = 0; i < frames; i++) {
+		const float cur_level = levels[i];
 
 		if (cur_level > open_threshold && !ng->is_open) {
 			ng->is_open = true;
@@ -146,10 +160,12 @@ static struct obs_audio_data *noise_gate_filter_audio(void *data, struct obs_aud
 			}
 		}
 
-		for (size_t c = 0; c < channels; c++)
-			adata[c][i] *= ng->attenuation;
+		levels[i] = ng->attenuation;
 	}
 
+	for (size_t c = 0; c < channels; c++)
+		audio_dsp_gain_env(adata[c], adata[c], levels, frames);
+
 	return audio;
 }
 
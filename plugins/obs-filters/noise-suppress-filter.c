@@ -15,6 +15,7 @@
 #endif
 #include <rnnoise.h>
 #include <media-io/audio-resampler.h>
+#include "denoise-pool.h"
 #endif
 
 bool nvafx_loaded = false;
@@ -47,6 +48,7 @@ bool nvafx_loaded = false;
 #define S_METHOD_NVAFX_DENOISER "denoiser"
 #define S_METHOD_NVAFX_DEREVERB "dereverb"
 #define S_METHOD_NVAFX_DEREVERB_DENOISER "dereverb_denoiser"
+#define S_RNNOISE_SHARED_THREADS "rnnoise_shared_threads"
 
 #define MT_ obs_module_text
 #define TEXT_SUPPRESS_LEVEL MT_("NoiseSuppress.SuppressLevel")
@@ -59,6 +61,7 @@ bool nvafx_loaded = false;
 #define TEXT_METHOD_NVAFX_DEREVERB_DENOISER MT_("NoiseSuppress.Method.Nvafx.DenoiserPlusDereverb")
 #define TEXT_METHOD_NVAFX_DEPRECATION MT_("NoiseSuppress.Method.Nvafx.Deprecation")
 #define TEXT_METHOD_NVAFX_DEPRECATION2 MT_("NoiseSuppress.Method.Nvafx.Deprecation2")
+#define TEXT_RNNOISE_SHARED_THREADS MT_("NoiseSuppress.RNNoise.SharedThreads")
 
 #define MAX_PREPROC_CHANNELS 8
 
@@ -109,6 +112,11 @@ struct noise_suppress_data {
 	/* Resampler */
 	audio_resampler_t *rnn_resampler;
 	audio_resampler_t *rnn_resampler_back;
+
+	/* Shared worker threads, only changed on the audio thread */
+	bool rnn_use_shared_threads;
+	denoise_client_t *rnn_client;
+	bool rnn_in_flight;
 #endif
 	/* PCM buffers */
 	float *copy_buffers[MAX_PREPROC_CHANNELS];
@@ -145,6 +153,10 @@ static void noise_suppress_destroy(void *data)
 {
 	struct noise_suppress_data *ng = data;
 
+#ifdef LIBRNNOISE_ENABLED
+	denoise_client_destroy(ng->rnn_client);
+#endif
+
 	for (size_t i = 0; i < ng->channels; i++) {
 #ifdef LIBSPEEXDSP_ENABLED
 		speex_preprocess_state_destroy(ng->spx_states[i]);
@@ -223,6 +235,9 @@ static void noise_suppress_update(void *data, obs_data_t *s)
 	ng->suppress_level = (int)obs_data_get_int(s, S_SUPPRESS_LEVEL);
 	ng->latency = 1000000000LL / (1000 / BUFFER_SIZE_MSEC);
 	ng->use_rnnoise = strcmp(method, S_METHOD_RNN) == 0;
+#ifdef LIBRNNOISE_ENABLED
+	ng->rnn_use_shared_threads = obs_data_get_bool(s, S_RNNOISE_SHARED_THREADS);
+#endif
 
 	/* Process 10 millisecond segments to keep latency low. */
 	/* Also RNNoise only supports buffers of this exact size. */
@@ -341,10 +356,10 @@ static inline void process_speexdsp(struct noise_suppress_data *ng)
 #endif
 }
 
-static inline void process_rnnoise(struct noise_suppress_data *ng)
-{
 #ifdef LIBRNNOISE_ENABLED
-	/* Adjust signal level to what RNNoise expects, resample if necessary */
+/* copy_buffers -> rnn_segment_buffers, resampled to 48 kHz if necessary */
+static void rnnoise_prepare(struct noise_suppress_data *ng)
+{
 	if (ng->rnn_resampler) {
 		float *output[MAX_PREPROC_CHANNELS];
 		uint32_t out_frames;
@@ -356,26 +371,21 @@ static inline void process_rnnoise(struct noise_suppress_data *ng)
 			for (ssize_t j = 0, k = (ssize_t)out_frames - RNNOISE_FRAME_SIZE; j < RNNOISE_FRAME_SIZE;
 			     ++j, ++k) {
 				if (k >= 0) {
-					ng->rnn_segment_buffers[i][j] = output[i][k] * 32768.0f;
+					ng->rnn_segment_buffers[i][j] = output[i][k];
 				} else {
 					ng->rnn_segment_buffers[i][j] = 0;
 				}
 			}
 		}
 	} else {
-		for (size_t i = 0; i < ng->channels; i++) {
-			for (size_t j = 0; j < RNNOISE_FRAME_SIZE; ++j) {
-				ng->rnn_segment_buffers[i][j] = ng->copy_buffers[i][j] * 32768.0f;
-			}
-		}
-	}
-
-	/* Execute */
-	for (size_t i = 0; i < ng->channels; i++) {
-		rnnoise_process_frame(ng->rnn_states[i], ng->rnn_segment_buffers[i], ng->rnn_segment_buffers[i]);
+		for (size_t i = 0; i < ng->channels; i++)
+			memcpy(ng->rnn_segment_buffers[i], ng->copy_buffers[i], RNNOISE_FRAME_SIZE * sizeof(float));
 	}
+}
 
-	/* Revert signal level adjustment, resample back if necessary */
+/* rnn_segment_buffers -> copy_buffers, resampled back if necessary */
+static void rnnoise_finish(struct noise_suppress_data *ng)
+{
 	if (ng->rnn_resampler) {
 		float *output[MAX_PREPROC_CHANNELS];
 		uint32_t out_frames;
@@ -386,28 +396,68 @@ static inline void process_rnnoise(struct noise_suppress_data *ng)
 		for (size_t i = 0; i < ng->channels; i++) {
 			for (ssize_t j = 0, k = (ssize_t)out_frames - ng->frames; j < (ssize_t)ng->frames; ++j, ++k) {
 				if (k >= 0) {
-					ng->copy_buffers[i][j] = output[i][k] / 32768.0f;
+					ng->copy_buffers[i][j] = output[i][k];
 				} else {
 					ng->copy_buffers[i][j] = 0;
 				}
 			}
 		}
 	} else {
-		for (size_t i = 0; i < ng->channels; i++) {
-			for (size_t j = 0; j < RNNOISE_FRAME_SIZE; ++j) {
-				ng->copy_buffers[i][j] = ng->rnn_segment_buffers[i][j] / 32768.0f;
-			}
-		}
+		for (size_t i = 0; i < ng->channels; i++)
+			memcpy(ng->copy_buffers[i], ng->rnn_segment_buffers[i], RNNOISE_FRAME_SIZE * sizeof(float));
 	}
+}
+#endif
+
+static inline void process_rnnoise(struct noise_suppress_data *ng)
+{
+#ifdef LIBRNNOISE_ENABLED
+	/* at 48 kHz the segment is already an RNNoise frame */
+	if (!ng->rnn_resampler) {
+		denoise_process(ng->rnn_states, ng->copy_buffers, ng->channels);
+		return;
+	}
+
+	rnnoise_prepare(ng);
+	denoise_process(ng->rnn_states, ng->rnn_segment_buffers, ng->channels);
+	rnnoise_finish(ng);
 #else
 	UNUSED_PARAMETER(ng);
 #endif
 }
 
+#ifdef LIBRNNOISE_ENABLED
+/* Hands the segment to the shared workers and collects it along with the next
+ * one, which adds a segment of latency */
+static void process_rnnoise_shared(struct noise_suppress_data *ng)
+{
+	if (ng->rnn_in_flight) {
+		denoise_client_wait(ng->rnn_client);
+		rnnoise_finish(ng);
+
+		for (size_t i = 0; i < ng->channels; i++)
+			deque_push_back(&ng->output_buffers[i], ng->copy_buffers[i], ng->frames * sizeof(float));
+	}
+
+	for (size_t i = 0; i < ng->channels; i++)
+		deque_pop_front(&ng->input_buffers[i], ng->copy_buffers[i], ng->frames * sizeof(float));
+
+	rnnoise_prepare(ng);
+	denoise_client_submit(ng->rnn_client, ng->rnn_states, ng->rnn_segment_buffers, ng->channels);
+	ng->rnn_in_flight = true;
+}
+#endif
+
 static inline void process(struct noise_suppress_data *ng)
 {
 	if (ng->nvafx_enabled)
 		return;
+#ifdef LIBRNNOISE_ENABLED
+	if (ng->use_rnnoise && ng->rnn_client) {
+		process_rnnoise_shared(ng);
+		return;
+	}
+#endif
 	/* Pop from input deque */
 	for (size_t i = 0; i < ng->channels; i++)
 		deque_pop_front(&ng->input_buffers[i], ng->copy_buffers[i], ng->frames * sizeof(float));
@@ -435,6 +485,13 @@ static inline void clear_deque(struct deque *buf)
 
 static void reset_data(struct noise_suppress_data *ng)
 {
+#ifdef LIBRNNOISE_ENABLED
+	if (ng->rnn_in_flight) {
+		denoise_client_wait(ng->rnn_client);
+		ng->rnn_in_flight = false;
+	}
+#endif
+
 	for (size_t i = 0; i < ng->channels; i++) {
 		clear_deque(&ng->input_buffers[i]);
 		clear_deque(&ng->output_buffers[i]);
@@ -443,6 +500,26 @@ static void reset_data(struct noise_suppress_data *ng)
 	clear_deque(&ng->info_buffer);
 }
 
+#ifdef LIBRNNOISE_ENABLED
+static void update_shared_threads(struct noise_suppress_data *ng, bool enable)
+{
+	reset_data(ng);
+
+	if (ng->rnn_client) {
+		denoise_client_destroy(ng->rnn_client);
+		ng->rnn_client = NULL;
+	}
+
+	if (enable) {
+		ng->rnn_client = denoise_client_create();
+		if (!ng->rnn_client) {
+			warn("Failed to start shared RNNoise threads, processing on the audio thread");
+			ng->rnn_use_shared_threads = false;
+		}
+	}
+}
+#endif
+
 static struct obs_audio_data *noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 {
 	struct noise_suppress_data *ng = data;
@@ -471,6 +548,10 @@ static struct obs_audio_data *noise_suppress_filter_audio(void *data, struct obs
 #ifdef LIBRNNOISE_ENABLED
 	if (!ng->rnn_states[0])
 		return audio;
+
+	bool shared_threads = ng->use_rnnoise && ng->rnn_use_shared_threads;
+	if (shared_threads != (ng->rnn_client != NULL))
+		update_shared_threads(ng, shared_threads);
 #endif
 
 	/* -----------------------------------------------
@@ -533,6 +614,7 @@ static bool noise_suppress_method_modified(obs_properties_t *props, obs_property
 {
 	obs_property_t *p_suppress_level = obs_properties_get(props, S_SUPPRESS_LEVEL);
 	obs_property_t *p_navfx_intensity = obs_properties_get(props, S_NVAFX_INTENSITY);
+	obs_property_t *p_shared_threads = obs_properties_get(props, S_RNNOISE_SHARED_THREADS);
 
 	const char *method = obs_data_get_string(settings, S_METHOD);
 	bool enable_level = strcmp(method, S_METHOD_SPEEX) == 0;
@@ -541,6 +623,7 @@ static bool noise_suppress_method_modified(obs_properties_t *props, obs_property
 				strcmp(method, S_METHOD_NVAFX_DEREVERB_DENOISER) == 0;
 	obs_property_set_visible(p_suppress_level, enable_level);
 	obs_property_set_visible(p_navfx_intensity, enable_intensity);
+	obs_property_set_visible(p_shared_threads, strcmp(method, S_METHOD_RNN) == 0);
 
 	UNUSED_PARAMETER(property);
 	return true;
@@ -554,6 +637,9 @@ static void noise_suppress_defaults_v1(obs_data_t *s)
 #else
 	obs_data_set_default_string(s, S_METHOD, S_METHOD_SPEEX);
 #endif
+#if defined(LIBRNNOISE_ENABLED)
+	obs_data_set_default_bool(s, S_RNNOISE_SHARED_THREADS, false);
+#endif
 #if defined(LIBNVAFX_ENABLED)
 	obs_data_set_default_double(s, S_NVAFX_INTENSITY, 1.0);
 #endif
@@ -567,6 +653,9 @@ static void noise_suppress_defaults_v2(obs_data_t *s)
 #else
 	obs_data_set_default_string(s, S_METHOD, S_METHOD_SPEEX);
 #endif
+#if defined(LIBRNNOISE_ENABLED)
+	obs_data_set_default_bool(s, S_RNNOISE_SHARED_THREADS, false);
+#endif
 #if defined(LIBNVAFX_ENABLED)
 	obs_data_set_default_double(s, S_NVAFX_INTENSITY, 1.0);
 #endif
@@ -607,6 +696,10 @@ static obs_properties_t *noise_suppress_properties(void *data)
 	obs_property_int_set_suffix(speex_slider, " dB");
 #endif
 
+#ifdef LIBRNNOISE_ENABLED
+	obs_properties_add_bool(ppts, S_RNNOISE_SHARED_THREADS, TEXT_RNNOISE_SHARED_THREADS);
+#endif
+
 #ifdef LIBNVAFX_ENABLED
 	if (ng->nvafx_enabled) {
 		obs_properties_add_float_slider(ppts, S_NVAFX_INTENSITY, TEXT_NVAFX_INTENSITY, 0.0f, 1.0f, 0.01f);
@@ -61,6 +61,14 @@ RNNOISE_EXPORT void rnnoise_destroy(DenoiseState *st);
 
 RNNOISE_EXPORT float rnnoise_process_frame(DenoiseState *st, float *out, const float *in);
 
+/* Processes one frame for each of count different states, running the
+ * network on several of them at once.  The input is multiplied by scale and
+ * the output divided by it (32768 for samples in [-1, 1]).  out may be the
+ * same as in, vad may be NULL. */
+#define RNNOISE_HAS_PROCESS_FRAMES 1
+RNNOISE_EXPORT void rnnoise_process_frames(DenoiseState *const *st, float *const *out, const float *const *in,
+                                           float *vad, int count, float scale);
+
 RNNOISE_EXPORT RNNModel *rnnoise_model_from_file(FILE *f);
 
 RNNOISE_EXPORT void rnnoise_model_free(RNNModel *model);
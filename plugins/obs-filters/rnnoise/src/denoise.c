@@ -97,6 +97,15 @@ struct DenoiseState {
   float mem_hp_x[2];
   float lastg[NB_BANDS];
   RNNState rnn;
+  /* Analysis of the frame being processed */
+  kiss_fft_cpx X[FREQ_SIZE];
+  kiss_fft_cpx P[WINDOW_SIZE];
+  float Ex[NB_BANDS], Ep[NB_BANDS];
+  float Exp[NB_BANDS];
+  float features[NB_FEATURES];
+  float g[NB_BANDS];
+  float vad_prob;
+  int silence;
 };
 
 void compute_band_energy(float *bandE, const kiss_fft_cpx *X) {
@@ -396,12 +405,12 @@ static int compute_frame_features(DenoiseState *st, kiss_fft_cpx *X, kiss_fft_cp
   return TRAINING && E < 0.1;
 }
 
-static void frame_synthesis(DenoiseState *st, float *out, const kiss_fft_cpx *y) {
+static void frame_synthesis(DenoiseState *st, float *out, const kiss_fft_cpx *y, float out_scale) {
   float x[WINDOW_SIZE];
   int i;
   inverse_transform(x, y);
   apply_window(x);
-  for (i=0;i<FRAME_SIZE;i++) out[i] = x[i] + st->synthesis_mem[i];
+  for (i=0;i<FRAME_SIZE;i++) out[i] = (x[i] + st->synthesis_mem[i])*out_scale;
   RNN_COPY(st->synthesis_mem, &x[FRAME_SIZE], FRAME_SIZE);
 }
 
@@ -453,42 +462,79 @@ void pitch_filter(kiss_fft_cpx *X, const kiss_fft_cpx *P, const float *Ex, const
   }
 }
 
-float rnnoise_process_frame(DenoiseState *st, float *out, const float *in) {
+/* Everything up to the RNN, in_scale is applied to the input first. */
+static void frame_begin(DenoiseState *st, const float *in, float in_scale) {
   int i;
-  kiss_fft_cpx X[FREQ_SIZE];
-  kiss_fft_cpx P[WINDOW_SIZE];
   float x[FRAME_SIZE];
-  float Ex[NB_BANDS], Ep[NB_BANDS];
-  float Exp[NB_BANDS];
-  float features[NB_FEATURES];
-  float g[NB_BANDS];
-  float gf[FREQ_SIZE]={1};
-  float vad_prob = 0;
-  int silence;
   static const float a_hp[2] = {-1.99599f, 0.99600f};
   static const float b_hp[2] = {-2, 1};
-  biquad(x, st->mem_hp_x, in, b_hp, a_hp, FRAME_SIZE);
-  silence = compute_frame_features(st, X, P, Ex, Ep, Exp, features, x);
+  if (in_scale != 1) {
+    for (i=0;i<FRAME_SIZE;i++) x[i] = in[i]*in_scale;
+    biquad(x, st->mem_hp_x, x, b_hp, a_hp, FRAME_SIZE);
+  } else {
+    biquad(x, st->mem_hp_x, in, b_hp, a_hp, FRAME_SIZE);
+  }
+  st->vad_prob = 0;
+  st->silence = compute_frame_features(st, st->X, st->P, st->Ex, st->Ep, st->Exp, st->features, x);
+}
 
-  if (!silence) {
-    compute_rnn(&st->rnn, g, &vad_prob, features);
-    pitch_filter(X, P, Ex, Ep, Exp, g);
+/* Everything after the RNN, which has written st->g and st->vad_prob. */
+static void frame_end(DenoiseState *st, float *out, float out_scale) {
+  int i;
+  float gf[FREQ_SIZE]={1};
+  if (!st->silence) {
+    pitch_filter(st->X, st->P, st->Ex, st->Ep, st->Exp, st->g);
     for (i=0;i<NB_BANDS;i++) {
       float alpha = .6f;
-      g[i] = MAX16(g[i], alpha*st->lastg[i]);
-      st->lastg[i] = g[i];
+      st->g[i] = MAX16(st->g[i], alpha*st->lastg[i]);
+      st->lastg[i] = st->g[i];
     }
-    interp_band_gain(gf, g);
+    interp_band_gain(gf, st->g);
 #if 1
     for (i=0;i<FREQ_SIZE;i++) {
-      X[i].r *= gf[i];
-      X[i].i *= gf[i];
+      st->X[i].r *= gf[i];
+      st->X[i].i *= gf[i];
     }
 #endif
   }
 
-  frame_synthesis(st, out, X);
-  return vad_prob;
+  frame_synthesis(st, out, st->X, out_scale);
+}
+
+float rnnoise_process_frame(DenoiseState *st, float *out, const float *in) {
+  frame_begin(st, in, 1);
+  if (!st->silence)
+    compute_rnn(&st->rnn, st->g, &st->vad_prob, st->features);
+  frame_end(st, out, 1);
+  return st->vad_prob;
+}
+
+void rnnoise_process_frames(DenoiseState *const *st, float *const *out, const float *const *in, float *vad,
+                            int count, float scale) {
+  int i;
+  for (i=0;i<count;i++) frame_begin(st[i], in[i], scale);
+  /* The RNN runs on batches of frames that are not silent and share a model */
+  for (i=0;i<count;) {
+    RNNState *rnn[RNN_MAX_BATCH];
+    float *g[RNN_MAX_BATCH];
+    float *v[RNN_MAX_BATCH];
+    const float *features[RNN_MAX_BATCH];
+    int n = 0;
+    for (;i<count && n<RNN_MAX_BATCH;i++) {
+      if (st[i]->silence) continue;
+      if (n && st[i]->rnn.model != rnn[0]->model) break;
+      rnn[n] = &st[i]->rnn;
+      g[n] = st[i]->g;
+      v[n] = &st[i]->vad_prob;
+      features[n] = st[i]->features;
+      n++;
+    }
+    if (n) compute_rnn_batch(rnn, g, v, features, n);
+  }
+  for (i=0;i<count;i++) {
+    frame_end(st[i], out[i], 1/scale);
+    if (vad) vad[i] = st[i]->vad_prob;
+  }
 }
 
 #if TRAINING
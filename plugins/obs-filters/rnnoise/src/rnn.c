@@ -76,103 +76,189 @@ static OPUS_INLINE float relu(float x)
    return x < 0 ? 0 : x;
 }
 
-static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#include <string.h>
+#define RNN_SSE2
+
+/* Four consecutive 8-bit weights as floats. */
+static OPUS_INLINE __m128 load_weights4(const rnn_weight *w)
 {
-   int i, j;
-   int N, M;
-   int stride;
-   M = layer->nb_inputs;
-   N = layer->nb_neurons;
-   stride = N;
-   for (i=0;i<N;i++)
+   int packed;
+   __m128i x;
+   memcpy(&packed, w, sizeof(packed));
+   x = _mm_cvtsi32_si128(packed);
+   x = _mm_unpacklo_epi8(x, x);
+   x = _mm_unpacklo_epi16(x, x);
+   return _mm_cvtepi32_ps(_mm_srai_epi32(x, 24));
+}
+#endif
+
+/* sums[b][i] += w[j*stride + i]*in[b][j] (*mul[b][j] if mul is given) for
+   every j < M, i < N and b < count.  The weights are read once for the whole
+   batch.  Each neuron adds its terms in the same order as a plain loop over j,
+   so the results do not depend on the batch size or on SSE2. */
+static void accumulate(float *const sums[], const rnn_weight *w, int stride, int N,
+                       const float *const in[], const float *const mul[], int M, int count)
+{
+   int i = 0;
+   int j, b;
+#ifdef RNN_SSE2
+   for (;i+4<=N;i+=4)
    {
-      /* Compute update gate. */
-      float sum = layer->bias[i];
+      __m128 acc[RNN_MAX_BATCH];
+      for (b=0;b<count;b++)
+         acc[b] = _mm_loadu_ps(&sums[b][i]);
       for (j=0;j<M;j++)
-         sum += layer->input_weights[j*stride + i]*input[j];
-      output[i] = WEIGHTS_SCALE*sum;
+      {
+         const __m128 wv = load_weights4(&w[j*stride + i]);
+         for (b=0;b<count;b++)
+         {
+            __m128 t = _mm_mul_ps(wv, _mm_set1_ps(in[b][j]));
+            if (mul)
+               t = _mm_mul_ps(t, _mm_set1_ps(mul[b][j]));
+            acc[b] = _mm_add_ps(acc[b], t);
+         }
+      }
+      for (b=0;b<count;b++)
+         _mm_storeu_ps(&sums[b][i], acc[b]);
    }
-   if (layer->activation == ACTIVATION_SIGMOID) {
-      for (i=0;i<N;i++)
-         output[i] = sigmoid_approx(output[i]);
-   } else if (layer->activation == ACTIVATION_TANH) {
+#endif
+   for (;i<N;i++)
+   {
+      for (b=0;b<count;b++)
+      {
+         float sum = sums[b][i];
+         for (j=0;j<M;j++)
+         {
+            if (mul)
+               sum += w[j*stride + i]*in[b][j]*mul[b][j];
+            else
+               sum += w[j*stride + i]*in[b][j];
+         }
+         sums[b][i] = sum;
+      }
+   }
+}
+
+static OPUS_INLINE float activate(int activation, float x)
+{
+   if (activation == ACTIVATION_SIGMOID) return sigmoid_approx(x);
+   else if (activation == ACTIVATION_TANH) return tansig_approx(x);
+   else if (activation == ACTIVATION_RELU) return relu(x);
+   else *(int*)0=0;
+   return 0;
+}
+
+static void compute_dense(const DenseLayer *layer, float *const output[], const float *const input[], int count)
+{
+   int i, b;
+   int N, M;
+   M = layer->nb_inputs;
+   N = layer->nb_neurons;
+   for (b=0;b<count;b++)
       for (i=0;i<N;i++)
-         output[i] = tansig_approx(output[i]);
-   } else if (layer->activation == ACTIVATION_RELU) {
+         output[b][i] = layer->bias[i];
+   accumulate(output, layer->input_weights, N, N, input, NULL, M, count);
+   for (b=0;b<count;b++)
       for (i=0;i<N;i++)
-         output[i] = relu(output[i]);
-   } else {
-     *(int*)0=0;
-   }
+         output[b][i] = activate(layer->activation, WEIGHTS_SCALE*output[b][i]);
 }
 
-static void compute_gru(const GRULayer *gru, float *state, const float *input)
+static void compute_gru(const GRULayer *gru, float *const state[], const float *const input[], int count)
 {
-   int i, j;
+   int i, b;
    int N, M;
    int stride;
-   float z[MAX_NEURONS];
-   float r[MAX_NEURONS];
-   float h[MAX_NEURONS];
+   float z_buf[RNN_MAX_BATCH][MAX_NEURONS];
+   float r_buf[RNN_MAX_BATCH][MAX_NEURONS];
+   float h_buf[RNN_MAX_BATCH][MAX_NEURONS];
+   float *z[RNN_MAX_BATCH] = {0};
+   float *r[RNN_MAX_BATCH] = {0};
+   float *h[RNN_MAX_BATCH] = {0};
    M = gru->nb_inputs;
    N = gru->nb_neurons;
    stride = 3*N;
-   for (i=0;i<N;i++)
+   for (b=0;b<count;b++)
    {
-      /* Compute update gate. */
-      float sum = gru->bias[i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[j*stride + i]*state[j];
-      z[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
+      z[b] = z_buf[b];
+      r[b] = r_buf[b];
+      h[b] = h_buf[b];
+      for (i=0;i<N;i++)
+      {
+         z[b][i] = gru->bias[i];
+         r[b][i] = gru->bias[N + i];
+         h[b][i] = gru->bias[2*N + i];
+      }
    }
-   for (i=0;i<N;i++)
+   /* Compute update gate. */
+   accumulate(z, gru->input_weights, stride, N, input, NULL, M, count);
+   accumulate(z, gru->recurrent_weights, stride, N, (const float *const *)state, NULL, N, count);
+   /* Compute reset gate. */
+   accumulate(r, gru->input_weights + N, stride, N, input, NULL, M, count);
+   accumulate(r, gru->recurrent_weights + N, stride, N, (const float *const *)state, NULL, N, count);
+   for (b=0;b<count;b++)
    {
-      /* Compute reset gate. */
-      float sum = gru->bias[N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[N + j*stride + i]*state[j];
-      r[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
+      for (i=0;i<N;i++)
+      {
+         z[b][i] = sigmoid_approx(WEIGHTS_SCALE*z[b][i]);
+         r[b][i] = sigmoid_approx(WEIGHTS_SCALE*r[b][i]);
+      }
    }
-   for (i=0;i<N;i++)
+   /* Compute output. */
+   accumulate(h, gru->input_weights + 2*N, stride, N, input, NULL, M, count);
+   accumulate(h, gru->recurrent_weights + 2*N, stride, N, (const float *const *)state,
+              (const float *const *)r, N, count);
+   for (b=0;b<count;b++)
    {
-      /* Compute output. */
-      float sum = gru->bias[2*N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[2*N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[2*N + j*stride + i]*state[j]*r[j];
-      if (gru->activation == ACTIVATION_SIGMOID) sum = sigmoid_approx(WEIGHTS_SCALE*sum);
-      else if (gru->activation == ACTIVATION_TANH) sum = tansig_approx(WEIGHTS_SCALE*sum);
-      else if (gru->activation == ACTIVATION_RELU) sum = relu(WEIGHTS_SCALE*sum);
-      else *(int*)0=0;
-      h[i] = z[i]*state[i] + (1-z[i])*sum;
+      for (i=0;i<N;i++)
+      {
+         float sum = activate(gru->activation, WEIGHTS_SCALE*h[b][i]);
+         h[b][i] = z[b][i]*state[b][i] + (1-z[b][i])*sum;
+      }
+      for (i=0;i<N;i++)
+         state[b][i] = h[b][i];
    }
-   for (i=0;i<N;i++)
-      state[i] = h[i];
 }
 
 #define INPUT_SIZE 42
 
+void compute_rnn_batch(RNNState *const rnn[], float *const gains[], float *const vad[],
+                       const float *const input[], int count) {
+  int i, b;
+  const RNNModel *model = rnn[0]->model;
+  float dense_out[RNN_MAX_BATCH][MAX_NEURONS];
+  float noise_input[RNN_MAX_BATCH][MAX_NEURONS*3];
+  float denoise_input[RNN_MAX_BATCH][MAX_NEURONS*3];
+  float *dense[RNN_MAX_BATCH] = {0}, *noise[RNN_MAX_BATCH] = {0}, *denoise[RNN_MAX_BATCH] = {0};
+  float *vad_state[RNN_MAX_BATCH] = {0}, *noise_state[RNN_MAX_BATCH] = {0}, *denoise_state[RNN_MAX_BATCH] = {0};
+  for (b=0;b<count;b++) {
+    dense[b] = dense_out[b];
+    noise[b] = noise_input[b];
+    denoise[b] = denoise_input[b];
+    vad_state[b] = rnn[b]->vad_gru_state;
+    noise_state[b] = rnn[b]->noise_gru_state;
+    denoise_state[b] = rnn[b]->denoise_gru_state;
+  }
+  compute_dense(model->input_dense, dense, input, count);
+  compute_gru(model->vad_gru, vad_state, (const float *const *)dense, count);
+  compute_dense(model->vad_output, vad, (const float *const *)vad_state, count);
+  for (b=0;b<count;b++) {
+    for (i=0;i<model->input_dense_size;i++) noise[b][i] = dense[b][i];
+    for (i=0;i<model->vad_gru_size;i++) noise[b][i+model->input_dense_size] = vad_state[b][i];
+    for (i=0;i<INPUT_SIZE;i++) noise[b][i+model->input_dense_size+model->vad_gru_size] = input[b][i];
+  }
+  compute_gru(model->noise_gru, noise_state, (const float *const *)noise, count);
+
+  for (b=0;b<count;b++) {
+    for (i=0;i<model->vad_gru_size;i++) denoise[b][i] = vad_state[b][i];
+    for (i=0;i<model->noise_gru_size;i++) denoise[b][i+model->vad_gru_size] = noise_state[b][i];
+    for (i=0;i<INPUT_SIZE;i++) denoise[b][i+model->vad_gru_size+model->noise_gru_size] = input[b][i];
+  }
+  compute_gru(model->denoise_gru, denoise_state, (const float *const *)denoise, count);
+  compute_dense(model->denoise_output, gains, (const float *const *)denoise_state, count);
+}
+
 void compute_rnn(RNNState *rnn, float *gains, float *vad, const float *input) {
-  int i;
-  float dense_out[MAX_NEURONS];
-  float noise_input[MAX_NEURONS*3];
-  float denoise_input[MAX_NEURONS*3];
-  compute_dense(rnn->model->input_dense, dense_out, input);
-  compute_gru(rnn->model->vad_gru, rnn->vad_gru_state, dense_out);
-  compute_dense(rnn->model->vad_output, vad, rnn->vad_gru_state);
-  for (i=0;i<rnn->model->input_dense_size;i++) noise_input[i] = dense_out[i];
-  for (i=0;i<rnn->model->vad_gru_size;i++) noise_input[i+rnn->model->input_dense_size] = rnn->vad_gru_state[i];
-  for (i=0;i<INPUT_SIZE;i++) noise_input[i+rnn->model->input_dense_size+rnn->model->vad_gru_size] = input[i];
-  compute_gru(rnn->model->noise_gru, rnn->noise_gru_state, noise_input);
-
-  for (i=0;i<rnn->model->vad_gru_size;i++) denoise_input[i] = rnn->vad_gru_state[i];
-  for (i=0;i<rnn->model->noise_gru_size;i++) denoise_input[i+rnn->model->vad_gru_size] = rnn->noise_gru_state[i];
-  for (i=0;i<INPUT_SIZE;i++) denoise_input[i+rnn->model->vad_gru_size+rnn->model->noise_gru_size] = input[i];
-  compute_gru(rnn->model->denoise_gru, rnn->denoise_gru_state, denoise_input);
-  compute_dense(rnn->model->denoise_output, gains, rnn->denoise_gru_state);
+  compute_rnn_batch(&rnn, &gains, &vad, &input, 1);
 }
@@ -35,6 +35,9 @@
 
 #define MAX_NEURONS 128
 
+/* Most frames compute_rnn_batch() takes at once */
+#define RNN_MAX_BATCH 8
+
 #define ACTIVATION_TANH    0
 #define ACTIVATION_SIGMOID 1
 #define ACTIVATION_RELU    2
@@ -62,4 +65,8 @@ typedef struct RNNState RNNState;
 
 void compute_rnn(RNNState *rnn, float *gains, float *vad, const float *input);
 
+/* compute_rnn() for up to RNN_MAX_BATCH different states of the same model */
+void compute_rnn_batch(RNNState *const rnn[], float *const gains[], float *const vad[],
+                       const float *const input[], int count);
+
 #endif /* _MLP_H_ */
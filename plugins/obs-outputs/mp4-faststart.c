@@ -0,0 +1,317 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "mp4-mux.h"
+
+#include <inttypes.h>
+
+#include <util/platform.h>
+#include <util/dstr.h>
+#include <util/bmem.h>
+#include <util/threading.h>
+
+/*
+ * "faststart" pass for finalised hybrid MP4 files: copies the file into a new
+ * one with the moov box placed in front of mdat, shifting all chunk offsets
+ * (stco/co64) by the size of the moov box. The finalised file is left as-is
+ * if anything fails or the rewrite is cancelled, since it is already valid
+ * with moov at the end.
+ */
+
+#define do_log(level, format, ...) blog(level, "[mp4 faststart: '%s'] " format, path, ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define COPY_BUF_SIZE (1024 * 1024)
+
+struct box {
+	int64_t offset;
+	uint64_t size;
+	uint32_t header_size;
+	char type[4];
+};
+
+struct faststart {
+	FILE *in;
+	FILE *out;
+	uint8_t *buf;
+	uint64_t shift;
+	volatile bool *cancel;
+};
+
+static inline uint32_t rb32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t rb64(const uint8_t *p)
+{
+	return ((uint64_t)rb32(p) << 32) | rb32(p + 4);
+}
+
+static inline void wb32(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)(val >> 24);
+	p[1] = (uint8_t)(val >> 16);
+	p[2] = (uint8_t)(val >> 8);
+	p[3] = (uint8_t)val;
+}
+
+static inline void wb64(uint8_t *p, uint64_t val)
+{
+	wb32(p, (uint32_t)(val >> 32));
+	wb32(p + 4, (uint32_t)val);
+}
+
+static bool read_box(FILE *f, int64_t offset, int64_t end, struct box *box)
+{
+	uint8_t hdr[16];
+
+	if (end - offset < 8)
+		return false;
+	if (os_fseeki64(f, offset, SEEK_SET) != 0 || fread(hdr, 1, 8, f) != 8)
+		return false;
+
+	box->offset = offset;
+	box->size = rb32(hdr);
+	box->header_size = 8;
+	memcpy(box->type, hdr + 4, 4);
+
+	if (box->size == 1) {
+		if (fread(hdr + 8, 1, 8, f) != 8)
+			return false;
+		box->size = rb64(hdr + 8);
+		box->header_size = 16;
+	} else if (box->size == 0) {
+		box->size = (uint64_t)(end - offset);
+	}
+
+	return box->size >= box->header_size && (int64_t)box->size <= end - offset;
+}
+
+static inline bool box_is(const struct box *box, const char *type)
+{
+	return memcmp(box->type, type, 4) == 0;
+}
+
+static bool copy_range(struct faststart *fs, int64_t offset, uint64_t size)
+{
+	if (os_fseeki64(fs->in, offset, SEEK_SET) != 0)
+		return false;
+
+	while (size) {
+		size_t chunk = size > COPY_BUF_SIZE ? COPY_BUF_SIZE : (size_t)size;
+
+		if (fs->cancel && os_atomic_load_bool(fs->cancel))
+			return false;
+
+		if (fread(fs->buf, 1, chunk, fs->in) != chunk)
+			return false;
+		if (fwrite(fs->buf, 1, chunk, fs->out) != chunk)
+			return false;
+
+		size -= chunk;
+	}
+
+	return true;
+}
+
+/* Copies stco/co64 with every chunk offset shifted. */
+static bool copy_chunk_offsets(struct faststart *fs, const struct box *box, bool co64)
+{
+	const size_t entry_size = co64 ? 8 : 4;
+	const size_t max_entries = COPY_BUF_SIZE / 8;
+	uint8_t hdr[8];
+
+	if (!copy_range(fs, box->offset, box->header_size))
+		return false;
+
+	/* version + flags, entry_count */
+	if (fread(hdr, 1, 8, fs->in) != 8 || fwrite(hdr, 1, 8, fs->out) != 8)
+		return false;
+
+	uint32_t remaining = rb32(hdr + 4);
+
+	while (remaining) {
+		size_t count = remaining > max_entries ? max_entries : remaining;
+
+		if (fread(fs->buf, entry_size, count, fs->in) != count)
+			return false;
+
+		for (size_t i = 0; i < count; i++) {
+			uint8_t *p = fs->buf + i * entry_size;
+
+			if (co64) {
+				wb64(p, rb64(p) + fs->shift);
+			} else {
+				uint64_t offset = (uint64_t)rb32(p) + fs->shift;
+				/* Would need co64, which changes the moov size */
+				if (offset > UINT32_MAX)
+					return false;
+				wb32(p, (uint32_t)offset);
+			}
+		}
+
+		if (fwrite(fs->buf, entry_size, count, fs->out) != count)
+			return false;
+
+		remaining -= (uint32_t)count;
+	}
+
+	return true;
+}
+
+static bool copy_moov_box(struct faststart *fs, const struct box *box)
+{
+	if (box_is(box, "stco"))
+		return copy_chunk_offsets(fs, box, false);
+	if (box_is(box, "co64"))
+		return copy_chunk_offsets(fs, box, true);
+
+	bool container = box_is(box, "moov") || box_is(box, "trak") || box_is(box, "mdia") || box_is(box, "minf") ||
+			 box_is(box, "stbl");
+
+	if (!container)
+		return copy_range(fs, box->offset, box->size);
+
+	/* Box sizes do not change, so headers can be copied verbatim. */
+	if (!copy_range(fs, box->offset, box->header_size))
+		return false;
+
+	int64_t end = box->offset + (int64_t)box->size;
+	int64_t offset = box->offset + box->header_size;
+
+	while (offset < end) {
+		struct box child;
+
+		if (!read_box(fs->in, offset, end, &child))
+			return false;
+		if (!copy_moov_box(fs, &child))
+			return false;
+
+		offset += (int64_t)child.size;
+	}
+
+	return true;
+}
+
+static bool rewrite_file(struct faststart *fs, const char *path, int64_t file_size)
+{
+	struct box moov = {0};
+	int64_t offset = 0;
+	int64_t mdat_offset = -1;
+
+	/* Find top-level moov and first mdat */
+	while (offset < file_size) {
+		struct box box;
+
+		if (!read_box(fs->in, offset, file_size, &box)) {
+			warn("Invalid box at offset %" PRId64, offset);
+			return false;
+		}
+
+		if (box_is(&box, "moov"))
+			moov = box;
+		else if (box_is(&box, "mdat") && mdat_offset < 0)
+			mdat_offset = box.offset;
+
+		offset += (int64_t)box.size;
+	}
+
+	if (!moov.size || mdat_offset < 0) {
+		warn("File has no moov or mdat box");
+		return false;
+	}
+
+	if (moov.offset < mdat_offset) {
+		info("moov already precedes mdat, nothing to do");
+		return false;
+	}
+
+	fs->shift = moov.size;
+
+	/* Everything before mdat (ftyp), then moov, then the rest except the
+	 * old moov. */
+	offset = 0;
+	while (offset < file_size) {
+		struct box box;
+		read_box(fs->in, offset, file_size, &box);
+
+		if (box.offset == mdat_offset && !copy_moov_box(fs, &moov))
+			return false;
+		if (box.offset != moov.offset && !copy_range(fs, box.offset, box.size))
+			return false;
+
+		offset += (int64_t)box.size;
+	}
+
+	return true;
+}
+
+bool mp4_faststart(const char *path, volatile bool *cancel)
+{
+	struct faststart fs = {0};
+	struct dstr tmp_path = {0};
+	bool created = false;
+	bool success = false;
+	uint64_t start_time = os_gettime_ns();
+
+	fs.in = os_fopen(path, "rb");
+	if (!fs.in) {
+		warn("Unable to open file for reading");
+		return false;
+	}
+
+	dstr_printf(&tmp_path, "%s.faststart", path);
+	fs.out = os_fopen(tmp_path.array, "wb");
+	if (!fs.out) {
+		warn("Unable to open temporary file '%s'", tmp_path.array);
+		goto fail;
+	}
+
+	created = true;
+	fs.cancel = cancel;
+	fs.buf = bmalloc(COPY_BUF_SIZE);
+	success = rewrite_file(&fs, path, os_fgetsize(fs.in));
+
+	if (fclose(fs.out) != 0)
+		success = false;
+	fs.out = NULL;
+
+fail:
+	fclose(fs.in);
+	bfree(fs.buf);
+
+	/* os_rename replaces the original, which is left untouched if it
+	 * fails */
+	if (success) {
+		success = os_rename(tmp_path.array, path) == 0;
+		if (!success)
+			warn("Failed to rename '%s', keeping the original file", tmp_path.array);
+	}
+	if (!success && created)
+		os_unlink(tmp_path.array);
+
+	if (!success && cancel && os_atomic_load_bool(cancel))
+		info("Faststart rewrite cancelled, keeping the original file");
+	else if (success)
+		info("Faststart rewrite took %" PRIu64 " ms", (os_gettime_ns() - start_time) / 1000000);
+
+	dstr_free(&tmp_path);
+	return success;
+}
@@ -80,6 +80,19 @@ struct fragment_sample {
 	uint32_t duration;
 };
 
+/* Range of sample table entries written to the index file */
+struct index_extent {
+	int64_t offset;
+	size_t num;
+};
+
+/* Sample table entries that have been checkpointed to the index file and
+ * dropped from memory. The in-memory DARRAY only holds the remaining tail. */
+struct index_spill {
+	size_t num;
+	DARRAY(struct index_extent) extents;
+};
+
 struct mp4_track {
 	enum mp4_track_type type;
 	enum mp4_codec codec;
@@ -111,17 +124,22 @@ struct mp4_track {
 	/* Sample sizes (fixed for PCM) */
 	uint32_t sample_size;
 	DARRAY(uint32_t) sample_sizes;
+	struct index_spill sample_sizes_spill;
 	/* Data chunks in file containing samples for this track */
 	DARRAY(struct chunk) chunks;
+	struct index_spill chunks_spill;
 	/* Time delta between samples */
 	DARRAY(struct sample_delta) deltas;
+	struct index_spill deltas_spill;
 
 	/* Sample CT-DT offset, i.e. DTS-PTS offset (Video only) */
 	bool needs_ctts;
 	int32_t dts_offset;
 	DARRAY(struct sample_offset) offsets;
+	struct index_spill offsets_spill;
 	/* Sync samples, i.e. keyframes (Video only) */
 	DARRAY(uint32_t) sync_samples;
+	struct index_spill sync_samples_spill;
 
 	/* Temporary array with information about the samples to be included
 	 * in the next fragment. */
@@ -148,6 +166,11 @@ struct mp4_mux {
 	/* Offset of placeholder atom/box to contain final mdat header */
 	size_t placeholder_offset;
 
+	/* Index file that sample tables are checkpointed to after each
+	 * fragment, keeps memory usage bounded for long recordings. */
+	FILE *index_file;
+	char *index_path;
+
 	uint8_t track_ctr;
 	/* Audio/Video tracks */
 	DARRAY(struct mp4_track) tracks;
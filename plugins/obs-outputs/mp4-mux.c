@@ -78,6 +78,129 @@ static inline void write_fullbox(struct serializer *s, const size_t size, const
 	s_wb24(s, flags);
 }
 
+/* ========================================================================== */
+/* Sample table index checkpoints                                             */
+
+/* Checkpoint a table once its in-memory tail grows beyond this many entries */
+#define INDEX_CHECKPOINT_ENTRIES 4096
+/* Number of entries read back from the index file at once */
+#define INDEX_READ_ENTRIES 4096
+
+typedef bool (*index_entry_cb)(struct mp4_mux *mux, const void *entry, void *param);
+
+#define table_count(track, name) ((track)->name##_spill.num + (track)->name.num)
+
+#define table_checkpoint(mux, track, name) \
+	index_checkpoint(mux, &(track)->name##_spill, (track)->name.array, &(track)->name.num, sizeof(*(track)->name.array))
+
+#define table_for_each(mux, track, name, cb, param)                                                      \
+	index_for_each(mux, &(track)->name##_spill, (track)->name.array, (track)->name.num, \
+		       sizeof(*(track)->name.array), cb, param)
+
+static void index_checkpoint(struct mp4_mux *mux, struct index_spill *spill, void *array, size_t *num,
+			     size_t elem_size)
+{
+	if (*num <= INDEX_CHECKPOINT_ENTRIES)
+		return;
+
+	/* Keep the last entry in memory, run-length encoded tables may still
+	 * need to increment its counter. */
+	size_t count = *num - 1;
+
+	os_fseeki64(mux->index_file, 0, SEEK_END);
+	int64_t offset = os_ftelli64(mux->index_file);
+
+	if (fwrite(array, elem_size, count, mux->index_file) != count) {
+		warn("Failed to write sample table checkpoint, keeping entries in memory");
+		return;
+	}
+
+	struct index_extent *ext = da_push_back_new(spill->extents);
+	ext->offset = offset;
+	ext->num = count;
+	spill->num += count;
+
+	memmove(array, (uint8_t *)array + count * elem_size, elem_size);
+	*num = 1;
+}
+
+static void index_for_each(struct mp4_mux *mux, struct index_spill *spill, const void *array, size_t num,
+			   size_t elem_size, index_entry_cb cb, void *param)
+{
+	const uint8_t *mem = array;
+	uint8_t *buf = NULL;
+
+	if (spill->num)
+		buf = bmalloc(elem_size * INDEX_READ_ENTRIES);
+
+	for (size_t i = 0; i < spill->extents.num; i++) {
+		struct index_extent *ext = &spill->extents.array[i];
+		size_t remaining = ext->num;
+
+		os_fseeki64(mux->index_file, ext->offset, SEEK_SET);
+
+		while (remaining) {
+			size_t count = min(remaining, INDEX_READ_ENTRIES);
+
+			if (fread(buf, elem_size, count, mux->index_file) != count) {
+				warn("Failed to read sample table checkpoint");
+				goto done;
+			}
+
+			for (size_t idx = 0; idx < count; idx++) {
+				if (!cb(mux, buf + idx * elem_size, param))
+					goto done;
+			}
+
+			remaining -= count;
+		}
+	}
+
+	for (size_t idx = 0; idx < num; idx++) {
+		if (!cb(mux, mem + idx * elem_size, param))
+			break;
+	}
+
+done:
+	bfree(buf);
+}
+
+struct first_entry {
+	void *dst;
+	size_t size;
+};
+
+static bool copy_first_entry(struct mp4_mux *mux, const void *entry, void *param)
+{
+	struct first_entry *first = param;
+	memcpy(first->dst, entry, first->size);
+
+	UNUSED_PARAMETER(mux);
+	return false;
+}
+
+/* Reads the first entry of a table, which may already be checkpointed. */
+#define table_first(mux, track, name, dst)                                         \
+	do {                                                                      \
+		struct first_entry first = {(dst), sizeof(*(track)->name.array)}; \
+		table_for_each(mux, track, name, copy_first_entry, &first);       \
+	} while (false)
+
+static void mp4_checkpoint_tables(struct mp4_mux *mux)
+{
+	for (size_t i = 0; i < mux->tracks.num; i++) {
+		struct mp4_track *track = &mux->tracks.array[i];
+
+		table_checkpoint(mux, track, sample_sizes);
+		table_checkpoint(mux, track, chunks);
+		table_checkpoint(mux, track, deltas);
+		table_checkpoint(mux, track, offsets);
+		table_checkpoint(mux, track, sync_samples);
+	}
+
+	fflush(mux->index_file);
+}
+
 /// 4.3 File Type Box
 static size_t mp4_write_ftyp(struct mp4_mux *mux, bool fragmented)
 {
@@ -1101,6 +1224,18 @@ static size_t mp4_write_stsd(struct mp4_mux *mux, struct mp4_track *track)
 	return write_box_size(s, start);
 }
 
+static bool write_stts_entry(struct mp4_mux *mux, const void *entry, void *param)
+{
+	const struct sample_delta *smp = entry;
+	struct mp4_track *track = param;
+
+	uint64_t delta = util_mul_div64(smp->delta, track->timescale, track->timebase_den);
+
+	s_wb32(mux->serializer, smp->count);      // sample_count
+	s_wb32(mux->serializer, (uint32_t)delta); // sample_delta
+	return true;
+}
+
 /// 8.6.1.2 Decoding Time to Sample Box
 static size_t mp4_write_stts(struct mp4_mux *mux, struct mp4_track *track, bool fragmented)
 {
@@ -1113,30 +1248,30 @@ static size_t mp4_write_stts(struct mp4_mux *mux, struct mp4_track *track, bool
 	}
 
 	int64_t start = serializer_get_pos(s);
-	struct sample_delta *arr = track->deltas.array;
-	size_t num = track->deltas.num;
+	size_t num = table_count(track, deltas);
 
 	write_fullbox(s, 0, "stts", 0, 0);
 
 	s_wb32(s, (uint32_t)num); // entry_count
 
-	for (size_t idx = 0; idx < num; idx++) {
-		struct sample_delta *smp = &arr[idx];
+	table_for_each(mux, track, deltas, write_stts_entry, track);
 
-		uint64_t delta = util_mul_div64(smp->delta, track->timescale, track->timebase_den);
+	return write_box_size(s, start);
+}
 
-		s_wb32(s, smp->count);      // sample_count
-		s_wb32(s, (uint32_t)delta); // sample_delta
-	}
+static bool write_u32_entry(struct mp4_mux *mux, const void *entry, void *param)
+{
+	s_wb32(mux->serializer, *(const uint32_t *)entry);
 
-	return write_box_size(s, start);
+	UNUSED_PARAMETER(param);
+	return true;
 }
 
 /// 8.6.2 Sync Sample Box
 static size_t mp4_write_stss(struct mp4_mux *mux, struct mp4_track *track)
 {
 	struct serializer *s = mux->serializer;
-	uint32_t num = (uint32_t)track->sync_samples.num;
+	uint32_t num = (uint32_t)table_count(track, sync_samples);
 
 	if (!num)
 		return 0;
@@ -1147,17 +1282,28 @@ static size_t mp4_write_stss(struct mp4_mux *mux, struct mp4_track *track)
 	write_fullbox(s, size, "stss", 0, 0);
 	s_wb32(s, num); // entry_count
 
-	for (size_t idx = 0; idx < num; idx++)
-		s_wb32(s, track->sync_samples.array[idx]); // sample_number
+	table_for_each(mux, track, sync_samples, write_u32_entry, NULL); // sample_number
 
 	return size;
 }
 
+static bool write_ctts_entry(struct mp4_mux *mux, const void *entry, void *param)
+{
+	const struct sample_offset *smp = entry;
+	struct mp4_track *track = param;
+
+	int64_t offset = (int64_t)smp->offset * (int64_t)track->timescale / (int64_t)track->timebase_den;
+
+	s_wb32(mux->serializer, smp->count);       // sample_count
+	s_wb32(mux->serializer, (uint32_t)offset); // sample_offset
+	return true;
+}
+
 /// 8.6.1.3 Composition Time to Sample Box
 static size_t mp4_write_ctts(struct mp4_mux *mux, struct mp4_track *track)
 {
 	struct serializer *s = mux->serializer;
-	uint32_t num = (uint32_t)track->offsets.num;
+	uint32_t num = (uint32_t)table_count(track, offsets);
 
 	uint8_t version = mux->flags & MP4_USE_NEGATIVE_CTS ? 1 : 0;
 
@@ -1167,15 +1313,34 @@ static size_t mp4_write_ctts(struct mp4_mux *mux, struct mp4_track *track)
 
 	s_wb32(s, num); // entry_count
 
-	for (size_t idx = 0; idx < num; idx++) {
-		int64_t offset = (int64_t)track->offsets.array[idx].offset * (int64_t)track->timescale /
-				 (int64_t)track->timebase_den;
+	table_for_each(mux, track, offsets, write_ctts_entry, track);
+
+	return size;
+}
+
+struct chunk_runs {
+	uint32_t idx;
+	uint32_t samples;
+	uint32_t entries;
+};
+
+static bool write_stsc_entry(struct mp4_mux *mux, const void *entry, void *param)
+{
+	const struct chunk *chk = entry;
+	struct chunk_runs *runs = param;
+
+	runs->idx++; // ISO-BMFF is 1-indexed
 
-		s_wb32(s, track->offsets.array[idx].count); // sample_count
-		s_wb32(s, (uint32_t)offset);                // sample_offset
+	if (!runs->entries || runs->samples != chk->samples) {
+		s_wb32(mux->serializer, runs->idx);    // first_chunk
+		s_wb32(mux->serializer, chk->samples); // samples_per_chunk
+		s_wb32(mux->serializer, 1);            // sample_description_index
+
+		runs->samples = chk->samples;
+		runs->entries++;
 	}
 
-	return size;
+	return true;
 }
 
 /// 8.7.4 Sample To Chunk Box
@@ -1189,45 +1354,23 @@ static size_t mp4_write_stsc(struct mp4_mux *mux, struct mp4_track *track, bool
 		return 16;
 	}
 
-	struct chunk *arr = track->chunks.array;
-	size_t arr_num = track->chunks.num;
-
-	/* Compress into array with counter for repeating chunk sizes */
-	DARRAY(struct chunk_run {
-		uint32_t first;
-		uint32_t samples;
-	}) chunk_runs;
-
-	da_init(chunk_runs);
-
-	for (size_t idx = 0; idx < arr_num; idx++) {
-		struct chunk *chk = &arr[idx];
-
-		if (!chunk_runs.num || chunk_runs.array[chunk_runs.num - 1].samples != chk->samples) {
-			struct chunk_run *cr = da_push_back_new(chunk_runs);
-			cr->samples = chk->samples;
-			cr->first = (uint32_t)idx + 1; // ISO-BMFF is 1-indexed
-		}
-	}
-
-	uint32_t num = (uint32_t)chunk_runs.num;
+	int64_t start = serializer_get_pos(s);
+	struct chunk_runs runs = {0};
 
-	/* 16 byte FullBox header + 12-bytes (u32+u32+u32) per chunk run */
-	uint32_t size = 16 + 12 * num;
-	write_fullbox(s, size, "stsc", 0, 0);
+	write_fullbox(s, 0, "stsc", 0, 0);
 
-	s_wb32(s, num); // entry_count
+	s_wb32(s, 0); // entry_count (placeholder)
 
-	for (size_t idx = 0; idx < num; idx++) {
-		struct chunk_run *cr = &chunk_runs.array[idx];
-		s_wb32(s, cr->first);   // first_chunk
-		s_wb32(s, cr->samples); // samples_per_chunk
-		s_wb32(s, 1);           // sample_description_index
-	}
+	/* Compress into runs of chunks with the same number of samples, these
+	 * are written out as they are found, entry_count is patched after. */
+	table_for_each(mux, track, chunks, write_stsc_entry, &runs);
 
-	da_free(chunk_runs);
+	int64_t end = serializer_get_pos(s);
+	serializer_seek(s, start + 12, SERIALIZE_SEEK_START);
+	s_wb32(s, runs.entries); // entry_count
+	serializer_seek(s, end, SERIALIZE_SEEK_START);
 
-	return size;
+	return write_box_size(s, start);
 }
 
 /// 8.7.3 Sample Size Boxes
@@ -1261,17 +1404,31 @@ static size_t mp4_write_stsz(struct mp4_mux *mux, struct mp4_track *track, bool
 		s_wb32(s, track->sample_size);       // sample_size
 		s_wb32(s, (uint32_t)track->samples); // sample_count
 	} else {
-		s_wb32(s, 0);                                 // sample_size
-		s_wb32(s, (uint32_t)track->sample_sizes.num); // sample_count
+		s_wb32(s, 0);                                              // sample_size
+		s_wb32(s, (uint32_t)table_count(track, sample_sizes)); // sample_count
 
-		for (size_t idx = 0; idx < track->sample_sizes.num; idx++) {
-			s_wb32(s, track->sample_sizes.array[idx]); // entry_size
-		}
+		table_for_each(mux, track, sample_sizes, write_u32_entry, NULL); // entry_size
 	}
 
 	return write_box_size(s, start);
 }
 
+static bool write_stco_entry(struct mp4_mux *mux, const void *entry, void *param)
+{
+	s_wb32(mux->serializer, (uint32_t)((const struct chunk *)entry)->offset);
+
+	UNUSED_PARAMETER(param);
+	return true;
+}
+
+static bool write_co64_entry(struct mp4_mux *mux, const void *entry, void *param)
+{
+	s_wb64(mux->serializer, ((const struct chunk *)entry)->offset);
+
+	UNUSED_PARAMETER(param);
+	return true;
+}
+
 /// 8.7.5 Chunk Offset Box
 static size_t mp4_write_stco(struct mp4_mux *mux, struct mp4_track *track, bool fragmented)
 {
@@ -1283,10 +1440,10 @@ static size_t mp4_write_stco(struct mp4_mux *mux, struct mp4_track *track, bool
 		return 16;
 	}
 
-	struct chunk *arr = track->chunks.array;
-	uint32_t num = (uint32_t)track->chunks.num;
+	uint32_t num = (uint32_t)table_count(track, chunks);
 
-	uint64_t last_off = arr[num - 1].offset;
+	/* The last chunk is never checkpointed, so always in memory. */
+	uint64_t last_off = track->chunks.array[track->chunks.num - 1].offset;
 	uint32_t size;
 	bool co64 = last_off > UINT32_MAX;
 
@@ -1302,12 +1459,7 @@ static size_t mp4_write_stco(struct mp4_mux *mux, struct mp4_track *track, bool
 
 	s_wb32(s, num); // entry_count
 
-	for (size_t idx = 0; idx < num; idx++) {
-		if (co64)
-			s_wb64(s, arr[idx].offset); // chunk_offset
-		else
-			s_wb32(s, (uint32_t)arr[idx].offset); // chunk_offset
-	}
+	table_for_each(mux, track, chunks, co64 ? write_co64_entry : write_stco_entry, NULL); // chunk_offset
 
 	return size;
 }
@@ -1350,6 +1502,25 @@ static size_t mp4_write_sbgp_aac(struct mp4_mux *mux, struct mp4_track *track)
 	return write_box_size(s, start);
 }
 
+struct opus_preroll {
+	int64_t remaining;
+	uint16_t count;
+};
+
+static bool count_preroll_samples(struct mp4_mux *mux, const void *entry, void *param)
+{
+	const struct sample_delta *smp = entry;
+	struct opus_preroll *preroll = param;
+
+	for (uint32_t j = 0; j < smp->count && preroll->remaining > 0; j++) {
+		preroll->remaining -= smp->delta;
+		preroll->count++;
+	}
+
+	UNUSED_PARAMETER(mux);
+	return preroll->remaining > 0;
+}
+
 static size_t mp4_write_sbgp_sbgp_opus(struct mp4_mux *mux, struct mp4_track *track)
 {
 	struct serializer *s = mux->serializer;
@@ -1365,15 +1536,9 @@ static size_t mp4_write_sbgp_sbgp_opus(struct mp4_mux *mux, struct mp4_track *tr
 	const int64_t opus_preroll = 3840;
 
 	/* Compute the preroll samples (should be 4, each being 20 ms) */
-	uint16_t preroll_count = 0;
-	int64_t preroll_remaining = opus_preroll;
-
-	for (size_t i = 0; i < track->deltas.num && preroll_remaining > 0; i++) {
-		for (uint32_t j = 0; j < track->deltas.array[i].count && preroll_remaining > 0; j++) {
-			preroll_remaining -= track->deltas.array[i].delta;
-			preroll_count++;
-		}
-	}
+	struct opus_preroll preroll = {opus_preroll, 0};
+	table_for_each(mux, track, deltas, count_preroll_samples, &preroll);
+	uint16_t preroll_count = preroll.count;
 
 	s_wb32(s, 1); // entry_count
 	/// 10.1 AudioRollRecoveryEntry
@@ -1596,8 +1761,9 @@ static size_t mp4_write_elst(struct mp4_mux *mux, struct mp4_track *track)
 		 * using b-frames). */
 		int64_t dts_offset = 0;
 
-		if (track->offsets.num) {
-			struct sample_offset sample = track->offsets.array[0];
+		if (table_count(track, offsets)) {
+			struct sample_offset sample;
+			table_first(mux, track, offsets, &sample);
 			dts_offset = sample.offset;
 		} else if (track->packets.size) {
 			/* If no offset data exists yet (i.e. when writing the
@@ -1669,7 +1835,7 @@ static size_t mp4_write_trak(struct mp4_mux *mux, struct mp4_track *track, bool
 	int64_t start = serializer_get_pos(s);
 
 	/* If track has no data, omit it from full moov. */
-	if (!fragmented && !track->chunks.num)
+	if (!fragmented && !table_count(track, chunks))
 		return 0;
 
 	write_box(s, 0, "trak");
@@ -2265,7 +2431,7 @@ static void process_packets(struct mp4_mux *mux, struct mp4_track *track, uint64
 
 		/* When using negative CTS, subtract DTS-PTS offset. */
 		if (track->type == TRACK_VIDEO && mux->flags & MP4_USE_NEGATIVE_CTS) {
-			if (!track->offsets.num)
+			if (!table_count(track, offsets))
 				track->dts_offset = offset;
 
 			offset -= track->dts_offset;
@@ -2439,6 +2605,9 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 	if (!mux->next_frag_pts && mux->chapter_track)
 		write_packets(mux, mux->chapter_track);
 
+	if (mux->index_file)
+		mp4_checkpoint_tables(mux);
+
 	mux->next_frag_pts = 0;
 }
 
@@ -2577,6 +2746,12 @@ static inline void free_track(struct mp4_track *track)
 	da_free(track->deltas);
 	da_free(track->offsets);
 	da_free(track->sync_samples);
+
+	da_free(track->sample_sizes_spill.extents);
+	da_free(track->chunks_spill.extents);
+	da_free(track->deltas_spill.extents);
+	da_free(track->offsets_spill.extents);
+	da_free(track->sync_samples_spill.extents);
 	da_free(track->fragment_samples);
 }
 
@@ -2618,9 +2793,31 @@ void mp4_mux_destroy(struct mp4_mux *mux)
 	free_track(mux->chapter_track);
 	bfree(mux->chapter_track);
 	da_free(mux->tracks);
+
+	if (mux->index_file) {
+		fclose(mux->index_file);
+		os_unlink(mux->index_path);
+	}
+
+	bfree(mux->index_path);
 	bfree(mux);
 }
 
+bool mp4_mux_set_index_file(struct mp4_mux *mux, const char *path)
+{
+	if (mux->index_file)
+		return false;
+
+	mux->index_file = os_fopen(path, "w+b");
+	if (!mux->index_file) {
+		warn("Unable to open index file '%s', sample tables will be kept in memory", path);
+		return false;
+	}
+
+	mux->index_path = bstrdup(path);
+	return true;
+}
+
 bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt)
 {
 	struct mp4_track *track = NULL;
@@ -2715,20 +2912,27 @@ bool mp4_mux_finalise(struct mp4_mux *mux)
 	/* ---------------------------------------- */
 	/* Write full moov box                      */
 
-	/* Use array serializer for moov data as this will do a lot
-	 * of seeks to write size values of variable-size boxes. */
-	struct serializer fs;
-	struct array_output_data ao;
-	array_output_serializer_init(&fs, &ao);
+	if (mux->index_file) {
+		/* Sample tables are streamed back from the index file, write
+		 * moov directly rather than buffering all of it in memory. */
+		size_t moov_size = mp4_write_moov(mux, false);
+		info("Full moov size: %zu KiB", moov_size / 1024);
+	} else {
+		/* Use array serializer for moov data as this will do a lot
+		 * of seeks to write size values of variable-size boxes. */
+		struct serializer fs;
+		struct array_output_data ao;
+		array_output_serializer_init(&fs, &ao);
 
-	mux->serializer = &fs;
+		mux->serializer = &fs;
 
-	mp4_write_moov(mux, false);
-	s_write(s, ao.bytes.array, ao.bytes.num);
-	info("Full moov size: %zu KiB", ao.bytes.num / 1024);
+		mp4_write_moov(mux, false);
+		s_write(s, ao.bytes.array, ao.bytes.num);
+		info("Full moov size: %zu KiB", ao.bytes.num / 1024);
 
-	mux->serializer = s; // restore real serializer
-	array_output_serializer_free(&ao);
+		mux->serializer = s; // restore real serializer
+		array_output_serializer_free(&ao);
+	}
 
 	/* ---------------------------------------- */
 	/* Overwrite file header (ftyp + free/moov) */
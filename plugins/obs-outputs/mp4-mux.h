@@ -31,6 +31,8 @@ enum mp4_mux_flags {
 	MP4_SKIP_FINALISATION = 1 << 2,
 	/* Use negative CTS instead of edit lists */
 	MP4_USE_NEGATIVE_CTS = 1 << 3,
+	/* Move moov in front of mdat after finalisation (see mp4_faststart) */
+	MP4_FASTSTART = 1 << 4,
 };
 
 struct mp4_mux *mp4_mux_create(obs_output_t *output, struct serializer *serializer, enum mp4_mux_flags flags);
@@ -38,3 +40,10 @@ void mp4_mux_destroy(struct mp4_mux *mux);
 bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt);
 bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name);
 bool mp4_mux_finalise(struct mp4_mux *mux);
+/* Checkpoint sample tables to an index file instead of keeping them in memory
+ * for the whole recording. The file is deleted when the muxer is destroyed. */
+bool mp4_mux_set_index_file(struct mp4_mux *mux, const char *path);
+
+/* Rewrite a finalised MP4 file so that moov precedes mdat (streaming copy).
+ * Setting *cancel (may be NULL) aborts the copy and keeps the original. */
+bool mp4_faststart(const char *path, volatile bool *cancel);
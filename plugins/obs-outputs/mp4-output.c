@@ -23,6 +23,7 @@
 #include <util/platform.h>
 #include <util/dstr.h>
 #include <util/threading.h>
+#include <util/task.h>
 #include <util/buffered-file-serializer.h>
 
 #include <opts-parser.h>
@@ -38,6 +39,17 @@ struct chapter {
 	char *name;
 };
 
+/* Faststart rewrites of finished files, shared by all outputs so that
+ * destroying an output doesn't wait for them */
+static pthread_mutex_t faststart_mutex = PTHREAD_MUTEX_INITIALIZER;
+static os_task_queue_t *faststart_queue;
+static volatile bool faststart_cancel;
+
+struct faststart_task {
+	obs_weak_output_t *output;
+	char *path;
+};
+
 struct mp4_output {
 	obs_output_t *output;
 	struct dstr path;
@@ -55,6 +67,7 @@ struct mp4_output {
 
 	struct mp4_mux *muxer;
 	int flags;
+	bool direct_io;
 
 	int64_t last_dts_usec;
 	DARRAY(struct chapter) chapters;
@@ -187,6 +200,29 @@ static void split_file_proc(void *data, calldata_t *cd)
 	os_atomic_set_bool(&out->manual_split, true);
 }
 
+static void get_write_stats_proc(void *data, calldata_t *cd)
+{
+	struct mp4_output *out = data;
+	struct buffered_file_serializer_stats stats = {0};
+
+	/* Files are only opened and closed with the mutex held */
+	pthread_mutex_lock(&out->mutex);
+	bool success = os_atomic_load_bool(&out->active) &&
+		       buffered_file_serializer_get_stats(&out->serializer, &stats);
+	pthread_mutex_unlock(&out->mutex);
+
+	double seconds = (double)stats.duration_ns / 1000000000.0;
+	double throughput = seconds > 0.0 ? (double)stats.bytes_written / 1048576.0 / seconds : 0.0;
+	double avg_latency = stats.writes ? (double)stats.total_latency_ns / (double)stats.writes / 1000000.0 : 0.0;
+
+	calldata_set_bool(cd, "active", success);
+	calldata_set_bool(cd, "direct_io", stats.direct_io);
+	calldata_set_int(cd, "bytes_written", (long long)stats.bytes_written);
+	calldata_set_float(cd, "throughput_mib", throughput);
+	calldata_set_float(cd, "avg_latency_ms", avg_latency);
+	calldata_set_float(cd, "max_latency_ms", (double)stats.max_latency_ns / 1000000.0);
+}
+
 static void *mp4_output_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct mp4_output *out = bzalloc(sizeof(struct mp4_output));
@@ -195,10 +231,15 @@ static void *mp4_output_create(obs_data_t *settings, obs_output_t *output)
 
 	signal_handler_t *sh = obs_output_get_signal_handler(output);
 	signal_handler_add(sh, "void file_changed(string next_file)");
+	signal_handler_add(sh, "void faststart_complete(string path, bool success)");
 
 	proc_handler_t *ph = obs_output_get_proc_handler(output);
 	proc_handler_add(ph, "void split_file(out bool split_file_enabled)", split_file_proc, out);
 	proc_handler_add(ph, "void add_chapter(string chapter_name)", mp4_add_chapter_proc, out);
+	proc_handler_add(ph,
+			 "void get_write_stats(out bool active, out bool direct_io, out int bytes_written, "
+			 "out float throughput_mib, out float avg_latency_ms, out float max_latency_ms)",
+			 get_write_stats_proc, out);
 
 	UNUSED_PARAMETER(settings);
 	return out;
@@ -212,7 +253,7 @@ static inline void apply_flag(int *flags, const char *value, int flag_value)
 		*flags &= ~flag_value;
 }
 
-static int parse_custom_options(const char *opts_str)
+static int parse_custom_options(const char *opts_str, bool *direct_io)
 {
 	int flags = MP4_USE_NEGATIVE_CTS;
 
@@ -229,6 +270,10 @@ static int parse_custom_options(const char *opts_str)
 			apply_flag(&flags, opt.value, MP4_USE_MDTA_KEY_VALUE);
 		} else if (strcmp(opt.name, "use_negative_cts") == 0) {
 			apply_flag(&flags, opt.value, MP4_USE_NEGATIVE_CTS);
+		} else if (strcmp(opt.name, "faststart") == 0) {
+			apply_flag(&flags, opt.value, MP4_FASTSTART);
+		} else if (strcmp(opt.name, "direct_io") == 0) {
+			*direct_io = atoi(opt.value) != 0;
 		} else {
 			blog(LOG_WARNING, "Unknown muxer option: %s = %s", opt.name, opt.value);
 		}
@@ -239,6 +284,82 @@ static int parse_custom_options(const char *opts_str)
 	return flags;
 }
 
+static bool open_file(struct mp4_output *out)
+{
+	uint32_t flags = out->direct_io ? BUFFERED_FILE_DIRECT_IO : 0;
+
+	if (!buffered_file_serializer_init_ex(&out->serializer, out->path.array, 0, 0, flags)) {
+		warn("Unable to open MP4 file '%s'", out->path.array);
+		return false;
+	}
+
+	return true;
+}
+
+static void create_muxer(struct mp4_output *out)
+{
+	out->muxer = mp4_mux_create(out->output, &out->serializer, out->flags);
+
+	/* In faststart mode the file is rewritten at the end anyway, so keep
+	 * sample tables in an index file next to it rather than in memory. */
+	if (out->flags & MP4_FASTSTART) {
+		struct dstr index_path = {0};
+		dstr_printf(&index_path, "%s.index", out->path.array);
+		mp4_mux_set_index_file(out->muxer, index_path.array);
+		dstr_free(&index_path);
+	}
+}
+
+static void faststart_task(void *param)
+{
+	struct faststart_task *task = param;
+	bool success = mp4_faststart(task->path, &faststart_cancel);
+
+	/* the file is only final now, tell whoever still listens */
+	obs_output_t *output = obs_weak_output_get_output(task->output);
+	if (output) {
+		calldata_t cd = {0};
+		calldata_set_string(&cd, "path", task->path);
+		calldata_set_bool(&cd, "success", success);
+		signal_handler_signal(obs_output_get_signal_handler(output), "faststart_complete", &cd);
+		calldata_free(&cd);
+		obs_output_release(output);
+	}
+
+	obs_weak_output_release(task->output);
+	bfree(task->path);
+	bfree(task);
+}
+
+static void queue_faststart(struct mp4_output *out)
+{
+	if (!(out->flags & MP4_FASTSTART) || (out->flags & MP4_SKIP_FINALISATION))
+		return;
+
+	struct faststart_task *task = bzalloc(sizeof(*task));
+	task->output = obs_output_get_weak_output(out->output);
+	task->path = bstrdup(out->path.array);
+
+	pthread_mutex_lock(&faststart_mutex);
+	if (!faststart_queue)
+		faststart_queue = os_task_queue_create();
+	os_task_queue_queue_task(faststart_queue, faststart_task, task);
+	pthread_mutex_unlock(&faststart_mutex);
+}
+
+/* Called on module unload, cancels pending rewrites (the files are already
+ * valid without them) */
+void mp4_output_free_faststart(void)
+{
+	pthread_mutex_lock(&faststart_mutex);
+	if (faststart_queue) {
+		os_atomic_set_bool(&faststart_cancel, true);
+		os_task_queue_destroy(faststart_queue);
+		faststart_queue = NULL;
+	}
+	pthread_mutex_unlock(&faststart_mutex);
+}
+
 static bool mp4_output_start(void *data)
 {
 	struct mp4_output *out = data;
@@ -263,17 +384,16 @@ static bool mp4_output_start(void *data)
 
 	/* Allow skipping the remux step for debugging purposes. */
 	const char *muxer_settings = obs_data_get_string(settings, "muxer_settings");
-	out->flags = parse_custom_options(muxer_settings);
+	out->direct_io = false;
+	out->flags = parse_custom_options(muxer_settings, &out->direct_io);
 
 	obs_data_release(settings);
 
-	if (!buffered_file_serializer_init_defaults(&out->serializer, out->path.array)) {
-		warn("Unable to open MP4 file '%s'", out->path.array);
+	if (!open_file(out))
 		return false;
-	}
 
 	/* Initialise muxer and start capture */
-	out->muxer = mp4_mux_create(out->output, &out->serializer, out->flags);
+	create_muxer(out);
 	os_atomic_set_bool(&out->active, true);
 	obs_output_begin_data_capture(out->output, 0);
 
@@ -379,6 +499,7 @@ static bool change_file(struct mp4_output *out, struct encoder_packet *pkt)
 	/* flush/close file and destroy old muxer */
 	buffered_file_serializer_free(&out->serializer);
 	mp4_mux_destroy(out->muxer);
+	queue_faststart(out);
 
 	for (size_t i = 0; i < out->chapters.num; i++)
 		bfree(out->chapters.array[i].name);
@@ -391,12 +512,10 @@ static bool change_file(struct mp4_output *out, struct encoder_packet *pkt)
 	generate_filename(out, &out->path, out->allow_overwrite);
 	info("Changing output file to '%s'", out->path.array);
 
-	if (!buffered_file_serializer_init_defaults(&out->serializer, out->path.array)) {
-		warn("Unable to open MP4 file '%s'", out->path.array);
+	if (!open_file(out))
 		return false;
-	}
 
-	out->muxer = mp4_mux_create(out->output, &out->serializer, out->flags);
+	create_muxer(out);
 
 	calldata_t cd = {0};
 	signal_handler_t *sh = obs_output_get_signal_handler(out->output);
@@ -449,6 +568,7 @@ static void mp4_output_actual_stop(struct mp4_output *out, int code)
 	buffered_file_serializer_free(&out->serializer);
 	obs_queue_task(OBS_TASK_DESTROY, mp4_mux_destroy_task, out->muxer, false);
 	out->muxer = NULL;
+	queue_faststart(out);
 
 	/* Clear chapter data */
 	for (size_t i = 0; i < out->chapters.num; i++)
@@ -0,0 +1,1094 @@
+/******************************************************************************
+    Copyright (C) 2024 by OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * RTMP fan-out output: muxes every encoder packet into FLV once and shares
+ * the resulting (refcounted) bytes between any number of destinations.  Each
+ * destination has its own RTMP connection, send queue, send thread, frame
+ * drop thresholds and reconnect policy.
+ */
+
+#include <obs-module.h>
+#include <obs-avc.h>
+#include <obs-hevc.h>
+#include <util/platform.h>
+#include <util/deque.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include <inttypes.h>
+#include "librtmp/rtmp.h"
+#include "librtmp/log.h"
+#include "flv-mux.h"
+#include "net-if.h"
+#include "rtmp-av1.h"
+#include "rtmp-hevc.h"
+
+#define do_log(level, format, ...) \
+	blog(level, "[rtmp fanout: '%s'] " format, obs_output_get_name(fo->output), ##__VA_ARGS__)
+#define dest_log(level, format, ...)                                                                      \
+	blog(level, "[rtmp fanout: '%s' #%zu] " format, obs_output_get_name(dest->fo->output), dest->idx, \
+	     ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define OPT_DESTINATIONS "destinations"
+#define OPT_SERVER "server"
+#define OPT_KEY "key"
+#define OPT_USERNAME "username"
+#define OPT_PASSWORD "password"
+#define OPT_BIND_IP "bind_ip"
+#define OPT_DROP_THRESHOLD "drop_threshold_ms"
+#define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
+#define OPT_MAX_RETRIES "max_retries"
+#define OPT_RETRY_DELAY "retry_delay_sec"
+#define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
+
+/* ------------------------------------------------------------------------- */
+/* shared muxed data                                                         */
+
+struct fanout_data {
+	volatile long refs;
+
+	enum obs_encoder_type type;
+	bool keyframe;
+	int drop_priority;
+	int64_t dts_usec;
+	int64_t sys_dts_usec;
+
+	uint8_t *data;
+	size_t size;
+};
+
+static struct fanout_data *fanout_data_create(uint8_t *data, size_t size)
+{
+	struct fanout_data *fd = bzalloc(sizeof(struct fanout_data));
+	fd->refs = 1;
+	fd->data = data;
+	fd->size = size;
+	return fd;
+}
+
+static inline struct fanout_data *fanout_data_addref(struct fanout_data *fd)
+{
+	os_atomic_inc_long(&fd->refs);
+	return fd;
+}
+
+static inline void fanout_data_release(struct fanout_data *fd)
+{
+	if (fd && os_atomic_dec_long(&fd->refs) == 0) {
+		bfree(fd->data);
+		bfree(fd);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* destinations                                                              */
+
+struct rtmp_fanout;
+
+struct rtmp_dest {
+	struct rtmp_fanout *fo;
+	size_t idx;
+
+	RTMP rtmp;
+	struct dstr path, key;
+	struct dstr username, password;
+	struct dstr bind_ip;
+	struct dstr encoder_name;
+
+	pthread_t thread;
+	bool thread_created;
+	os_sem_t *send_sem;
+
+	pthread_mutex_t packets_mutex;
+	struct deque packets;
+	volatile bool connected;
+	bool wait_keyframe;
+	bool sent_headers;
+
+	/* frame drop policy */
+	int64_t drop_threshold_usec;
+	int64_t pframe_drop_threshold_usec;
+	int64_t last_dts_usec;
+	int min_priority;
+	float congestion;
+
+	/* reconnect policy */
+	int max_retries;
+	int retry_delay_sec;
+
+	/* stats */
+	uint64_t total_bytes_sent;
+	int dropped_frames;
+	int reconnects;
+};
+
+struct rtmp_fanout {
+	obs_output_t *output;
+
+	DARRAY(struct rtmp_dest *) dests;
+	volatile long threads_running;
+
+	pthread_mutex_t mutex;
+	bool began_capture;
+
+	os_event_t *stop_event;
+	uint64_t stop_ts;
+	uint64_t shutdown_timeout_ts;
+	int max_shutdown_time_sec;
+
+	volatile bool active;
+	volatile bool encode_error;
+
+	bool got_first_packet;
+	int32_t start_dts_offset;
+
+	enum audio_id_t audio_codec[MAX_OUTPUT_AUDIO_ENCODERS];
+	enum video_id_t video_codec[MAX_OUTPUT_VIDEO_ENCODERS];
+
+	/* FLV metadata and sequence headers, built once on the first packet
+	 * and replayed by every destination on (re)connect */
+	pthread_mutex_t headers_mutex;
+	DARRAY(struct fanout_data *) headers;
+};
+
+static inline bool stopping(struct rtmp_fanout *fo)
+{
+	return os_event_try(fo->stop_event) != EAGAIN;
+}
+
+static inline bool active(struct rtmp_fanout *fo)
+{
+	return os_atomic_load_bool(&fo->active);
+}
+
+static inline size_t num_buffered_packets(struct rtmp_dest *dest)
+{
+	return dest->packets.size / sizeof(struct fanout_data *);
+}
+
+static void free_packets(struct rtmp_dest *dest)
+{
+	pthread_mutex_lock(&dest->packets_mutex);
+	while (dest->packets.size) {
+		struct fanout_data *fd;
+		deque_pop_front(&dest->packets, &fd, sizeof(fd));
+		fanout_data_release(fd);
+	}
+	pthread_mutex_unlock(&dest->packets_mutex);
+}
+
+static void free_headers(struct rtmp_fanout *fo)
+{
+	pthread_mutex_lock(&fo->headers_mutex);
+	for (size_t i = 0; i < fo->headers.num; i++)
+		fanout_data_release(fo->headers.array[i]);
+	da_free(fo->headers);
+	pthread_mutex_unlock(&fo->headers_mutex);
+}
+
+static void dest_destroy(struct rtmp_dest *dest)
+{
+	RTMP_TLS_Free(&dest->rtmp);
+	free_packets(dest);
+	deque_free(&dest->packets);
+	pthread_mutex_destroy(&dest->packets_mutex);
+	os_sem_destroy(dest->send_sem);
+	dstr_free(&dest->path);
+	dstr_free(&dest->key);
+	dstr_free(&dest->username);
+	dstr_free(&dest->password);
+	dstr_free(&dest->bind_ip);
+	dstr_free(&dest->encoder_name);
+	bfree(dest);
+}
+
+static void join_dests(struct rtmp_fanout *fo)
+{
+	for (size_t i = 0; i < fo->dests.num; i++) {
+		struct rtmp_dest *dest = fo->dests.array[i];
+		if (dest->thread_created) {
+			pthread_join(dest->thread, NULL);
+			dest->thread_created = false;
+		}
+	}
+}
+
+static void free_dests(struct rtmp_fanout *fo)
+{
+	join_dests(fo);
+
+	for (size_t i = 0; i < fo->dests.num; i++)
+		dest_destroy(fo->dests.array[i]);
+	da_free(fo->dests);
+}
+
+static struct rtmp_dest *dest_create(struct rtmp_fanout *fo, obs_data_t *settings, size_t idx)
+{
+	struct rtmp_dest *dest = bzalloc(sizeof(struct rtmp_dest));
+	int64_t drop_b, drop_p;
+
+	dest->fo = fo;
+	dest->idx = idx;
+
+	if (pthread_mutex_init(&dest->packets_mutex, NULL) != 0) {
+		bfree(dest);
+		return NULL;
+	}
+	if (os_sem_init(&dest->send_sem, 0) != 0) {
+		pthread_mutex_destroy(&dest->packets_mutex);
+		bfree(dest);
+		return NULL;
+	}
+
+	obs_data_set_default_int(settings, OPT_DROP_THRESHOLD, 700);
+	obs_data_set_default_int(settings, OPT_PFRAME_DROP_THRESHOLD, 900);
+	obs_data_set_default_int(settings, OPT_MAX_RETRIES, 25);
+	obs_data_set_default_int(settings, OPT_RETRY_DELAY, 2);
+	obs_data_set_default_string(settings, OPT_BIND_IP, "default");
+
+	dstr_copy(&dest->path, obs_data_get_string(settings, OPT_SERVER));
+	dstr_copy(&dest->key, obs_data_get_string(settings, OPT_KEY));
+	dstr_copy(&dest->username, obs_data_get_string(settings, OPT_USERNAME));
+	dstr_copy(&dest->password, obs_data_get_string(settings, OPT_PASSWORD));
+	dstr_copy(&dest->bind_ip, obs_data_get_string(settings, OPT_BIND_IP));
+	dstr_depad(&dest->path);
+	dstr_depad(&dest->key);
+
+	drop_b = (int64_t)obs_data_get_int(settings, OPT_DROP_THRESHOLD);
+	drop_p = (int64_t)obs_data_get_int(settings, OPT_PFRAME_DROP_THRESHOLD);
+	if (drop_p < (drop_b + 200))
+		drop_p = drop_b + 200;
+
+	dest->drop_threshold_usec = 1000 * drop_b;
+	dest->pframe_drop_threshold_usec = 1000 * drop_p;
+	dest->max_retries = (int)obs_data_get_int(settings, OPT_MAX_RETRIES);
+	dest->retry_delay_sec = (int)obs_data_get_int(settings, OPT_RETRY_DELAY);
+	return dest;
+}
+
+/* ------------------------------------------------------------------------- */
+/* sending                                                                   */
+
+static inline void set_rtmp_dstr(AVal *val, struct dstr *str)
+{
+	bool valid = !dstr_is_empty(str);
+	val->av_val = valid ? str->array : NULL;
+	val->av_len = valid ? (int)str->len : 0;
+}
+
+static int dest_connect(struct rtmp_dest *dest)
+{
+	RTMP *rtmp = &dest->rtmp;
+
+	if (dstr_is_empty(&dest->path)) {
+		dest_log(LOG_WARNING, "URL is empty");
+		return OBS_OUTPUT_BAD_PATH;
+	}
+
+	dest_log(LOG_INFO, "Connecting to RTMP URL %s...", dest->path.array);
+
+	RTMP_TLS_Free(rtmp);
+	RTMP_Init(rtmp);
+
+	if (!RTMP_SetupURL(rtmp, dest->path.array))
+		return OBS_OUTPUT_BAD_PATH;
+
+	RTMP_EnableWrite(rtmp);
+
+	dstr_copy(&dest->encoder_name, "FMLE/3.0 (compatible; FMSc/1.0)");
+
+	set_rtmp_dstr(&rtmp->Link.pubUser, &dest->username);
+	set_rtmp_dstr(&rtmp->Link.pubPasswd, &dest->password);
+	set_rtmp_dstr(&rtmp->Link.flashVer, &dest->encoder_name);
+	rtmp->Link.swfUrl = rtmp->Link.tcUrl;
+
+	if (dstr_is_empty(&dest->bind_ip) || dstr_cmp(&dest->bind_ip, "default") == 0)
+		memset(&rtmp->m_bindIP, 0, sizeof(rtmp->m_bindIP));
+	else
+		netif_str_to_addr(&rtmp->m_bindIP.addr, &rtmp->m_bindIP.addrLen, dest->bind_ip.array);
+
+	RTMP_AddStream(rtmp, dest->key.array);
+
+	rtmp->m_outChunkSize = 4096;
+	rtmp->m_bSendChunkSizeInfo = true;
+	rtmp->m_bUseNagle = true;
+
+	if (!RTMP_Connect(rtmp, NULL))
+		return OBS_OUTPUT_CONNECT_FAILED;
+
+	if (!RTMP_ConnectStream(rtmp, 0))
+		return OBS_OUTPUT_INVALID_STREAM;
+
+	char ip_address[INET6_ADDRSTRLEN] = {0};
+	netif_addr_to_str(&rtmp->m_sb.sb_addr, ip_address, INET6_ADDRSTRLEN);
+	dest_log(LOG_INFO, "Connection to %s (%s) successful", dest->path.array, ip_address);
+	return OBS_OUTPUT_SUCCESS;
+}
+
+static bool dest_write(struct rtmp_dest *dest, struct fanout_data *fd)
+{
+	if (RTMP_Write(&dest->rtmp, (char *)fd->data, (int)fd->size, 0) < 0)
+		return false;
+
+	dest->total_bytes_sent += fd->size;
+	return true;
+}
+
+static bool dest_send_headers(struct rtmp_dest *dest)
+{
+	struct rtmp_fanout *fo = dest->fo;
+	bool success = true;
+
+	pthread_mutex_lock(&fo->headers_mutex);
+	for (size_t i = 0; success && i < fo->headers.num; i++)
+		success = dest_write(dest, fo->headers.array[i]);
+	pthread_mutex_unlock(&fo->headers_mutex);
+
+	dest->sent_headers = true;
+	return success;
+}
+
+static inline bool get_next_packet(struct rtmp_dest *dest, struct fanout_data **fd)
+{
+	bool new_packet = false;
+
+	pthread_mutex_lock(&dest->packets_mutex);
+	if (dest->packets.size) {
+		deque_pop_front(&dest->packets, fd, sizeof(*fd));
+		new_packet = true;
+	}
+	pthread_mutex_unlock(&dest->packets_mutex);
+
+	return new_packet;
+}
+
+static inline bool can_shutdown_stream(struct rtmp_fanout *fo, struct fanout_data *fd)
+{
+	return os_gettime_ns() >= fo->shutdown_timeout_ts || fd->sys_dts_usec >= (int64_t)fo->stop_ts;
+}
+
+/* returns false if the connection was lost, true if the output is stopping */
+static bool dest_send_loop(struct rtmp_dest *dest)
+{
+	struct rtmp_fanout *fo = dest->fo;
+
+	while (os_sem_wait(dest->send_sem) == 0) {
+		struct fanout_data *fd;
+
+		if (os_atomic_load_bool(&fo->encode_error))
+			return true;
+		if (stopping(fo) && fo->stop_ts == 0)
+			return true;
+
+		if (!get_next_packet(dest, &fd))
+			continue;
+
+		if (stopping(fo) && can_shutdown_stream(fo, fd)) {
+			fanout_data_release(fd);
+			return true;
+		}
+
+		if (!dest->sent_headers && !dest_send_headers(dest)) {
+			fanout_data_release(fd);
+			return false;
+		}
+
+		bool success = dest_write(dest, fd);
+		fanout_data_release(fd);
+
+		if (!success)
+			return false;
+	}
+
+	return true;
+}
+
+static bool dest_send_footers(struct rtmp_dest *dest)
+{
+	struct rtmp_fanout *fo = dest->fo;
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		struct encoder_packet packet = {.type = OBS_ENCODER_VIDEO, .timebase_den = 1};
+		uint8_t *data;
+		size_t size = 0;
+
+		if (!obs_output_get_video_encoder2(fo->output, i))
+			continue;
+		if (i == 0 && fo->video_codec[i] == CODEC_H264)
+			continue;
+
+		flv_packet_end(&packet, fo->video_codec[i], &data, &size, i);
+		int ret = RTMP_Write(&dest->rtmp, (char *)data, (int)size, 0);
+		bfree(data);
+
+		if (ret < 0)
+			return false;
+	}
+
+	return true;
+}
+
+static void begin_capture_once(struct rtmp_fanout *fo)
+{
+	pthread_mutex_lock(&fo->mutex);
+	if (!fo->began_capture) {
+		fo->began_capture = true;
+		obs_output_begin_data_capture(fo->output, 0);
+	}
+	pthread_mutex_unlock(&fo->mutex);
+}
+
+static void dest_set_connected(struct rtmp_dest *dest, bool connected)
+{
+	pthread_mutex_lock(&dest->packets_mutex);
+	os_atomic_set_bool(&dest->connected, connected);
+	dest->wait_keyframe = true;
+	dest->sent_headers = false;
+	dest->min_priority = 0;
+	dest->congestion = 0.0f;
+	pthread_mutex_unlock(&dest->packets_mutex);
+
+	if (!connected)
+		free_packets(dest);
+}
+
+static void dest_thread_finished(struct rtmp_fanout *fo, int code)
+{
+	if (os_atomic_dec_long(&fo->threads_running) != 0)
+		return;
+
+	bool began = fo->began_capture;
+	bool encode_error = os_atomic_load_bool(&fo->encode_error);
+
+	os_atomic_set_bool(&fo->active, false);
+
+	if (encode_error) {
+		obs_output_signal_stop(fo->output, OBS_OUTPUT_ENCODE_ERROR);
+	} else if (stopping(fo)) {
+		if (began)
+			obs_output_end_data_capture(fo->output);
+		else
+			obs_output_signal_stop(fo->output, OBS_OUTPUT_SUCCESS);
+	} else {
+		/* every destination exhausted its reconnect attempts */
+		obs_output_signal_stop(fo->output, began ? OBS_OUTPUT_DISCONNECTED : code);
+	}
+}
+
+static void *dest_thread(void *data)
+{
+	struct rtmp_dest *dest = data;
+	struct rtmp_fanout *fo = dest->fo;
+	int retries = 0;
+	int code = OBS_OUTPUT_SUCCESS;
+
+	os_set_thread_name("rtmp-fanout: dest_thread");
+
+	while (!stopping(fo)) {
+		code = dest_connect(dest);
+
+		if (code == OBS_OUTPUT_SUCCESS) {
+			retries = 0;
+			dest_set_connected(dest, true);
+			begin_capture_once(fo);
+
+			bool lost = !dest_send_loop(dest);
+
+			dest_set_connected(dest, false);
+
+			if (lost) {
+				dest_log(LOG_INFO, "Disconnected from %s", dest->path.array);
+				code = OBS_OUTPUT_DISCONNECTED;
+			} else {
+				dest_send_footers(dest);
+			}
+
+			RTMP_Close(&dest->rtmp);
+		} else {
+			dest_log(LOG_INFO, "Connection to %s failed: %d", dest->path.array, code);
+		}
+
+		if (stopping(fo) || os_atomic_load_bool(&fo->encode_error))
+			break;
+
+		if (code == OBS_OUTPUT_BAD_PATH || retries++ >= dest->max_retries) {
+			dest_log(LOG_WARNING, "Giving up on %s", dest->path.array);
+			break;
+		}
+
+		dest->reconnects++;
+		dest_log(LOG_INFO, "Reconnecting in %d second(s) (attempt %d/%d)", dest->retry_delay_sec, retries,
+			 dest->max_retries);
+
+		if (os_event_timedwait(fo->stop_event, (unsigned long)dest->retry_delay_sec * 1000) == 0)
+			break;
+	}
+
+	dest_thread_finished(fo, code);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* frame dropping (per destination)                                          */
+
+static bool find_first_video_packet(struct rtmp_dest *dest, struct fanout_data **first)
+{
+	size_t count = num_buffered_packets(dest);
+
+	for (size_t i = 0; i < count; i++) {
+		struct fanout_data **cur = deque_data(&dest->packets, i * sizeof(*first));
+		if ((*cur)->type == OBS_ENCODER_VIDEO && !(*cur)->keyframe) {
+			*first = *cur;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void drop_frames(struct rtmp_dest *dest, int highest_priority)
+{
+	struct deque new_buf = {0};
+	int num_frames_dropped = 0;
+
+	deque_reserve(&new_buf, sizeof(struct fanout_data *) * 8);
+
+	while (dest->packets.size) {
+		struct fanout_data *fd;
+		deque_pop_front(&dest->packets, &fd, sizeof(fd));
+
+		/* do not drop audio data or video keyframes */
+		if (fd->type == OBS_ENCODER_AUDIO || fd->drop_priority >= highest_priority) {
+			deque_push_back(&new_buf, &fd, sizeof(fd));
+		} else {
+			num_frames_dropped++;
+			fanout_data_release(fd);
+		}
+	}
+
+	deque_free(&dest->packets);
+	dest->packets = new_buf;
+
+	if (dest->min_priority < highest_priority)
+		dest->min_priority = highest_priority;
+	dest->dropped_frames += num_frames_dropped;
+}
+
+static void check_to_drop_frames(struct rtmp_dest *dest, bool pframes)
+{
+	struct fanout_data *first;
+	int64_t buffer_duration_usec;
+	int priority = pframes ? OBS_NAL_PRIORITY_HIGHEST : OBS_NAL_PRIORITY_HIGH;
+	int64_t drop_threshold = pframes ? dest->pframe_drop_threshold_usec : dest->drop_threshold_usec;
+
+	if (num_buffered_packets(dest) < 5) {
+		if (!pframes)
+			dest->congestion = 0.0f;
+		return;
+	}
+
+	if (!find_first_video_packet(dest, &first))
+		return;
+
+	buffer_duration_usec = dest->last_dts_usec - first->dts_usec;
+
+	if (!pframes)
+		dest->congestion = (float)buffer_duration_usec / (float)drop_threshold;
+
+	if (buffer_duration_usec > drop_threshold)
+		drop_frames(dest, priority);
+}
+
+/* called with packets_mutex held */
+static bool dest_add_packet(struct rtmp_dest *dest, struct fanout_data *fd)
+{
+	if (dest->wait_keyframe) {
+		if (fd->type != OBS_ENCODER_VIDEO || !fd->keyframe)
+			return false;
+		dest->wait_keyframe = false;
+	}
+
+	if (fd->type == OBS_ENCODER_VIDEO) {
+		check_to_drop_frames(dest, false);
+		check_to_drop_frames(dest, true);
+
+		if (fd->drop_priority < dest->min_priority) {
+			dest->dropped_frames++;
+			return false;
+		}
+
+		dest->min_priority = 0;
+		dest->last_dts_usec = fd->dts_usec;
+	}
+
+	fanout_data_addref(fd);
+	deque_push_back(&dest->packets, &fd, sizeof(fd));
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* muxing                                                                    */
+
+static void push_header(struct rtmp_fanout *fo, uint8_t *data, size_t size)
+{
+	struct fanout_data *fd = fanout_data_create(data, size);
+	da_push_back(fo->headers, &fd);
+}
+
+static bool build_audio_header(struct rtmp_fanout *fo, size_t idx)
+{
+	obs_encoder_t *aencoder = obs_output_get_audio_encoder(fo->output, idx);
+	struct encoder_packet packet = {.type = OBS_ENCODER_AUDIO, .timebase_den = 1};
+	uint8_t *header;
+	uint8_t *data;
+	size_t size;
+
+	if (!aencoder)
+		return false;
+	if (!obs_encoder_get_extra_data(aencoder, &header, &packet.size))
+		return true;
+
+	packet.data = header;
+	if (idx == 0)
+		flv_packet_mux(&packet, 0, &data, &size, true);
+	else
+		flv_packet_audio_start(&packet, fo->audio_codec[idx], &data, &size, idx);
+
+	push_header(fo, data, size);
+	return true;
+}
+
+static void build_video_header(struct rtmp_fanout *fo, size_t idx)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder2(fo->output, idx);
+	struct encoder_packet packet = {.type = OBS_ENCODER_VIDEO, .timebase_den = 1, .keyframe = true};
+	uint8_t *header;
+	uint8_t *data;
+	size_t size;
+
+	if (!vencoder || !obs_encoder_get_extra_data(vencoder, &header, &size))
+		return;
+
+	switch (fo->video_codec[idx]) {
+	case CODEC_NONE:
+		return;
+	case CODEC_H264:
+		packet.size = obs_parse_avc_header(&packet.data, header, size);
+		break;
+	case CODEC_HEVC:
+#ifdef ENABLE_HEVC
+		packet.size = obs_parse_hevc_header(&packet.data, header, size);
+		break;
+#else
+		return;
+#endif
+	case CODEC_AV1:
+		packet.size = obs_parse_av1_header(&packet.data, header, size);
+		break;
+	}
+
+	if (idx == 0 && fo->video_codec[idx] == CODEC_H264)
+		flv_packet_mux(&packet, 0, &data, &size, true);
+	else
+		flv_packet_start(&packet, fo->video_codec[idx], &data, &size, idx);
+
+	bfree(packet.data);
+	push_header(fo, data, size);
+}
+
+static void build_headers(struct rtmp_fanout *fo)
+{
+	uint8_t *data;
+	size_t size;
+
+	pthread_mutex_lock(&fo->headers_mutex);
+
+	flv_meta_data(fo->output, &data, &size, false);
+	push_header(fo, data, size);
+
+	build_audio_header(fo, 0);
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+		build_video_header(fo, i);
+
+	for (size_t i = 1; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (!build_audio_header(fo, i))
+			break;
+	}
+
+	pthread_mutex_unlock(&fo->headers_mutex);
+}
+
+static struct fanout_data *mux_packet(struct rtmp_fanout *fo, struct encoder_packet *packet)
+{
+	size_t idx = packet->track_idx;
+	struct fanout_data *fd;
+	uint8_t *data;
+	size_t size = 0;
+
+	if (packet->type == OBS_ENCODER_VIDEO && (fo->video_codec[idx] != CODEC_H264 || idx != 0))
+		flv_packet_frames(packet, fo->video_codec[idx], fo->start_dts_offset, &data, &size, idx);
+	else if (packet->type == OBS_ENCODER_AUDIO && idx != 0)
+		flv_packet_audio_frames(packet, fo->audio_codec[idx], fo->start_dts_offset, &data, &size, idx);
+	else
+		flv_packet_mux(packet, fo->start_dts_offset, &data, &size, false);
+
+	fd = fanout_data_create(data, size);
+	fd->type = packet->type;
+	fd->keyframe = packet->keyframe;
+	fd->drop_priority = packet->drop_priority;
+	fd->dts_usec = packet->dts_usec;
+	fd->sys_dts_usec = packet->sys_dts_usec;
+	return fd;
+}
+
+static void rtmp_fanout_data(void *data, struct encoder_packet *packet)
+{
+	struct rtmp_fanout *fo = data;
+	struct encoder_packet parsed;
+	struct fanout_data *fd;
+
+	if (!active(fo))
+		return;
+
+	/* encoder fail */
+	if (!packet) {
+		os_atomic_set_bool(&fo->encode_error, true);
+		for (size_t i = 0; i < fo->dests.num; i++)
+			os_sem_post(fo->dests.array[i]->send_sem);
+		return;
+	}
+
+	if (!fo->got_first_packet) {
+		fo->start_dts_offset = get_ms_time(packet, packet->dts);
+		fo->got_first_packet = true;
+		build_headers(fo);
+	}
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		switch (fo->video_codec[packet->track_idx]) {
+		case CODEC_NONE:
+			return;
+		case CODEC_H264:
+			obs_parse_avc_packet(&parsed, packet);
+			break;
+		case CODEC_HEVC:
+#ifdef ENABLE_HEVC
+			obs_parse_hevc_packet(&parsed, packet);
+			break;
+#else
+			return;
+#endif
+		case CODEC_AV1:
+			obs_parse_av1_packet(&parsed, packet);
+			break;
+		}
+
+		fd = mux_packet(fo, &parsed);
+		obs_encoder_packet_release(&parsed);
+	} else {
+		fd = mux_packet(fo, packet);
+	}
+
+	for (size_t i = 0; i < fo->dests.num; i++) {
+		struct rtmp_dest *dest = fo->dests.array[i];
+		bool added = false;
+
+		if (!os_atomic_load_bool(&dest->connected))
+			continue;
+
+		pthread_mutex_lock(&dest->packets_mutex);
+		if (os_atomic_load_bool(&dest->connected))
+			added = dest_add_packet(dest, fd);
+		pthread_mutex_unlock(&dest->packets_mutex);
+
+		if (added)
+			os_sem_post(dest->send_sem);
+	}
+
+	fanout_data_release(fd);
+}
+
+/* ------------------------------------------------------------------------- */
+/* stats                                                                     */
+
+static struct rtmp_dest *get_dest(struct rtmp_fanout *fo, calldata_t *cd)
+{
+	long long idx = calldata_int(cd, "index");
+	if (idx < 0 || (size_t)idx >= fo->dests.num)
+		return NULL;
+	return fo->dests.array[idx];
+}
+
+static void get_destination_count_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_fanout *fo = data;
+	calldata_set_int(cd, "count", (long long)fo->dests.num);
+}
+
+static void get_destination_stats_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_fanout *fo = data;
+	struct rtmp_dest *dest = get_dest(fo, cd);
+
+	if (!dest)
+		return;
+
+	calldata_set_string(cd, "url", dest->path.array);
+	calldata_set_bool(cd, "connected", os_atomic_load_bool(&dest->connected));
+	calldata_set_int(cd, "total_bytes", (long long)dest->total_bytes_sent);
+	calldata_set_int(cd, "dropped_frames", dest->dropped_frames);
+	calldata_set_int(cd, "reconnects", dest->reconnects);
+	calldata_set_float(cd, "congestion", dest->min_priority > 0 ? 1.0f : dest->congestion);
+	calldata_set_int(cd, "connect_time_ms", dest->rtmp.connect_time_ms);
+}
+
+static uint64_t rtmp_fanout_total_bytes_sent(void *data)
+{
+	struct rtmp_fanout *fo = data;
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < fo->dests.num; i++)
+		total += fo->dests.array[i]->total_bytes_sent;
+	return total;
+}
+
+static int rtmp_fanout_dropped_frames(void *data)
+{
+	struct rtmp_fanout *fo = data;
+	int dropped = 0;
+
+	for (size_t i = 0; i < fo->dests.num; i++)
+		dropped += fo->dests.array[i]->dropped_frames;
+	return dropped;
+}
+
+static float rtmp_fanout_congestion(void *data)
+{
+	struct rtmp_fanout *fo = data;
+	float congestion = 0.0f;
+
+	for (size_t i = 0; i < fo->dests.num; i++) {
+		struct rtmp_dest *dest = fo->dests.array[i];
+		float val = dest->min_priority > 0 ? 1.0f : dest->congestion;
+		if (val > congestion)
+			congestion = val;
+	}
+	return congestion;
+}
+
+static int rtmp_fanout_connect_time(void *data)
+{
+	struct rtmp_fanout *fo = data;
+	return fo->dests.num ? fo->dests.array[0]->rtmp.connect_time_ms : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* output                                                                    */
+
+static const char *rtmp_fanout_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("RTMPFanout");
+}
+
+static void rtmp_fanout_destroy(void *data)
+{
+	struct rtmp_fanout *fo = data;
+
+	if (active(fo)) {
+		fo->stop_ts = 0;
+		os_event_signal(fo->stop_event);
+		for (size_t i = 0; i < fo->dests.num; i++)
+			os_sem_post(fo->dests.array[i]->send_sem);
+	}
+
+	free_dests(fo);
+	free_headers(fo);
+	os_event_destroy(fo->stop_event);
+	pthread_mutex_destroy(&fo->headers_mutex);
+	pthread_mutex_destroy(&fo->mutex);
+	bfree(fo);
+}
+
+static void *rtmp_fanout_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct rtmp_fanout *fo = bzalloc(sizeof(struct rtmp_fanout));
+	fo->output = output;
+
+	if (pthread_mutex_init(&fo->mutex, NULL) != 0)
+		goto fail_mutex;
+	if (pthread_mutex_init(&fo->headers_mutex, NULL) != 0)
+		goto fail_headers_mutex;
+	if (os_event_init(&fo->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail_event;
+
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph, "void get_destination_count(out int count)", get_destination_count_proc, fo);
+	proc_handler_add(ph,
+			 "void get_destination_stats(in int index, out string url, out bool connected, "
+			 "out int total_bytes, out int dropped_frames, out int reconnects, out float congestion, "
+			 "out int connect_time_ms)",
+			 get_destination_stats_proc, fo);
+
+	UNUSED_PARAMETER(settings);
+	return fo;
+
+fail_event:
+	pthread_mutex_destroy(&fo->headers_mutex);
+fail_headers_mutex:
+	pthread_mutex_destroy(&fo->mutex);
+fail_mutex:
+	bfree(fo);
+	return NULL;
+}
+
+static bool init_dests(struct rtmp_fanout *fo, obs_data_t *settings)
+{
+	obs_data_array_t *array = obs_data_get_array(settings, OPT_DESTINATIONS);
+	size_t count = obs_data_array_count(array);
+
+	free_dests(fo);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		struct rtmp_dest *dest = dest_create(fo, item, i);
+		obs_data_release(item);
+
+		if (dest)
+			da_push_back(fo->dests, &dest);
+	}
+
+	obs_data_array_release(array);
+	return fo->dests.num > 0;
+}
+
+static void init_codecs(struct rtmp_fanout *fo)
+{
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		obs_encoder_t *enc = obs_output_get_audio_encoder(fo->output, i);
+		fo->audio_codec[i] = enc ? to_audio_type(obs_encoder_get_codec(enc)) : AUDIO_CODEC_NONE;
+	}
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		obs_encoder_t *enc = obs_output_get_video_encoder2(fo->output, i);
+		fo->video_codec[i] = enc ? to_video_type(obs_encoder_get_codec(enc)) : CODEC_NONE;
+	}
+}
+
+static bool rtmp_fanout_start(void *data)
+{
+	struct rtmp_fanout *fo = data;
+	obs_data_t *settings;
+	bool success;
+
+	if (!obs_output_can_begin_data_capture(fo->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(fo->output, 0))
+		return false;
+
+	join_dests(fo);
+	free_headers(fo);
+	os_event_reset(fo->stop_event);
+
+	settings = obs_output_get_settings(fo->output);
+	success = init_dests(fo, settings);
+	fo->max_shutdown_time_sec = (int)obs_data_get_int(settings, OPT_MAX_SHUTDOWN_TIME_SEC);
+	obs_data_release(settings);
+
+	if (!success) {
+		warn("No destinations configured");
+		return false;
+	}
+
+	init_codecs(fo);
+	fo->began_capture = false;
+	fo->got_first_packet = false;
+	fo->stop_ts = 0;
+	os_atomic_set_bool(&fo->encode_error, false);
+	os_atomic_set_bool(&fo->active, true);
+	os_atomic_set_long(&fo->threads_running, (long)fo->dests.num);
+
+	info("Starting %zu destination(s)", fo->dests.num);
+
+	for (size_t i = 0; i < fo->dests.num; i++) {
+		struct rtmp_dest *dest = fo->dests.array[i];
+
+		if (pthread_create(&dest->thread, NULL, dest_thread, dest) == 0)
+			dest->thread_created = true;
+		else
+			dest_thread_finished(fo, OBS_OUTPUT_ERROR);
+	}
+
+	return true;
+}
+
+static void rtmp_fanout_stop(void *data, uint64_t ts)
+{
+	struct rtmp_fanout *fo = data;
+
+	if (stopping(fo) && ts != 0)
+		return;
+
+	fo->stop_ts = ts / 1000ULL;
+	if (ts)
+		fo->shutdown_timeout_ts = ts + (uint64_t)fo->max_shutdown_time_sec * 1000000000ULL;
+
+	if (active(fo)) {
+		os_event_signal(fo->stop_event);
+		for (size_t i = 0; i < fo->dests.num; i++)
+			os_sem_post(fo->dests.array[i]->send_sem);
+	} else {
+		obs_output_signal_stop(fo->output, OBS_OUTPUT_SUCCESS);
+	}
+}
+
+static void rtmp_fanout_defaults(obs_data_t *defaults)
+{
+	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
+}
+
+struct obs_output_info rtmp_fanout_output_info = {
+	.id = "rtmp_fanout_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK_AV,
+#ifdef NO_CRYPTO
+	.protocols = "RTMP",
+#else
+	.protocols = "RTMP;RTMPS",
+#endif
+#ifdef ENABLE_HEVC
+	.encoded_video_codecs = "h264;hevc;av1",
+#else
+	.encoded_video_codecs = "h264;av1",
+#endif
+	.encoded_audio_codecs = "aac",
+	.get_name = rtmp_fanout_getname,
+	.create = rtmp_fanout_create,
+	.destroy = rtmp_fanout_destroy,
+	.start = rtmp_fanout_start,
+	.stop = rtmp_fanout_stop,
+	.encoded_packet = rtmp_fanout_data,
+	.get_defaults = rtmp_fanout_defaults,
+	.get_total_bytes = rtmp_fanout_total_bytes_sent,
+	.get_congestion = rtmp_fanout_congestion,
+	.get_connect_time_ms = rtmp_fanout_connect_time,
+	.get_dropped_frames = rtmp_fanout_dropped_frames,
+};
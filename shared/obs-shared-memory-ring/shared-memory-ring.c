@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2024 OBS Project
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "shared-memory-ring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <util/threading.h>
+
+#define RING_MAGIC 0x4F534852 /* "OSHR" */
+#define NAME_SIZE 64
+
+struct ring_header {
+	uint32_t magic;
+	uint32_t capacity;
+
+	/* Set by the consumer once it has mapped the ring */
+	volatile long reader_attached;
+
+	/* Free-running byte counters, wrapped to 32 bits */
+	volatile long write_pos;
+	uint8_t pad0[56];
+	volatile long read_pos;
+	uint8_t pad1[56];
+};
+
+struct shm_ring {
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	int fd;
+#endif
+	struct ring_header *header;
+	uint8_t *data;
+	size_t map_size;
+	uint32_t mask;
+	bool is_writer;
+	char name[NAME_SIZE];
+};
+
+#define ALIGN_SIZE(size, align) size = (((size) + (align - 1)) & (~(align - 1)))
+
+static inline uint32_t next_pow2(uint32_t val)
+{
+	uint32_t pow2 = 4096;
+	while (pow2 < val && pow2 < 0x80000000U)
+		pow2 <<= 1;
+	return pow2;
+}
+
+static bool map_ring(struct shm_ring *ring, size_t size)
+{
+#ifdef _WIN32
+	void *ptr = MapViewOfFile(ring->handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!ptr)
+		return false;
+#else
+	void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+	if (ptr == MAP_FAILED)
+		return false;
+#endif
+
+	ring->header = ptr;
+	ring->data = (uint8_t *)ptr + sizeof(struct ring_header);
+	ring->map_size = size;
+	return true;
+}
+
+static void unmap_ring(struct shm_ring *ring)
+{
+	if (!ring->header)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(ring->header);
+#else
+	munmap(ring->header, ring->map_size);
+#endif
+	ring->header = NULL;
+}
+
+#ifndef __linux__
+static volatile long ring_counter = 0;
+#endif
+
+shm_ring_t *shm_ring_create(uint32_t capacity)
+{
+	struct shm_ring *ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+
+#ifndef _WIN32
+	ring->fd = -1;
+#endif
+	capacity = next_pow2(capacity);
+
+	size_t size = sizeof(struct ring_header) + capacity;
+	ALIGN_SIZE(size, 4096);
+
+	ring->is_writer = true;
+
+#ifdef _WIN32
+	snprintf(ring->name, sizeof(ring->name), "Local\\obs-shm-ring-%lu-%ld", GetCurrentProcessId(),
+		 os_atomic_inc_long(&ring_counter));
+
+	ring->handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32),
+					  (DWORD)size, ring->name);
+	if (!ring->handle)
+		goto fail;
+#else
+#ifdef __linux__
+	/* The consumer opens the memfd through /proc, so it never has to be
+	 * inherited */
+	ring->fd = memfd_create("obs-shm-ring", MFD_CLOEXEC);
+	snprintf(ring->name, sizeof(ring->name), "/proc/%d/fd/%d", (int)getpid(), ring->fd);
+#else
+	snprintf(ring->name, sizeof(ring->name), "/obs-shm-ring-%d-%ld", (int)getpid(),
+		 os_atomic_inc_long(&ring_counter));
+	ring->fd = shm_open(ring->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+#endif
+	if (ring->fd < 0)
+		goto fail;
+	if (ftruncate(ring->fd, (off_t)size) != 0)
+		goto fail;
+#endif
+
+	if (!map_ring(ring, size))
+		goto fail;
+
+	ring->header->magic = RING_MAGIC;
+	ring->header->capacity = capacity;
+	ring->mask = capacity - 1;
+	return ring;
+
+fail:
+	shm_ring_close(ring);
+	return NULL;
+}
+
+shm_ring_t *shm_ring_open(const char *name)
+{
+	struct shm_ring *ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+
+	snprintf(ring->name, sizeof(ring->name), "%s", name);
+
+#ifndef _WIN32
+	ring->fd = -1;
+#endif
+
+#ifdef _WIN32
+	ring->handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, false, name);
+	if (!ring->handle)
+		goto fail;
+
+	/* Size of the mapping is not known yet, map the header first */
+	if (!map_ring(ring, sizeof(struct ring_header)))
+		goto fail;
+#else
+	struct stat st;
+
+#ifdef __linux__
+	ring->fd = open(name, O_RDWR | O_CLOEXEC);
+	if (ring->fd < 0)
+		goto fail;
+#else
+	ring->fd = shm_open(name, O_RDWR, 0);
+	if (ring->fd < 0)
+		goto fail;
+
+	/* Only the one consumer ever opens it */
+	shm_unlink(name);
+#endif
+
+	if (fstat(ring->fd, &st) != 0 || (size_t)st.st_size < sizeof(struct ring_header))
+		goto fail;
+	if (!map_ring(ring, (size_t)st.st_size))
+		goto fail;
+#endif
+
+	if (ring->header->magic != RING_MAGIC)
+		goto fail;
+
+	uint32_t capacity = ring->header->capacity;
+	ring->mask = capacity - 1;
+
+#ifdef _WIN32
+	unmap_ring(ring);
+	if (!map_ring(ring, sizeof(struct ring_header) + capacity))
+		goto fail;
+#else
+	if (ring->map_size < sizeof(struct ring_header) + capacity)
+		goto fail;
+#endif
+
+	os_atomic_set_long(&ring->header->reader_attached, 1);
+	return ring;
+
+fail:
+	shm_ring_close(ring);
+	return NULL;
+}
+
+void shm_ring_close(shm_ring_t *ring)
+{
+	if (!ring)
+		return;
+
+	unmap_ring(ring);
+
+#ifdef _WIN32
+	if (ring->handle)
+		CloseHandle(ring->handle);
+#else
+	if (ring->fd >= 0)
+		close(ring->fd);
+#ifndef __linux__
+	if (ring->is_writer)
+		shm_unlink(ring->name);
+#endif
+#endif
+
+	free(ring);
+}
+
+const char *shm_ring_get_name(shm_ring_t *ring)
+{
+	return ring->name;
+}
+
+bool shm_ring_reader_attached(shm_ring_t *ring)
+{
+	return os_atomic_load_long(&ring->header->reader_attached) != 0;
+}
+
+bool shm_ring_try_write(shm_ring_t *ring, const void *data, uint32_t size)
+{
+	struct ring_header *header = ring->header;
+	uint32_t write_pos = (uint32_t)header->write_pos;
+	uint32_t read_pos = (uint32_t)os_atomic_load_long(&header->read_pos);
+	uint32_t capacity = ring->mask + 1;
+
+	if (size > capacity - (write_pos - read_pos))
+		return false;
+
+	uint32_t offset = write_pos & ring->mask;
+	uint32_t first = capacity - offset;
+	if (first > size)
+		first = size;
+
+	memcpy(ring->data + offset, data, first);
+	memcpy(ring->data, (const uint8_t *)data + first, size - first);
+
+	os_atomic_set_long(&header->write_pos, (long)(write_pos + size));
+	return true;
+}
+
+bool shm_ring_read(shm_ring_t *ring, void *data, uint32_t size)
+{
+	struct ring_header *header = ring->header;
+	uint32_t read_pos = (uint32_t)header->read_pos;
+	uint32_t write_pos = (uint32_t)os_atomic_load_long(&header->write_pos);
+	uint32_t capacity = ring->mask + 1;
+
+	if (size > write_pos - read_pos)
+		return false;
+
+	uint32_t offset = read_pos & ring->mask;
+	uint32_t first = capacity - offset;
+	if (first > size)
+		first = size;
+
+	memcpy(data, ring->data + offset, first);
+	memcpy((uint8_t *)data + first, ring->data, size - first);
+
+	os_atomic_set_long(&header->read_pos, (long)(read_pos + size));
+	return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Single producer, single consumer byte ring in shared memory, used to move
+ * bulk data between processes without going through a pipe. The ring does
+ * not block or signal: the producer tells the consumer about new data over
+ * its own channel (usually a pipe) after writing it, so the consumer never
+ * has to wait for data, and the producer simply fails if there is no room.
+ */
+
+struct shm_ring;
+typedef struct shm_ring shm_ring_t;
+
+/* Creates the ring on the producer side. capacity is rounded up to a power
+ * of two. None of the handles are inherited by child processes, the
+ * consumer opens the ring by name. */
+extern shm_ring_t *shm_ring_create(uint32_t capacity);
+
+/* Opens the ring on the consumer side, using the name from the producer */
+extern shm_ring_t *shm_ring_open(const char *name);
+extern void shm_ring_close(shm_ring_t *ring);
+
+extern const char *shm_ring_get_name(shm_ring_t *ring);
+/* Producer: true once the consumer has opened the ring. Nothing should be
+ * written before that, since the consumer may never be able to read it. */
+extern bool shm_ring_reader_attached(shm_ring_t *ring);
+
+/* Producer: copies size bytes into the ring, or returns false (writing
+ * nothing) if there is not enough free space */
+extern bool shm_ring_try_write(shm_ring_t *ring, const void *data, uint32_t size);
+
+/* Consumer: copies size bytes out of the ring, returns false if fewer than
+ * size bytes have been written */
+extern bool shm_ring_read(shm_ring_t *ring, void *data, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <util/platform.h>
+#include <media-io/audio-dsp.h>
+
+#include "filter-dsp.h"
+
+/*
+ * Biquad benchmark, scalar against SIMD.  Not registered as a test since the
+ * timings depend on the machine, run it by hand.
+ */
+
+static float input[MAX_AUDIO_CHANNELS][1024];
+
+/* N channels times M stages of 1024 frames, as a filter chain would be run */
+static double bench_biquads(size_t channels, size_t stages)
+{
+	static float buf[MAX_AUDIO_CHANNELS][1024];
+	float *data[MAX_AUDIO_CHANNELS];
+	struct biquad_coeffs coeffs[BIQUAD_MAX_STAGES];
+	struct biquad_cascade bq;
+	const int iterations = 200;
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		memcpy(buf[ch], input[ch], sizeof(buf[ch]));
+		data[ch] = buf[ch];
+	}
+	for (size_t s = 0; s < stages; s++)
+		biquad_peaking(&coeffs[s], 48000.0f, 100.0f * (s + 1), 1.0f, 3.0f);
+
+	biquad_cascade_init(&bq, channels, coeffs, stages);
+
+	uint64_t start = os_gettime_ns();
+	for (int i = 0; i < iterations; i++)
+		biquad_cascade_process(&bq, data, (const float *const *)data, 1024);
+	uint64_t end = os_gettime_ns();
+
+	return (double)(end - start) / (iterations * 1024.0);
+}
+
+int main()
+{
+	static const size_t channels[] = {1, 2, 6, 8};
+	static const size_t stages[] = {1, 4, 8};
+	uint32_t seed = 1;
+
+	for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++) {
+		for (size_t i = 0; i < 1024; i++) {
+			seed = seed * 1664525 + 1013904223;
+			input[ch][i] = (float)(int32_t)seed / 2147483648.0f;
+		}
+	}
+
+	for (size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++) {
+		for (size_t s = 0; s < sizeof(stages) / sizeof(stages[0]); s++) {
+			audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+			double scalar = bench_biquads(channels[c], stages[s]);
+			audio_dsp_set_impl(AUDIO_DSP_SIMD);
+			double simd = bench_biquads(channels[c], stages[s]);
+
+			printf("biquads: %zu channels x %zu stages: %.2f ns/frame scalar, %.2f ns/frame simd\n",
+			       channels[c], stages[s], scalar, simd);
+		}
+	}
+
+	return 0;
+}
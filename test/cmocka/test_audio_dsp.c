@@ -0,0 +1,232 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <math.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <media-io/audio-dsp.h>
+
+/* not a multiple of any vector width, so the tails are covered too */
+#define FRAMES 1027
+#define CHANNELS 6
+
+static float input[CHANNELS][FRAMES];
+
+static void fill_input(void)
+{
+	uint32_t seed = 1;
+
+	for (size_t ch = 0; ch < CHANNELS; ch++) {
+		for (size_t i = 0; i < FRAMES; i++) {
+			seed = seed * 1664525 + 1013904223;
+			input[ch][i] = (float)(int32_t)seed / 2147483648.0f;
+		}
+	}
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+	fill_input();
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	return 0;
+}
+
+static void gain_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float scalar[FRAMES], simd[FRAMES];
+
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	audio_dsp_gain(scalar, input[0], 0.3f, FRAMES);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	audio_dsp_gain(simd, input[0], 0.3f, FRAMES);
+
+	assert_memory_equal(scalar, simd, sizeof(scalar));
+	assert_true(scalar[5] == input[0][5] * 0.3f);
+
+	/* in place */
+	memcpy(simd, input[0], sizeof(simd));
+	audio_dsp_gain(simd, simd, 0.3f, FRAMES);
+	assert_memory_equal(scalar, simd, sizeof(scalar));
+}
+
+static void gain_env_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float scalar[FRAMES], simd[FRAMES], gains[FRAMES];
+
+	for (size_t i = 0; i < FRAMES; i++)
+		gains[i] = (i < FRAMES / 2) ? 1.0f : 0.25f;
+
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	audio_dsp_gain_env(scalar, input[1], gains, FRAMES);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	audio_dsp_gain_env(simd, input[1], gains, FRAMES);
+
+	assert_memory_equal(scalar, simd, sizeof(scalar));
+	assert_true(scalar[0] == input[1][0]);
+	assert_true(scalar[FRAMES - 1] == input[1][FRAMES - 1] * 0.25f);
+}
+
+static void gain_ramp_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float scalar[FRAMES], simd[FRAMES], ones[FRAMES];
+
+	for (size_t i = 0; i < FRAMES; i++)
+		ones[i] = 1.0f;
+
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	audio_dsp_gain_ramp(scalar, input[2], 1.0f, 0.0f, FRAMES);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	audio_dsp_gain_ramp(simd, input[2], 1.0f, 0.0f, FRAMES);
+
+	/* the scalar ramp may be computed with a fused multiply-add */
+	for (size_t i = 0; i < FRAMES; i++)
+		assert_true(fabsf(scalar[i] - simd[i]) <= 1e-6f);
+
+	assert_true(simd[0] == input[2][0]);
+
+	audio_dsp_gain_ramp(simd, ones, 0.0f, 1.0f, FRAMES);
+	assert_true(simd[0] == 0.0f);
+	for (size_t i = 1; i < FRAMES; i++)
+		assert_true(simd[i] > simd[i - 1]);
+	assert_true(fabsf(simd[FRAMES - 1] - (float)(FRAMES - 1) / FRAMES) <= 1e-6f);
+}
+
+static void mix_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float scalar[FRAMES], simd[FRAMES];
+
+	memcpy(scalar, input[3], sizeof(scalar));
+	memcpy(simd, input[3], sizeof(simd));
+
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	audio_dsp_mix(scalar, input[4], 0.5f, FRAMES);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	audio_dsp_mix(simd, input[4], 0.5f, FRAMES);
+
+	/* the scalar sum may be computed with a fused multiply-add */
+	for (size_t i = 0; i < FRAMES; i++)
+		assert_true(fabsf(scalar[i] - simd[i]) <= 1e-6f);
+
+	assert_true(fabsf(simd[FRAMES - 1] - (input[3][FRAMES - 1] + input[4][FRAMES - 1] * 0.5f)) <= 1e-6f);
+}
+
+static void pan_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	float l, r;
+
+	audio_dsp_pan_gains(AUDIO_PAN_LAW_LINEAR, 0.25f, &l, &r);
+	assert_true(l == 0.75f && r == 0.25f);
+
+	audio_dsp_pan_gains(AUDIO_PAN_LAW_SQUARE, 0.25f, &l, &r);
+	assert_true(fabsf(l * l + r * r - 1.0f) <= 1e-6f);
+
+	audio_dsp_pan_gains(AUDIO_PAN_LAW_SINE, 0.5f, &l, &r);
+	assert_true(fabsf(l - 0.70710678f) <= 1e-6f);
+	assert_true(l == r);
+
+	static float left[FRAMES], right[FRAMES];
+	memcpy(left, input[0], sizeof(left));
+	memcpy(right, input[1], sizeof(right));
+
+	audio_dsp_pan(left, right, AUDIO_PAN_LAW_LINEAR, 0.25f, FRAMES);
+	for (size_t i = 0; i < FRAMES; i++) {
+		assert_true(left[i] == input[0][i] * 0.75f);
+		assert_true(right[i] == input[1][i] * 0.25f);
+	}
+}
+
+static void downmix_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const float matrix[CHANNELS] = {0.5f, 0.5f, 0.7071f, 0.0f, 0.3f, 0.3f};
+	static float scalar[FRAMES], simd[FRAMES];
+	static float copy[CHANNELS][FRAMES];
+	const float *src[CHANNELS];
+
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		src[ch] = input[ch];
+
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	audio_dsp_downmix(scalar, src, matrix, CHANNELS, FRAMES);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	audio_dsp_downmix(simd, src, matrix, CHANNELS, FRAMES);
+
+	/* the scalar sum may be computed with fused multiply-adds */
+	for (size_t i = 0; i < FRAMES; i++)
+		assert_true(fabsf(scalar[i] - simd[i]) <= 1e-6f);
+
+	/* writing over one of the inputs */
+	memcpy(copy, input, sizeof(copy));
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		src[ch] = copy[ch];
+
+	audio_dsp_downmix(copy[0], src, matrix, CHANNELS, FRAMES);
+	assert_memory_equal(simd, copy[0], sizeof(simd));
+}
+
+static void downmix_mono_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float scalar[CHANNELS][FRAMES], simd[CHANNELS][FRAMES];
+	float *scalar_ch[CHANNELS], *simd_ch[CHANNELS];
+
+	memcpy(scalar, input, sizeof(scalar));
+	memcpy(simd, input, sizeof(simd));
+
+	for (size_t ch = 0; ch < CHANNELS; ch++) {
+		scalar_ch[ch] = scalar[ch];
+		simd_ch[ch] = simd[ch];
+	}
+
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	audio_dsp_downmix_mono(scalar_ch, CHANNELS, FRAMES);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	audio_dsp_downmix_mono(simd_ch, CHANNELS, FRAMES);
+
+	assert_memory_equal(scalar, simd, sizeof(scalar));
+
+	for (size_t ch = 1; ch < CHANNELS; ch++)
+		assert_memory_equal(simd[0], simd[ch], sizeof(simd[0]));
+
+	/* same order of operations as summing into the first channel and
+	 * scaling afterwards */
+	float sum = input[0][7];
+	for (size_t ch = 1; ch < CHANNELS; ch++)
+		sum += input[ch][7];
+	assert_true(simd[3][7] == sum * (1.0f / CHANNELS));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(gain_test),
+		cmocka_unit_test(gain_env_test),
+		cmocka_unit_test(gain_ramp_test),
+		cmocka_unit_test(mix_test),
+		cmocka_unit_test(pan_test),
+		cmocka_unit_test(downmix_test),
+		cmocka_unit_test(downmix_mono_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
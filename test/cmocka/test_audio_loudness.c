@@ -0,0 +1,107 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <math.h>
+#include <cmocka.h>
+
+#include <graphics/math-defs.h>
+#include <media-io/audio-loudness.h>
+
+#define SAMPLE_RATE 48000
+#define SECONDS 5
+
+/* 997 Hz, 0 dBFS: the BS.1770 reference tone */
+static float sine[SAMPLE_RATE * SECONDS];
+static float silence[SAMPLE_RATE * SECONDS];
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < SAMPLE_RATE * SECONDS; i++)
+		sine[i] = (float)sin(2.0 * M_PI * 997.0 * (double)i / SAMPLE_RATE);
+	return 0;
+}
+
+/* fed in odd sized packets, so blocks span several calls */
+static void feed(struct audio_loudness *ld, const float *const planes[], size_t channels, float mul)
+{
+	const float *cur[MAX_AUDIO_CHANNELS];
+	size_t pos = 0;
+
+	while (pos < SAMPLE_RATE * SECONDS) {
+		size_t frames = SAMPLE_RATE * SECONDS - pos;
+		if (frames > 1021)
+			frames = 1021;
+
+		for (size_t c = 0; c < channels; c++)
+			cur[c] = planes[c] + pos;
+		audio_loudness_process(ld, cur, channels, frames, mul);
+		pos += frames;
+	}
+}
+
+static void reference_tone_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const float *mono[] = {sine};
+	const float *stereo[] = {sine, silence};
+	struct audio_loudness *ld = audio_loudness_create(SAMPLE_RATE, SPEAKERS_MONO);
+	float momentary, short_term, integrated;
+
+	audio_loudness_get(ld, &momentary, &short_term, &integrated);
+	assert_true(isinf(momentary) && isinf(integrated));
+
+	feed(ld, mono, 1, 1.0f);
+	audio_loudness_get(ld, &momentary, &short_term, &integrated);
+	assert_true(fabsf(momentary - -3.01f) <= 0.05f);
+	assert_true(fabsf(short_term - -3.01f) <= 0.05f);
+	assert_true(fabsf(integrated - -3.01f) <= 0.05f);
+
+	/* one channel of a stereo layout measures the same, and the gain is
+	 * applied before measuring */
+	audio_loudness_reset(ld, SAMPLE_RATE, SPEAKERS_STEREO);
+	feed(ld, stereo, 2, 0.5f);
+	audio_loudness_get(ld, &momentary, NULL, &integrated);
+	assert_true(fabsf(momentary - -9.03f) <= 0.05f);
+	assert_true(fabsf(integrated - -9.03f) <= 0.05f);
+
+	audio_loudness_destroy(ld);
+}
+
+static void gate_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const float *tone[] = {sine};
+	const float *quiet[] = {silence};
+	struct audio_loudness *ld = audio_loudness_create(SAMPLE_RATE, SPEAKERS_MONO);
+	float momentary, integrated;
+
+	/* silence is below the absolute gate and never counts */
+	feed(ld, quiet, 1, 1.0f);
+	audio_loudness_get(ld, &momentary, NULL, &integrated);
+	assert_true(isinf(momentary) && isinf(integrated));
+
+	/* 47 full tone blocks and six 400 ms blocks where the tone starts or
+	 * stops make it through the gates, an average of 50 / 53 of the tone's
+	 * energy.  Without gating the silent blocks would count too. */
+	feed(ld, tone, 1, 1.0f);
+	feed(ld, quiet, 1, 1.0f);
+	audio_loudness_get(ld, &momentary, NULL, &integrated);
+	assert_true(isinf(momentary));
+	assert_true(fabsf(integrated - -3.26f) <= 0.05f);
+
+	audio_loudness_destroy(ld);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(reference_tone_test),
+		cmocka_unit_test(gate_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, NULL);
+}
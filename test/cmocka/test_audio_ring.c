@@ -0,0 +1,215 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <media-io/audio-ring.h>
+
+#define CHANNELS 2
+#define CAPACITY 1024
+
+/* sample n of a stream is n on the first channel and -n on the second */
+static float stream[CHANNELS][4 * CAPACITY];
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < 4 * CAPACITY; i++) {
+		stream[0][i] = (float)i;
+		stream[1][i] = -(float)i;
+	}
+	return 0;
+}
+
+static void push(struct audio_ring *ring, uint32_t offset, uint32_t frames)
+{
+	const uint8_t *data[CHANNELS] = {(const uint8_t *)(stream[0] + offset),
+					 (const uint8_t *)(stream[1] + offset)};
+	assert_true(audio_ring_push_back(ring, data, frames));
+}
+
+static void place(struct audio_ring *ring, uint32_t pos, uint32_t offset, uint32_t frames)
+{
+	const uint8_t *data[CHANNELS] = {(const uint8_t *)(stream[0] + offset),
+					 (const uint8_t *)(stream[1] + offset)};
+	assert_true(audio_ring_place(ring, pos, data, frames));
+}
+
+/* checks that the next frames are samples offset... of the stream, or
+ * silence where offset is negative */
+static void check(struct audio_ring *ring, int64_t offset, uint32_t frames)
+{
+	static float buf[CHANNELS][CAPACITY];
+	float *data[CHANNELS] = {buf[0], buf[1]};
+
+	audio_ring_peek(ring, data, CHANNELS, frames);
+	for (uint32_t i = 0; i < frames; i++) {
+		int64_t n = offset + i;
+		assert_true(buf[0][i] == (n < 0 ? 0.0f : (float)n));
+		assert_true(buf[1][i] == (n < 0 ? 0.0f : -(float)n));
+	}
+}
+
+static void wrap_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct audio_ring *ring = audio_ring_create(CHANNELS, CAPACITY);
+	assert_true(audio_ring_capacity(ring) == CAPACITY);
+
+	push(ring, 0, 700);
+	assert_true(audio_ring_size(ring) == 700);
+	check(ring, 0, 700);
+	audio_ring_pop(ring, 600);
+	audio_ring_release(ring, 0);
+
+	/* wraps around the end of the buffer */
+	push(ring, 700, 900);
+	assert_true(audio_ring_size(ring) == 1000);
+	check(ring, 600, 1000);
+
+	/* only 1024 - 1000 frames are free */
+	assert_true(audio_ring_needed(ring, audio_ring_end(ring), 25) == CAPACITY + 1);
+	const uint8_t *data[CHANNELS] = {(const uint8_t *)stream[0], (const uint8_t *)stream[1]};
+	assert_false(audio_ring_push_back(ring, data, 25));
+	assert_true(audio_ring_size(ring) == 1000);
+
+	audio_ring_pop(ring, 1000);
+	audio_ring_release(ring, 0);
+	assert_true(audio_ring_size(ring) == 0);
+
+	audio_ring_destroy(ring);
+}
+
+static void place_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct audio_ring *ring = audio_ring_create(CHANNELS, CAPACITY);
+	uint32_t base;
+	uint64_t ts;
+
+	audio_ring_get_base(ring, &base, &ts);
+	assert_true(base == 0);
+
+	/* a gap to the previous end is filled with silence */
+	place(ring, base + 100, 100, 50);
+	assert_true(audio_ring_end(ring) == base + 150);
+	assert_true(audio_ring_size(ring) == 150);
+	check(ring, -100, 100);
+	audio_ring_pop(ring, 100);
+	check(ring, 100, 50);
+
+	/* placing earlier overwrites and drops everything after it */
+	place(ring, base + 120, 500, 10);
+	assert_true(audio_ring_end(ring) == base + 130);
+	assert_true(audio_ring_size(ring) == 30);
+	check(ring, 100, 20);
+	audio_ring_pop(ring, 20);
+	check(ring, 500, 10);
+
+	/* data before the published read position is skipped */
+	audio_ring_pop(ring, 10);
+	audio_ring_release(ring, 0);
+	place(ring, base + 120, 120, 40);
+	assert_true(audio_ring_end(ring) == base + 160);
+	assert_true(audio_ring_size(ring) == 30);
+	check(ring, 130, 30);
+
+	audio_ring_destroy(ring);
+}
+
+static void reset_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct audio_ring *ring = audio_ring_create(CHANNELS, CAPACITY);
+	uint32_t base;
+	uint64_t ts;
+
+	push(ring, 0, 100);
+	audio_ring_release(ring, 1000);
+	assert_false(audio_ring_acquire(ring, &ts));
+
+	/* the producer sees the new timeline right away */
+	audio_ring_reset(ring, 5000);
+	audio_ring_get_base(ring, &base, &ts);
+	assert_true(base == 100);
+	assert_true(ts == 5000);
+	push(ring, 200, 50);
+
+	/* the consumer keeps reading the old one until it acquires */
+	assert_true(audio_ring_size(ring) == 100);
+	check(ring, 0, 100);
+	audio_ring_pop(ring, 40);
+
+	assert_true(audio_ring_acquire(ring, &ts));
+	assert_true(ts == 5000);
+	assert_true(audio_ring_size(ring) == 50);
+	check(ring, 200, 50);
+	assert_false(audio_ring_acquire(ring, &ts));
+
+	audio_ring_release(ring, 5000);
+	audio_ring_get_base(ring, &base, &ts);
+	assert_true(base == 100);
+	assert_true(ts == 5000);
+
+	audio_ring_clear(ring);
+	assert_true(audio_ring_size(ring) == 0);
+
+	audio_ring_destroy(ring);
+}
+
+static void copy_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct audio_ring *src = audio_ring_create(CHANNELS, CAPACITY);
+	struct audio_ring *dst = audio_ring_create(CHANNELS, 4 * CAPACITY);
+	uint64_t ts;
+
+	/* queued data that wraps in src */
+	push(src, 0, 900);
+	audio_ring_pop(src, 800);
+	audio_ring_release(src, 0);
+	push(src, 900, 600);
+
+	/* and a reset the consumer has not applied yet */
+	audio_ring_reset(src, 7000);
+	push(src, 2000, 100);
+
+	audio_ring_copy(dst, src);
+	assert_true(audio_ring_end(dst) == audio_ring_end(src));
+	assert_true(audio_ring_writes(dst) == audio_ring_writes(src));
+
+	/* the producer continues on dst before the consumer adopts it */
+	push(dst, 2100, 1000);
+
+	audio_ring_adopt(dst, src);
+	audio_ring_destroy(src);
+
+	assert_true(audio_ring_size(dst) == 700);
+	check(dst, 800, 700);
+	audio_ring_pop(dst, 700);
+
+	assert_true(audio_ring_acquire(dst, &ts));
+	assert_true(ts == 7000);
+	assert_true(audio_ring_size(dst) == 1100);
+	check(dst, 2000, 1024);
+
+	audio_ring_destroy(dst);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(wrap_test),
+		cmocka_unit_test(place_test),
+		cmocka_unit_test(reset_test),
+		cmocka_unit_test(copy_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, NULL);
+}
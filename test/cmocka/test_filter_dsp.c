@@ -0,0 +1,228 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/c99defs.h>
+#include <media-io/audio-dsp.h>
+
+#include "filter-dsp.h"
+
+/* not a multiple of the lane block, so the tails are covered too */
+#define FRAMES 1027
+#define CHANNELS 6
+#define STAGES 5
+
+/* the biquads are recursive, so rounding differences (e.g. from FMA
+ * contraction) accumulate a bit more than in a single multiply-add */
+#define TOLERANCE 1e-6f
+#define BIQUAD_TOLERANCE 1e-4f
+
+static float input[CHANNELS][FRAMES];
+static const float *in[CHANNELS];
+
+static void assert_close(const float *a, const float *b, size_t count, float tolerance)
+{
+	for (size_t i = 0; i < count; i++)
+		assert_true(fabsf(a[i] - b[i]) <= tolerance);
+}
+
+static void fill_input(void)
+{
+	uint32_t seed = 1;
+
+	for (size_t ch = 0; ch < CHANNELS; ch++) {
+		for (size_t i = 0; i < FRAMES; i++) {
+			seed = seed * 1664525 + 1013904223;
+			input[ch][i] = (float)(int32_t)seed / 2147483648.0f;
+		}
+		in[ch] = input[ch];
+	}
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+	fill_input();
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	return 0;
+}
+
+static void make_coeffs(struct biquad_coeffs *coeffs)
+{
+	biquad_lowpass(&coeffs[0], 48000.0f, 8000.0f, 0.707f);
+	biquad_highpass(&coeffs[1], 48000.0f, 80.0f, 0.707f);
+	biquad_peaking(&coeffs[2], 48000.0f, 1000.0f, 1.0f, 6.0f);
+	biquad_one_pole_lowpass(&coeffs[3], 0.1f);
+	biquad_peaking(&coeffs[4], 48000.0f, 300.0f, 2.0f, -4.0f);
+}
+
+static void biquad_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float scalar[CHANNELS][FRAMES], simd[CHANNELS][FRAMES];
+	float *scalar_out[CHANNELS], *simd_out[CHANNELS];
+	struct biquad_coeffs coeffs[STAGES];
+	struct biquad_cascade a, b;
+
+	for (size_t ch = 0; ch < CHANNELS; ch++) {
+		scalar_out[ch] = scalar[ch];
+		simd_out[ch] = simd[ch];
+	}
+
+	make_coeffs(coeffs);
+	biquad_cascade_init(&a, CHANNELS, coeffs, STAGES);
+	biquad_cascade_init(&b, CHANNELS, coeffs, STAGES);
+
+	/* two calls, so the state is carried over */
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	biquad_cascade_process(&a, scalar_out, in, 100);
+	biquad_cascade_process(&a, scalar_out, in, FRAMES);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	biquad_cascade_process(&b, simd_out, in, 100);
+	biquad_cascade_process(&b, simd_out, in, FRAMES);
+
+	assert_close(scalar[0], simd[0], CHANNELS * FRAMES, BIQUAD_TOLERANCE);
+	for (size_t s = 0; s < STAGES; s++) {
+		assert_close(a.z1[s], b.z1[s], CHANNELS, BIQUAD_TOLERANCE);
+		assert_close(a.z2[s], b.z2[s], CHANNELS, BIQUAD_TOLERANCE);
+	}
+
+	/* in place */
+	memcpy(simd, input, sizeof(simd));
+	biquad_cascade_reset(&b);
+	biquad_cascade_process(&b, simd_out, (const float *const *)simd_out, FRAMES);
+	biquad_cascade_reset(&a);
+	biquad_cascade_process(&a, scalar_out, in, FRAMES);
+	assert_close(scalar[0], simd[0], CHANNELS * FRAMES, BIQUAD_TOLERANCE);
+}
+
+static void envelope_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float expected[FRAMES], scalar[FRAMES], simd[FRAMES];
+	const float attack = 0.9f;
+	const float release = 0.999f;
+
+	/* the loop the compressor used to have */
+	memset(expected, 0, sizeof(expected));
+	for (size_t ch = 0; ch < CHANNELS; ch++) {
+		float env = 0.25f;
+		for (size_t i = 0; i < FRAMES; i++) {
+			const float env_in = fabsf(input[ch][i]);
+			if (env < env_in)
+				env = env_in + attack * (env - env_in);
+			else
+				env = env_in + release * (env - env_in);
+			expected[i] = fmaxf(expected[i], env);
+		}
+	}
+
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	float last = envelope_follow_linked(scalar, in, CHANNELS, FRAMES, attack, release, 0.25f);
+	assert_close(expected, scalar, FRAMES, TOLERANCE);
+	assert_true(fabsf(last - expected[FRAMES - 1]) <= TOLERANCE);
+
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	last = envelope_follow_linked(simd, in, CHANNELS, FRAMES, attack, release, 0.25f);
+	assert_close(expected, simd, FRAMES, TOLERANCE);
+	assert_true(fabsf(last - expected[FRAMES - 1]) <= TOLERANCE);
+}
+
+static void rms_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float scalar[CHANNELS][FRAMES], simd[CHANNELS][FRAMES];
+	float *scalar_out[CHANNELS], *simd_out[CHANNELS];
+	float scalar_state[CHANNELS] = {0}, simd_state[CHANNELS] = {0};
+
+	for (size_t ch = 0; ch < CHANNELS; ch++) {
+		scalar_out[ch] = scalar[ch];
+		simd_out[ch] = simd[ch];
+	}
+
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	envelope_rms(scalar_state, scalar_out, in, CHANNELS, FRAMES, 0.99f);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	envelope_rms(simd_state, simd_out, in, CHANNELS, FRAMES, 0.99f);
+
+	assert_close(scalar[0], simd[0], CHANNELS * FRAMES, TOLERANCE);
+	assert_close(scalar_state, simd_state, CHANNELS, TOLERANCE);
+	assert_true(scalar_state[2] > 0.0f);
+}
+
+static void peak_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float scalar[FRAMES], simd[FRAMES];
+
+	audio_dsp_set_impl(AUDIO_DSP_SCALAR);
+	peak_level(scalar, in, CHANNELS, FRAMES);
+	audio_dsp_set_impl(AUDIO_DSP_SIMD);
+	peak_level(simd, in, CHANNELS, FRAMES);
+
+	assert_close(scalar, simd, FRAMES, TOLERANCE);
+
+	float max = 0.0f;
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		max = fmaxf(max, fabsf(input[ch][9]));
+	assert_true(simd[9] == max);
+}
+
+static void lookahead_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const uint32_t blocks[] = {3, 1, 7, 5, 2, 20, 4};
+	const uint32_t delay = 5;
+	struct lookahead_buffer lb;
+	float buf[2][20];
+	float *data[2] = {buf[0], buf[1]};
+	uint32_t pos = 0;
+
+	lookahead_buffer_init(&lb, 2, delay);
+
+	for (size_t b = 0; pos + 20 < FRAMES; b = (b + 1) % 7) {
+		const uint32_t frames = blocks[b];
+
+		memcpy(buf[0], input[0] + pos, frames * sizeof(float));
+		memcpy(buf[1], input[1] + pos, frames * sizeof(float));
+		lookahead_buffer_process(&lb, data, frames);
+
+		for (uint32_t i = 0; i < frames; i++) {
+			const uint32_t n = pos + i;
+			assert_true(buf[0][i] == (n < delay ? 0.0f : input[0][n - delay]));
+			assert_true(buf[1][i] == (n < delay ? 0.0f : input[1][n - delay]));
+		}
+
+		pos += frames;
+	}
+
+	lookahead_buffer_free(&lb);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(biquad_test),
+		cmocka_unit_test(envelope_test),
+		cmocka_unit_test(rms_test),
+		cmocka_unit_test(peak_test),
+		cmocka_unit_test(lookahead_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
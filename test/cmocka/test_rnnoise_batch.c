@@ -0,0 +1,129 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <math.h>
+#include <cmocka.h>
+
+#include <rnnoise.h>
+
+#define FRAME_SIZE 480
+#define FRAMES 40
+/* more than one batch of the network, and not a multiple of it */
+#define STATES 11
+#define SILENT_STATE 3
+
+#define TOLERANCE 1e-5f
+
+static float input[STATES][FRAMES][FRAME_SIZE];
+
+/* a tone with noise on top, different for every state */
+static void fill_input(void)
+{
+	uint32_t seed = 1;
+
+	for (size_t st = 0; st < STATES; st++) {
+		const float freq = 150.0f * (float)(st + 1);
+
+		for (size_t f = 0; f < FRAMES; f++) {
+			for (size_t i = 0; i < FRAME_SIZE; i++) {
+				const size_t n = f * FRAME_SIZE + i;
+
+				seed = seed * 1664525 + 1013904223;
+				float noise = (float)(int32_t)seed / 2147483648.0f;
+				float tone = sinf(2.0f * 3.14159265f * freq * (float)n / 48000.0f);
+
+				input[st][f][i] = 0.3f * tone + 0.05f * noise;
+			}
+		}
+	}
+
+	/* silent for a while, which takes it out of the batch */
+	for (size_t f = 10; f < 20; f++)
+		for (size_t i = 0; i < FRAME_SIZE; i++)
+			input[SILENT_STATE][f][i] = 0.0f;
+}
+
+static void batch_test(void **state)
+{
+	(void)state;
+
+	DenoiseState *single[STATES], *batched[STATES];
+	static float single_out[FRAME_SIZE], batched_out[STATES][FRAME_SIZE];
+	float *out[STATES];
+	const float *in[STATES];
+	float vad[STATES];
+
+	fill_input();
+
+	for (size_t st = 0; st < STATES; st++) {
+		single[st] = rnnoise_create(NULL);
+		batched[st] = rnnoise_create(NULL);
+		out[st] = batched_out[st];
+	}
+
+	for (size_t f = 0; f < FRAMES; f++) {
+		for (size_t st = 0; st < STATES; st++)
+			in[st] = input[st][f];
+
+		rnnoise_process_frames(batched, out, in, vad, STATES, 32768.0f);
+
+		for (size_t st = 0; st < STATES; st++) {
+			float scaled[FRAME_SIZE];
+
+			for (size_t i = 0; i < FRAME_SIZE; i++)
+				scaled[i] = input[st][f][i] * 32768.0f;
+
+			float single_vad = rnnoise_process_frame(single[st], single_out, scaled);
+
+			assert_true(fabsf(single_vad - vad[st]) <= TOLERANCE);
+			for (size_t i = 0; i < FRAME_SIZE; i++)
+				assert_true(fabsf(single_out[i] / 32768.0f - batched_out[st][i]) <= TOLERANCE);
+		}
+	}
+
+	for (size_t st = 0; st < STATES; st++) {
+		rnnoise_destroy(single[st]);
+		rnnoise_destroy(batched[st]);
+	}
+}
+
+/* the filter processes its buffers in place */
+static void in_place_test(void **state)
+{
+	(void)state;
+
+	DenoiseState *a = rnnoise_create(NULL);
+	DenoiseState *b = rnnoise_create(NULL);
+	static float buf[FRAME_SIZE], expected[FRAME_SIZE];
+	float *out[1] = {buf};
+	const float *in[1] = {buf};
+
+	fill_input();
+
+	for (size_t f = 0; f < FRAMES; f++) {
+		for (size_t i = 0; i < FRAME_SIZE; i++) {
+			buf[i] = input[0][f][i];
+			expected[i] = input[0][f][i] * 32768.0f;
+		}
+
+		rnnoise_process_frames(&a, out, in, NULL, 1, 32768.0f);
+		rnnoise_process_frame(b, expected, expected);
+
+		for (size_t i = 0; i < FRAME_SIZE; i++)
+			assert_true(fabsf(expected[i] / 32768.0f - buf[i]) <= TOLERANCE);
+	}
+
+	rnnoise_destroy(a);
+	rnnoise_destroy(b);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(batch_test),
+		cmocka_unit_test(in_place_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,172 @@
+#include <obs-module.h>
+#include <util/threading.h>
+#include <util/platform.h>
+#include <inttypes.h>
+
+/*
+ * Audio latency benchmark: outputs an impulse every half second and watches
+ * the first mix for it, logging how long it took from obs_source_output_audio
+ * to the mix callbacks.  That is mostly the audio buffering plus one or two
+ * audio ticks, so it is meant to be compared between frames_per_tick
+ * settings.  Use it in an otherwise silent scene.
+ */
+
+#define CHUNK_NS 2000000ULL
+#define IMPULSE_INTERVAL 250
+#define LOG_INTERVAL 20
+
+struct audio_latency {
+	obs_source_t *source;
+	os_event_t *stop_signal;
+	pthread_t thread;
+	bool initialized;
+
+	/* os_gettime_ns() of the last impulse sent, 0 once it was seen */
+	pthread_mutex_t impulse_mutex;
+	uint64_t impulse_sent;
+
+	uint64_t total_ns;
+	uint64_t worst_ns;
+	uint64_t best_ns;
+	uint32_t count;
+};
+
+static const char *latency_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Audio Latency Benchmark";
+}
+
+static void latency_mix_callback(void *param, size_t mix_idx, struct audio_data *data)
+{
+	struct audio_latency *al = param;
+	const float *samples = (const float *)data->data[0];
+	uint64_t sent;
+
+	pthread_mutex_lock(&al->impulse_mutex);
+	sent = al->impulse_sent;
+	pthread_mutex_unlock(&al->impulse_mutex);
+
+	if (!sent)
+		return;
+
+	for (uint32_t i = 0; i < data->frames; i++) {
+		if (samples[i] < 0.5f)
+			continue;
+
+		uint64_t latency = os_gettime_ns() - sent;
+
+		pthread_mutex_lock(&al->impulse_mutex);
+		al->impulse_sent = 0;
+		pthread_mutex_unlock(&al->impulse_mutex);
+
+		al->total_ns += latency;
+		if (latency > al->worst_ns)
+			al->worst_ns = latency;
+		if (!al->best_ns || latency < al->best_ns)
+			al->best_ns = latency;
+
+		if (++al->count == LOG_INTERVAL) {
+			blog(LOG_INFO,
+			     "[audio latency] %" PRIu32 " frames per tick: "
+			     "%.3f ms avg, %.3f ms best, %.3f ms worst",
+			     audio_output_get_frames(obs_get_audio()), al->total_ns / 1000000.0 / al->count,
+			     al->best_ns / 1000000.0, al->worst_ns / 1000000.0);
+			al->total_ns = al->worst_ns = al->best_ns = 0;
+			al->count = 0;
+		}
+		break;
+	}
+
+	UNUSED_PARAMETER(mix_idx);
+}
+
+static void *latency_thread(void *data)
+{
+	struct audio_latency *al = data;
+	uint32_t sample_rate = audio_output_get_sample_rate(obs_get_audio());
+	uint32_t frames = (uint32_t)(sample_rate * CHUNK_NS / 1000000000ULL);
+	float *samples = bzalloc(frames * sizeof(float));
+	uint64_t cur_time = os_gettime_ns();
+	uint32_t chunks = 0;
+
+	while (os_event_try(al->stop_signal) == EAGAIN) {
+		bool impulse = ++chunks == IMPULSE_INTERVAL;
+		samples[0] = impulse ? 1.0f : 0.0f;
+
+		struct obs_source_audio audio = {
+			.data = {[0] = (uint8_t *)samples},
+			.frames = frames,
+			.speakers = SPEAKERS_MONO,
+			.format = AUDIO_FORMAT_FLOAT,
+			.samples_per_sec = sample_rate,
+			.timestamp = cur_time,
+		};
+
+		if (impulse) {
+			pthread_mutex_lock(&al->impulse_mutex);
+			al->impulse_sent = os_gettime_ns();
+			pthread_mutex_unlock(&al->impulse_mutex);
+			chunks = 0;
+		}
+
+		obs_source_output_audio(al->source, &audio);
+		os_sleepto_ns(cur_time += CHUNK_NS);
+	}
+
+	bfree(samples);
+	return NULL;
+}
+
+static void latency_destroy(void *data)
+{
+	struct audio_latency *al = data;
+
+	if (al->initialized) {
+		os_event_signal(al->stop_signal);
+		pthread_join(al->thread, NULL);
+		obs_remove_raw_audio_callback(0, latency_mix_callback, al);
+	}
+
+	pthread_mutex_destroy(&al->impulse_mutex);
+	os_event_destroy(al->stop_signal);
+	bfree(al);
+}
+
+static void *latency_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct audio_latency *al = bzalloc(sizeof(struct audio_latency));
+	al->source = source;
+	pthread_mutex_init_value(&al->impulse_mutex);
+
+	if (pthread_mutex_init(&al->impulse_mutex, NULL) != 0) {
+		latency_destroy(al);
+		return NULL;
+	}
+	if (os_event_init(&al->stop_signal, OS_EVENT_TYPE_MANUAL) != 0) {
+		latency_destroy(al);
+		return NULL;
+	}
+
+	obs_add_raw_audio_callback(0, NULL, latency_mix_callback, al);
+
+	if (pthread_create(&al->thread, NULL, latency_thread, al) != 0) {
+		obs_remove_raw_audio_callback(0, latency_mix_callback, al);
+		latency_destroy(al);
+		return NULL;
+	}
+
+	al->initialized = true;
+
+	UNUSED_PARAMETER(settings);
+	return al;
+}
+
+struct obs_source_info sync_audio_latency = {
+	.id = "sync_audio_latency",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO,
+	.get_name = latency_getname,
+	.create = latency_create,
+	.destroy = latency_destroy,
+};
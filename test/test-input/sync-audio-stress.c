@@ -0,0 +1,199 @@
+#include <math.h>
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include <util/platform.h>
+
+/*
+ * Audio input stress test: runs a number of private "sync_audio" sources
+ * alongside a producer of its own, and keeps moving their sync offsets so
+ * that input is placed out of order, reset, and buffered far ahead.  The
+ * producer times its obs_source_output_audio calls and logs the worst one
+ * every few seconds; with audio input being lock-free towards the audio
+ * thread, that should stay well below a millisecond regardless of what the
+ * audio thread is doing.
+ */
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#define CHUNK_NS 10000000ULL
+#define LOG_INTERVAL 500
+#define MAX_OFFSET_MS 2000
+
+struct audio_stress {
+	obs_source_t *source;
+	os_event_t *stop_signal;
+	pthread_t thread;
+	bool initialized;
+
+	DARRAY(obs_source_t *) children;
+	bool jitter;
+};
+
+static const char *stress_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Audio Input Stress Test";
+}
+
+static void stress_jitter(struct audio_stress *as, uint32_t step)
+{
+	for (size_t i = 0; i < as->children.num; i++) {
+		/* spread the offsets out, and every so often jump back to
+		 * zero to force a reset */
+		int64_t offset_ms = (int64_t)(((step + i * 7) * 37) % MAX_OFFSET_MS);
+		if ((step + i) % 16 == 0)
+			offset_ms = 0;
+
+		obs_source_set_sync_offset(as->children.array[i], offset_ms * 1000000);
+	}
+
+	if (step % 32 == 0)
+		obs_source_set_async_decoupled(as->source, !obs_source_async_decoupled(as->source));
+}
+
+static void *stress_thread(void *data)
+{
+	struct audio_stress *as = data;
+	uint32_t sample_rate = audio_output_get_sample_rate(obs_get_audio());
+	uint32_t frames = sample_rate / 100;
+	float *samples = bzalloc(frames * sizeof(float));
+	uint64_t cur_time = os_gettime_ns();
+	uint64_t worst_ns = 0;
+	uint64_t total_ns = 0;
+	uint32_t chunks = 0;
+	uint32_t step = 0;
+	double phase = 0.0;
+
+	while (os_event_try(as->stop_signal) == EAGAIN) {
+		for (uint32_t i = 0; i < frames; i++) {
+			samples[i] = (float)(sin(phase) * 0.25);
+			phase += 2.0 * M_PI * 440.0 / sample_rate;
+		}
+		phase = fmod(phase, 2.0 * M_PI);
+
+		struct obs_source_audio audio = {
+			.data = {[0] = (uint8_t *)samples},
+			.frames = frames,
+			.speakers = SPEAKERS_MONO,
+			.format = AUDIO_FORMAT_FLOAT,
+			.samples_per_sec = sample_rate,
+			.timestamp = cur_time,
+		};
+
+		uint64_t start = os_gettime_ns();
+		obs_source_output_audio(as->source, &audio);
+		uint64_t elapsed = os_gettime_ns() - start;
+
+		total_ns += elapsed;
+		if (elapsed > worst_ns)
+			worst_ns = elapsed;
+
+		if (as->jitter && chunks % 25 == 0)
+			stress_jitter(as, step++);
+
+		if (++chunks == LOG_INTERVAL) {
+			blog(LOG_INFO, "[audio stress] output: %.3f us avg, %.3f us worst", total_ns / 1000.0 / chunks,
+			     worst_ns / 1000.0);
+			worst_ns = 0;
+			total_ns = 0;
+			chunks = 0;
+		}
+
+		os_sleepto_ns(cur_time += CHUNK_NS);
+	}
+
+	bfree(samples);
+	return NULL;
+}
+
+static void stress_destroy(void *data)
+{
+	struct audio_stress *as = data;
+
+	if (as->initialized) {
+		os_event_signal(as->stop_signal);
+		pthread_join(as->thread, NULL);
+	}
+
+	for (size_t i = 0; i < as->children.num; i++) {
+		obs_source_remove_active_child(as->source, as->children.array[i]);
+		obs_source_release(as->children.array[i]);
+	}
+
+	da_free(as->children);
+	os_event_destroy(as->stop_signal);
+	bfree(as);
+}
+
+static void *stress_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct audio_stress *as = bzalloc(sizeof(struct audio_stress));
+	const uint32_t count = (uint32_t)obs_data_get_int(settings, "count");
+
+	as->source = source;
+	as->jitter = obs_data_get_bool(settings, "jitter");
+
+	for (uint32_t i = 0; i < count; i++) {
+		obs_source_t *child = obs_source_create_private("sync_audio", "audio stress child", NULL);
+		if (!child)
+			break;
+
+		obs_source_add_active_child(source, child);
+		da_push_back(as->children, &child);
+	}
+
+	blog(LOG_INFO, "[audio stress] %zu producers, jitter: %s", as->children.num + 1, as->jitter ? "yes" : "no");
+
+	if (os_event_init(&as->stop_signal, OS_EVENT_TYPE_MANUAL) != 0) {
+		stress_destroy(as);
+		return NULL;
+	}
+
+	if (pthread_create(&as->thread, NULL, stress_thread, as) != 0) {
+		stress_destroy(as);
+		return NULL;
+	}
+
+	as->initialized = true;
+	return as;
+}
+
+static void stress_enum_sources(void *data, obs_source_enum_proc_t enum_callback, void *param)
+{
+	struct audio_stress *as = data;
+
+	for (size_t i = 0; i < as->children.num; i++)
+		enum_callback(as->source, as->children.array[i], param);
+}
+
+static void stress_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "count", 32);
+	obs_data_set_default_bool(settings, "jitter", true);
+}
+
+static obs_properties_t *stress_properties(void *unused)
+{
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_int(props, "count", "Additional producers", 0, 256, 1);
+	obs_properties_add_bool(props, "jitter", "Move sync offsets around");
+
+	UNUSED_PARAMETER(unused);
+	return props;
+}
+
+struct obs_source_info sync_audio_stress = {
+	.id = "sync_audio_stress",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_DO_NOT_DUPLICATE,
+	.get_name = stress_getname,
+	.create = stress_create,
+	.destroy = stress_destroy,
+	.get_defaults = stress_defaults,
+	.get_properties = stress_properties,
+	.enum_active_sources = stress_enum_sources,
+};
@@ -9,6 +9,11 @@ extern struct obs_source_info async_sync_test;
 extern struct obs_source_info buffering_async_sync_test;
 extern struct obs_source_info sync_video;
 extern struct obs_source_info sync_audio;
+extern struct obs_source_info sync_audio_stress;
+extern struct obs_source_info sync_audio_latency;
+extern struct obs_source_info sprite_grid_cell;
+extern struct obs_source_info sprite_grid_bench;
+extern struct obs_source_info test_interlaced;
 
 bool obs_module_load(void)
 {
@@ -19,5 +24,10 @@ bool obs_module_load(void)
 	obs_register_source(&buffering_async_sync_test);
 	obs_register_source(&sync_video);
 	obs_register_source(&sync_audio);
+	obs_register_source(&sync_audio_stress);
+	obs_register_source(&sync_audio_latency);
+	obs_register_source(&sprite_grid_cell);
+	obs_register_source(&sprite_grid_bench);
+	obs_register_source(&test_interlaced);
 	return true;
 }
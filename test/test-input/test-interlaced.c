@@ -0,0 +1,174 @@
+#include <util/threading.h>
+#include <util/platform.h>
+#include <obs-module.h>
+
+/*
+ * Synthetic interlaced capture: outputs UYVY frames whose two fields show a
+ * vertical bar at different positions, as a capture card would deliver them
+ * from an interlaced signal.  Deinterlacing is enabled on the source itself,
+ * so a correctly deinterlaced picture shows one sharp bar moving at field
+ * rate, and any field order or history mistake shows up as combing or the
+ * bar stepping backwards.
+ */
+
+#define BAR_WIDTH 32
+
+struct interlaced_src {
+	obs_source_t *source;
+	os_event_t *stop_signal;
+	pthread_t thread;
+	bool initialized;
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t fps;
+	bool top_first;
+};
+
+static const char *interlaced_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Synthetic Interlaced Source (Test)";
+}
+
+static void fill_field(uint8_t *data, uint32_t width, uint32_t height, uint32_t first_line, uint32_t bar_x)
+{
+	const uint32_t linesize = width * 2;
+
+	for (uint32_t y = first_line; y < height; y += 2) {
+		uint8_t *line = data + (size_t)y * linesize;
+
+		for (uint32_t x = 0; x < width; x += 2) {
+			const bool bar = x >= bar_x && x < bar_x + BAR_WIDTH;
+			const uint8_t luma = bar ? 235 : 16;
+
+			line[x * 2 + 0] = 128;
+			line[x * 2 + 1] = luma;
+			line[x * 2 + 2] = 128;
+			line[x * 2 + 3] = luma;
+		}
+	}
+}
+
+static void *interlaced_thread(void *data)
+{
+	struct interlaced_src *is = data;
+	const uint32_t width = is->width;
+	const uint32_t height = is->height;
+	const uint64_t interval = 1000000000ULL / is->fps;
+	const uint32_t travel = width - BAR_WIDTH;
+	uint8_t *pixels = bmalloc((size_t)width * height * 2);
+	uint64_t cur_time = os_gettime_ns();
+	uint32_t field = 0;
+
+	struct obs_source_frame frame = {
+		.data = {[0] = pixels},
+		.linesize = {[0] = width * 2},
+		.width = width,
+		.height = height,
+		.format = VIDEO_FORMAT_UYVY,
+	};
+
+	video_format_get_parameters_for_format(VIDEO_CS_709, VIDEO_RANGE_PARTIAL, VIDEO_FORMAT_UYVY,
+					       frame.color_matrix, frame.color_range_min, frame.color_range_max);
+
+	while (os_event_try(is->stop_signal) == EAGAIN) {
+		/* the first field in time goes on the lines the field order
+		 * says are displayed first */
+		fill_field(pixels, width, height, is->top_first ? 0 : 1, (field * 8) % travel);
+		fill_field(pixels, width, height, is->top_first ? 1 : 0, ((field + 1) * 8) % travel);
+		field += 2;
+
+		frame.timestamp = cur_time;
+		obs_source_output_video(is->source, &frame);
+
+		os_sleepto_ns(cur_time += interval);
+	}
+
+	bfree(pixels);
+	return NULL;
+}
+
+static void interlaced_destroy(void *data)
+{
+	struct interlaced_src *is = data;
+
+	if (is->initialized) {
+		os_event_signal(is->stop_signal);
+		pthread_join(is->thread, NULL);
+	}
+
+	os_event_destroy(is->stop_signal);
+	bfree(is);
+}
+
+static void *interlaced_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct interlaced_src *is = bzalloc(sizeof(struct interlaced_src));
+	is->source = source;
+	is->width = (uint32_t)obs_data_get_int(settings, "width") & ~1U;
+	is->height = (uint32_t)obs_data_get_int(settings, "height") & ~1U;
+	is->fps = (uint32_t)obs_data_get_int(settings, "fps");
+	is->top_first = obs_data_get_bool(settings, "top_first");
+
+	obs_source_set_deinterlace_mode(source, (enum obs_deinterlace_mode)obs_data_get_int(settings, "mode"));
+	obs_source_set_deinterlace_field_order(source, is->top_first ? OBS_DEINTERLACE_FIELD_ORDER_TOP
+								     : OBS_DEINTERLACE_FIELD_ORDER_BOTTOM);
+
+	if (os_event_init(&is->stop_signal, OS_EVENT_TYPE_MANUAL) != 0) {
+		interlaced_destroy(is);
+		return NULL;
+	}
+
+	if (pthread_create(&is->thread, NULL, interlaced_thread, is) != 0) {
+		interlaced_destroy(is);
+		return NULL;
+	}
+
+	is->initialized = true;
+	return is;
+}
+
+static void interlaced_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "width", 1920);
+	obs_data_set_default_int(settings, "height", 1080);
+	obs_data_set_default_int(settings, "fps", 30);
+	obs_data_set_default_bool(settings, "top_first", true);
+	obs_data_set_default_int(settings, "mode", OBS_DEINTERLACE_MODE_YADIF_2X);
+}
+
+static obs_properties_t *interlaced_properties(void *unused)
+{
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_int(props, "width", "Width", 64, 3840, 2);
+	obs_properties_add_int(props, "height", "Height", 64, 2160, 2);
+	obs_properties_add_int(props, "fps", "Frames per second", 1, 60, 1);
+	obs_properties_add_bool(props, "top_first", "Top field first");
+
+	obs_property_t *mode =
+		obs_properties_add_list(props, "mode", "Deinterlacing", OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(mode, "Discard", OBS_DEINTERLACE_MODE_DISCARD);
+	obs_property_list_add_int(mode, "Retro", OBS_DEINTERLACE_MODE_RETRO);
+	obs_property_list_add_int(mode, "Blend", OBS_DEINTERLACE_MODE_BLEND);
+	obs_property_list_add_int(mode, "Blend 2x", OBS_DEINTERLACE_MODE_BLEND_2X);
+	obs_property_list_add_int(mode, "Linear", OBS_DEINTERLACE_MODE_LINEAR);
+	obs_property_list_add_int(mode, "Linear 2x", OBS_DEINTERLACE_MODE_LINEAR_2X);
+	obs_property_list_add_int(mode, "Yadif", OBS_DEINTERLACE_MODE_YADIF);
+	obs_property_list_add_int(mode, "Yadif 2x", OBS_DEINTERLACE_MODE_YADIF_2X);
+
+	UNUSED_PARAMETER(unused);
+	return props;
+}
+
+struct obs_source_info test_interlaced = {
+	.id = "test_interlaced",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_ASYNC_VIDEO | OBS_SOURCE_DO_NOT_DUPLICATE,
+	.get_name = interlaced_getname,
+	.create = interlaced_create,
+	.destroy = interlaced_destroy,
+	.get_defaults = interlaced_defaults,
+	.get_properties = interlaced_properties,
+};
@@ -0,0 +1,246 @@
+#include <obs-module.h>
+#include <util/platform.h>
+
+/*
+ * Benchmark scene generator: builds a private scene with a grid of items that
+ * all show the same small source and logs how long rendering it takes.  With
+ * "crop" enabled, the items render through their item textures and can be
+ * batched; "vary" gives every other item a different crop so that runs of
+ * compatible items are broken up, for comparison.
+ */
+
+#define CELL_TEX_SIZE 16
+#define LOG_INTERVAL 300
+
+struct sprite_cell {
+	gs_texture_t *tex;
+	uint32_t size;
+};
+
+struct sprite_grid {
+	obs_source_t *source;
+	obs_source_t *cell;
+	obs_scene_t *scene;
+	uint32_t cx, cy;
+
+	uint64_t render_ns;
+	uint32_t frames;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static const char *cell_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Sprite Grid Cell (Test)";
+}
+
+static void cell_destroy(void *data)
+{
+	struct sprite_cell *cell = data;
+
+	obs_enter_graphics();
+	gs_texture_destroy(cell->tex);
+	obs_leave_graphics();
+
+	bfree(cell);
+}
+
+static void *cell_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct sprite_cell *cell = bzalloc(sizeof(struct sprite_cell));
+	uint32_t pixels[CELL_TEX_SIZE * CELL_TEX_SIZE];
+
+	for (size_t y = 0; y < CELL_TEX_SIZE; y++) {
+		for (size_t x = 0; x < CELL_TEX_SIZE; x++)
+			pixels[y * CELL_TEX_SIZE + x] = ((x ^ y) & 4) ? 0xFF3080F0 : 0xFFF0F0F0;
+	}
+
+	const uint8_t *data = (const uint8_t *)pixels;
+
+	obs_enter_graphics();
+	cell->tex = gs_texture_create(CELL_TEX_SIZE, CELL_TEX_SIZE, GS_RGBA, 1, &data, 0);
+	obs_leave_graphics();
+
+	cell->size = (uint32_t)obs_data_get_int(settings, "size");
+
+	UNUSED_PARAMETER(source);
+	return cell;
+}
+
+static void cell_render(void *data, gs_effect_t *effect)
+{
+	struct sprite_cell *cell = data;
+
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), cell->tex);
+	gs_draw_sprite(cell->tex, 0, cell->size, cell->size);
+}
+
+static uint32_t cell_getsize(void *data)
+{
+	struct sprite_cell *cell = data;
+	return cell->size;
+}
+
+struct obs_source_info sprite_grid_cell = {
+	.id = "sprite_grid_cell",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_DISABLED,
+	.get_name = cell_getname,
+	.create = cell_create,
+	.destroy = cell_destroy,
+	.video_render = cell_render,
+	.get_width = cell_getsize,
+	.get_height = cell_getsize,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static const char *grid_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Sprite Grid Benchmark (Test)";
+}
+
+static void grid_free_scene(struct sprite_grid *grid)
+{
+	if (grid->scene) {
+		obs_source_remove_active_child(grid->source, obs_scene_get_source(grid->scene));
+		obs_scene_release(grid->scene);
+		grid->scene = NULL;
+	}
+
+	obs_source_release(grid->cell);
+	grid->cell = NULL;
+}
+
+static void grid_destroy(void *data)
+{
+	struct sprite_grid *grid = data;
+
+	grid_free_scene(grid);
+	bfree(grid);
+}
+
+static void grid_update(void *data, obs_data_t *settings)
+{
+	struct sprite_grid *grid = data;
+	const uint32_t count = (uint32_t)obs_data_get_int(settings, "count");
+	const uint32_t size = (uint32_t)obs_data_get_int(settings, "size");
+	const bool crop = obs_data_get_bool(settings, "crop");
+	const bool vary = obs_data_get_bool(settings, "vary");
+
+	grid_free_scene(grid);
+
+	obs_data_t *cell_settings = obs_data_create();
+	obs_data_set_int(cell_settings, "size", size);
+	grid->cell = obs_source_create_private("sprite_grid_cell", "sprite grid cell", cell_settings);
+	obs_data_release(cell_settings);
+
+	grid->scene = obs_scene_create_private("sprite grid");
+
+	uint32_t columns = 1;
+	while (columns * columns < count)
+		columns++;
+
+	for (uint32_t i = 0; i < count; i++) {
+		obs_sceneitem_t *item = obs_scene_add(grid->scene, grid->cell);
+		struct vec2 pos;
+
+		vec2_set(&pos, (float)((i % columns) * size), (float)((i / columns) * size));
+		obs_sceneitem_set_pos(item, &pos);
+
+		if (crop) {
+			struct obs_sceneitem_crop item_crop = {1, 1, 1, 1};
+			if (vary && (i & 1))
+				item_crop.left = 2;
+			obs_sceneitem_set_crop(item, &item_crop);
+		}
+	}
+
+	obs_source_add_active_child(grid->source, obs_scene_get_source(grid->scene));
+
+	grid->cx = columns * size;
+	grid->cy = ((count + columns - 1) / columns) * size;
+	grid->render_ns = 0;
+	grid->frames = 0;
+
+	blog(LOG_INFO, "[sprite grid] %u items of %ux%u, crop: %s, vary: %s", count, size, size, crop ? "yes" : "no",
+	     vary ? "yes" : "no");
+}
+
+static void *grid_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct sprite_grid *grid = bzalloc(sizeof(struct sprite_grid));
+	grid->source = source;
+	grid_update(grid, settings);
+	return grid;
+}
+
+static void grid_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "count", 400);
+	obs_data_set_default_int(settings, "size", 32);
+	obs_data_set_default_bool(settings, "crop", true);
+	obs_data_set_default_bool(settings, "vary", false);
+}
+
+static obs_properties_t *grid_properties(void *unused)
+{
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_int(props, "count", "Items", 1, 10000, 1);
+	obs_properties_add_int(props, "size", "Item size", 4, 512, 1);
+	obs_properties_add_bool(props, "crop", "Crop items (render through item textures)");
+	obs_properties_add_bool(props, "vary", "Alternate crop (breaks up batches)");
+
+	UNUSED_PARAMETER(unused);
+	return props;
+}
+
+static void grid_render(void *data, gs_effect_t *effect)
+{
+	struct sprite_grid *grid = data;
+
+	if (!grid->scene)
+		return;
+
+	uint64_t start = os_gettime_ns();
+	obs_source_video_render(obs_scene_get_source(grid->scene));
+	grid->render_ns += os_gettime_ns() - start;
+
+	if (++grid->frames == LOG_INTERVAL) {
+		blog(LOG_INFO, "[sprite grid] render: %.3f ms/frame", (double)grid->render_ns / LOG_INTERVAL / 1000000.0);
+		grid->render_ns = 0;
+		grid->frames = 0;
+	}
+
+	UNUSED_PARAMETER(effect);
+}
+
+static uint32_t grid_getwidth(void *data)
+{
+	struct sprite_grid *grid = data;
+	return grid->cx;
+}
+
+static uint32_t grid_getheight(void *data)
+{
+	struct sprite_grid *grid = data;
+	return grid->cy;
+}
+
+struct obs_source_info sprite_grid_bench = {
+	.id = "sprite_grid_bench",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW,
+	.get_name = grid_getname,
+	.create = grid_create,
+	.destroy = grid_destroy,
+	.update = grid_update,
+	.get_defaults = grid_defaults,
+	.get_properties = grid_properties,
+	.video_render = grid_render,
+	.get_width = grid_getwidth,
+	.get_height = grid_getheight,
+};